@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "bilateral.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    BilateralGrid::BilateralGrid() : grid_w_(0), grid_h_(0), grid_d_(0)
+    {
+      for (auto& g : grid_) {
+	g.bind(0, GL_TEXTURE_3D);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+      }
+      glBindTexture(GL_TEXTURE_3D, 0);
+    }
+
+    bool BilateralGrid::init()
+    {
+      using Names = std::vector<std::string>;
+
+      if (!splat_prog_.build_program_from_files(Names{ "shader/bilateral_splat.cs" })) {
+	return false;
+      }
+      if (!blur_prog_.build_program_from_files(Names{ "shader/bilateral_blur.cs" })) {
+	return false;
+      }
+      if (!slice_prog_.build_program_from_files(Names{ "shader/bilateral_slice.cs" })) {
+	return false;
+      }
+
+      return true;
+    }
+
+#define WORKGROUP_SIZE 16
+#define BLUR_WORKGROUP_SIZE 4
+    void BilateralGrid::apply(int sigma_s, float sigma_r, const Texture& src, const Texture& dst)
+    {
+      sigma_s = std::max(sigma_s, 1);
+      // 輝度[0, 1]をsigma_r刻み(両端を含む)
+      const int bins = std::min(static_cast<int>(std::ceil(1.f / sigma_r)) + 1, static_cast<int>(max_range_bins_));
+      sigma_r = 1.f / (bins - 1);
+      const int w = (src.width() + sigma_s - 1) / sigma_s;
+      const int h = (src.height() + sigma_s - 1) / sigma_s;
+      if (w != grid_w_ || h != grid_h_ || bins != grid_d_) {
+	for (auto& g : grid_) {
+	  g.bind(0, GL_TEXTURE_3D);
+	  glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA32F, w, h, bins, 0, GL_RGBA, GL_FLOAT, nullptr);
+	}
+	glBindTexture(GL_TEXTURE_3D, 0);
+	grid_w_ = w; grid_h_ = h; grid_d_ = bins;
+      }
+
+      splat_prog_.use();
+      splat_prog_.set_uniform("sigma_s", sigma_s);
+      splat_prog_.set_uniform("sigma_r", sigma_r);
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, grid_[0].handle(), 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+      // 格子の1列に1 workgroup
+      glDispatchCompute(w, h, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+      // x : 0 -> 1, y : 1 -> 0, 輝度 : 0 -> 1
+      blur_prog_.use();
+      for (int axis = 0; axis < 3; ++axis) {
+	blur_prog_.set_uniform("axis", axis);
+	glBindImageTexture(0, grid_[axis & 1].handle(), 0, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA32F);
+	glBindImageTexture(1, grid_[(axis + 1) & 1].handle(), 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	glDispatchCompute((w + BLUR_WORKGROUP_SIZE - 1) / BLUR_WORKGROUP_SIZE,
+			  (h + BLUR_WORKGROUP_SIZE - 1) / BLUR_WORKGROUP_SIZE,
+			  (bins + BLUR_WORKGROUP_SIZE - 1) / BLUR_WORKGROUP_SIZE);
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+      }
+
+      slice_prog_.use();
+      slice_prog_.set_uniform("sigma_s", sigma_s);
+      slice_prog_.set_uniform("sigma_r", sigma_r);
+      grid_[1].bind(0, GL_TEXTURE_3D);
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+  }
+}
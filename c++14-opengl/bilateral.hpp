@@ -0,0 +1,66 @@
+#ifndef INCLUDED_BILATERAL_HPP
+#define INCLUDED_BILATERAL_HPP
+
+#include <glad/glad.h>
+
+#include "program.hpp"
+#include "texture.hpp"
+#include "globject.hpp"
+#include "filtergraph.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // bilateral grid(Chen, Paris, Durand)によるbilateral filter
+    // 画像を(空間sigma_s画素, 輝度sigma_r)刻みの3次元格子に縮小して
+    // 1. shader/bilateral_splat.cs : 各画素の(rgb, 1)を格子へ足し込む(輝度方向は線形に分配)
+    // 2. shader/bilateral_blur.cs : 格子をx, y, 輝度の順に[1 4 6 4 1]でぼかす
+    // 3. shader/bilateral_slice.cs : 各画素の(位置, 輝度)で格子を3次元線形補間して重みで割る
+    // 画素あたりの手間はsigma_sによらない(格子の大きさは画素数 / sigma_s^2 x 1 / sigma_r)
+    // 輝度を境界の判定に使う(色毎には分けない). alphaは1
+    class BilateralGrid {
+    public:
+      BilateralGrid();
+      ~BilateralGrid() = default;
+
+      BilateralGrid(const BilateralGrid&) = delete;
+      BilateralGrid& operator=(const BilateralGrid&) = delete;
+
+      bool init();
+
+      // sigma_sは画素数, sigma_rは輝度(0-1)
+      void apply(int sigma_s, float sigma_r, const Texture& src, const Texture& dst);
+
+      static const int max_range_bins_ = 64; // shader/bilateral_splat.csのMAX_BINS
+    private:
+      Program splat_prog_;
+      Program blur_prog_;
+      Program slice_prog_;
+      gl::Texture grid_[2]; // RGBA32F (rgb * 重み, 重み)
+      int grid_w_, grid_h_, grid_d_;
+    };
+
+    // FilterGraph用
+    class BilateralFilter : public FilterNode {
+    public:
+      BilateralFilter(BilateralGrid& grid, int sigma_s, float sigma_r)
+	: grid_(grid), sigma_s_(sigma_s), sigma_r_(sigma_r) {}
+
+      void set_sigma(int sigma_s, float sigma_r) { sigma_s_ = sigma_s; sigma_r_ = sigma_r; }
+
+      size_t hash() const override
+      {
+	return hash_bytes(hash_combine(reinterpret_cast<size_t>(&grid_), sigma_s_), &sigma_r_);
+      }
+      void apply(const Texture& src, const Texture& dst) override { grid_.apply(sigma_s_, sigma_r_, src, dst); }
+      // 足し込み, ぼかし, 補間で届くのは格子4個分程度
+      // (格子の区切りはタイルの位置で変わるので, タイル分割時は継ぎ目で僅かに値がずれる)
+      int footprint() const override { return 4 * sigma_s_; }
+    private:
+      BilateralGrid& grid_;
+      int sigma_s_;
+      float sigma_r_;
+    };
+  }
+}
+
+#endif // INCLUDED_BILATERAL_HPP
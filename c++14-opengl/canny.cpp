@@ -0,0 +1,160 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "canny.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // shader/canny_control.csのState(先頭はCanny::Status)
+    struct CannyState {
+      GLuint changed;
+      GLuint passes;
+      GLuint num_groups[3];
+    };
+
+    Canny::Canny(Convolution& conv)
+      : conv_(conv), readback_(sizeof(Status)), status_{ 0u, 0u }, status_valid_(false)
+    {
+      state_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(CannyState), nullptr, GL_DYNAMIC_COPY);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    bool Canny::init()
+    {
+      using Names = std::vector<std::string>;
+
+      if (!gradient_prog_.build_program_from_files(Names{ "shader/canny_gradient.cs" })) {
+	return false;
+      }
+      if (!nms_prog_.build_program_from_files(Names{ "shader/canny_nms.cs" })) {
+	return false;
+      }
+      if (!control_prog_.build_program_from_files(Names{ "shader/canny_control.cs" })) {
+	return false;
+      }
+      if (!hysteresis_prog_.build_program_from_files(Names{ "shader/canny_hysteresis.cs" })) {
+	return false;
+      }
+      if (!output_prog_.build_program_from_files(Names{ "shader/canny_output.cs" })) {
+	return false;
+      }
+
+      return true;
+    }
+
+#define WORKGROUP_SIZE 16
+    void Canny::apply(float sigma, float low, float high, const Texture& src, const Texture& dst)
+    {
+      const int w = src.width(), h = src.height();
+      if (!gradient_ || gradient_.width() != w || gradient_.height() != h) {
+	blurred_ = Texture::create(w, h, TextureFormat::RGBA8);
+	gradient_ = Texture::create(w, h, TextureFormat::RG16F);
+	labels_ = Texture::create(w, h, TextureFormat::RED32);
+      }
+      const GLuint gx = (w + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+      const GLuint gy = (h + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+
+      // ぼかし(半径は3 sigma)
+      const Texture* blurred = &src;
+      const int radius = static_cast<int>(std::ceil(3.f * sigma));
+      if (radius > 0) {
+	conv_.apply(ConvKernel::gaussian(radius, sigma), src, blurred_);
+	blurred = &blurred_;
+      }
+
+      // 勾配
+      gradient_prog_.use();
+      glBindImageTexture(0, blurred->handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, gradient_.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+      glDispatchCompute(gx, gy, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+      // 細線化と分類
+      nms_prog_.use();
+      nms_prog_.set_uniform("low", low);
+      nms_prog_.set_uniform("high", high);
+      glBindImageTexture(0, gradient_.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RG16F);
+      glBindImageTexture(1, labels_.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32UI);
+      glDispatchCompute(gx, gy, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+      // hysteresis(最初のパスは必ず計算する)
+      const CannyState initial = { 1u, 0u, { 0u, 0u, 1u } };
+      state_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(initial), &initial);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+      state_.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+      state_.bind(GL_DISPATCH_INDIRECT_BUFFER);
+      glBindImageTexture(0, labels_.handle(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+      control_prog_.use();
+      control_prog_.set_uniform("groups_x", gx);
+      control_prog_.set_uniform("groups_y", gy);
+      for (int i = 0; i < max_passes; ++i) {
+	control_prog_.use();
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	hysteresis_prog_.use();
+	glDispatchComputeIndirect(static_cast<GLintptr>(offsetof(CannyState, num_groups)));
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+      }
+      glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+      // 表示用のパス数と収束したか
+      glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+      if (!readback_.pending()) {
+	readback_.copy_buffer(state_.handle(), 0, sizeof(Status));
+      }
+
+      output_prog_.use();
+      glBindImageTexture(0, labels_.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_R32UI);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    void Canny::poll_status()
+    {
+      Status s;
+      if (!readback_.poll(&s)) {
+	return;
+      }
+      if (s.changed != 0u) {
+	fprintf(stderr, "Canny : hysteresis stopped at max_passes (%u) before converging.\n", s.passes);
+      }
+      status_ = s;
+      status_valid_ = true;
+    }
+
+    int Canny::passes()
+    {
+      poll_status();
+      return status_valid_ ? static_cast<int>(status_.passes) : -1;
+    }
+
+    bool Canny::converged()
+    {
+      poll_status();
+      return !status_valid_ || status_.changed == 0u;
+    }
+
+    void Canny::copy_status(GLuint buffer, GLintptr offset) const
+    {
+      glBindBuffer(GL_COPY_READ_BUFFER, state_.handle());
+      glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, offset, sizeof(Status));
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+  }
+}
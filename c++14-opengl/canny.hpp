@@ -0,0 +1,99 @@
+#ifndef INCLUDED_CANNY_HPP
+#define INCLUDED_CANNY_HPP
+
+#include <glad/glad.h>
+
+#include "program.hpp"
+#include "texture.hpp"
+#include "globject.hpp"
+#include "filtergraph.hpp"
+#include "convolution.hpp"
+#include "readback.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // Cannyのエッジ検出(結果はエッジが白, 他は黒. alphaは1)
+    // 1. Gaussianでぼかす(Convolution)
+    // 2. shader/canny_gradient.cs : 輝度のSobelで勾配の(大きさ, 向き)をRG16Fへ
+    // 3. shader/canny_nms.cs : 勾配の向きに極大でない画素を捨てて, 2つの閾値で強い/弱いエッジに分ける
+    // 4. shader/canny_hysteresis.cs : 強いエッジにつながる弱いエッジを強いエッジにする
+    //    変化が無くなるまでパスを繰り返す. 各パスの前にshader/canny_control.csが
+    //    直前のパスで変化があったかを見て次のパスのworkgroup数(間接dispatchの引数)を決めるので
+    //    収束の判定にCPUへの読み戻しは要らない(収束後のパスは空のdispatchになる)
+    // 全てGPU上で終わり, パス数は表示用に非同期で読み戻すだけ
+    // パス数はmax_passesで打ち切るので, 長く入り組んだエッジでは収束前に止まることがある
+    // (読み戻した結果が打ち切りならstderrに出す. 一括処理ではcopy_status()で画像毎に確かめる)
+    class Canny {
+    public:
+      explicit Canny(Convolution& conv);
+      ~Canny() = default;
+
+      Canny(const Canny&) = delete;
+      Canny& operator=(const Canny&) = delete;
+
+      bool init();
+
+      // sigma : ぼかしの標準偏差(画素, 0ならぼかさない)
+      // low, high : 勾配の大きさ(明るさ0 -> 1の段差が1)の閾値
+      void apply(float sigma, float low, float high, const Texture& src, const Texture& dst);
+
+      // hysteresisの結果(shader/canny_control.csのStateの先頭)
+      struct Status {
+	GLuint changed; // 0でなければ最後のパスでも変化があった(max_passesで打ち切り, 収束していない)
+	GLuint passes; // 実際に計算したパス数
+      };
+
+      // 直近のhysteresisで実際に計算したパス数
+      // 表示用に非同期で読み戻すので数フレーム遅れる(まだ無ければ-1)
+      int passes();
+      // 同じく読み戻した直近の結果が収束していたか(まだ無ければtrue)
+      bool converged();
+      // 直近のapplyのStatusをbufferのoffsetへGPU上でコピーする(読み戻しは呼び出し側で)
+      void copy_status(GLuint buffer, GLintptr offset = 0) const;
+
+      // hysteresisのパス数の上限(1パスで16x16のタイル1個分以上伝わる)
+      int max_passes = 64;
+    private:
+      Convolution& conv_;
+      Program gradient_prog_;
+      Program nms_prog_;
+      Program control_prog_;
+      Program hysteresis_prog_;
+      Program output_prog_;
+      Texture blurred_; // rgba8
+      Texture gradient_; // RG16F(大きさ, 向き)
+      Texture labels_; // R32UI(0 : なし, 1 : 弱いエッジ, 2 : 強いエッジ)
+      gl::Buffer state_; // shader/canny_control.csのState
+      AsyncReadback readback_;
+      Status status_; // 直近に読み戻した結果
+      bool status_valid_;
+
+      void poll_status();
+    };
+
+    // FilterGraph用
+    class CannyFilter : public FilterNode {
+    public:
+      CannyFilter(Canny& canny, float sigma, float low, float high)
+	: canny_(canny), sigma_(sigma), low_(low), high_(high) {}
+
+      void set_params(float sigma, float low, float high) { sigma_ = sigma; low_ = low; high_ = high; }
+
+      size_t hash() const override
+      {
+	const float params[] = { sigma_, low_, high_ };
+	return hash_bytes(hash_combine(reinterpret_cast<size_t>(&canny_), canny_.max_passes), params, 3);
+      }
+      void apply(const Texture& src, const Texture& dst) override { canny_.apply(sigma_, low_, high_, src, dst); }
+      // hysteresisはエッジに沿って画像の端まで伝わり得る
+      int footprint() const override { return -1; }
+    private:
+      Canny& canny_;
+      float sigma_;
+      float low_;
+      float high_;
+    };
+  }
+}
+
+#endif // INCLUDED_CANNY_HPP
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "convolution.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    ConvKernel::ConvKernel(int width, int height, const std::vector<float>& weights,
+			   float scale, float bias)
+      : width_(width), height_(height), weights_(weights), scale_(scale), bias_(bias)
+    {
+      assert(width % 2 == 1 && height % 2 == 1);
+      assert(weights.size() == static_cast<size_t>(width * height));
+      factorize();
+    }
+
+    ConvKernel::ConvKernel(const std::vector<float>& column, const std::vector<float>& row,
+			   float scale, float bias)
+      : width_(static_cast<int>(row.size())), height_(static_cast<int>(column.size())),
+	weights_(row.size() * column.size()), scale_(scale), bias_(bias),
+	row_(row), column_(column)
+    {
+      assert(width_ % 2 == 1 && height_ % 2 == 1);
+      for (int y = 0; y < height_; ++y) {
+	for (int x = 0; x < width_; ++x) {
+	  weights_[y * width_ + x] = column[y] * row[x];
+	}
+      }
+    }
+
+    // 絶対値最大の係数の行と列から分解して全係数が一致するか確かめる
+    void ConvKernel::factorize()
+    {
+      int px = 0, py = 0;
+      float pivot = 0.f;
+      for (int y = 0; y < height_; ++y) {
+	for (int x = 0; x < width_; ++x) {
+	  if (std::abs(weights_[y * width_ + x]) > std::abs(pivot)) {
+	    pivot = weights_[y * width_ + x];
+	    px = x; py = y;
+	  }
+	}
+      }
+      if (pivot == 0.f) {
+	return;
+      }
+
+      std::vector<float> row(width_), column(height_);
+      for (int x = 0; x < width_; ++x) {
+	row[x] = weights_[py * width_ + x] / pivot;
+      }
+      for (int y = 0; y < height_; ++y) {
+	column[y] = weights_[y * width_ + px];
+      }
+      const float eps = 1e-6f * std::abs(pivot);
+      for (int y = 0; y < height_; ++y) {
+	for (int x = 0; x < width_; ++x) {
+	  if (std::abs(column[y] * row[x] - weights_[y * width_ + x]) > eps) {
+	    return;
+	  }
+	}
+      }
+      row_.swap(row);
+      column_.swap(column);
+    }
+
+    ConvKernel ConvKernel::box(int radius)
+    {
+      const std::vector<float> w(2 * radius + 1, 1.f / (2 * radius + 1));
+      return ConvKernel(w, w);
+    }
+
+    ConvKernel ConvKernel::gaussian(int radius, float sigma)
+    {
+      if (sigma <= 0.f) {
+	sigma = std::max(radius / 3.f, 0.5f);
+      }
+      std::vector<float> w(2 * radius + 1);
+      float sum = 0.f;
+      for (int i = -radius; i <= radius; ++i) {
+	w[i + radius] = std::exp(-0.5f * i * i / (sigma * sigma));
+	sum += w[i + radius];
+      }
+      for (auto& x : w) {
+	x /= sum;
+      }
+      return ConvKernel(w, w);
+    }
+
+    ConvKernel ConvKernel::disk(int radius)
+    {
+      const int n = 2 * radius + 1;
+      std::vector<float> w(n * n);
+      float sum = 0.f;
+      for (int y = -radius; y <= radius; ++y) {
+	for (int x = -radius; x <= radius; ++x) {
+	  if (x * x + y * y <= radius * radius) {
+	    w[(y + radius) * n + x + radius] = 1.f;
+	    sum += 1.f;
+	  }
+	}
+      }
+      for (auto& x : w) {
+	x /= sum;
+      }
+      return ConvKernel(n, n, w);
+    }
+
+    ConvKernel ConvKernel::laplacian()
+    {
+      return ConvKernel(3, 3, { 0.f, -1.f, 0.f,
+				-1.f, 4.f, -1.f,
+				0.f, -1.f, 0.f });
+    }
+
+    ConvKernel ConvKernel::sobel_x()
+    {
+      return ConvKernel({ 1.f, 2.f, 1.f }, { -1.f, 0.f, 1.f });
+    }
+
+    ConvKernel ConvKernel::sobel_y()
+    {
+      return ConvKernel({ -1.f, 0.f, 1.f }, { 1.f, 2.f, 1.f });
+    }
+
+    bool Convolution::init()
+    {
+      using Names = std::vector<std::string>;
+
+      if (!conv2d_prog_.build_program_from_files(Names{ "shader/conv2d.cs" })) {
+	return false;
+      }
+      if (!row_prog_.build_program_from_files(Names{ "shader/conv1d.cs" })) {
+	return false;
+      }
+      column_prog_.define("VERTICAL");
+      if (!column_prog_.build_program_from_files(Names{ "shader/conv1d.cs" })) {
+	return false;
+      }
+      if (!fft_.init() ||
+	  !fft_pack_prog_.build_program_from_files(Names{ "shader/fft_pack.cs" }) ||
+	  !fft_kernel_prog_.build_program_from_files(Names{ "shader/fft_kernel.cs" }) ||
+	  !fft_multiply_prog_.build_program_from_files(Names{ "shader/fft_multiply.cs" }) ||
+	  !fft_unpack_prog_.build_program_from_files(Names{ "shader/fft_unpack.cs" })) {
+	return false;
+      }
+
+      return true;
+    }
+
+    // 係数をSSBOへ(2個目は1個目の直後)
+    void Convolution::upload(const std::vector<float>& a, const std::vector<float>* b)
+    {
+      std::vector<float> w(a);
+      if (b) {
+	w.insert(w.end(), b->begin(), b->end());
+      }
+      weights_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(float) * w.size(), w.data(), GL_STREAM_DRAW);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+      weights_.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    // FFTで使う2のべきの大きさ(端の延長分を含む)
+    static int fft_size(int n)
+    {
+      int size = 1;
+      while (size < n) {
+	size *= 2;
+      }
+      return size;
+    }
+
+    static int log2i(int n)
+    {
+      int l = 0;
+      while ((1 << l) < n) {
+	++l;
+      }
+      return l;
+    }
+
+    Convolution::Method Convolution::method(const ConvKernel& kernel, int width, int height) const
+    {
+      const int r = std::max(kernel.radius_x(), kernel.radius_y());
+      if (force_fft) {
+	return Method::FFT;
+      }
+
+      Method direct;
+      int direct_cost;
+      if (kernel.separable() && !force_2d && (r >= separable_radius_ || r > max_radius_2d_) && r <= max_radius_1d_) {
+	direct = Method::SEPARABLE;
+	direct_cost = kernel.width() + kernel.height();
+      } else if (r <= max_radius_2d_) {
+	direct = Method::DIRECT_2D;
+	direct_cost = kernel.width() * kernel.height();
+      } else {
+	return Method::FFT;
+      }
+      const int fft_cost = fft_cost_ * (log2i(fft_size(width + 2 * kernel.radius_x())) +
+					log2i(fft_size(height + 2 * kernel.radius_y())));
+      return (direct_cost <= fft_cost) ? direct : Method::FFT;
+    }
+
+    const char* Convolution::method_name(Method method) noexcept
+    {
+      switch (method) {
+      case Method::DIRECT_2D:
+	return "2D";
+      case Method::SEPARABLE:
+	return "separable";
+      case Method::FFT:
+	return "FFT";
+      }
+      return "";
+    }
+
+    bool Convolution::apply(const ConvKernel& kernel, const Texture& src, const Texture& dst)
+    {
+      switch (method(kernel, src.width(), src.height())) {
+      case Method::DIRECT_2D:
+	apply_2d(kernel, nullptr, src, dst);
+	return true;
+      case Method::SEPARABLE:
+	apply_separable(kernel, src, dst);
+	return true;
+      case Method::FFT:
+	break;
+      }
+
+      const int r = std::max(kernel.radius_x(), kernel.radius_y());
+      if (r > max_radius_fft_) {
+	fprintf(stderr, "Convolution radius %d is too large (max %d).\n", r, max_radius_fft_);
+	return false;
+      }
+      GLint max_size = 0;
+      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+      if (fft_size(src.width() + 2 * kernel.radius_x()) > max_size ||
+	  fft_size(src.height() + 2 * kernel.radius_y()) > max_size) {
+	fprintf(stderr, "Image is too large for FFT convolution.\n");
+	return false;
+      }
+      apply_fft(kernel, src, dst);
+      return true;
+    }
+
+    bool Convolution::apply_magnitude(const ConvKernel& a, const ConvKernel& b, const Texture& src, const Texture& dst)
+    {
+      assert(a.width() == b.width() && a.height() == b.height());
+      if (std::max(a.radius_x(), a.radius_y()) > max_radius_2d_) {
+	fprintf(stderr, "Convolution radius is too large (max %d).\n", max_radius_2d_);
+	return false;
+      }
+      apply_2d(a, &b, src, dst);
+      return true;
+    }
+
+#define WORKGROUP_SIZE 16
+    void Convolution::apply_2d(const ConvKernel& a, const ConvKernel* b, const Texture& src, const Texture& dst)
+    {
+      upload(a.weights(), b ? &b->weights() : nullptr);
+
+      conv2d_prog_.use();
+      conv2d_prog_.set_uniform("radius_x", a.radius_x());
+      conv2d_prog_.set_uniform("radius_y", a.radius_y());
+      conv2d_prog_.set_uniform("kernel_num", b ? 2 : 1);
+      conv2d_prog_.set_uniform("scale", a.scale());
+      conv2d_prog_.set_uniform("bias", a.bias());
+
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+#define LINE_SIZE 256
+    void Convolution::apply_separable(const ConvKernel& kernel, const Texture& src, const Texture& dst)
+    {
+      const int w = dst.width(), h = dst.height();
+      if (!temp_ || temp_.width() != w || temp_.height() != h) {
+	temp_ = Texture::create(w, h, TextureFormat::RGBA16F);
+      }
+
+      // 行方向(係数の行ベクトル, 倍率は最後にまとめて)
+      upload(kernel.row());
+      row_prog_.use();
+      row_prog_.set_uniform("radius", kernel.radius_x());
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, temp_.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+      glDispatchCompute((w + LINE_SIZE - 1) / LINE_SIZE, h, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+      // 列方向
+      upload(kernel.column());
+      column_prog_.use();
+      column_prog_.set_uniform("radius", kernel.radius_y());
+      column_prog_.set_uniform("scale", kernel.scale());
+      column_prog_.set_uniform("bias", kernel.bias());
+      glBindImageTexture(0, temp_.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((h + LINE_SIZE - 1) / LINE_SIZE, w, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    void Convolution::apply_fft(const ConvKernel& kernel, const Texture& src, const Texture& dst)
+    {
+      const int rx = kernel.radius_x(), ry = kernel.radius_y();
+      // 端の延長分を足しておけば循環畳み込みの折り返しが結果の範囲に掛からない
+      const int w = fft_size(src.width() + 2 * rx);
+      const int h = fft_size(src.height() + 2 * ry);
+      const GLuint gx = (w + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+      const GLuint gy = (h + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+      bool resized = false;
+      if (!fft_data_[0] || fft_data_[0].width() != w || fft_data_[0].height() != h) {
+	for (auto& t : fft_data_) {
+	  t = Texture::create(w, h, TextureFormat::RGBA32F);
+	}
+	fft_spectrum_ = Texture::create(w, h, TextureFormat::RGBA32F);
+	resized = true;
+      }
+
+      // 係数のスペクトル(係数か大きさが変わった時だけ)
+      if (resized || rx != spectrum_radius_x_ || ry != spectrum_radius_y_ || kernel.weights() != spectrum_weights_) {
+	upload(kernel.weights());
+	fft_kernel_prog_.use();
+	fft_kernel_prog_.set_uniform("radius_x", rx);
+	fft_kernel_prog_.set_uniform("radius_y", ry);
+	glBindImageTexture(1, fft_spectrum_.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	glDispatchCompute(gx, gy, 1);
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	Texture spectrum = fft_.transform(fft_spectrum_, fft_data_[0], -1);
+	if (spectrum != fft_spectrum_) {
+	  std::swap(fft_spectrum_, fft_data_[0]);
+	}
+	spectrum_weights_ = kernel.weights();
+	spectrum_radius_x_ = rx;
+	spectrum_radius_y_ = ry;
+      }
+
+      // 画像を延長して詰める -> 順変換
+      fft_pack_prog_.use();
+      fft_pack_prog_.set_uniform("offset_x", rx);
+      fft_pack_prog_.set_uniform("offset_y", ry);
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, fft_data_[0].handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+      glDispatchCompute(gx, gy, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+      Texture data = fft_.transform(fft_data_[0], fft_data_[1], -1);
+      Texture work = (data == fft_data_[0]) ? fft_data_[1] : fft_data_[0];
+
+      // 係数のスペクトルとの積 -> 逆変換
+      fft_multiply_prog_.use();
+      fft_multiply_prog_.set_uniform("scale", 1.f / (static_cast<float>(w) * h));
+      glBindImageTexture(0, data.handle(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+      glBindImageTexture(1, fft_spectrum_.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+      glDispatchCompute(gx, gy, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+      data = fft_.transform(data, work, 1);
+
+      // 延長分を除いて取り出す
+      fft_unpack_prog_.use();
+      fft_unpack_prog_.set_uniform("offset_x", rx);
+      fft_unpack_prog_.set_uniform("offset_y", ry);
+      fft_unpack_prog_.set_uniform("scale", kernel.scale());
+      fft_unpack_prog_.set_uniform("bias", kernel.bias());
+      glBindImageTexture(0, data.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+  }
+}
@@ -0,0 +1,129 @@
+#ifndef INCLUDED_CONVOLUTION_HPP
+#define INCLUDED_CONVOLUTION_HPP
+
+#include <vector>
+#include <glad/glad.h>
+
+#include "program.hpp"
+#include "texture.hpp"
+#include "globject.hpp"
+#include "fft.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // 畳み込みの係数
+    // 結果は (係数との積和) * scale + bias
+    // 作る時に行ベクトルと列ベクトルの積(階数1)に分解できるか調べておく
+    class ConvKernel {
+    public:
+      // width x heightの係数(行優先, 上の行から, 幅と高さは奇数)
+      ConvKernel(int width, int height, const std::vector<float>& weights,
+		 float scale = 1.f, float bias = 0.f);
+      // 列ベクトルcolumnと行ベクトルrowの積
+      ConvKernel(const std::vector<float>& column, const std::vector<float>& row,
+		 float scale = 1.f, float bias = 0.f);
+
+      // よく使うもの
+      static ConvKernel box(int radius);
+      static ConvKernel gaussian(int radius, float sigma = 0.f); // sigma = 0ならradius / 3
+      static ConvKernel disk(int radius); // 半径内が一様な円(分離できない)
+      static ConvKernel laplacian();
+      static ConvKernel sobel_x();
+      static ConvKernel sobel_y();
+
+      int width() const noexcept { return width_; }
+      int height() const noexcept { return height_; }
+      int radius_x() const noexcept { return width_ / 2; }
+      int radius_y() const noexcept { return height_ / 2; }
+      const std::vector<float>& weights() const noexcept { return weights_; }
+      float scale() const noexcept { return scale_; }
+      float bias() const noexcept { return bias_; }
+
+      bool separable() const noexcept { return !row_.empty(); }
+      const std::vector<float>& row() const noexcept { return row_; }
+      const std::vector<float>& column() const noexcept { return column_; }
+    private:
+      int width_;
+      int height_;
+      std::vector<float> weights_;
+      float scale_;
+      float bias_;
+      // 分解できた時のみ
+      std::vector<float> row_;
+      std::vector<float> column_;
+
+      void factorize();
+    };
+
+    // rgba8の画像の畳み込み(rgbのみ, 結果のalphaは1)
+    // 16x16のworkgroupがタイル + 周囲(半径分)を共有メモリに1回だけ読んでから積和を取る
+    // 係数はSSBOで渡すので大きさは自由(2次元のままなら半径max_radius_2d_まで)
+    // 分離可能な係数で半径が大きいものは行方向 -> 列方向の1次元2パス(中間結果はRGBA16F)
+    // どちらにも収まらない大きな係数はFFT(fft.hpp)で周波数領域の積にする
+    //  画像を端の延長分(半径)だけ広げた2のべきの大きさのRGBA32Fへ置いて変換し,
+    //  係数のスペクトル(係数と大きさが同じ間は使い回す)を掛けて逆変換する
+    //  手間は係数の大きさによらず O(N log N)
+    // 画像の端は端の画素を延長する
+    class Convolution {
+    public:
+      enum class Method { DIRECT_2D, SEPARABLE, FFT };
+
+      Convolution() = default;
+      ~Convolution() = default;
+
+      Convolution(const Convolution&) = delete;
+      Convolution& operator=(const Convolution&) = delete;
+      Convolution(Convolution&&) = delete;
+      Convolution& operator=(Convolution&&) = delete;
+
+      bool init();
+
+      // srcをkernelで畳み込んでdstへ(srcとdstは同じ大きさ)
+      bool apply(const ConvKernel& kernel, const Texture& src, const Texture& dst);
+      // 2個の係数の結果の大きさ sqrt(a^2 + b^2) * a.scale() + a.bias() (Sobel等)
+      bool apply_magnitude(const ConvKernel& a, const ConvKernel& b, const Texture& src, const Texture& dst);
+
+      // width x heightの画像にkernelをかける時の方法
+      // 直接計算できる(2次元は半径max_radius_2d_, 分離2パスはmax_radius_1d_まで)なら
+      // 係数の数とFFTの段数に比例する手間の目安を比べて安い方
+      Method method(const ConvKernel& kernel, int width, int height) const;
+      static const char* method_name(Method method) noexcept;
+
+      bool force_2d = false; // 分離可能でも2次元のまま計算する(比較用)
+      bool force_fft = false; // 常にFFT(比較用)
+
+      static const int max_radius_2d_ = 8; // shader/conv2d.csのMAX_RADIUS
+      static const int max_radius_1d_ = 64; // shader/conv1d.csのMAX_RADIUS
+      static const int max_radius_fft_ = 512; // 係数の作成とテクスチャの大きさの都合
+      static const int separable_radius_ = 3; // 分離可能な係数をこの半径以上なら2パスにする
+      // FFTの画素あたりの手間の目安(行と列の長さのlog2の和に掛ける, 係数1個の積和を1とする)
+      // 1024x1024程度の画像で31x31前後の係数と釣り合う
+      static const int fft_cost_ = 40;
+    private:
+      Program conv2d_prog_;
+      Program row_prog_;
+      Program column_prog_;
+      gl::Buffer weights_;
+      Texture temp_; // 1次元2パスの中間結果
+
+      Fft fft_;
+      Program fft_pack_prog_;
+      Program fft_kernel_prog_;
+      Program fft_multiply_prog_;
+      Program fft_unpack_prog_;
+      Texture fft_data_[2]; // RGBA32F
+      Texture fft_spectrum_; // 係数のスペクトル
+      // fft_spectrum_の元の係数
+      std::vector<float> spectrum_weights_;
+      int spectrum_radius_x_ = -1;
+      int spectrum_radius_y_ = -1;
+
+      void upload(const std::vector<float>&, const std::vector<float>* = nullptr);
+      void apply_2d(const ConvKernel&, const ConvKernel*, const Texture&, const Texture&);
+      void apply_separable(const ConvKernel&, const Texture&, const Texture&);
+      void apply_fft(const ConvKernel&, const Texture&, const Texture&);
+    };
+  }
+}
+
+#endif // INCLUDED_CONVOLUTION_HPP
@@ -0,0 +1,526 @@
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "cpufilter.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    namespace {
+      // 近傍の3行(端を1画素ずつ延長済み, rows[k][4 * (x + 1)]が(x, y - 1 + k))
+      using Rows = const unsigned char* const*;
+
+      inline unsigned char to_unorm8(float v)
+      {
+	return static_cast<unsigned char>(std::lrint(std::min(std::max(v, 0.f), 1.f) * 255.f));
+      }
+
+      // 1画素ずつの版(SIMDの端数とSIMD無しの時)
+      inline void mean_pixel(Rows r, unsigned char* o, int x)
+      {
+	for (int c = 0; c < 3; ++c) {
+	  int sum = 0;
+	  for (int k = 0; k < 3; ++k) {
+	    sum += r[k][4 * x + c] + r[k][4 * (x + 1) + c] + r[k][4 * (x + 2) + c];
+	  }
+	  o[4 * x + c] = static_cast<unsigned char>(std::lrint(sum * (1.f / 9.f)));
+	}
+	o[4 * x + 3] = 255;
+      }
+
+      inline void laplacian_pixel(Rows r, unsigned char* o, int x)
+      {
+	for (int c = 0; c < 3; ++c) {
+	  const int v = 4 * r[1][4 * (x + 1) + c] - r[0][4 * (x + 1) + c] - r[2][4 * (x + 1) + c]
+	    - r[1][4 * x + c] - r[1][4 * (x + 2) + c];
+	  o[4 * x + c] = static_cast<unsigned char>(std::min(std::max(v, 0), 255));
+	}
+	o[4 * x + 3] = 255;
+      }
+
+      inline void sobel_pixel(Rows r, unsigned char* o, int x)
+      {
+	for (int c = 0; c < 3; ++c) {
+	  const int gx = (r[0][4 * (x + 2) + c] - r[0][4 * x + c]) + 2 * (r[1][4 * (x + 2) + c] - r[1][4 * x + c])
+	    + (r[2][4 * (x + 2) + c] - r[2][4 * x + c]);
+	  const int gy = (r[2][4 * x + c] + 2 * r[2][4 * (x + 1) + c] + r[2][4 * (x + 2) + c])
+	    - (r[0][4 * x + c] + 2 * r[0][4 * (x + 1) + c] + r[0][4 * (x + 2) + c]);
+	  const float v = std::sqrt(static_cast<float>(gx * gx + gy * gy)) * 0.5f;
+	  o[4 * x + c] = static_cast<unsigned char>(std::lrint(std::min(v, 255.f)));
+	}
+	o[4 * x + 3] = 255;
+      }
+
+      inline void color_matrix_pixel(const glm::mat4& m, const unsigned char* s, unsigned char* o, int x)
+      {
+	// SIMD版と同じ順序で計算する
+	const float r = s[4 * x] * (1.f / 255.f);
+	const float g = s[4 * x + 1] * (1.f / 255.f);
+	const float b = s[4 * x + 2] * (1.f / 255.f);
+	for (int c = 0; c < 3; ++c) {
+	  o[4 * x + c] = to_unorm8((m[0][c] * r + m[1][c] * g) + (m[2][c] * b + m[3][c]));
+	}
+	o[4 * x + 3] = s[4 * x + 3];
+      }
+
+#if defined(__SSE2__)
+#define CPUFILTER_SIMD
+      // SIMD命令の薄い包み(同じ処理をSSE2とAVX2で書くため)
+      // AVX2のunpack/packは128bit毎に働くが, unpackした物を同じ組でpackすれば順序は元に戻る
+      struct Sse2 {
+	using I = __m128i;
+	using F = __m128;
+	static const int bytes = 16;
+	static const char* name() { return "sse2"; }
+
+	static I load(const unsigned char* p) { return _mm_loadu_si128(reinterpret_cast<const I*>(p)); }
+	static void store(unsigned char* p, I v) { _mm_storeu_si128(reinterpret_cast<I*>(p), v); }
+	static I set1_32(int x) { return _mm_set1_epi32(x); }
+	static I lo8(I v) { return _mm_unpacklo_epi8(v, _mm_setzero_si128()); }
+	static I hi8(I v) { return _mm_unpackhi_epi8(v, _mm_setzero_si128()); }
+	static I lo16(I v) { return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16); }
+	static I hi16(I v) { return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16); }
+	static I add16(I a, I b) { return _mm_add_epi16(a, b); }
+	static I sub16(I a, I b) { return _mm_sub_epi16(a, b); }
+	static I mul16(I a, I b) { return _mm_mullo_epi16(a, b); }
+	static I packs32(I a, I b) { return _mm_packs_epi32(a, b); }
+	static I packus16(I a, I b) { return _mm_packus_epi16(a, b); }
+	static I or_(I a, I b) { return _mm_or_si128(a, b); }
+	static I xor_(I a, I b) { return _mm_xor_si128(a, b); }
+
+	static F set1(float x) { return _mm_set1_ps(x); }
+	static F set4(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+	static F cvt(I v) { return _mm_cvtepi32_ps(v); }
+	static I cvt(F v) { return _mm_cvtps_epi32(v); } // 最近接偶数丸め
+	static F add(F a, F b) { return _mm_add_ps(a, b); }
+	static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+	static F min(F a, F b) { return _mm_min_ps(a, b); }
+	static F max(F a, F b) { return _mm_max_ps(a, b); }
+	static F sqrt(F a) { return _mm_sqrt_ps(a); }
+	template <int i>
+	static F splat(F v) { return _mm_shuffle_ps(v, v, i * 0x55); }
+      };
+#endif
+
+#if defined(__AVX2__)
+      struct Avx2 {
+	using I = __m256i;
+	using F = __m256;
+	static const int bytes = 32;
+	static const char* name() { return "avx2"; }
+
+	static I load(const unsigned char* p) { return _mm256_loadu_si256(reinterpret_cast<const I*>(p)); }
+	static void store(unsigned char* p, I v) { _mm256_storeu_si256(reinterpret_cast<I*>(p), v); }
+	static I set1_32(int x) { return _mm256_set1_epi32(x); }
+	static I lo8(I v) { return _mm256_unpacklo_epi8(v, _mm256_setzero_si256()); }
+	static I hi8(I v) { return _mm256_unpackhi_epi8(v, _mm256_setzero_si256()); }
+	static I lo16(I v) { return _mm256_srai_epi32(_mm256_unpacklo_epi16(v, v), 16); }
+	static I hi16(I v) { return _mm256_srai_epi32(_mm256_unpackhi_epi16(v, v), 16); }
+	static I add16(I a, I b) { return _mm256_add_epi16(a, b); }
+	static I sub16(I a, I b) { return _mm256_sub_epi16(a, b); }
+	static I mul16(I a, I b) { return _mm256_mullo_epi16(a, b); }
+	static I packs32(I a, I b) { return _mm256_packs_epi32(a, b); }
+	static I packus16(I a, I b) { return _mm256_packus_epi16(a, b); }
+	static I or_(I a, I b) { return _mm256_or_si256(a, b); }
+	static I xor_(I a, I b) { return _mm256_xor_si256(a, b); }
+
+	static F set1(float x) { return _mm256_set1_ps(x); }
+	static F set4(float x, float y, float z, float w) { return _mm256_setr_ps(x, y, z, w, x, y, z, w); }
+	static F cvt(I v) { return _mm256_cvtepi32_ps(v); }
+	static I cvt(F v) { return _mm256_cvtps_epi32(v); }
+	static F add(F a, F b) { return _mm256_add_ps(a, b); }
+	static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+	static F min(F a, F b) { return _mm256_min_ps(a, b); }
+	static F max(F a, F b) { return _mm256_max_ps(a, b); }
+	static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+	template <int i>
+	static F splat(F v) { return _mm256_shuffle_ps(v, v, i * 0x55); }
+      };
+      using Simd = Avx2;
+#elif defined(__SSE2__)
+      using Simd = Sse2;
+#endif
+
+#ifdef CPUFILTER_SIMD
+      // 以下は処理できた画素数を返す(残りは1画素ずつの版で)
+      template <typename V>
+      int invert_simd(const unsigned char* s, unsigned char* o, int w)
+      {
+	const int step = V::bytes / 4;
+	const typename V::I ones = V::set1_32(-1);
+	int x = 0;
+	for (; x + step <= w; x += step) {
+	  V::store(o + 4 * x, V::xor_(V::load(s + 4 * x), ones)); // 255 - c
+	}
+	return x;
+      }
+
+      // int16 x 2組 -> float演算 -> int16 x 2組
+      template <typename V, typename Op>
+      typename V::I map16(typename V::I v, Op op)
+      {
+	return V::packs32(V::cvt(op(V::cvt(V::lo16(v)))), V::cvt(op(V::cvt(V::hi16(v)))));
+      }
+
+      template <typename V>
+      int mean_simd(Rows r, unsigned char* o, int w)
+      {
+	using I = typename V::I;
+	using F = typename V::F;
+	const int step = V::bytes / 4;
+	const I alpha = V::set1_32(static_cast<int>(0xff000000));
+	const F inv9 = V::set1(1.f / 9.f);
+	auto div9 = [&](F a) { return V::mul(a, inv9); };
+	int x = 0;
+	for (; x + step <= w; x += step) {
+	  I lo = V::lo8(V::load(r[0] + 4 * x));
+	  I hi = V::hi8(V::load(r[0] + 4 * x));
+	  for (int k = 0; k < 3; ++k) {
+	    for (int dx = (k == 0) ? 1 : 0; dx < 3; ++dx) {
+	      const I v = V::load(r[k] + 4 * (x + dx));
+	      lo = V::add16(lo, V::lo8(v));
+	      hi = V::add16(hi, V::hi8(v));
+	    }
+	  }
+	  V::store(o + 4 * x, V::or_(V::packus16(map16<V>(lo, div9), map16<V>(hi, div9)), alpha));
+	}
+	return x;
+      }
+
+      template <typename V>
+      int laplacian_simd(Rows r, unsigned char* o, int w)
+      {
+	using I = typename V::I;
+	const int step = V::bytes / 4;
+	const I alpha = V::set1_32(static_cast<int>(0xff000000));
+	const I four = V::set1_32(0x00040004);
+	int x = 0;
+	for (; x + step <= w; x += step) {
+	  const I c = V::load(r[1] + 4 * (x + 1));
+	  const I n[4] = { V::load(r[0] + 4 * (x + 1)), V::load(r[2] + 4 * (x + 1)),
+			   V::load(r[1] + 4 * x), V::load(r[1] + 4 * (x + 2)) };
+	  I lo = V::mul16(V::lo8(c), four);
+	  I hi = V::mul16(V::hi8(c), four);
+	  for (const auto& v : n) {
+	    lo = V::sub16(lo, V::lo8(v));
+	    hi = V::sub16(hi, V::hi8(v));
+	  }
+	  V::store(o + 4 * x, V::or_(V::packus16(lo, hi), alpha)); // 0-255に飽和
+	}
+	return x;
+      }
+
+      template <typename V>
+      int sobel_simd(Rows r, unsigned char* o, int w)
+      {
+	using I = typename V::I;
+	using F = typename V::F;
+	const int step = V::bytes / 4;
+	const I alpha = V::set1_32(static_cast<int>(0xff000000));
+	const F half = V::set1(0.5f);
+	// gx, gyの片側(lo8/hi8)ずつ大きさを求める
+	auto magnitude = [&](I gx, I gy) {
+	  auto m = [&](I x, I y) {
+	    const F fx = V::cvt(x);
+	    const F fy = V::cvt(y);
+	    return V::cvt(V::mul(V::sqrt(V::add(V::mul(fx, fx), V::mul(fy, fy))), half));
+	  };
+	  return V::packs32(m(V::lo16(gx), V::lo16(gy)), m(V::hi16(gx), V::hi16(gy)));
+	};
+	int x = 0;
+	for (; x + step <= w; x += step) {
+	  I gx[2], gy[2];
+	  for (int h = 0; h < 2; ++h) {
+	    auto u = [&](const unsigned char* p) {
+	      const I v = V::load(p);
+	      return h == 0 ? V::lo8(v) : V::hi8(v);
+	    };
+	    const I l0 = u(r[0] + 4 * x), c0 = u(r[0] + 4 * (x + 1)), r0 = u(r[0] + 4 * (x + 2));
+	    const I l1 = u(r[1] + 4 * x), r1 = u(r[1] + 4 * (x + 2));
+	    const I l2 = u(r[2] + 4 * x), c2 = u(r[2] + 4 * (x + 1)), r2 = u(r[2] + 4 * (x + 2));
+	    const I d1 = V::sub16(r1, l1);
+	    gx[h] = V::add16(V::add16(V::sub16(r0, l0), V::sub16(r2, l2)), V::add16(d1, d1));
+	    const I dc = V::sub16(c2, c0);
+	    gy[h] = V::add16(V::add16(V::sub16(l2, l0), V::sub16(r2, r0)), V::add16(dc, dc));
+	  }
+	  V::store(o + 4 * x, V::or_(V::packus16(magnitude(gx[0], gy[0]), magnitude(gx[1], gy[1])), alpha));
+	}
+	return x;
+      }
+
+      template <typename V>
+      int color_matrix_simd(const glm::mat4& m, const unsigned char* s, unsigned char* o, int w)
+      {
+	using I = typename V::I;
+	using F = typename V::F;
+	const int step = V::bytes / 4;
+	// 1画素(rgba)をfloat 4個で持ち, 列ベクトルの線形結合で変換する
+	// alphaは元の値をそのまま通す
+	const F c0 = V::set4(m[0][0], m[0][1], m[0][2], 0.f);
+	const F c1 = V::set4(m[1][0], m[1][1], m[1][2], 0.f);
+	const F c2 = V::set4(m[2][0], m[2][1], m[2][2], 0.f);
+	const F c3 = V::set4(m[3][0], m[3][1], m[3][2], 0.f);
+	const F ca = V::set4(0.f, 0.f, 0.f, 1.f);
+	const F inv255 = V::set1(1.f / 255.f);
+	const F zero = V::set1(0.f);
+	const F one = V::set1(1.f);
+	const F scale = V::set1(255.f);
+	auto transform = [&](I v) {
+	  const F p = V::mul(V::cvt(v), inv255);
+	  F r = V::add(V::mul(c0, V::template splat<0>(p)), V::mul(c1, V::template splat<1>(p)));
+	  r = V::add(r, V::add(V::mul(c2, V::template splat<2>(p)), c3));
+	  r = V::add(r, V::mul(ca, V::template splat<3>(p)));
+	  return V::cvt(V::mul(V::min(V::max(r, zero), one), scale));
+	};
+	int x = 0;
+	for (; x + step <= w; x += step) {
+	  const I v = V::load(s + 4 * x);
+	  const I lo = V::lo8(v);
+	  const I hi = V::hi8(v);
+	  const I a = V::packs32(transform(V::lo16(lo)), transform(V::hi16(lo)));
+	  const I b = V::packs32(transform(V::lo16(hi)), transform(V::hi16(hi)));
+	  V::store(o + 4 * x, V::packus16(a, b));
+	}
+	return x;
+      }
+#endif
+
+      // for_each_band用のスレッドの集まり
+      // 一度作ったスレッドはプログラムの終了まで待機させて使い回す(呼び出し毎に作らない)
+      // run()は1度に1つだけ(複数のスレッドから呼ばれたら順番に実行)
+      class BandPool {
+      public:
+	BandPool() = default;
+	~BandPool()
+	{
+	  {
+	    std::lock_guard<std::mutex> lock(mutex_);
+	    stop_ = true;
+	  }
+	  wake_.notify_all();
+	  for (auto& th : workers_) {
+	    th.join();
+	  }
+	}
+
+	BandPool(const BandPool&) = delete;
+	BandPool& operator=(const BandPool&) = delete;
+
+	// job(0) ... job(threads - 1)を並列に実行して全て終わるまで待つ(job(0)は呼び出したスレッドで)
+	void run(unsigned threads, const std::function<void(unsigned)>& job)
+	{
+	  std::lock_guard<std::mutex> run_lock(run_mutex_);
+	  {
+	    std::lock_guard<std::mutex> lock(mutex_);
+	    // 足りない分だけ作る
+	    while (workers_.size() + 1 < threads) {
+	      const unsigned tid = static_cast<unsigned>(workers_.size()) + 1;
+	      workers_.emplace_back([this, tid]() { work(tid); });
+	    }
+	    job_ = &job;
+	    threads_ = threads;
+	    remaining_ = threads - 1;
+	    ++generation_;
+	  }
+	  wake_.notify_all();
+
+	  job(0);
+
+	  std::unique_lock<std::mutex> lock(mutex_);
+	  done_.wait(lock, [this]() { return remaining_ == 0; });
+	  job_ = nullptr;
+	}
+      private:
+	std::mutex run_mutex_;
+	std::mutex mutex_; // 以下を守る
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	std::vector<std::thread> workers_; // workers_[i]がtid = i + 1
+	const std::function<void(unsigned)>* job_ = nullptr;
+	unsigned threads_ = 0;
+	unsigned remaining_ = 0;
+	unsigned generation_ = 0; // run()毎に増やす
+	bool stop_ = false;
+
+	void work(unsigned tid)
+	{
+	  unsigned seen = 0;
+	  std::unique_lock<std::mutex> lock(mutex_);
+	  for (;;) {
+	    wake_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+	    if (stop_) {
+	      return;
+	    }
+	    seen = generation_;
+	    if (tid >= threads_) {
+	      continue; // 今回は出番なし
+	    }
+	    const std::function<void(unsigned)>& job = *job_;
+	    lock.unlock();
+	    job(tid);
+	    lock.lock();
+	    if (--remaining_ == 0) {
+	      done_.notify_one();
+	    }
+	  }
+	}
+      };
+
+      BandPool& band_pool()
+      {
+	static BandPool pool;
+	return pool;
+      }
+    }
+
+    CpuFilter::CpuFilter(unsigned threads)
+      : threads_(threads ? threads : std::max(std::thread::hardware_concurrency(), 1u))
+    {
+    }
+
+    const char* CpuFilter::simd_name() noexcept
+    {
+#ifdef CPUFILTER_SIMD
+      return Simd::name();
+#else
+      return "scalar";
+#endif
+    }
+
+    // 帯は連続する行(スレッド毎にメモリ上で連続した範囲を読み書きする)
+    template <typename F>
+    void CpuFilter::for_each_band(int height, F f) const
+    {
+      // 1帯が小さすぎると受け渡しの方が高くつくので16行以上にする
+      const unsigned threads = static_cast<unsigned>(std::max(std::min<int>(threads_, height / 16), 1));
+      if (threads == 1) {
+	f(0, height);
+	return;
+      }
+      band_pool().run(threads, [&](unsigned tid) {
+	  f(static_cast<int>(height * tid / threads), static_cast<int>(height * (tid + 1) / threads));
+	});
+    }
+
+    template <typename Row>
+    void CpuFilter::neighborhood(const CpuImage& src, CpuImage& dst, Row row) const
+    {
+      const int w = src.width;
+      const int h = src.height;
+      dst = CpuImage(w, h);
+      if (w == 0 || h == 0) {
+	return;
+      }
+
+      for_each_band(h, [&](int y0, int y1) {
+	  // 上中下の3行を左右に1画素ずつ延長して写す
+	  std::vector<unsigned char> pad[3];
+	  const unsigned char* rows[3];
+	  for (int k = 0; k < 3; ++k) {
+	    pad[k].resize(4 * (w + 2));
+	    rows[k] = pad[k].data();
+	  }
+	  for (int y = y0; y < y1; ++y) {
+	    for (int k = 0; k < 3; ++k) {
+	      const unsigned char* s = src.row(std::min(std::max(y - 1 + k, 0), h - 1));
+	      unsigned char* p = pad[k].data();
+	      memcpy(p + 4, s, 4 * w);
+	      memcpy(p, s, 4);
+	      memcpy(p + 4 * (w + 1), s + 4 * (w - 1), 4);
+	    }
+	    row(rows, dst.row(y), w);
+	  }
+	});
+    }
+
+    void CpuFilter::invert(const CpuImage& src, CpuImage& dst) const
+    {
+      const int w = src.width;
+      dst = CpuImage(w, src.height);
+      for_each_band(src.height, [&](int y0, int y1) {
+	  for (int y = y0; y < y1; ++y) {
+	    const unsigned char* s = src.row(y);
+	    unsigned char* o = dst.row(y);
+	    int x = 0;
+#ifdef CPUFILTER_SIMD
+	    x = invert_simd<Simd>(s, o, w);
+#endif
+	    for (; x < w; ++x) {
+	      for (int c = 0; c < 4; ++c) {
+		o[4 * x + c] = 255 - s[4 * x + c];
+	      }
+	    }
+	  }
+	});
+    }
+
+    void CpuFilter::mean3x3(const CpuImage& src, CpuImage& dst) const
+    {
+      neighborhood(src, dst, [](Rows r, unsigned char* o, int w) {
+	  int x = 0;
+#ifdef CPUFILTER_SIMD
+	  x = mean_simd<Simd>(r, o, w);
+#endif
+	  for (; x < w; ++x) {
+	    mean_pixel(r, o, x);
+	  }
+	});
+    }
+
+    void CpuFilter::laplacian(const CpuImage& src, CpuImage& dst) const
+    {
+      neighborhood(src, dst, [](Rows r, unsigned char* o, int w) {
+	  int x = 0;
+#ifdef CPUFILTER_SIMD
+	  x = laplacian_simd<Simd>(r, o, w);
+#endif
+	  for (; x < w; ++x) {
+	    laplacian_pixel(r, o, x);
+	  }
+	});
+    }
+
+    void CpuFilter::sobel(const CpuImage& src, CpuImage& dst) const
+    {
+      neighborhood(src, dst, [](Rows r, unsigned char* o, int w) {
+	  int x = 0;
+#ifdef CPUFILTER_SIMD
+	  x = sobel_simd<Simd>(r, o, w);
+#endif
+	  for (; x < w; ++x) {
+	    sobel_pixel(r, o, x);
+	  }
+	});
+    }
+
+    void CpuFilter::color_matrix(const glm::mat4& m, const CpuImage& src, CpuImage& dst) const
+    {
+      const int w = src.width;
+      dst = CpuImage(w, src.height);
+      for_each_band(src.height, [&](int y0, int y1) {
+	  for (int y = y0; y < y1; ++y) {
+	    const unsigned char* s = src.row(y);
+	    unsigned char* o = dst.row(y);
+	    int x = 0;
+#ifdef CPUFILTER_SIMD
+	    x = color_matrix_simd<Simd>(m, s, o, w);
+#endif
+	    for (; x < w; ++x) {
+	      color_matrix_pixel(m, s, o, x);
+	    }
+	  }
+	});
+    }
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef INCLUDED_CPUFILTER_HPP
+#define INCLUDED_CPUFILTER_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace nekolib {
+  namespace renderer {
+    // rgba8の画像(行優先, 上下の向きは問わない)
+    struct CpuImage {
+      int width = 0;
+      int height = 0;
+      std::vector<unsigned char> pixels;
+
+      CpuImage() = default;
+      CpuImage(int w, int h) : width(w), height(h), pixels(static_cast<size_t>(w) * h * 4) {}
+      unsigned char* row(int y) { return pixels.data() + static_cast<size_t>(y) * width * 4; }
+      const unsigned char* row(int y) const { return pixels.data() + static_cast<size_t>(y) * width * 4; }
+    };
+
+    // CPU版の画像フィルタ(shader/invert.cs, colormatrix.cs, Convolutionの
+    // Mean3x3/Laplacian/Sobelと同じ計算)
+    // GLの無い環境での一括処理とシェーダーの検算用
+    //
+    // 画像を行の帯に分けて各スレッドに割り当てる
+    // 各行は端を延長した3行分のバッファに写してからSSE2(AVX2付きでビルドすればAVX2)で
+    // 16(32)byteずつまとめて計算する(SIMDが使えなければ1画素ずつ)
+    //
+    // GPU版との差
+    //  invert, laplacian : 一致(整数で計算できるため)
+    //  mean3x3, sobel, color_matrix : 各成分±1以内(floatの丸め順序と
+    //  rgba8への変換時の丸め方の実装差)
+    // 結果のalphaはGPU版と同じくinvertは反転, color_matrixは元のまま, それ以外は255
+    class CpuFilter {
+    public:
+      // threads = 0ならstd::thread::hardware_concurrency()
+      explicit CpuFilter(unsigned threads = 0);
+      ~CpuFilter() = default;
+
+      CpuFilter(const CpuFilter&) = delete;
+      CpuFilter& operator=(const CpuFilter&) = delete;
+
+      // dstはsrcと同じ大きさに作り直される(src == dstは不可)
+      void invert(const CpuImage& src, CpuImage& dst) const;
+      void mean3x3(const CpuImage& src, CpuImage& dst) const;
+      void laplacian(const CpuImage& src, CpuImage& dst) const;
+      void sobel(const CpuImage& src, CpuImage& dst) const;
+      // rgbをm * vec4(rgb, 1)に(SceneColorMatrixのColorMatrix)
+      void color_matrix(const glm::mat4& m, const CpuImage& src, CpuImage& dst) const;
+
+      unsigned threads() const noexcept { return threads_; }
+      // ビルド時に有効だった命令セット("avx2", "sse2", "scalar")
+      static const char* simd_name() noexcept;
+
+    private:
+      const unsigned threads_;
+
+      // 行[0, height)を帯に分けてf(y0, y1)を各スレッドで実行(スレッドは作り置きを使い回す)
+      template <typename F>
+      void for_each_band(int height, F f) const;
+      // 3x3近傍を使うフィルタの共通部分
+      template <typename Row>
+      void neighborhood(const CpuImage& src, CpuImage& dst, Row row) const;
+    };
+  }
+}
+
+#endif // INCLUDED_CPUFILTER_HPP
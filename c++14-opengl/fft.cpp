@@ -0,0 +1,82 @@
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "fft.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    bool Fft::init()
+    {
+      using Names = std::vector<std::string>;
+
+      row_shared_prog_.define("SHARED");
+      if (!row_shared_prog_.build_program_from_files(Names{ "shader/fft.cs" })) {
+	return false;
+      }
+      column_shared_prog_.define("SHARED");
+      column_shared_prog_.define("VERTICAL");
+      if (!column_shared_prog_.build_program_from_files(Names{ "shader/fft.cs" })) {
+	return false;
+      }
+      if (!row_pass_prog_.build_program_from_files(Names{ "shader/fft.cs" })) {
+	return false;
+      }
+      column_pass_prog_.define("VERTICAL");
+      if (!column_pass_prog_.build_program_from_files(Names{ "shader/fft.cs" })) {
+	return false;
+      }
+
+      return true;
+    }
+
+    Texture Fft::transform(const Texture& data, const Texture& work, int direction)
+    {
+      Texture in = data, out = work;
+      transform_1d(false, direction, in, out);
+      transform_1d(true, direction, in, out);
+      check_gl_error(__FILE__, __LINE__);
+      return in;
+    }
+
+#define PASS_WORKGROUP_SIZE 64
+    // in -> out(終わったらinとoutを入れ替えて, 結果は常にin)
+    void Fft::transform_1d(bool vertical, int direction, Texture& in, Texture& out)
+    {
+      const int n = vertical ? in.height() : in.width();
+      const int lines = vertical ? in.width() : in.height();
+
+      if (n <= shared_max_) {
+	Program& prog = vertical ? column_shared_prog_ : row_shared_prog_;
+	prog.use();
+	prog.set_uniform("n", n);
+	prog.set_uniform("direction", static_cast<float>(direction));
+	glBindImageTexture(0, in.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+	glBindImageTexture(1, out.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	glDispatchCompute(lines, 1, 1);
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	std::swap(in, out);
+	return;
+      }
+
+      Program& prog = vertical ? column_pass_prog_ : row_pass_prog_;
+      prog.use();
+      prog.set_uniform("n", n);
+      prog.set_uniform("direction", static_cast<float>(direction));
+      for (int p = 1; p < n; ) {
+	const int radix = (n / p >= 4) ? 4 : 2;
+	prog.set_uniform("stride", p);
+	prog.set_uniform("pass_radix", radix);
+	glBindImageTexture(0, in.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32F);
+	glBindImageTexture(1, out.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+	glDispatchCompute((n / radix + PASS_WORKGROUP_SIZE - 1) / PASS_WORKGROUP_SIZE, lines, 1);
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	std::swap(in, out);
+	p *= radix;
+      }
+    }
+  }
+}
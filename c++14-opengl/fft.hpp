@@ -0,0 +1,43 @@
+#ifndef INCLUDED_FFT_HPP
+#define INCLUDED_FFT_HPP
+
+#include <glad/glad.h>
+
+#include "program.hpp"
+#include "texture.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // RGBA32Fの画像の2次元FFT(shader/fft.cs)
+    // 各texelに複素数2個(xy, zw)を持ち, 行方向 -> 列方向の順に変換する
+    // 幅と高さは2のべき
+    // 長さshared_max_までの行(列)は1 workgroupが共有メモリ上で全段を計算し,
+    // それより長ければradix 4の1段毎にdispatchする
+    class Fft {
+    public:
+      Fft() = default;
+      ~Fft() = default;
+
+      Fft(const Fft&) = delete;
+      Fft& operator=(const Fft&) = delete;
+
+      bool init();
+
+      // dataを変換する(workは同じ大きさの作業用)
+      // 結果はdataかworkのどちらかに入るのでそれを返す
+      // direction -1 : 順変換, 1 : 逆変換(1 / (幅 x 高さ)は掛けない)
+      Texture transform(const Texture& data, const Texture& work, int direction);
+
+      static const int shared_max_ = 1024; // shader/fft.csのSHARED_MAX
+    private:
+      Program row_shared_prog_;
+      Program column_shared_prog_;
+      Program row_pass_prog_;
+      Program column_pass_prog_;
+
+      void transform_1d(bool vertical, int direction, Texture& in, Texture& out);
+    };
+  }
+}
+
+#endif // INCLUDED_FFT_HPP
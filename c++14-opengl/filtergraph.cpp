@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+#include <glad/glad.h>
+
+#include "filtergraph.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    Texture TexturePool::acquire(int width, int height)
+    {
+      for (auto it = free_.begin(); it != free_.end(); ++it) {
+	if (it->width() == width && it->height() == height) {
+	  Texture t = *it;
+	  free_.erase(it);
+	  return t;
+	}
+      }
+      ++created_;
+      return Texture::create(width, height, TextureFormat::RGBA8);
+    }
+
+    void TexturePool::release(const Texture& t)
+    {
+      if (!t) {
+	return;
+      }
+      auto other_size = [&t](const Texture& f) { return f.width() != t.width() || f.height() != t.height(); };
+      free_.erase(std::remove_if(free_.begin(), free_.end(), other_size), free_.end());
+      free_.push_back(t);
+      const size_t max_free = max_free_;
+      if (free_.size() > max_free) {
+	free_.erase(free_.begin(), free_.end() - max_free);
+      }
+    }
+
+    size_t ProgramFilter::hash() const
+    {
+      size_t h = reinterpret_cast<size_t>(&prog_);
+      return matrix_name_ ? hash_bytes(h, &matrix_) : h;
+    }
+
+#define WORKGROUP_SIZE 16
+    void ProgramFilter::apply(const Texture& src, const Texture& dst)
+    {
+      prog_.use();
+      if (matrix_name_) {
+	prog_.set_uniform(matrix_name_, matrix_);
+      }
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    ConvolutionFilter::ConvolutionFilter(Convolution& conv, const ConvKernel& a)
+      : conv_(conv), a_(a), magnitude_(false), b_(a)
+    {
+      rehash();
+    }
+
+    ConvolutionFilter::ConvolutionFilter(Convolution& conv, const ConvKernel& a, const ConvKernel& b)
+      : conv_(conv), a_(a), magnitude_(true), b_(b)
+    {
+      rehash();
+    }
+
+    void ConvolutionFilter::set_kernel(const ConvKernel& a)
+    {
+      a_ = a;
+      rehash();
+    }
+
+    void ConvolutionFilter::rehash()
+    {
+      size_t h = hash_combine(a_.width(), a_.height());
+      h = hash_bytes(h, a_.weights().data(), a_.weights().size());
+      const float sb[] = { a_.scale(), a_.bias() };
+      h = hash_bytes(h, sb, 2);
+      if (magnitude_) {
+	h = hash_bytes(h, b_.weights().data(), b_.weights().size());
+      }
+      kernel_hash_ = h;
+    }
+
+    size_t ConvolutionFilter::hash() const
+    {
+      // 2次元/分離2パス/FFTで結果がわずかに変わるのでforce_2d, force_fftも含める
+      return hash_combine(kernel_hash_, (conv_.force_2d ? 1 : 0) | (conv_.force_fft ? 2 : 0));
+    }
+
+    int ConvolutionFilter::footprint() const
+    {
+      int r = std::max(a_.radius_x(), a_.radius_y());
+      if (magnitude_) {
+	r = std::max({ r, b_.radius_x(), b_.radius_y() });
+      }
+      return r;
+    }
+
+    void ConvolutionFilter::apply(const Texture& src, const Texture& dst)
+    {
+      if (magnitude_) {
+	conv_.apply_magnitude(a_, b_, src, dst);
+      } else {
+	conv_.apply(a_, src, dst);
+      }
+    }
+
+    void FilterGraph::set_chain(const std::vector<FilterNode*>& nodes)
+    {
+      size_t n = 0;
+      for (auto node : nodes) {
+	if (!node) {
+	  continue;
+	}
+	if (n < stages_.size()) {
+	  if (stages_[n].node != node) {
+	    stages_[n].node = node;
+	    stages_[n].key = 0;
+	  }
+	} else {
+	  stages_.push_back(Stage{ node, 0, Texture() });
+	}
+	++n;
+      }
+      // 余った段の出力はpoolへ返す
+      for (size_t i = n; i < stages_.size(); ++i) {
+	pool_.release(stages_[i].output);
+      }
+      stages_.resize(n);
+    }
+
+    const Texture& FilterGraph::evaluate()
+    {
+      assert(source_);
+      computed_ = 0;
+
+      size_t key = hash_combine(source_.handle(), source_version_);
+      const Texture* input = &source_;
+      for (auto& s : stages_) {
+	key = hash_combine(key, reinterpret_cast<size_t>(s.node));
+	key = hash_combine(key, s.node->hash());
+	if (!s.output || s.output.width() != input->width() || s.output.height() != input->height()) {
+	  pool_.release(s.output);
+	  s.output = pool_.acquire(input->width(), input->height());
+	  s.key = 0;
+	}
+	if (s.key != key) {
+	  s.node->apply(*input, s.output);
+	  s.key = key;
+	  ++computed_;
+	}
+	input = &s.output;
+      }
+      if (computed_ > 0) {
+	check_gl_error(__FILE__, __LINE__);
+      }
+
+      return *input;
+    }
+  }
+}
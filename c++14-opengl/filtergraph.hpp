@@ -0,0 +1,136 @@
+#ifndef INCLUDED_FILTERGRAPH_HPP
+#define INCLUDED_FILTERGRAPH_HPP
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "program.hpp"
+#include "texture.hpp"
+#include "convolution.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // hash値の合成(boost::hash_combineと同じ)
+    inline size_t hash_combine(size_t seed, size_t v) noexcept
+    {
+      return seed ^ (v + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+    }
+    // floatやmat4等はbit列をそのままhashする
+    template <typename T>
+    size_t hash_bytes(size_t seed, const T* p, size_t n = 1) noexcept
+    {
+      const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+      for (size_t i = 0; i < sizeof(T) * n; ++i) {
+	seed = hash_combine(seed, b[i]);
+      }
+      return seed;
+    }
+
+    // 中間結果用のrgba8テクスチャの使い回し
+    class TexturePool {
+    public:
+      // 同じ大きさの空きがあればそれを, なければ新しく作る
+      Texture acquire(int width, int height);
+      // 返したものと大きさの違う空きは捨てる(元画像の大きさが変わった後に古い大きさを溜めない)
+      // 空きがmax_free_個を超えたら古い方から捨てる
+      void release(const Texture&);
+      void clear() { free_.clear(); }
+      size_t created() const noexcept { return created_; }
+
+      static const size_t max_free_ = 8;
+    private:
+      std::vector<Texture> free_;
+      size_t created_ = 0;
+    };
+
+    // フィルタの1段(rgba8 -> rgba8)
+    // hash()はパラメータが変わった時だけ変わる値を返すこと
+    class FilterNode {
+    public:
+      virtual ~FilterNode() = default;
+      virtual size_t hash() const = 0;
+      virtual void apply(const Texture& src, const Texture& dst) = 0;
+      // 1画素の結果に使う周囲の画素の範囲(タイル分割時の余白, tiled.hpp)
+      // 格子に依存するフィルタでは目安で, タイル分割の継ぎ目は厳密には一致しない
+      // 画像全体に依存してタイルに分けられないなら負
+      virtual int footprint() const { return 0; }
+    };
+
+    // 1パスのcompute shader(16x16, image unit 0 -> 1)
+    // uniformはmat4を1個まで
+    class ProgramFilter : public FilterNode {
+    public:
+      explicit ProgramFilter(Program& prog, const char* matrix_name = nullptr)
+	: prog_(prog), matrix_name_(matrix_name), matrix_(1.f) {}
+
+      void set_matrix(const glm::mat4& m) { matrix_ = m; }
+
+      size_t hash() const override;
+      void apply(const Texture& src, const Texture& dst) override;
+    private:
+      Program& prog_;
+      const char* matrix_name_;
+      glm::mat4 matrix_;
+    };
+
+    // Convolutionによる畳み込み(bがあれば2個の係数の結果の大きさ)
+    class ConvolutionFilter : public FilterNode {
+    public:
+      ConvolutionFilter(Convolution& conv, const ConvKernel& a);
+      ConvolutionFilter(Convolution& conv, const ConvKernel& a, const ConvKernel& b);
+
+      void set_kernel(const ConvKernel& a);
+
+      size_t hash() const override;
+      void apply(const Texture& src, const Texture& dst) override;
+      int footprint() const override;
+    private:
+      Convolution& conv_;
+      ConvKernel a_;
+      bool magnitude_;
+      ConvKernel b_;
+      size_t kernel_hash_; // 係数は大きいので設定時に計算しておく
+
+      void rehash();
+    };
+
+    // FilterNodeを直列につないだもの
+    // 各段の出力は保持しておき, 元画像と上流の全段のhashを合成した値が
+    // 前回と変わった段(とその下流)だけを計算し直す
+    // 何も変わっていなければGPUの仕事は結果の表示だけになる
+    class FilterGraph {
+    public:
+      FilterGraph() = default;
+      FilterGraph(const FilterGraph&) = delete;
+      FilterGraph& operator=(const FilterGraph&) = delete;
+
+      // 元画像(中身を書き換えた時はtouch_source()を呼ぶ)
+      void set_source(const Texture& src) { source_ = src; }
+      void touch_source() noexcept { ++source_version_; }
+
+      // 段の並びを設定(nodeの寿命は呼び出し側で管理, nullptrは飛ばす)
+      void set_chain(const std::vector<FilterNode*>& nodes);
+
+      // 変更のあった段から下流を計算して最終結果を返す
+      const Texture& evaluate();
+
+      // 前回のevaluateで計算した段の数
+      int computed() const noexcept { return computed_; }
+      size_t pooled_textures() const noexcept { return pool_.created(); }
+    private:
+      struct Stage {
+	FilterNode* node;
+	size_t key; // 上流を含めたhash
+	Texture output;
+      };
+      Texture source_;
+      unsigned source_version_ = 0;
+      std::vector<Stage> stages_;
+      TexturePool pool_;
+      int computed_ = 0;
+    };
+  }
+}
+
+#endif // INCLUDED_FILTERGRAPH_HPP
@@ -274,6 +274,40 @@ namespace nekolib {
 	}
       };
 
+      // 汎用バッファ
+      // SSBO, PBO, 間接描画引数等の用途が決まっていないもの用
+      class Buffer {
+      private:
+	GLuint handle_;
+      public:
+	Buffer() : handle_(0) {
+	  glGenBuffers(1, &handle_);
+	}
+	~Buffer() noexcept {
+	  glDeleteBuffers(1, &handle_);
+	}
+
+	Buffer(const Buffer&) = delete;
+	Buffer& operator=(const Buffer&) = delete;
+	Buffer(Buffer&& rhs) noexcept {
+	  handle_ = rhs.handle_;
+	  rhs.handle_ = 0;
+	}
+	Buffer& operator=(Buffer&& rhs) noexcept {
+	  handle_ = rhs.handle_;
+	  rhs.handle_ = 0;
+	  return *this;
+	}
+
+	GLuint handle() const noexcept { return handle_; }
+	void bind(GLenum target) const {
+	  glBindBuffer(target, handle_);
+	}
+	void bind_base(GLenum target, GLuint bp) const {
+	  glBindBufferBase(target, bp, handle_);
+	}
+      };
+
     }
   }
 }
@@ -0,0 +1,595 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "gpuprim.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    namespace {
+      const unsigned scan_block_size = 512; // scan 1 workgroupで処理する要素数
+      const unsigned reduce_block_size = 256;
+      const unsigned reduce_items = 4; // reduce 1スレッドが読む要素数
+      const unsigned radix_block_size = 256;
+      const unsigned radix_bits = 4;
+      const unsigned radix_buckets = 1u << radix_bits;
+
+      unsigned blocks(unsigned n, unsigned size) { return (n + size - 1) / size; }
+
+      // 生成したGLSLから計算シェーダーを作る
+      bool build_compute(Program& prog, const std::string& source)
+      {
+	if (!prog.compile_shader_from_string(source, ShaderType::COMPUTE)) {
+	  fprintf(stderr, "Compiling compute shader failed.\n%s\n%s\n", prog.log().c_str(), source.c_str());
+	  return false;
+	}
+	if (!prog.link()) {
+	  fprintf(stderr, "Linking shader program failed.\n%s\n", prog.log().c_str());
+	  return false;
+	}
+	if (!prog.valid()) {
+	  fprintf(stderr, "Validating program failed.\n%s\n", prog.log().c_str());
+	  return false;
+	}
+	return true;
+      }
+
+      // 型と演算の定義部分
+      std::string op_header(const GpuOpDesc& desc, unsigned local_size)
+      {
+	return "#version 430 core\n"
+	  "layout(local_size_x = " + std::to_string(local_size) + ", local_size_y = 1, local_size_z = 1) in;\n"
+	  "#define T " + desc.type + "\n"
+	  "const T IDENTITY = T(" + desc.identity + ");\n"
+	  "T op(T a, T b) { return " + desc.op + "; }\n";
+      }
+
+      void allocate(gl::Buffer& buffer, GLsizeiptr size)
+      {
+	buffer.bind(GL_SHADER_STORAGE_BUFFER);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+      }
+    }
+
+    namespace detail {
+      // 1 workgroup(scan_block_size / 2スレッド)でscan_block_size個を
+      // Blelloch法(up-sweep/down-sweep, 演算の回数はO(n))でscanし
+      // ブロックの合計を1段上の階層として再帰的にscanしてから足し戻す
+      ScanImpl::ScanImpl(const GpuOpDesc& desc, unsigned capacity)
+	: desc_(desc), capacity_(capacity)
+      {
+	for (unsigned n = capacity; n > scan_block_size; ) {
+	  n = blocks(n, scan_block_size);
+	  sums_.emplace_back();
+	  allocate(sums_.back(), desc_.size * n);
+	}
+      }
+
+      bool ScanImpl::init()
+      {
+	const std::string block = std::to_string(scan_block_size);
+	return build_compute(prog_, op_header(desc_, scan_block_size / 2) +
+			     "layout(std430, binding = 0) buffer Src { T src[]; };\n"
+			     "layout(std430, binding = 1) buffer Dst { T dst[]; };\n"
+			     "layout(std430, binding = 2) buffer Sums { T sums[]; };\n"
+			     "uniform uint n;\n"
+			     "uniform uint stage; // 0 : ブロック内のscan, 1 : ブロックの先頭を足す\n"
+			     "uniform bool inclusive;\n"
+			     "uniform bool write_sums;\n"
+			     "const uint BLOCK = " + block + "u;\n"
+			     "const uint HALF = BLOCK / 2u; // 1スレッド2要素\n"
+			     "shared T temp[BLOCK];\n"
+			     "void main()\n"
+			     "{\n"
+			     "  const uint lid = gl_LocalInvocationID.x;\n"
+			     "  const uint i0 = gl_WorkGroupID.x * BLOCK + lid;\n"
+			     "  const uint i1 = i0 + HALF;\n"
+			     "  if (stage == 1u) {\n"
+			     "    const T s = sums[gl_WorkGroupID.x];\n"
+			     "    if (i0 < n) {\n"
+			     "      dst[i0] = op(s, dst[i0]);\n"
+			     "    }\n"
+			     "    if (i1 < n) {\n"
+			     "      dst[i1] = op(s, dst[i1]);\n"
+			     "    }\n"
+			     "    return;\n"
+			     "  }\n"
+			     "  const T a0 = (i0 < n) ? src[i0] : IDENTITY;\n"
+			     "  const T a1 = (i1 < n) ? src[i1] : IDENTITY;\n"
+			     "  temp[lid] = a0;\n"
+			     "  temp[lid + HALF] = a1;\n"
+			     "  // up-sweep : 部分木の合計を右端へ\n"
+			     "  uint offset = 1u;\n"
+			     "  for (uint d = HALF; d > 0u; d >>= 1) {\n"
+			     "    barrier();\n"
+			     "    if (lid < d) {\n"
+			     "      const uint ai = offset * (2u * lid + 1u) - 1u;\n"
+			     "      const uint bi = ai + offset;\n"
+			     "      temp[bi] = op(temp[ai], temp[bi]);\n"
+			     "    }\n"
+			     "    offset <<= 1;\n"
+			     "  }\n"
+			     "  barrier();\n"
+			     "  if (lid == 0u) {\n"
+			     "    if (write_sums) {\n"
+			     "      sums[gl_WorkGroupID.x] = temp[BLOCK - 1u];\n"
+			     "    }\n"
+			     "    temp[BLOCK - 1u] = IDENTITY;\n"
+			     "  }\n"
+			     "  // down-sweep : 左の子へ親の値, 右の子へ親の値 op 左の部分木の合計\n"
+			     "  for (uint d = 1u; d < BLOCK; d <<= 1) {\n"
+			     "    offset >>= 1;\n"
+			     "    barrier();\n"
+			     "    if (lid < d) {\n"
+			     "      const uint ai = offset * (2u * lid + 1u) - 1u;\n"
+			     "      const uint bi = ai + offset;\n"
+			     "      const T t = temp[ai];\n"
+			     "      temp[ai] = temp[bi];\n"
+			     "      temp[bi] = op(temp[bi], t);\n"
+			     "    }\n"
+			     "  }\n"
+			     "  barrier();\n"
+			     "  // temp[]は排他的scan\n"
+			     "  if (i0 < n) {\n"
+			     "    dst[i0] = inclusive ? op(temp[lid], a0) : temp[lid];\n"
+			     "  }\n"
+			     "  if (i1 < n) {\n"
+			     "    dst[i1] = inclusive ? op(temp[lid + HALF], a1) : temp[lid + HALF];\n"
+			     "  }\n"
+			     "}\n");
+      }
+
+      void ScanImpl::run(GLuint src, GLuint dst, unsigned n, bool inclusive)
+      {
+	assert(n <= capacity_);
+	if (n == 0) {
+	  return;
+	}
+	scan_level(src, dst, n, 0, inclusive);
+	check_gl_error(__FILE__, __LINE__);
+      }
+
+      void ScanImpl::scan_level(GLuint src, GLuint dst, unsigned n, size_t level, bool inclusive)
+      {
+	const unsigned block_num = blocks(n, scan_block_size);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, src);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, dst);
+	if (block_num > 1) {
+	  sums_[level].bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+	}
+	prog_.use();
+	prog_.set_uniform("n", n);
+	prog_.set_uniform("stage", 0u);
+	prog_.set_uniform("inclusive", inclusive ? 1 : 0);
+	prog_.set_uniform("write_sums", block_num > 1 ? 1 : 0);
+	glDispatchCompute(block_num, 1, 1);
+	if (block_num == 1) {
+	  return;
+	}
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// ブロックの合計の排他的scanが各ブロックの先頭になる
+	const GLuint sums = sums_[level].handle();
+	scan_level(sums, sums, block_num, level + 1, false);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// 上の階層で結合ポイントが変わっているので結び直す
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, dst);
+	sums_[level].bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+	prog_.use();
+	prog_.set_uniform("n", n);
+	prog_.set_uniform("stage", 1u);
+	glDispatchCompute(block_num, 1, 1);
+      }
+
+      // 1 workgroupでreduce_block_size * reduce_items個を畳み込み
+      // workgroup毎の結果を1個になるまで繰り返し畳み込む
+      ReduceImpl::ReduceImpl(const GpuOpDesc& desc, unsigned capacity)
+	: desc_(desc)
+      {
+	const unsigned n = blocks(capacity, reduce_block_size * reduce_items);
+	for (auto& p : partial_) {
+	  allocate(p, desc_.size * n);
+	}
+      }
+
+      bool ReduceImpl::init()
+      {
+	return build_compute(prog_, op_header(desc_, reduce_block_size) +
+			     "layout(std430, binding = 0) buffer Src { T src[]; };\n"
+			     "layout(std430, binding = 1) buffer Dst { T dst[]; };\n"
+			     "uniform uint n;\n"
+			     "uniform uint dst_index;\n"
+			     "const uint BLOCK = " + std::to_string(reduce_block_size) + "u;\n"
+			     "const uint ITEMS = " + std::to_string(reduce_items) + "u;\n"
+			     "shared T temp[BLOCK];\n"
+			     "void main()\n"
+			     "{\n"
+			     "  const uint lid = gl_LocalInvocationID.x;\n"
+			     "  const uint base = gl_WorkGroupID.x * BLOCK * ITEMS + lid;\n"
+			     "  T a = IDENTITY;\n"
+			     "  for (uint k = 0u; k < ITEMS; ++k) {\n"
+			     "    uint i = base + k * BLOCK;\n"
+			     "    if (i < n) {\n"
+			     "      T b = src[i];\n"
+			     "      a = op(a, b);\n"
+			     "    }\n"
+			     "  }\n"
+			     "  temp[lid] = a;\n"
+			     "  barrier();\n"
+			     "  for (uint s = BLOCK / 2u; s > 0u; s >>= 1) {\n"
+			     "    if (lid < s) {\n"
+			     "      T b = temp[lid + s];\n"
+			     "      a = temp[lid];\n"
+			     "      temp[lid] = op(a, b);\n"
+			     "    }\n"
+			     "    barrier();\n"
+			     "  }\n"
+			     "  if (lid == 0u) {\n"
+			     "    dst[dst_index + gl_WorkGroupID.x] = temp[0];\n"
+			     "  }\n"
+			     "}\n");
+      }
+
+      void ReduceImpl::run(GLuint src, unsigned n, GLuint dst, unsigned dst_index)
+      {
+	prog_.use();
+	unsigned p = 0;
+	for (;;) {
+	  const unsigned block_num = std::max(1u, blocks(n, reduce_block_size * reduce_items));
+	  const bool last = (block_num == 1);
+
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, src);
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, last ? dst : partial_[p].handle());
+	  prog_.set_uniform("n", n);
+	  prog_.set_uniform("dst_index", last ? dst_index : 0u);
+	  glDispatchCompute(block_num, 1, 1);
+	  if (last) {
+	    break;
+	  }
+	  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	  src = partial_[p].handle();
+	  n = block_num;
+	  p = 1 - p;
+	}
+	check_gl_error(__FILE__, __LINE__);
+      }
+    }
+
+    GpuArgMin::GpuArgMin(unsigned capacity)
+    {
+      const unsigned n = blocks(capacity, reduce_block_size * reduce_items);
+      for (auto& p : partial_) {
+	allocate(p, sizeof(Result) * n);
+      }
+    }
+
+    bool GpuArgMin::init()
+    {
+      return build_compute(prog_, "#version 430 core\n"
+			   "layout(local_size_x = " + std::to_string(reduce_block_size) + ", local_size_y = 1, local_size_z = 1) in;\n"
+			   "struct Result { float value; uint index; };\n"
+			   "layout(std430, binding = 0) buffer Values { float values[]; }; // 最初のパスの入力\n"
+			   "layout(std430, binding = 1) buffer Dst { Result dst[]; };\n"
+			   "layout(std430, binding = 2) buffer Src { Result src[]; }; // 2回目以降の入力\n"
+			   "uniform uint n;\n"
+			   "uniform uint dst_index;\n"
+			   "uniform bool first;\n"
+			   "const uint BLOCK = " + std::to_string(reduce_block_size) + "u;\n"
+			   "const uint ITEMS = " + std::to_string(reduce_items) + "u;\n"
+			   "shared float temp_value[BLOCK];\n"
+			   "shared uint temp_index[BLOCK];\n"
+			   "// 同じ値なら添字の小さい方\n"
+			   "bool less(float va, uint ia, float vb, uint ib) { return va < vb || (va == vb && ia < ib); }\n"
+			   "void main()\n"
+			   "{\n"
+			   "  const uint lid = gl_LocalInvocationID.x;\n"
+			   "  const uint base = gl_WorkGroupID.x * BLOCK * ITEMS + lid;\n"
+			   "  float v = 3.402823466e+38;\n"
+			   "  uint idx = 0xffffffffu;\n"
+			   "  for (uint k = 0u; k < ITEMS; ++k) {\n"
+			   "    uint i = base + k * BLOCK;\n"
+			   "    if (i < n) {\n"
+			   "      float vb = first ? values[i] : src[i].value;\n"
+			   "      uint ib = first ? i : src[i].index;\n"
+			   "      if (less(vb, ib, v, idx)) { v = vb; idx = ib; }\n"
+			   "    }\n"
+			   "  }\n"
+			   "  temp_value[lid] = v;\n"
+			   "  temp_index[lid] = idx;\n"
+			   "  barrier();\n"
+			   "  for (uint s = BLOCK / 2u; s > 0u; s >>= 1) {\n"
+			   "    if (lid < s && less(temp_value[lid + s], temp_index[lid + s], temp_value[lid], temp_index[lid])) {\n"
+			   "      temp_value[lid] = temp_value[lid + s];\n"
+			   "      temp_index[lid] = temp_index[lid + s];\n"
+			   "    }\n"
+			   "    barrier();\n"
+			   "  }\n"
+			   "  if (lid == 0u) {\n"
+			   "    dst[dst_index + gl_WorkGroupID.x] = Result(temp_value[0], temp_index[0]);\n"
+			   "  }\n"
+			   "}\n");
+    }
+
+    void GpuArgMin::argmin(GLuint src, unsigned n, GLuint dst, unsigned dst_index)
+    {
+      prog_.use();
+      bool first = true;
+      unsigned p = 0;
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, src);
+      // 最初のパスでは使わないが何か結び付けておく
+      partial_[1].bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+      for (;;) {
+	const unsigned block_num = std::max(1u, blocks(n, reduce_block_size * reduce_items));
+	const bool last = (block_num == 1);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, last ? dst : partial_[p].handle());
+	prog_.set_uniform("n", n);
+	prog_.set_uniform("dst_index", last ? dst_index : 0u);
+	prog_.set_uniform("first", first ? 1 : 0);
+	glDispatchCompute(block_num, 1, 1);
+	if (last) {
+	  break;
+	}
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	partial_[p].bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+	n = block_num;
+	p = 1 - p;
+	first = false;
+      }
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    // flagを0/1にして排他的scanすると残す要素の行き先になる
+    GpuCompact::GpuCompact(unsigned capacity)
+      : scan_(capacity)
+    {
+      allocate(offsets_, sizeof(GLuint) * capacity);
+    }
+
+    bool GpuCompact::init()
+    {
+      if (!scan_.init()) {
+	return false;
+      }
+      return build_compute(prog_, "#version 430 core\n"
+			   "layout(local_size_x = " + std::to_string(scan_block_size) + ", local_size_y = 1, local_size_z = 1) in;\n"
+			   "layout(std430, binding = 0) buffer Values { readonly uint values[]; };\n"
+			   "layout(std430, binding = 1) buffer Flags { readonly uint flags[]; };\n"
+			   "layout(std430, binding = 2) buffer Offsets { uint offsets[]; };\n"
+			   "layout(std430, binding = 3) buffer Dst { writeonly uint dst[]; };\n"
+			   "layout(std430, binding = 4) buffer Count { writeonly uint count[]; };\n"
+			   "uniform uint n;\n"
+			   "uniform uint stage; // 0 : flagを0/1に, 1 : 詰める\n"
+			   "uniform uint count_index;\n"
+			   "void main()\n"
+			   "{\n"
+			   "  const uint i = gl_GlobalInvocationID.x;\n"
+			   "  if (i >= n) {\n"
+			   "    return;\n"
+			   "  }\n"
+			   "  const uint keep = (flags[i] != 0u) ? 1u : 0u;\n"
+			   "  if (stage == 0u) {\n"
+			   "    offsets[i] = keep;\n"
+			   "    return;\n"
+			   "  }\n"
+			   "  if (keep != 0u) {\n"
+			   "    dst[offsets[i]] = values[i];\n"
+			   "  }\n"
+			   "  if (i == n - 1u) {\n"
+			   "    count[count_index] = offsets[i] + keep;\n"
+			   "  }\n"
+			   "}\n");
+    }
+
+    void GpuCompact::compact(GLuint values, GLuint flags, unsigned n,
+			     GLuint dst, GLuint count, unsigned count_index)
+    {
+      if (n == 0) {
+	GLuint zero = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, count);
+	glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, sizeof(GLuint) * count_index, sizeof(GLuint),
+			     GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return;
+      }
+
+      const unsigned block_num = blocks(n, scan_block_size);
+      auto bind = [&]() {
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, values);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, flags);
+	offsets_.bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, dst);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, count);
+	prog_.use();
+	prog_.set_uniform("n", n);
+	prog_.set_uniform("count_index", count_index);
+      };
+
+      bind();
+      prog_.set_uniform("stage", 0u);
+      glDispatchCompute(block_num, 1, 1);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      scan_.exclusive(offsets_.handle(), offsets_.handle(), n);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      // scanで結合ポイントが変わっているので結び直す
+      bind();
+      prog_.set_uniform("stage", 1u);
+      glDispatchCompute(block_num, 1, 1);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    // 頻度表は桁の値毎にブロックを並べる(histogram[digit * block_num + block])
+    // 排他的scanするとブロック順を保った各桁の値の書き込み先頭になる
+    GpuRadixSort::GpuRadixSort(unsigned capacity)
+      : scan_(radix_buckets * blocks(capacity, radix_block_size)), capacity_(capacity)
+    {
+      allocate(histogram_, sizeof(GLuint) * radix_buckets * blocks(capacity, radix_block_size));
+      allocate(keys_temp_, sizeof(GLuint) * capacity);
+      allocate(values_temp_, sizeof(GLuint) * capacity);
+    }
+
+    bool GpuRadixSort::init()
+    {
+      if (!scan_.init()) {
+	return false;
+      }
+
+      const std::string header = "#version 430 core\n"
+	"layout(local_size_x = " + std::to_string(radix_block_size) + ", local_size_y = 1, local_size_z = 1) in;\n"
+	"const uint BLOCK = " + std::to_string(radix_block_size) + "u;\n"
+	"const uint BUCKETS = " + std::to_string(radix_buckets) + "u;\n"
+	"layout(std430, binding = 0) buffer KeysIn { readonly uint keys_in[]; };\n"
+	"layout(std430, binding = 1) buffer ValuesIn { readonly uint values_in[]; };\n"
+	"layout(std430, binding = 2) buffer KeysOut { writeonly uint keys_out[]; };\n"
+	"layout(std430, binding = 3) buffer ValuesOut { writeonly uint values_out[]; };\n"
+	"layout(std430, binding = 4) buffer Histogram { uint histogram[]; };\n"
+	"uniform uint n;\n"
+	"uniform uint shift; // 今回の桁\n"
+	"uniform uint block_num;\n"
+	"uniform bool has_values;\n";
+
+      if (!build_compute(histogram_prog_, header +
+			 "shared uint counts[BUCKETS];\n"
+			 "void main()\n"
+			 "{\n"
+			 "  const uint i = gl_GlobalInvocationID.x;\n"
+			 "  const uint lid = gl_LocalInvocationID.x;\n"
+			 "  if (lid < BUCKETS) {\n"
+			 "    counts[lid] = 0u;\n"
+			 "  }\n"
+			 "  barrier();\n"
+			 "  if (i < n) {\n"
+			 "    atomicAdd(counts[(keys_in[i] >> shift) & (BUCKETS - 1u)], 1u);\n"
+			 "  }\n"
+			 "  barrier();\n"
+			 "  if (lid < BUCKETS) {\n"
+			 "    histogram[lid * block_num + gl_WorkGroupID.x] = counts[lid];\n"
+			 "  }\n"
+			 "}\n")) {
+	return false;
+      }
+
+      // ブロック内の順位は自分より前の同じ桁の値の個数(安定)
+      // 桁の値毎の0/1のflag(16bitずつ2個を1wordに詰めて16個分で8word)を
+      // ブロック内でBlelloch法で排他的scanすると全ての桁の値の順位が一度に求まる
+      // (ブロック内の個数は256以下なので16bitで溢れない)
+      return build_compute(scatter_prog_, header +
+			   "shared uvec4 ranks[2][BLOCK]; // [0] : 桁の値0-7, [1] : 8-15\n"
+			   "void main()\n"
+			   "{\n"
+			   "  const uint i = gl_GlobalInvocationID.x;\n"
+			   "  const uint lid = gl_LocalInvocationID.x;\n"
+			   "  const uint key = (i < n) ? keys_in[i] : 0u;\n"
+			   "  const uint digit = (i < n) ? ((key >> shift) & (BUCKETS - 1u)) : BUCKETS;\n"
+			   "  uvec4 flag[2] = uvec4[2](uvec4(0u), uvec4(0u));\n"
+			   "  if (digit < BUCKETS) {\n"
+			   "    flag[digit >> 3][(digit >> 1) & 3u] = 1u << ((digit & 1u) * 16u);\n"
+			   "  }\n"
+			   "  ranks[0][lid] = flag[0];\n"
+			   "  ranks[1][lid] = flag[1];\n"
+			   "  uint offset = 1u;\n"
+			   "  for (uint d = BLOCK / 2u; d > 0u; d >>= 1) {\n"
+			   "    barrier();\n"
+			   "    if (lid < d) {\n"
+			   "      const uint ai = offset * (2u * lid + 1u) - 1u;\n"
+			   "      const uint bi = ai + offset;\n"
+			   "      ranks[0][bi] += ranks[0][ai];\n"
+			   "      ranks[1][bi] += ranks[1][ai];\n"
+			   "    }\n"
+			   "    offset <<= 1;\n"
+			   "  }\n"
+			   "  barrier();\n"
+			   "  if (lid == 0u) {\n"
+			   "    ranks[0][BLOCK - 1u] = uvec4(0u);\n"
+			   "    ranks[1][BLOCK - 1u] = uvec4(0u);\n"
+			   "  }\n"
+			   "  for (uint d = 1u; d < BLOCK; d <<= 1) {\n"
+			   "    offset >>= 1;\n"
+			   "    barrier();\n"
+			   "    if (lid < d) {\n"
+			   "      const uint ai = offset * (2u * lid + 1u) - 1u;\n"
+			   "      const uint bi = ai + offset;\n"
+			   "      for (int k = 0; k < 2; ++k) {\n"
+			   "        const uvec4 t = ranks[k][ai];\n"
+			   "        ranks[k][ai] = ranks[k][bi];\n"
+			   "        ranks[k][bi] += t;\n"
+			   "      }\n"
+			   "    }\n"
+			   "  }\n"
+			   "  barrier();\n"
+			   "  if (i >= n) {\n"
+			   "    return;\n"
+			   "  }\n"
+			   "  const uint rank = (ranks[digit >> 3][lid][(digit >> 1) & 3u] >> ((digit & 1u) * 16u)) & 0xffffu;\n"
+			   "  const uint dst = histogram[digit * block_num + gl_WorkGroupID.x] + rank;\n"
+			   "  keys_out[dst] = key;\n"
+			   "  if (has_values) {\n"
+			   "    values_out[dst] = values_in[i];\n"
+			   "  }\n"
+			   "}\n");
+    }
+
+    void GpuRadixSort::sort(GLuint keys, GLuint values, unsigned n)
+    {
+      assert(n <= capacity_);
+      if (n <= 1) {
+	return;
+      }
+
+      const unsigned block_num = blocks(n, radix_block_size);
+      const bool has_values = (values != 0);
+      // 値が無い時も何か結び付けておく
+      const GLuint values_in[2] = { has_values ? values : values_temp_.handle(), values_temp_.handle() };
+      const GLuint keys_in[2] = { keys, keys_temp_.handle() };
+
+      // 8パス(偶数回)なので最後は元のバッファに戻る
+      for (unsigned pass = 0; pass < 32 / radix_bits; ++pass) {
+	const unsigned src = pass & 1, dst = 1 - src;
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, keys_in[src]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, values_in[src]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, keys_in[dst]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, values_in[dst]);
+	histogram_.bind_base(GL_SHADER_STORAGE_BUFFER, 4);
+
+	for (Program* prog : { &histogram_prog_, &scatter_prog_ }) {
+	  prog->use();
+	  prog->set_uniform("n", n);
+	  prog->set_uniform("shift", pass * radix_bits);
+	  prog->set_uniform("block_num", block_num);
+	  prog->set_uniform("has_values", has_values ? 1 : 0);
+	}
+
+	histogram_prog_.use();
+	glDispatchCompute(block_num, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	scan_.exclusive(histogram_.handle(), histogram_.handle(), radix_buckets * block_num);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// scanで結合ポイントが変わっているので結び直す
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, keys_in[src]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, values_in[src]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, keys_in[dst]);
+	histogram_.bind_base(GL_SHADER_STORAGE_BUFFER, 4);
+	scatter_prog_.use();
+	glDispatchCompute(block_num, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+      }
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+  }
+}
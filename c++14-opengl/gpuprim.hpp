@@ -0,0 +1,191 @@
+#ifndef INCLUDED_GPUPRIM_HPP
+#define INCLUDED_GPUPRIM_HPP
+
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "program.hpp"
+#include "globject.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // SSBO上の配列に対する計算シェーダーの基本演算
+    //  GpuScan : 排他的/包括的prefix scan
+    //  GpuReduce : 総和/最小/最大
+    //  GpuArgMin : 最小値とその添字
+    //  GpuCompact : flagの立った要素だけを詰める
+    //  GpuRadixSort : 32bitキー(+値)の基数ソート
+    // 要素の型と演算からGLSLを生成してProgramでcompileする
+    // 入出力はバッファのhandleで受け取り, 結果もGPU上に置く(読み戻しは呼び出し側の判断)
+    // どれもinit()でシェーダーを準備してから使う
+    // 直後に結果を読む処理の為のglMemoryBarrierは呼び出し側で行う
+
+    // 演算の種類
+    enum class GpuOp { SUM, MIN, MAX };
+
+    // 要素の型毎のGLSL上の名前と演算の単位元
+    // std430で配列の要素間に隙間が出来ない型のみ(vec3は不可)
+    template <typename T> struct GpuType;
+    template <> struct GpuType<GLuint> {
+      static const char* name() { return "uint"; }
+      static const char* lowest() { return "0u"; }
+      static const char* highest() { return "0xffffffffu"; }
+    };
+    template <> struct GpuType<GLint> {
+      static const char* name() { return "int"; }
+      static const char* lowest() { return "(-0x7fffffff - 1)"; }
+      static const char* highest() { return "0x7fffffff"; }
+    };
+    template <> struct GpuType<float> {
+      static const char* name() { return "float"; }
+      static const char* lowest() { return "(-3.402823466e+38)"; }
+      static const char* highest() { return "3.402823466e+38"; }
+    };
+    template <> struct GpuType<glm::vec2> {
+      static const char* name() { return "vec2"; }
+      static const char* lowest() { return "vec2(-3.402823466e+38)"; }
+      static const char* highest() { return "vec2(3.402823466e+38)"; }
+    };
+    template <> struct GpuType<glm::vec4> {
+      static const char* name() { return "vec4"; }
+      static const char* lowest() { return "vec4(-3.402823466e+38)"; }
+      static const char* highest() { return "vec4(3.402823466e+38)"; }
+    };
+
+    // 生成するGLSLに渡す型と演算の文字列
+    struct GpuOpDesc {
+      std::string type; // 要素の型名
+      std::string op; // aとbから結果を作る式
+      std::string identity; // 単位元
+      size_t size; // 要素1個のbyte数
+
+      template <typename T>
+      static GpuOpDesc make(GpuOp op) {
+	switch (op) {
+	case GpuOp::MIN:
+	  return GpuOpDesc{ GpuType<T>::name(), "min(a, b)", GpuType<T>::highest(), sizeof(T) };
+	case GpuOp::MAX:
+	  return GpuOpDesc{ GpuType<T>::name(), "max(a, b)", GpuType<T>::lowest(), sizeof(T) };
+	case GpuOp::SUM:
+	  break;
+	}
+	return GpuOpDesc{ GpuType<T>::name(), "a + b", std::string(GpuType<T>::name()) + "(0)", sizeof(T) };
+      }
+    };
+
+    // 型に依らない実装部分
+    namespace detail {
+      class ScanImpl {
+      public:
+	ScanImpl(const GpuOpDesc&, unsigned capacity);
+	bool init();
+	void run(GLuint src, GLuint dst, unsigned n, bool inclusive);
+	unsigned capacity() const noexcept { return capacity_; }
+      private:
+	const GpuOpDesc desc_;
+	const unsigned capacity_;
+	Program prog_;
+	std::vector<gl::Buffer> sums_; // 階層毎のブロックの合計
+
+	void scan_level(GLuint src, GLuint dst, unsigned n, size_t level, bool inclusive);
+      };
+
+      class ReduceImpl {
+      public:
+	ReduceImpl(const GpuOpDesc&, unsigned capacity);
+	bool init();
+	void run(GLuint src, unsigned n, GLuint dst, unsigned dst_index);
+      private:
+	const GpuOpDesc desc_;
+	Program prog_;
+	gl::Buffer partial_[2]; // 途中結果(交互に使う)
+      };
+    }
+
+    // prefix scan
+    // src == dstでも可
+    template <typename T, GpuOp Op = GpuOp::SUM>
+    class GpuScan {
+    public:
+      GpuScan(unsigned capacity) : impl_(GpuOpDesc::make<T>(Op), capacity) {}
+      bool init() { return impl_.init(); }
+
+      // dst[i] = src[0] op ... op src[i - 1] (dst[0]は単位元)
+      void exclusive(GLuint src, GLuint dst, unsigned n) { impl_.run(src, dst, n, false); }
+      // dst[i] = src[0] op ... op src[i]
+      void inclusive(GLuint src, GLuint dst, unsigned n) { impl_.run(src, dst, n, true); }
+      unsigned capacity() const noexcept { return impl_.capacity(); }
+    private:
+      detail::ScanImpl impl_;
+    };
+
+    // 総和/最小/最大
+    // 結果はdst(Tの配列)のdst_index番目に書く
+    template <typename T, GpuOp Op = GpuOp::SUM>
+    class GpuReduce {
+    public:
+      GpuReduce(unsigned capacity) : impl_(GpuOpDesc::make<T>(Op), capacity) {}
+      bool init() { return impl_.init(); }
+
+      void reduce(GLuint src, unsigned n, GLuint dst, unsigned dst_index = 0) {
+	impl_.run(src, n, dst, dst_index);
+      }
+    private:
+      detail::ReduceImpl impl_;
+    };
+
+    // floatの配列の最小値とその添字
+    // 結果はdstのdst_index番目に struct { float value; uint index; } で書く
+    // (同じ値が複数あれば添字の小さい方)
+    class GpuArgMin {
+    public:
+      struct Result {
+	float value;
+	GLuint index;
+      };
+
+      GpuArgMin(unsigned capacity);
+      bool init();
+      void argmin(GLuint src, unsigned n, GLuint dst, unsigned dst_index = 0);
+    private:
+      Program prog_;
+      gl::Buffer partial_[2];
+    };
+
+    // values[i]のうちflags[i] != 0のものだけを順番を保ってdstへ詰める
+    // 詰めた個数はcount(uintの配列)のcount_index番目に書く
+    class GpuCompact {
+    public:
+      GpuCompact(unsigned capacity);
+      bool init();
+      void compact(GLuint values, GLuint flags, unsigned n,
+		   GLuint dst, GLuint count, unsigned count_index = 0);
+    private:
+      Program prog_;
+      GpuScan<GLuint> scan_;
+      gl::Buffer offsets_; // flagを0/1にしたもの -> その排他的scan
+    };
+
+    // 32bitのキー(uint)と値(uint)の組を昇順に並べる(安定)
+    // 4bitずつ8パス, パス毎にブロック毎の頻度表 -> scan -> 書き込み
+    class GpuRadixSort {
+    public:
+      GpuRadixSort(unsigned capacity);
+      bool init();
+      // keys[0..n), values[0..n)をその場で並べ替える(valuesが0なら値無し)
+      void sort(GLuint keys, GLuint values, unsigned n);
+    private:
+      Program histogram_prog_;
+      Program scatter_prog_;
+      GpuScan<GLuint> scan_;
+      gl::Buffer histogram_; // 桁の値 x ブロック
+      gl::Buffer keys_temp_;
+      gl::Buffer values_temp_;
+      const unsigned capacity_;
+    };
+  }
+}
+
+#endif // INCLUDED_GPUPRIM_HPP
@@ -0,0 +1,158 @@
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "histogram.hpp"
+#include "utils.hpp"
+
+using glm::mat4;
+using glm::uvec4;
+
+namespace nekolib {
+  namespace renderer {
+    AutoLevels::AutoLevels()
+      : readback_(sizeof(clip_points_)), clip_points_valid_(false)
+    {
+      histogram_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * 4 * 256, nullptr, GL_DYNAMIC_COPY);
+      levels_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(mat4) + sizeof(clip_points_), nullptr, GL_DYNAMIC_COPY);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+      reset();
+    }
+
+    void AutoLevels::reset()
+    {
+      const mat4 identity(1.f);
+      levels_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(identity), &identity);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    bool AutoLevels::init()
+    {
+      using Names = std::vector<std::string>;
+
+      if (!histogram_prog_.build_program_from_files(Names{ "shader/histogram.cs" })) {
+	return false;
+      }
+      if (!levels_prog_.build_program_from_files(Names{ "shader/levels.cs" })) {
+	return false;
+      }
+      apply_prog_.define("AUTO_LEVELS");
+      if (!apply_prog_.build_program_from_files(Names{ "shader/colormatrix.cs" })) {
+	return false;
+      }
+      apply_lut_prog_.define("AUTO_LEVELS");
+      apply_lut_prog_.define("LUT");
+      if (!apply_lut_prog_.build_program_from_files(Names{ "shader/colormatrix.cs" })) {
+	return false;
+      }
+
+      return true;
+    }
+
+#define HISTOGRAM_TILE 64
+    void AutoLevels::analyze(const Texture& src, float clip, Mode mode)
+    {
+      histogram_.bind(GL_SHADER_STORAGE_BUFFER);
+      const GLuint zero = 0;
+      glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+      histogram_prog_.use();
+      histogram_.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glDispatchCompute((src.width() + HISTOGRAM_TILE - 1) / HISTOGRAM_TILE,
+			(src.height() + HISTOGRAM_TILE - 1) / HISTOGRAM_TILE, 1);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      levels_prog_.use();
+      levels_prog_.set_uniform("clip", clip);
+      levels_prog_.set_uniform("mode", static_cast<int>(mode));
+      levels_.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+      glDispatchCompute(1, 1, 1);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      // 表示用の捨てる位置(行列の後ろ)
+      if (!readback_.pending()) {
+	readback_.copy_buffer(levels_.handle(), sizeof(mat4), sizeof(clip_points_));
+      }
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+#define WORKGROUP_SIZE 16
+    void AutoLevels::apply(const mat4& color_matrix, const Texture& src, const Texture& dst)
+    {
+      apply_prog_.use();
+      apply_prog_.set_uniform("ColorMatrix", color_matrix);
+      levels_.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    void AutoLevels::apply(ColorLut& lut, const Texture& src, const Texture& dst)
+    {
+      apply_lut_prog_.use();
+      apply_lut_prog_.set_uniform("LutSize", static_cast<float>(lut.size()));
+      lut.bind(0);
+      levels_.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    bool AutoLevels::clip_points(uvec4* low, uvec4* high)
+    {
+      if (readback_.poll(clip_points_)) {
+	clip_points_valid_ = true;
+      }
+      if (clip_points_valid_) {
+	*low = clip_points_[0];
+	*high = clip_points_[1];
+      }
+      return clip_points_valid_;
+    }
+
+    size_t AutoLevelsFilter::hash() const
+    {
+      size_t h = reinterpret_cast<size_t>(&levels_);
+      if (lut_) {
+	h = hash_combine(h, reinterpret_cast<size_t>(lut_));
+	h = hash_combine(h, lut_->version());
+      } else {
+	h = hash_bytes(h, &matrix_);
+      }
+      if (enabled_) {
+	h = hash_bytes(h, &clip_);
+	h = hash_combine(h, static_cast<size_t>(mode_) + 1);
+      }
+      return h;
+    }
+
+    void AutoLevelsFilter::apply(const Texture& src, const Texture& dst)
+    {
+      if (enabled_) {
+	levels_.analyze(src, clip_, mode_);
+      } else {
+	levels_.reset();
+      }
+      if (lut_) {
+	levels_.apply(*lut_, src, dst);
+      } else {
+	levels_.apply(matrix_, src, dst);
+      }
+    }
+  }
+}
@@ -0,0 +1,89 @@
+#ifndef INCLUDED_HISTOGRAM_HPP
+#define INCLUDED_HISTOGRAM_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "program.hpp"
+#include "texture.hpp"
+#include "globject.hpp"
+#include "readback.hpp"
+#include "filtergraph.hpp"
+#include "lut.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // 画像の度数分布から自動で色補正(auto levels/auto contrast)
+    // 1. shader/histogram.cs : r, g, b, 輝度の256段階の度数分布
+    // 2. shader/levels.cs : 累積から両端clipの割合を捨てる位置を求めて補正行列を作る
+    // 3. shader/colormatrix.cs(AUTO_LEVELS) : ColorMatrix * 補正行列 で変換
+    //    (ColorLutを渡した時は補正行列の後に3D LUT)
+    // 補正行列はSSBO(binding 1)に置いたままなのでCPUへの読み戻しは無い
+    class AutoLevels {
+    public:
+      enum class Mode { CHANNELS = 0, // r, g, b毎
+			LUMA = 1,     // 輝度で共通
+      };
+
+      AutoLevels();
+      ~AutoLevels() = default;
+
+      AutoLevels(const AutoLevels&) = delete;
+      AutoLevels& operator=(const AutoLevels&) = delete;
+
+      bool init();
+
+      // srcの度数分布から補正行列を作る(clipは両端それぞれで捨てる割合)
+      void analyze(const Texture& src, float clip, Mode mode);
+      // 補正行列を単位行列に戻す
+      void reset();
+      // color_matrix * (analyze済みの補正行列)でsrc -> dst
+      void apply(const glm::mat4& color_matrix, const Texture& src, const Texture& dst);
+      // lut(補正行列の後)でsrc -> dst
+      void apply(ColorLut& lut, const Texture& src, const Texture& dst);
+
+      // 直近のanalyzeで求めた捨てる位置(r, g, b, 輝度)
+      // 表示用に非同期で読み戻すので数フレーム遅れる(まだ無ければfalse)
+      bool clip_points(glm::uvec4* low, glm::uvec4* high);
+    private:
+      Program histogram_prog_;
+      Program levels_prog_;
+      Program apply_prog_;
+      Program apply_lut_prog_;
+      gl::Buffer histogram_; // uint[4 * 256]
+      gl::Buffer levels_; // mat4 + uvec4 x 2
+      AsyncReadback readback_;
+      glm::uvec4 clip_points_[2];
+      bool clip_points_valid_;
+    };
+
+    // FilterGraph用の色補正(自動補正なしならcolormatrix.csと同じ)
+    // set_lutでLUTを渡すと行列の代わりにそちらを使う(nullptrで行列に戻す)
+    class AutoLevelsFilter : public FilterNode {
+    public:
+      explicit AutoLevelsFilter(AutoLevels& levels)
+	: levels_(levels), lut_(nullptr), matrix_(1.f), enabled_(false), clip_(0.005f), mode_(AutoLevels::Mode::CHANNELS) {}
+
+      void set_matrix(const glm::mat4& m) { matrix_ = m; }
+      void set_lut(ColorLut* lut) { lut_ = lut; }
+      void set_auto(bool enabled, float clip, AutoLevels::Mode mode)
+      {
+	enabled_ = enabled; clip_ = clip; mode_ = mode;
+      }
+
+      size_t hash() const override;
+      void apply(const Texture& src, const Texture& dst) override;
+      // 自動補正は画像全体の度数分布を使うのでタイルに分けられない
+      int footprint() const override { return enabled_ ? -1 : 0; }
+    private:
+      AutoLevels& levels_;
+      ColorLut* lut_;
+      glm::mat4 matrix_;
+      bool enabled_;
+      float clip_;
+      AutoLevels::Mode mode_;
+    };
+  }
+}
+
+#endif // INCLUDED_HISTOGRAM_HPP
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "lut.hpp"
+#include "utils.hpp"
+
+using glm::mat4;
+using glm::vec4;
+
+namespace nekolib {
+  namespace renderer {
+    static_assert(sizeof(ColorOp) == 96, "ColorOp must match std430 layout in lut_bake.cs");
+
+    ColorOp ColorOp::affine(const mat4& m)
+    {
+      return ColorOp{ m, vec4(0.f), Type::MATRIX, { 0, 0, 0 } };
+    }
+
+    ColorOp ColorOp::gamma(float g)
+    {
+      return ColorOp{ mat4(1.f), vec4(g, g, g, 0.f), Type::GAMMA, { 0, 0, 0 } };
+    }
+
+    ColorOp ColorOp::s_curve(float strength)
+    {
+      return ColorOp{ mat4(1.f), vec4(strength, 0.f, 0.f, 0.f), Type::CURVE, { 0, 0, 0 } };
+    }
+
+    ColorOp ColorOp::tonemap(float exposure, Tonemap op)
+    {
+      return ColorOp{ mat4(1.f), vec4(exposure, static_cast<float>(op), 0.f, 0.f), Type::TONEMAP, { 0, 0, 0 } };
+    }
+
+    ColorLut::ColorLut() : size_(0), version_(0)
+    {
+      lut_.bind(0, GL_TEXTURE_3D);
+      glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+      glBindTexture(GL_TEXTURE_3D, 0);
+    }
+
+    bool ColorLut::init()
+    {
+      using Names = std::vector<std::string>;
+
+      if (!bake_prog_.build_program_from_files(Names{ "shader/lut_bake.cs" })) {
+	return false;
+      }
+      apply_prog_.define("LUT");
+      if (!apply_prog_.build_program_from_files(Names{ "shader/colormatrix.cs" })) {
+	return false;
+      }
+
+      return true;
+    }
+
+#define BAKE_WORKGROUP_SIZE 4
+    void ColorLut::bake(const std::vector<ColorOp>& ops, int size)
+    {
+      if (size == size_ && ops.size() == baked_ops_.size() &&
+	  (ops.empty() || std::memcmp(ops.data(), baked_ops_.data(), sizeof(ColorOp) * ops.size()) == 0)) {
+	return;
+      }
+
+      if (size != size_) {
+	lut_.bind(0, GL_TEXTURE_3D);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, size, size, size, 0, GL_RGBA, GL_FLOAT, nullptr);
+	glBindTexture(GL_TEXTURE_3D, 0);
+	size_ = size;
+      }
+      baked_ops_ = ops;
+
+      // 空だとglBufferDataの大きさが0になるので最低1個分確保
+      ops_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ColorOp) * std::max<size_t>(ops.size(), 1),
+		   ops.empty() ? nullptr : ops.data(), GL_DYNAMIC_DRAW);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+      bake_prog_.use();
+      bake_prog_.set_uniform("op_count", static_cast<int>(ops.size()));
+      bake_prog_.set_uniform("size", size);
+      ops_.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+      glBindImageTexture(0, lut_.handle(), 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+      const GLuint groups = (size + BAKE_WORKGROUP_SIZE - 1) / BAKE_WORKGROUP_SIZE;
+      glDispatchCompute(groups, groups, groups);
+      glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+      ++version_;
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+#define WORKGROUP_SIZE 16
+    void ColorLut::apply(const Texture& src, const Texture& dst)
+    {
+      apply_prog_.use();
+      apply_prog_.set_uniform("LutSize", static_cast<float>(size_));
+      bind(0);
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+  }
+}
@@ -0,0 +1,89 @@
+#ifndef INCLUDED_LUT_HPP
+#define INCLUDED_LUT_HPP
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "program.hpp"
+#include "texture.hpp"
+#include "globject.hpp"
+#include "filtergraph.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // 3D LUTに焼き込む色変換1個分(shader/lut_bake.csのColorOpとstd430で同じ並び)
+    struct ColorOp {
+      enum class Type : GLint { MATRIX = 0,  // rgb = (matrix * vec4(rgb, 1)).rgb
+				GAMMA = 1,   // rgb = pow(rgb, 1 / param.rgb)
+				CURVE = 2,   // S字カーブ(param.x : 強さ, 負なら逆S字)
+				TONEMAP = 3, // 露出param.x段の後にトーンマップ(param.y : 0 Reinhard, 1 ACES)
+      };
+      enum class Tonemap { REINHARD = 0, ACES = 1 };
+
+      glm::mat4 matrix;
+      glm::vec4 param;
+      Type type;
+      GLint pad_[3];
+
+      static ColorOp affine(const glm::mat4& m);
+      static ColorOp gamma(float g);
+      static ColorOp s_curve(float strength);
+      static ColorOp tonemap(float exposure, Tonemap op);
+    };
+
+    // 任意の色変換の列を格子点(size^3)で計算してGL_TEXTURE_3Dへ焼き込み
+    // 各画素はshader/colormatrix.cs(LUT)の3次元線形補間1回で変換する
+    // (変換の列がどれだけ長くても画素あたりの手間は同じ)
+    //
+    // 入力はrgbを[0, 1]にclampしてから引くので, 範囲外の値が意味を持つ変換
+    // (行列だけの時のColorMatrixより前の段)とは結果が変わり得る
+    // アフィン変換だけなら線形補間で厳密に再現される(誤差はRGBA16Fの丸めのみ)
+    class ColorLut {
+    public:
+      ColorLut();
+      ~ColorLut() = default;
+
+      ColorLut(const ColorLut&) = delete;
+      ColorLut& operator=(const ColorLut&) = delete;
+
+      bool init();
+
+      // opsを順に適用した結果を焼く(size : 1辺の格子点数, 33か65程度)
+      // 前回と同じ内容なら何もしない
+      void bake(const std::vector<ColorOp>& ops, int size = 33);
+      // src -> dst(alphaはそのまま)
+      void apply(const Texture& src, const Texture& dst);
+      // sampler3Dとしてbind
+      void bind(unsigned no) const { lut_.bind(no, GL_TEXTURE_3D); }
+
+      int size() const noexcept { return size_; }
+      // 焼き直す度に増える(FilterNodeのhash用)
+      unsigned version() const noexcept { return version_; }
+    private:
+      Program bake_prog_;
+      Program apply_prog_;
+      gl::Texture lut_; // RGBA16F
+      gl::Buffer ops_;
+      std::vector<ColorOp> baked_ops_;
+      int size_;
+      unsigned version_;
+    };
+
+    // FilterGraph用
+    class ColorLutFilter : public FilterNode {
+    public:
+      explicit ColorLutFilter(ColorLut& lut) : lut_(lut) {}
+
+      size_t hash() const override
+      {
+	return hash_combine(reinterpret_cast<size_t>(&lut_), lut_.version());
+      }
+      void apply(const Texture& src, const Texture& dst) override { lut_.apply(src, dst); }
+    private:
+      ColorLut& lut_;
+    };
+  }
+}
+
+#endif // INCLUDED_LUT_HPP
@@ -51,7 +51,7 @@ void draw()
   SDL_GL_SwapWindow(window);
 }
 
-bool init(void)
+bool init(const char* cloud_path)
 {
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
     fprintf(stderr, "SDL初期化に失敗:%s\n", SDL_GetError());
@@ -112,7 +112,7 @@ bool init(void)
   ImGui_ImplOpenGL3_Init("#version 410");
 
   // TODO:
-  scene = new SceneBlob();
+  scene = new SceneBlob(cloud_path);
   if (!scene || !scene->init()) {
     return false;
   }
@@ -149,7 +149,8 @@ void main_loop()
 
 int main(int argc, char* argv[])
 {
-  if (!init()) {
+  // 引数があれば点群ファイル(.plyかfloat32のxyzを並べたバイナリ)を背景に表示
+  if (!init(argc > 1 ? argv[1] : nullptr)) {
     return -1;
   }
 
@@ -0,0 +1,656 @@
+#include <SDL2/SDL.h>
+#include <cctype>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "renderer.hpp"
+#include "memory.hpp"
+#include "program.hpp"
+#include "texture.hpp"
+#include "globject.hpp"
+#include "convolution.hpp"
+#include "filtergraph.hpp"
+#include "sat.hpp"
+#include "median.hpp"
+#include "bilateral.hpp"
+#include "pyramid.hpp"
+#include "morphology.hpp"
+#include "canny.hpp"
+#include "cpufilter.hpp"
+#include "tiled.hpp"
+#include "utils.hpp"
+
+// 画像ファイルの一括フィルタ処理(画面表示なし)
+// usage: filterbatch [-f フィルタ列] [-o 出力ディレクトリ] [-j スレッド数] [-t タイルの大きさ] 入力...
+//   入力 : 画像ファイル, ディレクトリ(中の画像ファイル全部), @リストファイル(1行1ファイル)
+//   フィルタ列 : invert, mono, mean3, laplacian, sobel, box:半径, gaussian:半径, disk:半径(円形),
+//                sat:半径(積分画像の箱型平均), pyrblur:段数(pyramidによるぼかし), median:半径,
+//                bilateral:sigma_s(輝度のsigma_rは0.1),
+//                erode, dilate, open, close, tophat:半径((2 * 半径 + 1)四方の矩形),
+//                canny(sigma 1.4, 閾値0.05/0.15), canny:hysteresisの最大パス数(既定64) を','で区切る
+//                (例 mono,gaussian:4,sobel 既定はsobel)
+//   出力は出力ディレクトリ(既定は.)/元のファイル名.png
+//   cannyのhysteresisが最大パス数で打ち切られた画像はstderrにファイル名を出す
+//   -tを付けるとタイルに分けて1枚ずつ処理する(tiled.hpp)
+//     入力がPPM(P6)なら出力もPPMにして, 画像全体をメモリに載せずに読み書きする
+//
+// 読み込み(デコード)と書き出し(エンコード)はそれぞれ-j個のスレッドで
+// GPUへの転送と読み戻しはPBOを3組使い回して, fenceで空いた組から順に次の画像を流す
+// 異なる画像のデコード, GPU処理, エンコードが重なって進むので
+// 1枚毎の待ち時間ではなく枚数/秒で効く
+// (GL_MAX_TEXTURE_SIZEを超える画像はその場でタイルに分けて処理する)
+
+const char* TITLE = "filterbatch";
+
+static SDL_Window* window = nullptr;
+static SDL_GLContext context = nullptr;
+
+using namespace nekolib::renderer;
+
+bool init(void)
+{
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
+    fprintf(stderr, "SDL初期化に失敗:%s\n", SDL_GetError());
+    return false;
+  }
+
+  // OpenGL 4.3 Core profile
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+  // コンテキストだけ欲しいので画面は出さない
+  window = SDL_CreateWindow(TITLE, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+			    64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  if (window) {
+    context = SDL_GL_CreateContext(window);
+  }
+  if (!window || !context) {
+    fprintf(stderr, "OpenGLコンテキスト作成に失敗:%s\n", SDL_GetError());
+    SDL_Quit();
+    return false;
+  }
+
+  gladLoadGLLoader(SDL_GL_GetProcAddress);
+  fprintf(stderr, "Renderer: %s\n", glGetString(GL_RENDERER));
+  fprintf(stderr, "Version: %s\n", glGetString(GL_VERSION));
+
+  nekolib::memory::Manager::init();
+  nekolib::renderer::ScreenManager::init(64, 64);
+
+  return true;
+}
+
+void finalize()
+{
+  SDL_GL_DeleteContext(context);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+}
+
+// スレッド間の受け渡し用の上限付きキュー
+// close()後は空になった時点でpopがfalseを返す
+template <typename T>
+class BlockingQueue {
+public:
+  explicit BlockingQueue(size_t capacity) : capacity_(capacity) {}
+
+  void push(T v)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [&]() { return queue_.size() < capacity_; });
+    queue_.push_back(std::move(v));
+    not_empty_.notify_one();
+  }
+  bool pop(T& v)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [&]() { return !queue_.empty() || closed_; });
+    if (queue_.empty()) {
+      return false;
+    }
+    v = std::move(queue_.front());
+    queue_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+private:
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<T> queue_;
+  const size_t capacity_;
+  bool closed_ = false;
+};
+
+// 1枚の画像
+struct Job {
+  std::string input;
+  std::string output;
+  CpuImage image;
+};
+
+bool has_image_extension(const std::string& name)
+{
+  static const char* exts[] = { ".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif", ".psd", ".hdr", ".pic", ".pnm", ".ppm", ".pgm" };
+  const size_t dot = name.rfind('.');
+  if (dot == std::string::npos) {
+    return false;
+  }
+  std::string ext = name.substr(dot);
+  std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+  return std::find_if(std::begin(exts), std::end(exts), [&](const char* e) { return ext == e; }) != std::end(exts);
+}
+
+// 入力の指定をファイル名の列に展開
+void collect_inputs(const std::string& arg, std::vector<std::string>& inputs)
+{
+  if (arg[0] == '@') {
+    std::ifstream list(arg.substr(1));
+    std::string line;
+    while (std::getline(list, line)) {
+      if (!line.empty()) {
+	inputs.push_back(line);
+      }
+    }
+    return;
+  }
+
+  struct stat st;
+  if (stat(arg.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    DIR* dir = opendir(arg.c_str());
+    if (!dir) {
+      return;
+    }
+    std::vector<std::string> names;
+    while (dirent* e = readdir(dir)) {
+      if (has_image_extension(e->d_name)) {
+	names.push_back(arg + "/" + e->d_name);
+      }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    inputs.insert(inputs.end(), names.begin(), names.end());
+    return;
+  }
+  inputs.push_back(arg);
+}
+
+std::string output_name(const std::string& outdir, const std::string& input, const char* ext = ".png")
+{
+  const size_t slash = input.rfind('/');
+  std::string base = (slash == std::string::npos) ? input : input.substr(slash + 1);
+  const size_t dot = base.rfind('.');
+  if (dot != std::string::npos) {
+    base.erase(dot);
+  }
+  return outdir + "/" + base + ext;
+}
+
+// フィルタ列"mono,gaussian:4,sobel"からFilterNodeを作る
+bool parse_filters(const std::string& spec, Program& invert_prog, Program& cm_prog, Convolution& conv,
+		   SummedAreaTable& sat, Median& median, BilateralGrid& bilateral, Pyramid& pyramid,
+		   Morphology& morph, Canny& canny, std::vector<std::unique_ptr<FilterNode>>& nodes)
+{
+  size_t pos = 0;
+  while (pos <= spec.size()) {
+    size_t end = spec.find(',', pos);
+    if (end == std::string::npos) {
+      end = spec.size();
+    }
+    const std::string item = spec.substr(pos, end - pos);
+    pos = end + 1;
+
+    const size_t colon = item.find(':');
+    const std::string name = item.substr(0, colon);
+    const int radius = (colon == std::string::npos) ? 1 : std::atoi(item.c_str() + colon + 1);
+    const bool morph_op = (name == "erode" || name == "dilate" || name == "open" || name == "close" || name == "tophat");
+    const int max_radius = (name == "sat" || name == "bilateral") ? INT_MAX : morph_op ? 4096 : (name == "pyrblur") ? 12 :
+      (name == "canny") ? 65536 :
+      (name == "median") ? static_cast<int>(Median::max_radius_) : static_cast<int>(Convolution::max_radius_fft_);
+    if (radius < 1 || radius > max_radius) {
+      fprintf(stderr, "Illegal radius - %s\n", item.c_str());
+      return false;
+    }
+
+    if (name == "invert") {
+      nodes.push_back(std::make_unique<ProgramFilter>(invert_prog));
+    } else if (name == "mono") {
+      // imageprocessのMonotoneと同じ(彩度0の色変換行列)
+      const glm::vec3 lumRGB(0.3086, 0.6094, 0.0820);
+      auto mono = std::make_unique<ProgramFilter>(cm_prog, "ColorMatrix");
+      mono->set_matrix(glm::mat4(glm::vec4(lumRGB.r), glm::vec4(lumRGB.g), glm::vec4(lumRGB.b),
+				 glm::vec4(0.f, 0.f, 0.f, 1.f)));
+      nodes.push_back(std::move(mono));
+    } else if (name == "mean3") {
+      nodes.push_back(std::make_unique<ConvolutionFilter>(conv, ConvKernel::box(1)));
+    } else if (name == "laplacian") {
+      nodes.push_back(std::make_unique<ConvolutionFilter>(conv, ConvKernel::laplacian()));
+    } else if (name == "canny") {
+      if (colon != std::string::npos) {
+	canny.max_passes = radius;
+      }
+      nodes.push_back(std::make_unique<CannyFilter>(canny, 1.4f, 0.05f, 0.15f));
+    } else if (name == "sobel") {
+      nodes.push_back(std::make_unique<ConvolutionFilter>(conv, ConvKernel({ 1.f, 2.f, 1.f }, { -1.f, 0.f, 1.f }, 0.5f),
+							  ConvKernel::sobel_y()));
+    } else if (name == "box") {
+      nodes.push_back(std::make_unique<ConvolutionFilter>(conv, ConvKernel::box(radius)));
+    } else if (name == "gaussian") {
+      nodes.push_back(std::make_unique<ConvolutionFilter>(conv, ConvKernel::gaussian(radius)));
+    } else if (name == "disk") {
+      nodes.push_back(std::make_unique<ConvolutionFilter>(conv, ConvKernel::disk(radius)));
+    } else if (name == "sat") {
+      nodes.push_back(std::make_unique<SatBoxFilter>(sat, radius));
+    } else if (name == "pyrblur") {
+      nodes.push_back(std::make_unique<PyramidBlurFilter>(pyramid, radius));
+    } else if (morph_op) {
+      const Morphology::Op op = (name == "erode") ? Morphology::Op::ERODE : (name == "dilate") ? Morphology::Op::DILATE :
+	(name == "open") ? Morphology::Op::OPEN : (name == "close") ? Morphology::Op::CLOSE : Morphology::Op::TOP_HAT;
+      nodes.push_back(std::make_unique<MorphologyFilter>(morph, op, StructuringElement::rect(2 * radius + 1, 2 * radius + 1)));
+    } else if (name == "median") {
+      nodes.push_back(std::make_unique<MedianFilter>(median, radius));
+    } else if (name == "bilateral") {
+      nodes.push_back(std::make_unique<BilateralFilter>(bilateral, radius, 0.1f));
+    } else {
+      fprintf(stderr, "Unknown filter - %s\n", item.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// GPU処理中の1組(転送用PBO, 元画像, 読み戻し用PBO)
+struct Slot {
+  gl::Buffer upload;
+  gl::Buffer download;
+  GLsizeiptr upload_size = 0;
+  GLsizeiptr download_size = 0;
+  Texture source;
+  GLsync fence = nullptr;
+  Job job;
+  gl::Buffer canny_status; // Canny::Status(フィルタ列にcannyがある時)
+  GLsizeiptr canny_status_size = 0;
+  bool canny = false;
+};
+
+// バッファを必要なら大きくする
+void reserve(const gl::Buffer& buffer, GLenum target, GLsizeiptr& size, GLsizeiptr bytes, GLenum usage)
+{
+  buffer.bind(target);
+  if (size < bytes) {
+    glBufferData(target, bytes, nullptr, usage);
+    size = bytes;
+  }
+}
+
+// 画像をPBO経由でslotのテクスチャへ送ってフィルタをかけ, 結果の読み戻しを要求する
+// cannyがnullptrでなければそのhysteresisの結果も同じfenceで読めるようにslotへ写す
+// PBOへ書き込めなければfalse(fenceは作らない)
+bool submit(Slot& slot, FilterGraph& graph, const Canny* canny)
+{
+  const int w = slot.job.image.width;
+  const int h = slot.job.image.height;
+  const GLsizeiptr bytes = static_cast<GLsizeiptr>(w) * h * 4;
+
+  // 前回この組を使った画像は読み戻し済みなのでPBOは書き換えてよい
+  reserve(slot.upload, GL_PIXEL_UNPACK_BUFFER, slot.upload_size, bytes, GL_STREAM_DRAW);
+  void* p = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (!p) {
+    fprintf(stderr, "%s : can't map upload buffer.\n", slot.job.input.c_str());
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return false;
+  }
+  memcpy(p, slot.job.image.pixels.data(), bytes);
+  if (!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+    fprintf(stderr, "%s : upload buffer was corrupted.\n", slot.job.input.c_str());
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return false;
+  }
+
+  if (!slot.source || slot.source.width() != w || slot.source.height() != h) {
+    slot.source = Texture::create(w, h, TextureFormat::RGBA8);
+  }
+  slot.source.bind(0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  // PBOがbindされているので最後の引数はPBO内のoffset
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  graph.set_source(slot.source);
+  graph.touch_source();
+  const Texture& result = graph.evaluate();
+
+  // image storeの結果をglGetTexImageで読む
+  glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+  reserve(slot.download, GL_PIXEL_PACK_BUFFER, slot.download_size, bytes, GL_STREAM_READ);
+  result.bind(0);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  slot.canny = (canny != nullptr);
+  if (canny) {
+    reserve(slot.canny_status, GL_COPY_WRITE_BUFFER, slot.canny_status_size, sizeof(Canny::Status), GL_STREAM_READ);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    canny->copy_status(slot.canny_status.handle());
+  }
+
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  return true;
+}
+
+// slotの結果が揃うまで待ってjobの画像へ取り出す
+// PBOから読めなければfalse
+bool retrieve(Slot& slot)
+{
+  while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {
+  }
+  glDeleteSync(slot.fence);
+  slot.fence = nullptr;
+
+  CpuImage& image = slot.job.image;
+  slot.download.bind(GL_PIXEL_PACK_BUFFER);
+  const void* p = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, image.pixels.size(), GL_MAP_READ_BIT);
+  if (!p) {
+    fprintf(stderr, "%s : can't map download buffer.\n", slot.job.input.c_str());
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return false;
+  }
+  memcpy(image.pixels.data(), p, image.pixels.size());
+  const bool intact = glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  if (!intact) {
+    fprintf(stderr, "%s : download buffer was corrupted.\n", slot.job.input.c_str());
+    return false;
+  }
+
+  if (slot.canny) {
+    Canny::Status status;
+    slot.canny_status.bind(GL_COPY_READ_BUFFER);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(status), &status);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    if (status.changed != 0u) {
+      fprintf(stderr, "%s : canny hysteresis stopped at %u passes before converging (use canny:passes).\n",
+	      slot.job.input.c_str(), status.passes);
+    }
+  }
+  return true;
+}
+
+// 書き出せなかった入力(読み込み, 処理, 書き込みのどこかで失敗)があれば数を出して1
+int report_failures(size_t inputs, size_t written)
+{
+  if (written == inputs) {
+    return 0;
+  }
+  fprintf(stdout, "%zu of %zu inputs failed\n", inputs - written, inputs);
+  return 1;
+}
+
+bool is_ppm(const std::string& name)
+{
+  const size_t dot = name.rfind('.');
+  if (dot == std::string::npos) {
+    return false;
+  }
+  std::string ext = name.substr(dot);
+  std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+  return ext == ".ppm" || ext == ".pnm";
+}
+
+// -t : 1枚ずつタイルに分けて処理
+// PPMは必要な行だけ読んでタイル毎に書き込むので画像の大きさはメモリに制限されない
+size_t run_tiled(TiledFilter& tiled, const std::vector<FilterNode*>& chain,
+		 const std::vector<std::string>& inputs, const std::string& outdir, double* pixels)
+{
+  size_t written = 0;
+  for (auto& input : inputs) {
+    bool ok;
+    int w, h;
+    if (is_ppm(input)) {
+      PpmReader reader;
+      PpmWriter writer;
+      const std::string output = output_name(outdir, input, ".ppm");
+      if (!reader.open(input) || !writer.create(output, reader.width(), reader.height())) {
+	continue;
+      }
+      w = reader.width();
+      h = reader.height();
+      ok = tiled.process(chain, reader, writer) && writer.close();
+    } else {
+      int components;
+      unsigned char* data = stbi_load(input.c_str(), &w, &h, &components, 4);
+      if (!data) {
+	fprintf(stderr, "Can't load %s.\n", input.c_str());
+	continue;
+      }
+      CpuImage image(w, h), result(w, h);
+      memcpy(image.pixels.data(), data, image.pixels.size());
+      stbi_image_free(data);
+      CpuImageSource reader(image);
+      CpuImageSink writer(result);
+      const std::string output = output_name(outdir, input);
+      ok = tiled.process(chain, reader, writer) &&
+	stbi_write_png(output.c_str(), w, h, 4, result.pixels.data(), w * 4);
+    }
+    if (!ok) {
+      fprintf(stderr, "Can't process %s.\n", input.c_str());
+      continue;
+    }
+    fprintf(stdout, "%s : %dx%d, %d tiles (halo %d)\n", input.c_str(), w, h, tiled.tiles(), tiled.halo());
+    ++written;
+    *pixels += static_cast<double>(w) * h;
+  }
+  return written;
+}
+
+int main(int argc, char* argv[])
+{
+  std::string spec = "sobel";
+  std::string outdir = ".";
+  unsigned threads = std::max(std::thread::hardware_concurrency() / 2, 1u);
+  int tile_size = 0;
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      spec = argv[++i];
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      outdir = argv[++i];
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = std::max(std::atoi(argv[++i]), 1);
+    } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      tile_size = std::max(std::atoi(argv[++i]), 1);
+    } else {
+      collect_inputs(argv[i], inputs);
+    }
+  }
+  if (inputs.empty()) {
+    fprintf(stderr, "usage: filterbatch [-f filters] [-o outdir] [-j threads] [-t tile_size] inputs...\n");
+    return -1;
+  }
+
+  if (!init()) {
+    return -1;
+  }
+
+  using Names = std::vector<std::string>;
+  Program invert_prog, cm_prog;
+  Convolution conv;
+  SummedAreaTable sat;
+  Median median;
+  BilateralGrid bilateral;
+  Pyramid pyramid;
+  Morphology morph;
+  Canny canny(conv);
+  std::vector<std::unique_ptr<FilterNode>> nodes;
+  if (!invert_prog.build_program_from_files(Names{ "shader/invert.cs" }) ||
+      !cm_prog.build_program_from_files(Names{ "shader/colormatrix.cs" }) ||
+      !conv.init() || !sat.init() || !median.init() || !bilateral.init() ||
+      !pyramid.init() || !morph.init() || !canny.init() ||
+      !parse_filters(spec, invert_prog, cm_prog, conv, sat, median, bilateral, pyramid, morph, canny, nodes)) {
+    finalize();
+    return -1;
+  }
+  FilterGraph graph;
+  std::vector<FilterNode*> chain;
+  for (auto& n : nodes) {
+    chain.push_back(n.get());
+  }
+  graph.set_chain(chain);
+  // cannyがあれば画像毎にhysteresisが収束したかを見る
+  const bool has_canny = std::any_of(chain.begin(), chain.end(),
+				     [](FilterNode* n) { return dynamic_cast<CannyFilter*>(n) != nullptr; });
+  TiledFilter tiled(tile_size > 0 ? tile_size : 2048);
+
+  if (tile_size > 0) {
+    fprintf(stdout, "%zu inputs, filters %s, tile %d\n", inputs.size(), spec.c_str(), tiled.tile_size());
+    Uint64 start = SDL_GetPerformanceCounter();
+    double pixels = 0.0;
+    const size_t written = run_tiled(tiled, chain, inputs, outdir, &pixels);
+    const double sec = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    fprintf(stdout, "%zu images in %.3f s : %.2f Mpixels/s\n", written, sec, pixels / sec * 1e-6);
+    finalize();
+    return report_failures(inputs.size(), written);
+  }
+  GLint max_size = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+  // デコード : 入力名を順に取ってjobを作る
+  BlockingQueue<Job> decoded(2 * threads + 3);
+  BlockingQueue<Job> encoding(2 * threads + 3);
+  std::mutex input_mutex;
+  size_t next_input = 0;
+  std::vector<std::thread> decoders, encoders;
+  for (unsigned i = 0; i < threads; ++i) {
+    decoders.emplace_back([&]() {
+	for (;;) {
+	  Job job;
+	  {
+	    std::lock_guard<std::mutex> lock(input_mutex);
+	    if (next_input == inputs.size()) {
+	      return;
+	    }
+	    job.input = inputs[next_input++];
+	  }
+	  int w, h, components;
+	  unsigned char* data = stbi_load(job.input.c_str(), &w, &h, &components, 4);
+	  if (!data) {
+	    fprintf(stderr, "Can't load %s.\n", job.input.c_str());
+	    continue;
+	  }
+	  job.image = CpuImage(w, h);
+	  memcpy(job.image.pixels.data(), data, job.image.pixels.size());
+	  stbi_image_free(data);
+	  job.output = output_name(outdir, job.input);
+	  decoded.push(std::move(job));
+	}
+      });
+  }
+  // エンコード
+  size_t written = 0;
+  double pixels = 0.0;
+  std::mutex count_mutex;
+  for (unsigned i = 0; i < threads; ++i) {
+    encoders.emplace_back([&]() {
+	Job job;
+	while (encoding.pop(job)) {
+	  const CpuImage& im = job.image;
+	  if (!stbi_write_png(job.output.c_str(), im.width, im.height, 4, im.pixels.data(), im.width * 4)) {
+	    fprintf(stderr, "Can't write %s.\n", job.output.c_str());
+	    continue;
+	  }
+	  std::lock_guard<std::mutex> lock(count_mutex);
+	  ++written;
+	  pixels += static_cast<double>(im.width) * im.height;
+	}
+      });
+  }
+  // 全部デコードし終えたらdecodedを閉じる
+  std::thread closer([&]() {
+      for (auto& th : decoders) {
+	th.join();
+      }
+      decoded.close();
+    });
+
+  fprintf(stdout, "%zu inputs, filters %s, %u decode/encode threads\n", inputs.size(), spec.c_str(), threads);
+  Uint64 start = SDL_GetPerformanceCounter();
+
+  // GPU : 3組を順番に使う
+  // 組iを再利用する前にその組の結果を取り出す(その間も他の2組はGPUで処理中)
+  static const int slot_num = 3;
+  Slot slots[slot_num];
+  bool input_done = false;
+  for (int i = 0; ; i = (i + 1) % slot_num) {
+    Slot& slot = slots[i];
+    if (slot.fence && retrieve(slot)) {
+      encoding.push(std::move(slot.job));
+    }
+    if (!input_done && !decoded.pop(slot.job)) {
+      input_done = true;
+    }
+    if (input_done) {
+      if (std::none_of(std::begin(slots), std::end(slots), [](const Slot& s) { return s.fence != nullptr; })) {
+	break;
+      }
+      continue;
+    }
+    CpuImage& image = slot.job.image;
+    if (image.width > max_size || image.height > max_size) {
+      // テクスチャに入らないのでタイルに分けてその場で処理
+      CpuImage result(image.width, image.height);
+      CpuImageSource reader(image);
+      CpuImageSink writer(result);
+      if (tiled.process(chain, reader, writer)) {
+	image = std::move(result);
+	encoding.push(std::move(slot.job));
+      } else {
+	fprintf(stderr, "Can't process %s.\n", slot.job.input.c_str());
+      }
+      continue;
+    }
+    submit(slot, graph, has_canny ? &canny : nullptr);
+  }
+  check_gl_error(__FILE__, __LINE__);
+
+  closer.join();
+  encoding.close();
+  for (auto& th : encoders) {
+    th.join();
+  }
+  const double sec = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+  fprintf(stdout, "%zu images in %.3f s : %.2f images/s, %.2f Mpixels/s\n",
+	  written, sec, written / sec, pixels / sec * 1e-6);
+
+  finalize();
+
+  return report_failures(inputs.size(), written);
+}
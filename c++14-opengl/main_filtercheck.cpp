@@ -0,0 +1,208 @@
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <stb_image.h>
+
+#include "renderer.hpp"
+#include "memory.hpp"
+#include "program.hpp"
+#include "texture.hpp"
+#include "convolution.hpp"
+#include "filtergraph.hpp"
+#include "cpufilter.hpp"
+#include "lut.hpp"
+
+// CPU版フィルタ(cpufilter.hpp)とGPU版の比較(画面表示なし)
+// usage: filtercheck [画像ファイル [スレッド数]]
+//
+// 同じ画像に各フィルタをかけて成分毎の差の最大値, 差のある成分の数,
+// CPU版とGPU版それぞれの処理時間を出力する
+// (許容範囲はinvert/laplacianが0, それ以外が1)
+// lut33/lut65はcolor matrixを3D LUTに焼いたもの(アフィン変換なので補間で誤差は出ない)
+
+const char* TITLE = "filtercheck";
+
+static SDL_Window* window = nullptr;
+static SDL_GLContext context = nullptr;
+
+using namespace nekolib::renderer;
+
+bool init(void)
+{
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
+    fprintf(stderr, "SDL初期化に失敗:%s\n", SDL_GetError());
+    return false;
+  }
+
+  // OpenGL 4.3 Core profile
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+  // コンテキストだけ欲しいので画面は出さない
+  window = SDL_CreateWindow(TITLE, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+			    64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  if (window) {
+    context = SDL_GL_CreateContext(window);
+  }
+  if (!window || !context) {
+    fprintf(stderr, "OpenGLコンテキスト作成に失敗:%s\n", SDL_GetError());
+    SDL_Quit();
+    return false;
+  }
+
+  gladLoadGLLoader(SDL_GL_GetProcAddress);
+  fprintf(stderr, "Renderer: %s\n", glGetString(GL_RENDERER));
+  fprintf(stderr, "Version: %s\n", glGetString(GL_VERSION));
+
+  nekolib::memory::Manager::init();
+  nekolib::renderer::ScreenManager::init(64, 64);
+
+  return true;
+}
+
+void finalize()
+{
+  SDL_GL_DeleteContext(context);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+}
+
+bool load_image(const char* filename, CpuImage& image)
+{
+  int w, h, components;
+  unsigned char* data = stbi_load(filename, &w, &h, &components, 4);
+  if (!data) {
+    fprintf(stderr, "Can't load %s.\n", filename);
+    return false;
+  }
+  image = CpuImage(w, h);
+  std::copy(data, data + image.pixels.size(), image.pixels.begin());
+  stbi_image_free(data);
+  return true;
+}
+
+double seconds(Uint64 start)
+{
+  return static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+static unsigned failures = 0;
+
+// 1個のフィルタについて比較して1行出力
+void check(const char* name, int tolerance, const Texture& src, FilterNode& gpu,
+	   const CpuImage& image, std::function<void(const CpuImage&, CpuImage&)> cpu)
+{
+  Texture dst = Texture::create(image.width, image.height, TextureFormat::RGBA8);
+
+  glFinish();
+  Uint64 start = SDL_GetPerformanceCounter();
+  gpu.apply(src, dst);
+  glFinish();
+  const double gpu_sec = seconds(start);
+
+  CpuImage gpu_result(image.width, image.height);
+  dst.bind(0);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, gpu_result.pixels.data());
+
+  CpuImage cpu_result;
+  start = SDL_GetPerformanceCounter();
+  cpu(image, cpu_result);
+  const double cpu_sec = seconds(start);
+
+  int max_diff = 0;
+  size_t diff_num = 0;
+  for (size_t i = 0; i < cpu_result.pixels.size(); ++i) {
+    const int d = std::abs(static_cast<int>(cpu_result.pixels[i]) - gpu_result.pixels[i]);
+    max_diff = std::max(max_diff, d);
+    diff_num += (d != 0);
+  }
+
+  const bool ok = (max_diff <= tolerance);
+  fprintf(stdout, "%-12s %9d %12zu %12.3f %12.3f %s\n", name, max_diff, diff_num,
+	  gpu_sec * 1e3, cpu_sec * 1e3, ok ? "ok" : "NG");
+  if (!ok) {
+    ++failures;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  const char* filename = (argc > 1) ? argv[1] : "texture/ginn_aomuke.png";
+  const unsigned threads = (argc > 2) ? std::max(std::atoi(argv[2]), 1) : 0;
+
+  if (!init()) {
+    return -1;
+  }
+
+  CpuImage image;
+  if (!load_image(filename, image)) {
+    finalize();
+    return -1;
+  }
+
+  using Names = std::vector<std::string>;
+  Program invert_prog, cm_prog;
+  Convolution conv;
+  ColorLut lut;
+  if (!invert_prog.build_program_from_files(Names{ "shader/invert.cs" }) ||
+      !cm_prog.build_program_from_files(Names{ "shader/colormatrix.cs" }) ||
+      !conv.init() || !lut.init()) {
+    finalize();
+    return -1;
+  }
+
+  // CPU版と同じ内容の元画像
+  Texture src = Texture::create(image.width, image.height, TextureFormat::RGBA8);
+  src.bind(0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels.data());
+
+  // 彩度とコントラストを変える程度の行列
+  glm::mat4 m = glm::rotate(glm::mat4(1.f), glm::radians(30.f), glm::vec3(1.f, 1.f, 1.f));
+  m[0][0] *= 1.2f; m[1][1] *= 1.2f; m[2][2] *= 1.2f;
+  m[3] = glm::vec4(-0.05f, -0.05f, -0.05f, 1.f);
+
+  ProgramFilter invert(invert_prog);
+  ProgramFilter cm(cm_prog, "ColorMatrix");
+  cm.set_matrix(m);
+  ConvolutionFilter mean(conv, ConvKernel::box(1));
+  ConvolutionFilter laplacian(conv, ConvKernel::laplacian());
+  ConvolutionFilter sobel(conv, ConvKernel({ 1.f, 2.f, 1.f }, { -1.f, 0.f, 1.f }, 0.5f), ConvKernel::sobel_y());
+  ColorLutFilter lut_filter(lut);
+
+  CpuFilter cpu(threads);
+  fprintf(stdout, "%s : %dx%d, cpu %s x%u\n", filename, image.width, image.height,
+	  CpuFilter::simd_name(), cpu.threads());
+  fprintf(stdout, "%-12s %9s %12s %12s %12s\n", "filter", "max diff", "diff count", "gpu ms", "cpu ms");
+  check("invert", 0, src, invert, image,
+	[&](const CpuImage& s, CpuImage& d) { cpu.invert(s, d); });
+  check("mean3x3", 1, src, mean, image,
+	[&](const CpuImage& s, CpuImage& d) { cpu.mean3x3(s, d); });
+  check("laplacian", 0, src, laplacian, image,
+	[&](const CpuImage& s, CpuImage& d) { cpu.laplacian(s, d); });
+  check("sobel", 1, src, sobel, image,
+	[&](const CpuImage& s, CpuImage& d) { cpu.sobel(s, d); });
+  check("colormatrix", 1, src, cm, image,
+	[&](const CpuImage& s, CpuImage& d) { cpu.color_matrix(m, s, d); });
+  lut.bake({ ColorOp::affine(m) }, 33);
+  check("lut33", 1, src, lut_filter, image,
+	[&](const CpuImage& s, CpuImage& d) { cpu.color_matrix(m, s, d); });
+  lut.bake({ ColorOp::affine(m) }, 65);
+  check("lut65", 1, src, lut_filter, image,
+	[&](const CpuImage& s, CpuImage& d) { cpu.color_matrix(m, s, d); });
+  if (failures > 0) {
+    fprintf(stdout, "%u filters NG\n", failures);
+  }
+
+  finalize();
+
+  return failures > 0 ? 1 : 0;
+}
@@ -11,7 +11,7 @@
 #include "memory.hpp"
 #include "input.hpp"
 #include "clock.hpp"
-#include "scene_gomu2.hpp"
+#include "scene_rope.hpp"
 
 const char* TITLE = "gomu(with compute shader)";
 
@@ -20,7 +20,7 @@ static SDL_GLContext context = nullptr;
 const int SCREEN_WIDTH = 1280;
 const int SCREEN_HEIGHT = 720;
 
-static SceneGomu2* scene = nullptr;
+static SceneRope* scene = nullptr;
 
 bool update()
 {
@@ -112,7 +112,7 @@ bool init(void)
   ImGui_ImplOpenGL3_Init("#version 410");
 
   // TODO:
-  scene = new SceneGomu2();
+  scene = new SceneRope(nekolib::renderer::RopeIntegrator::MODIFIED_EULER);
   if (!scene || !scene->init()) {
     return false;
   }
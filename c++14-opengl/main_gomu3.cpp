@@ -11,7 +11,7 @@
 #include "memory.hpp"
 #include "input.hpp"
 #include "clock.hpp"
-#include "scene_gomu3.hpp"
+#include "scene_rope.hpp"
 
 const char* TITLE = "gomu(using verlet velocity)";
 
@@ -20,7 +20,7 @@ static SDL_GLContext context = nullptr;
 const int SCREEN_WIDTH = 1280;
 const int SCREEN_HEIGHT = 720;
 
-static SceneGomu3* scene = nullptr;
+static SceneRope* scene = nullptr;
 
 bool update()
 {
@@ -112,7 +112,7 @@ bool init(void)
   ImGui_ImplOpenGL3_Init("#version 410");
 
   // TODO:
-  scene = new SceneGomu3();
+  scene = new SceneRope(nekolib::renderer::RopeIntegrator::VELOCITY_VERLET);
   if (!scene || !scene->init()) {
     return false;
   }
@@ -0,0 +1,342 @@
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+#include <glad/glad.h>
+
+#include "renderer.hpp"
+#include "memory.hpp"
+#include "globject.hpp"
+#include "gpuprim.hpp"
+
+// GPU版の基本演算(gpuprim.hpp)とCPU版(標準ライブラリ)の結果の比較(画面表示なし)
+// usage: gpuprimcheck [seed [要素数 ...]]
+//
+// 乱数の入力で
+//  GpuScan : std::partial_sum (排他的scanは1個ずらしたもの)
+//  GpuReduce : std::accumulate / std::min_element / std::max_element
+//  GpuArgMin : std::min_element (同じ値が複数あれば添字の小さい方)
+//  GpuCompact : std::copy_if
+//  GpuRadixSort : std::stable_sort
+// と比べて要素数毎に一致したかを出力する
+// 既定の要素数はブロックの大きさの倍数でないものと, scanが複数階層になるものを含む
+// 1つでも一致しなければ終了コードは1
+
+const char* TITLE = "gpuprimcheck";
+
+static SDL_Window* window = nullptr;
+static SDL_GLContext context = nullptr;
+
+using namespace nekolib::renderer;
+
+bool init(void)
+{
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
+    fprintf(stderr, "SDL初期化に失敗:%s\n", SDL_GetError());
+    return false;
+  }
+
+  // OpenGL 4.3 Core profile
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+  // コンテキストだけ欲しいので画面は出さない
+  window = SDL_CreateWindow(TITLE, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+			    64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  if (window) {
+    context = SDL_GL_CreateContext(window);
+  }
+  if (!window || !context) {
+    fprintf(stderr, "OpenGLコンテキスト作成に失敗:%s\n", SDL_GetError());
+    SDL_Quit();
+    return false;
+  }
+
+  gladLoadGLLoader(SDL_GL_GetProcAddress);
+  fprintf(stderr, "Renderer: %s\n", glGetString(GL_RENDERER));
+  fprintf(stderr, "Version: %s\n", glGetString(GL_VERSION));
+
+  nekolib::memory::Manager::init();
+  nekolib::renderer::ScreenManager::init(64, 64);
+
+  return true;
+}
+
+void finalize()
+{
+  SDL_GL_DeleteContext(context);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+}
+
+// 配列をバッファに置く
+template <typename T>
+void upload(const gl::Buffer& buffer, const std::vector<T>& data)
+{
+  buffer.bind(GL_SHADER_STORAGE_BUFFER);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(T) * data.size(), data.data(), GL_DYNAMIC_COPY);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+// バッファの先頭n個を読み戻す(直前の計算シェーダーの書き込みを待つ)
+template <typename T>
+std::vector<T> download(const gl::Buffer& buffer, size_t n)
+{
+  std::vector<T> data(n);
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  buffer.bind(GL_SHADER_STORAGE_BUFFER);
+  glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(T) * n, data.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  return data;
+}
+
+static unsigned failures = 0;
+
+// 1行出力(不一致ならその最初の添字も)
+void report(const char* name, unsigned n, bool ok, size_t index = 0)
+{
+  if (ok) {
+    fprintf(stdout, "%-24s %9u ok\n", name, n);
+  } else {
+    fprintf(stdout, "%-24s %9u MISMATCH (index %zu)\n", name, n, index);
+    ++failures;
+  }
+}
+
+template <typename T>
+void compare(const char* name, unsigned n, const std::vector<T>& gpu, const std::vector<T>& cpu)
+{
+  auto m = std::mismatch(cpu.begin(), cpu.end(), gpu.begin());
+  report(name, n, m.first == cpu.end(), m.first - cpu.begin());
+}
+
+// 各演算を同じ要素数で比べる(GPU版のcapacityはどれもn以上)
+struct Checker {
+  std::mt19937 rng;
+  GpuScan<GLuint> scan_sum;
+  GpuScan<GLint, GpuOp::MAX> scan_max;
+  GpuReduce<GLuint> reduce_sum;
+  GpuReduce<GLint, GpuOp::MIN> reduce_min;
+  GpuReduce<float, GpuOp::MAX> reduce_max;
+  GpuArgMin argmin;
+  GpuCompact compact;
+  GpuRadixSort sort;
+  gl::Buffer src, src2, dst, out;
+
+  Checker(unsigned capacity, unsigned seed)
+    : rng(seed), scan_sum(capacity), scan_max(capacity), reduce_sum(capacity), reduce_min(capacity),
+      reduce_max(capacity), argmin(capacity), compact(capacity), sort(capacity) {}
+
+  bool init()
+  {
+    return scan_sum.init() && scan_max.init() && reduce_sum.init() && reduce_min.init() &&
+      reduce_max.init() && argmin.init() && compact.init() && sort.init();
+  }
+
+  void check_scan(unsigned n)
+  {
+    // uintの和は溢れてもCPUと同じく2^32を法として一致する
+    std::uniform_int_distribution<GLuint> value(0u, 0xffffffffu);
+    std::vector<GLuint> a(n);
+    for (auto& x : a) {
+      x = value(rng);
+    }
+    std::vector<GLuint> inclusive(n), exclusive(n);
+    std::partial_sum(a.begin(), a.end(), inclusive.begin());
+    exclusive[0] = 0u;
+    std::copy(inclusive.begin(), inclusive.end() - 1, exclusive.begin() + 1);
+
+    upload(src, a);
+    upload(dst, a);
+    scan_sum.inclusive(src.handle(), dst.handle(), n);
+    compare("scan inclusive (sum)", n, download<GLuint>(dst, n), inclusive);
+    scan_sum.exclusive(src.handle(), dst.handle(), n);
+    compare("scan exclusive (sum)", n, download<GLuint>(dst, n), exclusive);
+    // その場で(src == dst)
+    scan_sum.exclusive(src.handle(), src.handle(), n);
+    compare("scan exclusive in place", n, download<GLuint>(src, n), exclusive);
+
+    std::uniform_int_distribution<GLint> signed_value(-1000000, 1000000);
+    std::vector<GLint> b(n), running_max(n);
+    for (auto& x : b) {
+      x = signed_value(rng);
+    }
+    std::partial_sum(b.begin(), b.end(), running_max.begin(),
+		     [](GLint x, GLint y) { return std::max(x, y); });
+    upload(src, b);
+    upload(dst, b);
+    scan_max.inclusive(src.handle(), dst.handle(), n);
+    compare("scan inclusive (max)", n, download<GLint>(dst, n), running_max);
+  }
+
+  void check_reduce(unsigned n)
+  {
+    std::uniform_int_distribution<GLuint> value(0u, 0xffffffffu);
+    std::vector<GLuint> a(n);
+    for (auto& x : a) {
+      x = value(rng);
+    }
+    upload(src, a);
+    upload(dst, std::vector<GLuint>(1));
+    reduce_sum.reduce(src.handle(), n, dst.handle());
+    compare("reduce (sum)", n, download<GLuint>(dst, 1), std::vector<GLuint>{ std::accumulate(a.begin(), a.end(), 0u) });
+
+    std::uniform_int_distribution<GLint> signed_value(-0x7fffffff - 1, 0x7fffffff);
+    std::vector<GLint> b(n);
+    for (auto& x : b) {
+      x = signed_value(rng);
+    }
+    upload(src, b);
+    reduce_min.reduce(src.handle(), n, dst.handle());
+    compare("reduce (min)", n, download<GLint>(dst, 1), std::vector<GLint>{ *std::min_element(b.begin(), b.end()) });
+
+    // 最小/最大は丸めが無いのでfloatでも厳密に一致する
+    std::uniform_real_distribution<float> real_value(-1e6f, 1e6f);
+    std::vector<float> c(n);
+    for (auto& x : c) {
+      x = real_value(rng);
+    }
+    upload(src, c);
+    reduce_max.reduce(src.handle(), n, dst.handle());
+    compare("reduce (max, float)", n, download<float>(dst, 1), std::vector<float>{ *std::max_element(c.begin(), c.end()) });
+  }
+
+  void check_argmin(unsigned n)
+  {
+    // 値の種類を少なくして同じ最小値が複数ある場合を作る
+    std::uniform_int_distribution<int> value(-64, 64);
+    std::vector<float> a(n);
+    for (auto& x : a) {
+      x = value(rng) * 0.25f;
+    }
+    upload(src, a);
+    upload(dst, std::vector<GpuArgMin::Result>(1));
+    argmin.argmin(src.handle(), n, dst.handle());
+    const GpuArgMin::Result r = download<GpuArgMin::Result>(dst, 1)[0];
+    const auto m = std::min_element(a.begin(), a.end());
+    const size_t index = m - a.begin();
+    report("argmin", n, r.value == *m && r.index == index, index);
+  }
+
+  void check_compact(unsigned n)
+  {
+    // 0以外のflagは全て残す印(1 / 4が0)
+    std::uniform_int_distribution<GLuint> value(0u, 0xffffffffu);
+    std::uniform_int_distribution<GLuint> flag(0u, 3u);
+    std::vector<GLuint> values(n), flags(n);
+    for (unsigned i = 0; i < n; ++i) {
+      values[i] = value(rng);
+      flags[i] = flag(rng);
+    }
+    std::vector<unsigned> indices(n);
+    std::iota(indices.begin(), indices.end(), 0u);
+    std::vector<unsigned> kept;
+    std::copy_if(indices.begin(), indices.end(), std::back_inserter(kept),
+		 [&flags](unsigned i) { return flags[i] != 0u; });
+    std::vector<GLuint> expected(kept.size());
+    for (size_t i = 0; i < kept.size(); ++i) {
+      expected[i] = values[kept[i]];
+    }
+
+    upload(src, values);
+    upload(src2, flags);
+    upload(dst, std::vector<GLuint>(n));
+    upload(out, std::vector<GLuint>(1));
+    compact.compact(src.handle(), src2.handle(), n, dst.handle(), out.handle());
+    const GLuint count = download<GLuint>(out, 1)[0];
+    if (count != expected.size()) {
+      fprintf(stdout, "%-24s %9u MISMATCH (count %u, expected %zu)\n", "compact", n, count, expected.size());
+      ++failures;
+      return;
+    }
+    compare("compact", n, download<GLuint>(dst, count), expected);
+  }
+
+  void check_sort(unsigned n)
+  {
+    // キーの範囲を狭めた場合も試して同じキーの順番(安定性)を見る
+    for (GLuint mask : { 0xffffffffu, 0x3ffu }) {
+      std::uniform_int_distribution<GLuint> value(0u, 0xffffffffu);
+      std::vector<std::pair<GLuint, GLuint>> pairs(n);
+      std::vector<GLuint> keys(n), values(n);
+      for (unsigned i = 0; i < n; ++i) {
+	keys[i] = value(rng) & mask;
+	values[i] = i;
+	pairs[i] = std::make_pair(keys[i], values[i]);
+      }
+      std::stable_sort(pairs.begin(), pairs.end(),
+		       [](const std::pair<GLuint, GLuint>& a, const std::pair<GLuint, GLuint>& b) { return a.first < b.first; });
+      std::vector<GLuint> sorted_keys(n), sorted_values(n);
+      for (unsigned i = 0; i < n; ++i) {
+	sorted_keys[i] = pairs[i].first;
+	sorted_values[i] = pairs[i].second;
+      }
+
+      upload(src, keys);
+      upload(src2, values);
+      sort.sort(src.handle(), src2.handle(), n);
+      const bool full = (mask == 0xffffffffu);
+      compare(full ? "radix sort (keys)" : "radix sort (keys < 1024)", n, download<GLuint>(src, n), sorted_keys);
+      compare(full ? "radix sort (values)" : "radix sort (values, stable)", n, download<GLuint>(src2, n), sorted_values);
+
+      // 値無し
+      upload(src, keys);
+      sort.sort(src.handle(), 0, n);
+      compare(full ? "radix sort (keys only)" : "radix sort (keys only < 1024)", n, download<GLuint>(src, n), sorted_keys);
+    }
+  }
+};
+
+int main(int argc, char* argv[])
+{
+  unsigned seed = 1;
+  std::vector<unsigned> sizes;
+  if (argc > 1) {
+    seed = static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10));
+  }
+  for (int i = 2; i < argc; ++i) {
+    int n = std::atoi(argv[i]);
+    if (n >= 1) {
+      sizes.push_back(n);
+    }
+  }
+  if (sizes.empty()) {
+    // scanのブロックは512個, reduce/argminは1024個, radix sortは256個
+    // 512 * 512個を超えるとscanは3階層
+    sizes = { 1, 2, 255, 256, 257, 511, 512, 513, 1023, 1025, 4097, 100000, 262144, 262145, 1000003 };
+  }
+
+  if (!init()) {
+    return -1;
+  }
+
+  Checker checker(*std::max_element(sizes.begin(), sizes.end()), seed);
+  if (!checker.init()) {
+    fprintf(stderr, "Initializing gpu primitives failed.\n");
+    finalize();
+    return -1;
+  }
+
+  fprintf(stdout, "seed = %u\n", seed);
+  fprintf(stdout, "%-24s %9s\n", "primitive", "n");
+  for (unsigned n : sizes) {
+    checker.check_scan(n);
+    checker.check_reduce(n);
+    checker.check_argmin(n);
+    checker.check_compact(n);
+    checker.check_sort(n);
+  }
+  if (failures > 0) {
+    fprintf(stdout, "%u mismatches\n", failures);
+  }
+
+  finalize();
+
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,226 @@
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <glad/glad.h>
+
+#include "renderer.hpp"
+#include "memory.hpp"
+#include "rope.hpp"
+#include "ropecpu.hpp"
+
+// ゴム紐の積分法毎の速度と精度の比較(画面表示なし)
+// usage: ropebench [steps [point_num ...]]
+//
+// 減衰(c)を0にして両端固定の紐をsteps回進め
+// steps/s, エネルギーと紐の長さの初期値からのずれを出力する
+// CPU版velocity verlet法も同じ条件で計測してGPU版との位置の差(最大値)を出力する
+
+const char* TITLE = "ropebench";
+
+static SDL_Window* window = nullptr;
+static SDL_GLContext context = nullptr;
+
+using namespace nekolib::renderer;
+
+bool init(void)
+{
+  if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
+    fprintf(stderr, "SDL初期化に失敗:%s\n", SDL_GetError());
+    return false;
+  }
+
+  // OpenGL 4.3 Core profile
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+  // コンテキストだけ欲しいので画面は出さない
+  window = SDL_CreateWindow(TITLE, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+			    64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  if (window) {
+    context = SDL_GL_CreateContext(window);
+  }
+  if (!window || !context) {
+    fprintf(stderr, "OpenGLコンテキスト作成に失敗:%s\n", SDL_GetError());
+    SDL_Quit();
+    return false;
+  }
+
+  gladLoadGLLoader(SDL_GL_GetProcAddress);
+  fprintf(stderr, "Renderer: %s\n", glGetString(GL_RENDERER));
+  fprintf(stderr, "Version: %s\n", glGetString(GL_VERSION));
+
+  nekolib::memory::Manager::init();
+  nekolib::renderer::ScreenManager::init(64, 64);
+
+  return true;
+}
+
+void finalize()
+{
+  SDL_GL_DeleteContext(context);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+}
+
+// 力学的エネルギー(運動 + ばね + 重力)
+// 自然長と重力はシェーダーと同じく節点数から決める
+double energy(const RopeState& s, const RopeParams& p)
+{
+  const double l = 2.0 / p.point_num;
+  const double g = 9.8 / p.point_num;
+  double e = 0.0;
+  for (size_t i = 0; i < s.position.size(); ++i) {
+    if (s.movable[i]) {
+      e += 0.5 * p.m * glm::dot(s.velocity[i], s.velocity[i]);
+      e += p.m * g * s.position[i].y;
+    }
+    if (i > 0) {
+      double d = glm::length(s.position[i] - s.position[i - 1]) - l;
+      e += 0.5 * p.k * d * d;
+    }
+  }
+  return e;
+}
+
+double length(const RopeState& s)
+{
+  double len = 0.0;
+  for (size_t i = 1; i < s.position.size(); ++i) {
+    len += glm::length(s.position[i] - s.position[i - 1]);
+  }
+  return len;
+}
+
+void print_result(const char* name, unsigned point_num, unsigned steps, double sec,
+		  const RopeState& s0, const RopeState& s1, const RopeParams& params)
+{
+  const double e0 = energy(s0, params);
+  const double e1 = energy(s1, params);
+  const double l0 = length(s0);
+  const double l1 = length(s1);
+
+  fprintf(stdout, "%-28s %9u %12.1f %12.2f %14.3e %14.3e\n",
+	  name, point_num,
+	  steps / sec, steps * static_cast<double>(point_num) / sec * 1e-6,
+	  (e1 - e0) / std::max(std::fabs(e0), 1e-12), (l1 - l0) / l0);
+}
+
+RopeParams bench_params(unsigned point_num)
+{
+  return RopeParams{ point_num, 1.f / 60, 1.f, 250.f, 0.f };
+}
+
+// 1個の積分法と節点数について計測して1行出力
+// 最終状態をresultに返す(失敗時はfalse)
+bool bench(RopeIntegrator integrator, unsigned point_num, unsigned steps, RopeState& result)
+{
+  const RopeParams params = bench_params(point_num);
+
+  // 両端以外の節点数だけworkgroupを起動するので上限を超える場合は計測不可
+  GLint max_groups = 0;
+  glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &max_groups);
+  if (integrator != RopeIntegrator::EULER && point_num - 2 > static_cast<unsigned>(max_groups)) {
+    fprintf(stdout, "%-28s %9u (too many points for a dispatch)\n", rope_integrator_name(integrator), point_num);
+    return false;
+  }
+
+  std::unique_ptr<Rope> rope = create_rope(integrator, params);
+  if (!rope || !rope->init()) {
+    fprintf(stderr, "Creating rope (%s) failed.\n", rope_integrator_name(integrator));
+    return false;
+  }
+
+  RopeState state;
+  rope->read_state(state);
+
+  glFinish();
+  Uint64 start = SDL_GetPerformanceCounter();
+  for (unsigned i = 0; i < steps; ++i) {
+    rope->step();
+  }
+  glFinish();
+  double sec = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+  rope->read_state(result);
+  print_result(rope_integrator_name(integrator), point_num, steps, sec, state, result, params);
+  return true;
+}
+
+// CPU版velocity verlet法
+void bench_cpu(unsigned point_num, unsigned steps, RopeState& result)
+{
+  const RopeParams params = bench_params(point_num);
+  CpuRope rope(params);
+
+  RopeState state;
+  rope.read_state(state);
+
+  Uint64 start = SDL_GetPerformanceCounter();
+  rope.step(steps);
+  double sec = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+  rope.read_state(result);
+  char name[64];
+  snprintf(name, sizeof(name), "velocity verlet (cpu x%u)", rope.threads());
+  print_result(name, point_num, steps, sec, state, result, params);
+}
+
+// 2つの状態の位置の差の最大値
+double max_difference(const RopeState& a, const RopeState& b)
+{
+  double d = 0.0;
+  for (size_t i = 0; i < a.position.size(); ++i) {
+    d = std::max(d, static_cast<double>(glm::length(a.position[i] - b.position[i])));
+  }
+  return d;
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned steps = 600;
+  std::vector<unsigned> sizes;
+  if (argc > 1) {
+    steps = std::max(std::atoi(argv[1]), 1);
+  }
+  for (int i = 2; i < argc; ++i) {
+    int n = std::atoi(argv[i]);
+    if (n >= 3) {
+      sizes.push_back(n);
+    }
+  }
+  if (sizes.empty()) {
+    sizes = { 100, 1000, 10000 };
+  }
+
+  if (!init()) {
+    return -1;
+  }
+
+  fprintf(stdout, "%u steps, dt = 1/60, c = 0\n", steps);
+  fprintf(stdout, "%-28s %9s %12s %12s %14s %14s\n",
+	  "integrator", "points", "steps/s", "Mpoints/s", "energy drift", "length drift");
+  for (unsigned n : sizes) {
+    RopeState gpu, cpu;
+    bool gpu_valid = false;
+    for (RopeIntegrator integrator : rope_integrators) {
+      RopeState s;
+      if (bench(integrator, n, steps, s) && integrator == RopeIntegrator::VELOCITY_VERLET) {
+	gpu = std::move(s);
+	gpu_valid = true;
+      }
+    }
+    bench_cpu(n, steps, cpu);
+    if (gpu_valid) {
+      fprintf(stdout, "%-28s %9u %12.3e\n", "  max |gpu - cpu| position", n, max_difference(gpu, cpu));
+    }
+  }
+
+  finalize();
+
+  return 0;
+}
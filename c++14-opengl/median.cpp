@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "median.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    bool Median::init()
+    {
+      using Names = std::vector<std::string>;
+
+      if (!net3_prog_.build_program_from_files(Names{ "shader/median_net.cs" })) {
+	return false;
+      }
+      net5_prog_.define("RADIUS2");
+      if (!net5_prog_.build_program_from_files(Names{ "shader/median_net.cs" })) {
+	return false;
+      }
+      if (!hist_prog_.build_program_from_files(Names{ "shader/median_hist.cs" })) {
+	return false;
+      }
+
+      GLint64 max_block = 0;
+      glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &max_block);
+      const GLsizeiptr max_columns_size = max_columns_size_;
+      columns_limit_ = std::min(static_cast<GLsizeiptr>(max_block), max_columns_size);
+
+      return true;
+    }
+
+#define WORKGROUP_SIZE 16
+#define STRIP 64 // shader/median_hist.csのSTRIP, BAND
+#define BAND 128
+    void Median::apply(int radius, const Texture& src, const Texture& dst)
+    {
+      const int r = std::max(1, std::min(radius, static_cast<int>(max_radius_)));
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+      if (r <= network_radius_) {
+	Program& prog = (r == 1) ? net3_prog_ : net5_prog_;
+	prog.use();
+	glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			  (dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      } else {
+	const GLuint gx = (src.width() + STRIP - 1) / STRIP;
+	const GLuint gy = (src.height() + BAND - 1) / BAND;
+	// workgroup毎に(STRIP + 2r)列 x 3色 x 64word
+	const GLsizeiptr group_bytes = static_cast<GLsizeiptr>(STRIP + 2 * r) * 3 * 64 * sizeof(GLuint);
+	const GLsizeiptr groups = columns_limit_ / group_bytes;
+	if (groups == 0) {
+	  fprintf(stderr, "Median: shader storage block is too small (%lld bytes, %lld needed).\n",
+		  static_cast<long long>(columns_limit_), static_cast<long long>(group_bytes));
+	  return;
+	}
+	// 1回に起動するのは横chunk_x x 縦chunk_y個(行を優先して帯に分ける)
+	const GLuint chunk_x = static_cast<GLuint>(std::min<GLsizeiptr>(gx, groups));
+	const GLuint chunk_y = static_cast<GLuint>(std::max<GLsizeiptr>(1, std::min<GLsizeiptr>(gy, groups / chunk_x)));
+	const GLsizeiptr bytes = group_bytes * chunk_x * chunk_y;
+	columns_.bind(GL_SHADER_STORAGE_BUFFER);
+	if (columns_size_ < bytes) {
+	  glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, nullptr, GL_DYNAMIC_COPY);
+	  columns_size_ = bytes;
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	hist_prog_.use();
+	hist_prog_.set_uniform("radius", r);
+	columns_.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+	for (GLuint oy = 0; oy < gy; oy += chunk_y) {
+	  for (GLuint ox = 0; ox < gx; ox += chunk_x) {
+	    if (ox > 0 || oy > 0) {
+	      // 前の回と同じ作業領域を使う
+	      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	    }
+	    hist_prog_.set_uniform("group_x", static_cast<int>(ox));
+	    hist_prog_.set_uniform("group_y", static_cast<int>(oy));
+	    glDispatchCompute(std::min(chunk_x, gx - ox), std::min(chunk_y, gy - oy), 1);
+	  }
+	}
+      }
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+  }
+}
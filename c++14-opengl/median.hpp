@@ -0,0 +1,62 @@
+#ifndef INCLUDED_MEDIAN_HPP
+#define INCLUDED_MEDIAN_HPP
+
+#include <glad/glad.h>
+
+#include "program.hpp"
+#include "texture.hpp"
+#include "globject.hpp"
+#include "filtergraph.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // 中央値フィルタ((2 * radius + 1)^2の窓でr, g, b別々に, alphaは1)
+    //  radius 1, 2 : shader/median_net.cs 比較交換の固定列(sorting network)
+    //  radius 3以上 : shader/median_hist.cs 列毎の度数分布を使い回す方法(Perreault)で
+    //                 画素あたりの手間が半径によらない
+    //                 列毎の度数分布の作業領域はworkgroup毎に要るので, max_columns_size_
+    //                 (とGL_MAX_SHADER_STORAGE_BLOCK_SIZE)に収まるだけのworkgroupずつ分けて起動する
+    class Median {
+    public:
+      Median() : columns_size_(0), columns_limit_(0) {}
+      ~Median() = default;
+
+      Median(const Median&) = delete;
+      Median& operator=(const Median&) = delete;
+
+      bool init();
+
+      void apply(int radius, const Texture& src, const Texture& dst);
+
+      // 256スレッドで帯(64列)と左右radius列の度数分布を受け持つので
+      // 64 + 2 * radius <= 256, 列毎の数は8bitに詰めるので2 * radius + 1 <= 255
+      static const int max_radius_ = 96;
+      static const int network_radius_ = 2; // これ以下ならsorting network
+      static const GLsizeiptr max_columns_size_ = 64 << 20; // 作業領域の上限(byte)
+    private:
+      Program net3_prog_;
+      Program net5_prog_;
+      Program hist_prog_;
+      gl::Buffer columns_; // 列毎の度数分布の作業領域
+      GLsizeiptr columns_size_;
+      GLsizeiptr columns_limit_; // max_columns_size_とGL_MAX_SHADER_STORAGE_BLOCK_SIZEの小さい方
+    };
+
+    // FilterGraph用
+    class MedianFilter : public FilterNode {
+    public:
+      MedianFilter(Median& median, int radius) : median_(median), radius_(radius) {}
+
+      void set_radius(int radius) { radius_ = radius; }
+
+      size_t hash() const override { return hash_combine(reinterpret_cast<size_t>(&median_), radius_); }
+      void apply(const Texture& src, const Texture& dst) override { median_.apply(radius_, src, dst); }
+      int footprint() const override { return radius_; }
+    private:
+      Median& median_;
+      int radius_;
+    };
+  }
+}
+
+#endif // INCLUDED_MEDIAN_HPP
@@ -0,0 +1,137 @@
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "morphology.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    bool Morphology::init()
+    {
+      using Names = std::vector<std::string>;
+
+      if (!line_prog_.build_program_from_files(Names{ "shader/morph_line.cs" })) {
+	return false;
+      }
+      if (!diff_prog_.build_program_from_files(Names{ "shader/morph_diff.cs" })) {
+	return false;
+      }
+
+      return true;
+    }
+
+#define LINE_SIZE 256
+    void Morphology::pass(bool erode, int length, int dir_x, int dir_y, const Texture& src, const Texture& dst)
+    {
+      const int w = src.width(), h = src.height();
+      line_prog_.use();
+      line_prog_.set_uniform("element_length", length);
+      line_prog_.set_uniform("origin", length / 2);
+      line_prog_.set_uniform("dir_x", dir_x);
+      line_prog_.set_uniform("dir_y", dir_y);
+      line_prog_.set_uniform("erode", erode);
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      // 直線の長さ方向は256画素毎, 直線の本数(斜めは幅 + 高さ - 1本)
+      const int len = (dir_x == 0) ? h : w;
+      const int lines = (dir_y == 0) ? h : (dir_x == 0) ? w : w + h - 1;
+      glDispatchCompute((len + LINE_SIZE - 1) / LINE_SIZE, lines, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    void Morphology::erode_dilate(bool erode, const StructuringElement& element, const Texture& src, const Texture& dst)
+    {
+      // (長さ, 方向)のパスの列
+      struct Pass {
+	int length, dir_x, dir_y;
+      };
+      std::vector<Pass> passes;
+      auto add = [&passes](int length, int dir_x, int dir_y) {
+	// 長い要素はmax_pass_length_ずつ(1画素ずつ重なる)に分ける
+	const int max_length = max_pass_length_;
+	while (length > max_length) {
+	  passes.push_back(Pass{ max_length, dir_x, dir_y });
+	  length -= max_length - 1;
+	}
+	if (length > 1) {
+	  passes.push_back(Pass{ length, dir_x, dir_y });
+	}
+      };
+      if (element.shape() == StructuringElement::Shape::RECT) {
+	add(element.width(), 1, 0);
+	add(element.height(), 0, 1);
+      } else {
+	switch (element.angle()) {
+	case 0:
+	  add(element.length(), 1, 0);
+	  break;
+	case 45:
+	  add(element.length(), 1, -1); // y軸は下向き
+	  break;
+	case 90:
+	  add(element.length(), 0, 1);
+	  break;
+	default:
+	  add(element.length(), 1, 1);
+	  break;
+	}
+      }
+      if (passes.empty()) {
+	// 1x1の要素は何もしない
+	passes.push_back(Pass{ 1, 1, 0 });
+      }
+
+      const int w = src.width(), h = src.height();
+      for (auto& t : scratch_) {
+	if (!t || t.width() != w || t.height() != h) {
+	  t = Texture::create(w, h, TextureFormat::RGBA8);
+	}
+      }
+      for (size_t i = 0; i < passes.size(); ++i) {
+	const Texture& in = (i == 0) ? src : scratch_[(i - 1) & 1];
+	const Texture& out = (i + 1 == passes.size()) ? dst : scratch_[i & 1];
+	pass(erode, passes[i].length, passes[i].dir_x, passes[i].dir_y, in, out);
+      }
+    }
+
+#define WORKGROUP_SIZE 16
+    void Morphology::difference(const Texture& a, const Texture& b, const Texture& dst)
+    {
+      diff_prog_.use();
+      glBindImageTexture(0, a.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, b.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(2, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    void Morphology::apply(Op op, const StructuringElement& element, const Texture& src, const Texture& dst)
+    {
+      if (op == Op::ERODE || op == Op::DILATE) {
+	erode_dilate(op == Op::ERODE, element, src, dst);
+	check_gl_error(__FILE__, __LINE__);
+	return;
+      }
+
+      const int w = src.width(), h = src.height();
+      if (!result_ || result_.width() != w || result_.height() != h) {
+	result_ = Texture::create(w, h, TextureFormat::RGBA8);
+      }
+      // open系はerodeから, close系はdilateから
+      const bool open = (op == Op::OPEN || op == Op::TOP_HAT);
+      erode_dilate(open, element, src, result_);
+      erode_dilate(!open, element, result_, dst);
+      // top-hatはdstに置いたopen/closeと元の画像の差(その場で)
+      if (op == Op::TOP_HAT) {
+	difference(src, dst, dst);
+      } else if (op == Op::BLACK_HAT) {
+	difference(dst, src, dst);
+      }
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+  }
+}
@@ -0,0 +1,110 @@
+#ifndef INCLUDED_MORPHOLOGY_HPP
+#define INCLUDED_MORPHOLOGY_HPP
+
+#include <algorithm>
+#include <glad/glad.h>
+
+#include "program.hpp"
+#include "texture.hpp"
+#include "filtergraph.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // 構造要素(矩形か縦横斜めの直線)
+    // 長さnの要素の窓は位置xに対して[x - n / 2, x - n / 2 + n - 1](偶数長も可)
+    class StructuringElement {
+    public:
+      enum class Shape { RECT, LINE };
+
+      static StructuringElement rect(int width, int height) { return StructuringElement(Shape::RECT, width, height, 0); }
+      // angleは0(横), 45(右上がり), 90(縦), 135(左上がり)のどれか
+      static StructuringElement line(int length, int angle) { return StructuringElement(Shape::LINE, length, length, angle); }
+
+      Shape shape() const noexcept { return shape_; }
+      // 要素を囲む矩形
+      int width() const noexcept { return (shape_ == Shape::LINE && angle_ == 90) ? 1 : width_; }
+      int height() const noexcept { return (shape_ == Shape::LINE && angle_ == 0) ? 1 : height_; }
+      int length() const noexcept { return width_; } // LINEの長さ
+      int angle() const noexcept { return angle_; }
+    private:
+      StructuringElement(Shape shape, int width, int height, int angle)
+	: shape_(shape), width_(std::max(width, 1)), height_(std::max(height, 1)), angle_(angle) {}
+
+      Shape shape_;
+      int width_;
+      int height_;
+      int angle_;
+    };
+
+    // 形態学的処理(r, g, b別々, alphaは1)
+    // 全て直線の要素での最小値/最大値(shader/morph_line.cs, van Herk/Gil-Werman法)の組み合わせ
+    //  矩形 : 行方向 -> 列方向の2パス
+    //  直線 : その方向に1パス
+    // 1パスの長さはmax_pass_length_までで, 長い要素は複数パスに分ける
+    // (長さaとbの直線を続けると長さa + b - 1の直線と同じ)
+    // 区間内の累積は全スレッドで並列に行い, 1パスの段数はlog2(長さ)
+    class Morphology {
+    public:
+      enum class Op {
+	ERODE, // 最小値
+	DILATE, // 最大値
+	OPEN, // erode -> dilate (要素より小さい明るい部分を消す)
+	CLOSE, // dilate -> erode (要素より小さい暗い部分を埋める)
+	TOP_HAT, // 元の画像 - open (明るい細部だけ残す)
+	BLACK_HAT, // close - 元の画像 (暗い細部だけ残す)
+      };
+
+      Morphology() = default;
+      ~Morphology() = default;
+
+      Morphology(const Morphology&) = delete;
+      Morphology& operator=(const Morphology&) = delete;
+
+      bool init();
+
+      void apply(Op op, const StructuringElement& element, const Texture& src, const Texture& dst);
+
+      static const int max_pass_length_ = 511; // shader/morph_line.csのMAX_LENGTH
+    private:
+      Program line_prog_;
+      Program diff_prog_;
+      Texture scratch_[2]; // パスの途中
+      Texture result_; // open/closeの前半の結果
+
+      void pass(bool erode, int length, int dir_x, int dir_y, const Texture& src, const Texture& dst);
+      void erode_dilate(bool erode, const StructuringElement& element, const Texture& src, const Texture& dst);
+      void difference(const Texture& a, const Texture& b, const Texture& dst);
+    };
+
+    // FilterGraph用
+    class MorphologyFilter : public FilterNode {
+    public:
+      MorphologyFilter(Morphology& morph, Morphology::Op op, const StructuringElement& element)
+	: morph_(morph), op_(op), element_(element) {}
+
+      void set_op(Morphology::Op op) { op_ = op; }
+      void set_element(const StructuringElement& element) { element_ = element; }
+
+      size_t hash() const override
+      {
+	size_t h = hash_combine(reinterpret_cast<size_t>(&morph_), static_cast<size_t>(op_));
+	h = hash_combine(h, static_cast<size_t>(element_.shape()));
+	h = hash_combine(hash_combine(h, element_.width()), element_.height());
+	return hash_combine(h, element_.angle());
+      }
+      void apply(const Texture& src, const Texture& dst) override { morph_.apply(op_, element_, src, dst); }
+      // open/close系は要素2回分
+      int footprint() const override
+      {
+	const int r = std::max(element_.width(), element_.height()) / 2;
+	return (op_ == Morphology::Op::ERODE || op_ == Morphology::Op::DILATE) ? r : 2 * r;
+      }
+    private:
+      Morphology& morph_;
+      Morphology::Op op_;
+      StructuringElement element_;
+    };
+  }
+}
+
+#endif // INCLUDED_MORPHOLOGY_HPP
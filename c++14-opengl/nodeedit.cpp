@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "nodeedit.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    NodeEditQueue::NodeEditQueue(const NodeLayout& layout, unsigned capacity)
+      : prog_(), staging_(sizeof(Edit) * capacity), layout_(layout), capacity_(capacity)
+    {
+      edits_.reserve(capacity);
+    }
+
+    bool NodeEditQueue::init()
+    {
+      if (layout_.compact) {
+	prog_.define("COMPACT_POINTS");
+      }
+      return prog_.build_program_from_files(std::vector<std::string>{ "shader/node_edit.cs" });
+    }
+
+    // i番目の節点への編集を取得(無ければ追加)
+    NodeEditQueue::Edit& NodeEditQueue::edit(unsigned i)
+    {
+      auto it = slot_.find(i);
+      if (it != slot_.end()) {
+	return edits_[it->second];
+      }
+      slot_.emplace(i, edits_.size());
+      edits_.push_back(Edit{ i, 0u, glm::vec2(0.f) });
+      return edits_.back();
+    }
+
+    void NodeEditQueue::move(unsigned i, float x, float y)
+    {
+      Edit& e = edit(i);
+      e.ops |= SET_POSITION;
+      e.position = glm::vec2(x, y);
+    }
+
+    void NodeEditQueue::set_movable(unsigned i, bool movable)
+    {
+      Edit& e = edit(i);
+      e.ops |= SET_FLAG;
+      if (movable) {
+	e.ops |= FLAG_MOVABLE;
+      } else {
+	e.ops &= ~FLAG_MOVABLE;
+      }
+    }
+
+    void NodeEditQueue::clear_velocity(unsigned i)
+    {
+      edit(i).ops |= CLEAR_VELOCITY;
+    }
+
+    void NodeEditQueue::apply(const GLuint* targets, unsigned target_num)
+    {
+      assert(target_num == 1 || target_num == 2);
+
+      if (edits_.empty()) {
+	return;
+      }
+
+      prog_.use();
+      prog_.set_uniform("stride", layout_.stride);
+      prog_.set_uniform("position_offset0", layout_.position_offset[0]);
+      prog_.set_uniform("position_offset1", layout_.position_offset[1]);
+      prog_.set_uniform("velocity_offset0", layout_.velocity_offset[0]);
+      prog_.set_uniform("velocity_offset1", layout_.velocity_offset[1]);
+      prog_.set_uniform("target_num", target_num);
+
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, staging_.handle());
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, targets[0]);
+      // 使わない時も同じバッファを結び付けておく
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, targets[target_num - 1]);
+
+      // 直前の計算シェーダー/Transform Feedbackの書き込み完了を待つ
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      // 1フレームの編集は普通capacity_個に収まるが溢れたら分割して送る
+      // 節点番号は重複しないのでどの順で書いても結果は同じ
+      for (size_t first = 0; first < edits_.size(); first += capacity_) {
+	unsigned n = static_cast<unsigned>(std::min<size_t>(capacity_, edits_.size() - first));
+
+	void* p = staging_.map();
+	if (!p) {
+	  break;
+	}
+	std::memcpy(p, &edits_[first], sizeof(Edit) * n);
+	GLintptr offset = staging_.unmap(sizeof(Edit) * n);
+
+	prog_.set_uniform("edit_offset", static_cast<unsigned>(offset / sizeof(Edit)));
+	prog_.set_uniform("edit_num", n);
+	glDispatchCompute((n + workgroup_size_ - 1) / workgroup_size_, 1, 1);
+	staging_.fence();
+      }
+
+      // 後続の計算シェーダー, 頂点属性, texture buffer, バッファ間コピーのどれから読まれても良いように
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+		      GL_TEXTURE_FETCH_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+      clear();
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+  }
+}
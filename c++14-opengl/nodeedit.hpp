@@ -0,0 +1,99 @@
+#ifndef INCLUDED_NODEEDIT_HPP
+#define INCLUDED_NODEEDIT_HPP
+
+#include <vector>
+#include <unordered_map>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "program.hpp"
+#include "streambuffer.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // 節点バッファのレイアウト(単位はvec4)
+    // 節点iの位置は nodes[i * stride + position_offset[k]] (xy = 位置, w = 可動フラグ)
+    // 速度は nodes[i * stride + velocity_offset[k]] (xyz)
+    // 使わない欄は-1
+    //
+    // compact = trueの時は圧縮形式(シェーダー側はCOMPACT_POINTS)
+    // 位置の欄が vec2 位置 + uint flag(POINT_MOVABLE) + uint 速度(packHalf2x16) になり
+    // 速度は位置と同じ欄に入っているのでvelocity_offsetは位置と同じ値にする
+    struct NodeLayout {
+      unsigned stride;
+      int position_offset[2];
+      int velocity_offset[2];
+      bool compact = false;
+    };
+
+    // 圧縮形式の節点のflag
+    const unsigned POINT_MOVABLE = 1u;
+
+    // 節点の編集(移動, 固定/解除, 速度リセット)をフレーム中に溜めておき
+    // apply()で1回の計算シェーダー起動でまとめて節点バッファへ書き込む
+    // 溜めた命令はStreamBufferで転送するのでglBufferSubDataによる暗黙の同期が起きない
+    //
+    // 同じフレームで同じ節点に複数回編集した場合は後の命令が優先
+    class NodeEditQueue {
+    public:
+      // 編集の種類(ビット和)
+      enum Op : unsigned {
+	SET_POSITION = 1u,
+	SET_FLAG = 2u,
+	CLEAR_VELOCITY = 4u,
+	FLAG_MOVABLE = 8u, // SET_FLAGと併用 : 立っていればw = 1(可動), 無ければw = 0(固定)
+      };
+
+      NodeEditQueue(const NodeLayout& layout, unsigned capacity = 4096);
+      ~NodeEditQueue() = default;
+
+      NodeEditQueue(const NodeEditQueue&) = delete;
+      NodeEditQueue& operator=(const NodeEditQueue&) = delete;
+      NodeEditQueue(NodeEditQueue&&) = delete;
+      NodeEditQueue& operator=(NodeEditQueue&&) = delete;
+
+      bool init();
+
+      // i番目の節点を(x, y)に移動
+      void move(unsigned i, float x, float y);
+      // i番目の節点を可動(true)/固定(false)にする
+      void set_movable(unsigned i, bool movable);
+      // i番目の節点の速度を0にする
+      // 速度の欄が無いレイアウト(Verlet法)では前回位置(targets[1])を現在位置にそろえる
+      void clear_velocity(unsigned i);
+
+      bool empty() const noexcept { return edits_.empty(); }
+      void clear() noexcept { edits_.clear(); slot_.clear(); }
+
+      // 溜めた編集をtargets[0..target_num)の節点バッファへ適用する
+      // target_num > 1の時は位置とフラグを全バッファへ書く(Verlet法の前回位置など)
+      // 適用後は溜めた編集を捨てる
+      void apply(const GLuint* targets, unsigned target_num);
+      void apply(GLuint target) { apply(&target, 1); }
+
+    private:
+      // シェーダー側の
+      // struct NodeEdit { uint index; uint ops; vec2 position; };
+      // と同じレイアウト(std430)
+      struct Edit {
+	unsigned index;
+	unsigned ops;
+	glm::vec2 position;
+      };
+
+      Program prog_;
+      StreamBuffer staging_;
+      const NodeLayout layout_;
+      const unsigned capacity_; // 1回の転送で送れる命令数
+
+      std::vector<Edit> edits_;
+      std::unordered_map<unsigned, size_t> slot_; // 節点番号 -> edits_の添字
+
+      Edit& edit(unsigned);
+
+      static const unsigned workgroup_size_ = 64;
+    };
+  }
+}
+
+#endif // INCLUDED_NODEEDIT_HPP
@@ -0,0 +1,325 @@
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "particles.hpp"
+#include "defines.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    namespace {
+      // 粒子(シェーダー側のstruct Particleと同じレイアウト)
+      // 確保するサイズを決めるだけでCPU側からは読み書きしない
+#ifdef NEKO_COMPACT_POINTS
+      // 位置のwは省略, 速度と寿命はfp16
+      struct GpuParticle {
+	float position[3];
+	GLuint velocity_xy; // packHalf2x16(速度xy)
+	GLuint velocity_z_life; // packHalf2x16(速度z, 残り寿命)
+      };
+#else
+      struct GpuParticle {
+	glm::vec4 position; // 位置(w = 1)
+	glm::vec4 velocity; // 速度(xyz) + 残り寿命(w)
+      };
+#endif
+    }
+
+    ParticleSystem::ParticleSystem(unsigned capacity)
+      : cell_scan_(grid_table_size_), sort_(capacity), readback_(sizeof(GLuint)), capacity_(capacity), current_(0),
+	emitter_num_(0), frame_(0), alive_count_(0)
+    {
+      assert(capacity > 0);
+
+      particles_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuParticle) * capacity_, nullptr, GL_DYNAMIC_COPY);
+      for (auto& alive : alive_) {
+	alive.bind(GL_SHADER_STORAGE_BUFFER);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * capacity_, nullptr, GL_DYNAMIC_COPY);
+      }
+      dead_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint) * capacity_, nullptr, GL_DYNAMIC_COPY);
+      counters_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Counters), nullptr, GL_DYNAMIC_COPY);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+      positions_.bind();
+      glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * capacity_, nullptr, GL_DYNAMIC_COPY);
+
+      const std::pair<gl::Buffer*, GLsizeiptr> grid_buffers[] = {
+	{ &cell_count_, sizeof(GLuint) * grid_table_size_ },
+	{ &cell_start_, sizeof(GLuint) * grid_table_size_ },
+	{ &cell_key_, sizeof(GLuint) * 2 * capacity_ },
+	{ &sorted_positions_, sizeof(glm::vec4) * capacity_ },
+	{ &sorted_velocities_, sizeof(glm::vec4) * capacity_ },
+	{ &sorted_indices_, sizeof(GLuint) * capacity_ },
+	{ &particles_temp_, sizeof(GpuParticle) * capacity_ },
+	{ &morton_keys_, sizeof(GLuint) * capacity_ },
+	{ &morton_values_, sizeof(GLuint) * capacity_ },
+      };
+      for (auto& b : grid_buffers) {
+	b.first->bind(GL_SHADER_STORAGE_BUFFER);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, b.second, nullptr, GL_DYNAMIC_COPY);
+      }
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+      // 位置は詰めてあるのでw = 1が補われる
+      vao_.bind();
+      positions_.bind();
+      glEnableVertexAttribArray(0);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+      vao_.bind(false);
+
+      reset();
+    }
+
+    bool ParticleSystem::init()
+    {
+      using Names = std::vector<std::string>;
+
+#ifdef NEKO_COMPACT_POINTS
+      for (Program* prog : { &emit_prog_, &update_prog_, &grid_scatter_prog_, &collide_prog_, &reorder_prog_ }) {
+	prog->define("COMPACT_POINTS");
+      }
+#endif
+      if (!prepare_prog_.build_program_from_files(Names{ "shader/particle_prepare.cs" })) {
+	return false;
+      }
+      if (!emit_prog_.build_program_from_files(Names{ "shader/particle_emit.cs" })) {
+	return false;
+      }
+      if (!update_prog_.build_program_from_files(Names{ "shader/particle_update.cs" })) {
+	return false;
+      }
+      if (!grid_count_prog_.build_program_from_files(Names{ "shader/particle_grid_count.cs" })) {
+	return false;
+      }
+      if (!cell_scan_.init()) {
+	return false;
+      }
+      if (!grid_scatter_prog_.build_program_from_files(Names{ "shader/particle_grid_scatter.cs" })) {
+	return false;
+      }
+      if (!collide_prog_.build_program_from_files(Names{ "shader/particle_collide.cs" })) {
+	return false;
+      }
+      if (!reorder_prog_.build_program_from_files(Names{ "shader/particle_reorder.cs" })) {
+	return false;
+      }
+      if (!sort_.init()) {
+	return false;
+      }
+
+      return true;
+    }
+
+    void ParticleSystem::reset()
+    {
+      // 空きリストは全粒子(番号の小さい方から取り出されるように逆順)
+      std::vector<GLuint> dead(capacity_);
+      for (unsigned i = 0; i < capacity_; ++i) {
+	dead[i] = capacity_ - 1 - i;
+      }
+      dead_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint) * capacity_, dead.data());
+
+      Counters c = { 0, 1, 0, 0, 0, 1, 1, 0, capacity_, 0, 0 };
+      counters_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Counters), &c);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+      current_ = 0;
+      alive_count_ = 0;
+      readback_.cancel();
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    void ParticleSystem::set_emitters(const std::vector<ParticleEmitter>& emitters)
+    {
+      emitter_num_ = static_cast<unsigned>(emitters.size());
+      if (emitters.empty()) {
+	return;
+      }
+
+      // 発生源は毎フレーム変わる訳ではないので都度作り直す
+      emitters_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(ParticleEmitter) * emitters.size(),
+		   emitters.data(), GL_STATIC_DRAW);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    void ParticleSystem::update(float dt, unsigned emit_num)
+    {
+      if (emitter_num_ == 0) {
+	emit_num = 0;
+      }
+      const unsigned next = 1 - current_;
+
+      particles_.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+      alive_[current_].bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+      alive_[next].bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+      dead_.bind_base(GL_SHADER_STORAGE_BUFFER, 3);
+      counters_.bind_base(GL_SHADER_STORAGE_BUFFER, 4);
+      if (emitter_num_ > 0) {
+	emitters_.bind_base(GL_SHADER_STORAGE_BUFFER, 5);
+      }
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, positions_.handle());
+
+      // 発生数の確定と間接起動の引数
+      prepare_prog_.use();
+      prepare_prog_.set_uniform("emit_request", emit_num);
+      glDispatchCompute(1, 1, 1);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+      // 発生(emit_num個分起動して余りは何もしない)
+      if (emit_num > 0) {
+	emit_prog_.use();
+	emit_prog_.set_uniform("emitter_num", emitter_num_);
+	emit_prog_.set_uniform("seed", frame_);
+	glDispatchCompute((emit_num + workgroup_size_ - 1) / workgroup_size_, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+      }
+
+      // 積分と生存リストの詰め直し
+      update_prog_.use();
+      update_prog_.set_uniform("dt", dt);
+      update_prog_.set_uniform("height", height);
+      update_prog_.set_uniform("attenuation", attenuation);
+      glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, counters_.handle());
+      glDispatchComputeIndirect(offsetof(Counters, groups_x));
+      glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+      if (collide) {
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	collide_particles(dt);
+      }
+
+      if (reorder_interval > 0 && (frame_ + 1) % reorder_interval == 0) {
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	reorder_particles();
+      }
+
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT |
+		      GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+      current_ = next;
+      ++frame_;
+
+      // 生存数の読み戻し(前の要求が終わっていれば次を出す)
+      GLuint alive;
+      if (readback_.poll(&alive)) {
+	alive_count_ = alive;
+      }
+      if (!readback_.pending()) {
+	readback_.copy_buffer(counters_.handle(), offsetof(Counters, draw_count), sizeof(GLuint));
+      }
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    // 粒子同士の衝突
+    // update直後(生存リストはalive_[1 - current_])に呼ぶ
+    // 各パスの結合ポイントは粒子の更新用のものを上書きして使う(シェーダー側参照)
+    void ParticleSystem::collide_particles(float dt)
+    {
+      const float cell_size = 2.f * radius;
+
+      // セル毎の個数を数える
+      GLuint zero = 0;
+      cell_count_.bind(GL_SHADER_STORAGE_BUFFER);
+      glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+      cell_count_.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+      cell_key_.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, positions_.handle());
+      grid_count_prog_.use();
+      grid_count_prog_.set_uniform("cell_size", cell_size);
+      glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, counters_.handle());
+      glDispatchComputeIndirect(offsetof(Counters, groups_x));
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      // セル毎の先頭
+      cell_scan_.exclusive(cell_count_.handle(), cell_start_.handle(), grid_table_size_);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      // セル順に並べ直す(scanで結合ポイント0-2が変わっているので結び直す)
+      particles_.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+      cell_key_.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+      cell_start_.bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+      alive_[1 - current_].bind_base(GL_SHADER_STORAGE_BUFFER, 3);
+      sorted_positions_.bind_base(GL_SHADER_STORAGE_BUFFER, 5);
+      sorted_velocities_.bind_base(GL_SHADER_STORAGE_BUFFER, 6);
+      sorted_indices_.bind_base(GL_SHADER_STORAGE_BUFFER, 7);
+      grid_scatter_prog_.use();
+      glDispatchComputeIndirect(offsetof(Counters, groups_x));
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      // 周囲のセルの粒子から斥力を受ける
+      cell_count_.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+      collide_prog_.use();
+      collide_prog_.set_uniform("cell_size", cell_size);
+      collide_prog_.set_uniform("stiffness", stiffness);
+      collide_prog_.set_uniform("damping", damping);
+      collide_prog_.set_uniform("max_neighbors", max_neighbors);
+      collide_prog_.set_uniform("dt", dt);
+      glDispatchComputeIndirect(offsetof(Counters, groups_x));
+      glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    }
+
+    // 粒子プールをMorton順に並べ直す
+    // update直後(生存リストはalive_[1 - current_])に呼ぶ
+    // 生存数はGPU上にしか無いので空きの粒子も含めて容量分を並べ替える(空きはキー最大で後ろへ)
+    void ParticleSystem::reorder_particles()
+    {
+      const unsigned groups = (capacity_ + workgroup_size_ - 1) / workgroup_size_;
+
+      glBindBuffer(GL_COPY_READ_BUFFER, particles_.handle());
+      glBindBuffer(GL_COPY_WRITE_BUFFER, particles_temp_.handle());
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(GpuParticle) * capacity_);
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+      auto bind = [&]() {
+	particles_temp_.bind_base(GL_SHADER_STORAGE_BUFFER, 0);
+	morton_keys_.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+	alive_[1 - current_].bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+	dead_.bind_base(GL_SHADER_STORAGE_BUFFER, 3);
+	counters_.bind_base(GL_SHADER_STORAGE_BUFFER, 4);
+	morton_values_.bind_base(GL_SHADER_STORAGE_BUFFER, 5);
+	particles_.bind_base(GL_SHADER_STORAGE_BUFFER, 6);
+	reorder_prog_.use();
+	reorder_prog_.set_uniform("capacity", capacity_);
+	reorder_prog_.set_uniform("bounds_min", bounds_min);
+	reorder_prog_.set_uniform("bounds_max", bounds_max);
+      };
+
+      // (キー, 粒子番号)
+      bind();
+      reorder_prog_.set_uniform("stage", 0u);
+      glDispatchCompute(groups, 1, 1);
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      sort_.sort(morton_keys_.handle(), morton_values_.handle(), capacity_);
+
+      // 並べ替えで結合ポイントが変わっているので結び直す
+      bind();
+      reorder_prog_.set_uniform("stage", 1u);
+      glDispatchCompute(groups, 1, 1);
+    }
+
+    void ParticleSystem::render() const
+    {
+      vao_.bind();
+      counters_.bind(GL_DRAW_INDIRECT_BUFFER);
+      glDrawArraysIndirect(GL_POINTS, BUFFER_OFFSETOF(Counters, draw_count));
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+  }
+}
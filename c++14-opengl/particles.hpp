@@ -0,0 +1,144 @@
+#ifndef INCLUDED_PARTICLES_HPP
+#define INCLUDED_PARTICLES_HPP
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "program.hpp"
+#include "globject.hpp"
+#include "readback.hpp"
+#include "gpuprim.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // 粒子の発生源
+    // シェーダー側の struct Emitter と同じレイアウト(std430)
+    struct ParticleEmitter {
+      glm::vec4 position; // 発生位置(xyz) + 初速の大きさの標準偏差(w)
+      glm::vec4 velocity; // 初速の平均(xyz) + 寿命の平均(w, 秒)
+    };
+
+    // 固定容量の粒子プールを使い回すGPU粒子システム
+    // 1フレームの処理は
+    //  prepare : 発生数を空き数で制限し, 各カウンターと間接起動の引数を用意(1スレッド)
+    //  emit : 空きリストから取り出した粒子を発生源の設定で初期化して生存リストへ追加
+    //  update : 生存リストの粒子を積分し, 寿命が尽きたものは空きリストへ
+    //           残りはatomicAddで次の生存リストと描画用の位置バッファへ詰める
+    //  collide(有効時のみ) : 粒子を一様格子(ハッシュ表)へcounting sortで並べ直し
+    //           周囲27セルの粒子だけを調べて粒子同士の斥力を速度に反映する
+    //  reorder(reorder_intervalフレーム毎) : 粒子プールを位置のMorton順に並べ直し
+    //           生存リストと空きリストの粒子番号を付け替える
+    // 生存数はGPU上にしか無いのでupdateはglDispatchComputeIndirect, 描画はglDrawArraysIndirect
+    // 初期化後はCPUから粒子データには触らない(生存数の表示はAsyncReadbackで数フレーム遅れ)
+    //
+    // NEKO_COMPACT_POINTSの時は粒子を圧縮形式(20byte)で持つ(シェーダー側はCOMPACT_POINTS)
+    class ParticleSystem {
+    public:
+      ParticleSystem(unsigned capacity);
+      ~ParticleSystem() = default;
+
+      ParticleSystem(const ParticleSystem&) = delete;
+      ParticleSystem& operator=(const ParticleSystem&) = delete;
+      ParticleSystem(ParticleSystem&&) = delete;
+      ParticleSystem& operator=(ParticleSystem&&) = delete;
+
+      bool init();
+      // 全粒子を空きに戻す
+      void reset();
+
+      // 発生源の設定(emit時にid % 発生源の数で振り分ける)
+      void set_emitters(const std::vector<ParticleEmitter>&);
+
+      // dt秒進める
+      // emit_num個発生させる(空きが足りない分は発生しない)
+      void update(float dt, unsigned emit_num);
+      // 生存している粒子を点で描画(位置はattribute 0)
+      void render() const;
+
+      // 数フレーム前の生存数(表示用)
+      unsigned alive_count() const noexcept { return alive_count_; }
+      unsigned capacity() const noexcept { return capacity_; }
+
+      // 地面の高さと跳ね返り時の減衰率
+      float height = -0.95f;
+      float attenuation = 0.7f;
+
+      // 粒子同士の衝突
+      bool collide = false;
+      float radius = 0.02f; // 粒子の半径(格子のセルの大きさは2倍)
+      float stiffness = 50.f; // 斥力の強さ
+      float damping = 5.f; // 法線方向の相対速度の減衰
+      unsigned max_neighbors = 32; // 1粒子が相手にする最大数
+
+      // 粒子プールの並べ替え
+      unsigned reorder_interval = 60; // 何フレーム毎に並べ替えるか(0なら並べ替えない)
+      glm::vec3 bounds_min = glm::vec3(-2.f); // Mortonキーを求める範囲
+      glm::vec3 bounds_max = glm::vec3(2.f);
+    private:
+      // シェーダー側のbuffer Countersと同じレイアウト(std430)
+      struct Counters {
+	// DrawArraysIndirectCommand(countは次の生存数)
+	GLuint draw_count;
+	GLuint draw_instance_count;
+	GLuint draw_first;
+	GLuint draw_base_instance;
+	// DispatchIndirectCommand(update用)
+	GLuint groups_x;
+	GLuint groups_y;
+	GLuint groups_z;
+	GLuint alive_count; // 今回updateする生存数(emit分を含む)
+	GLuint dead_count; // 空きリストの個数
+	GLuint emit_num; // 今回実際に発生させる数
+	GLuint emit_base; // 今回発生させる粒子の生存リスト内の先頭
+      };
+
+      Program prepare_prog_;
+      Program emit_prog_;
+      Program update_prog_;
+      Program grid_count_prog_;
+      Program grid_scatter_prog_;
+      Program collide_prog_;
+      Program reorder_prog_;
+
+      gl::Buffer particles_; // 粒子プール
+      gl::Buffer alive_[2]; // 生存リスト(粒子番号, 毎フレーム入れ替え)
+      gl::Buffer dead_; // 空きリスト(粒子番号のスタック)
+      gl::Buffer counters_;
+      gl::Buffer emitters_;
+      gl::VertexBuffer positions_; // 描画用に詰めた位置(xyz)
+      gl::Vao vao_;
+
+      // 近傍探索用の一様格子
+      gl::Buffer cell_count_; // セル毎の粒子数
+      gl::Buffer cell_start_; // セル毎の先頭(cell_count_の排他的prefix sum)
+      GpuScan<GLuint> cell_scan_;
+      gl::Buffer cell_key_; // 粒子毎の(セル番号, セル内の順位)
+      gl::Buffer sorted_positions_; // セル順に並べた位置
+      gl::Buffer sorted_velocities_; // セル順に並べた速度
+      gl::Buffer sorted_indices_; // セル順に並べた粒子番号
+
+      // Morton順の並べ替え用
+      GpuRadixSort sort_;
+      gl::Buffer particles_temp_; // 並べ替え前の粒子プールのコピー
+      gl::Buffer morton_keys_;
+      gl::Buffer morton_values_; // 粒子番号
+
+      AsyncReadback readback_;
+
+      const unsigned capacity_;
+      unsigned current_; // 今回updateで読む生存リスト
+      unsigned emitter_num_;
+      unsigned frame_; // 乱数の種
+      unsigned alive_count_;
+
+      void collide_particles(float dt);
+      void reorder_particles();
+
+      static const unsigned workgroup_size_ = 64;
+      static const unsigned grid_table_size_ = 1u << 20; // ハッシュ表の大きさ(シェーダー側のTABLE_SIZE)
+    };
+  }
+}
+
+#endif // INCLUDED_PARTICLES_HPP
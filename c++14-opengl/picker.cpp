@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <vector>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "picker.hpp"
+#include "renderer.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // シェーダー側の
+    // struct Candidate { float distance; uint index; };
+    // と同じレイアウト(std430)
+    struct Candidate {
+      float distance;
+      unsigned index;
+    };
+
+    NodePicker::NodePicker() : readback_(sizeof(Candidate))
+    {
+      partials_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, max_workgroups_ * sizeof(Candidate), nullptr, GL_DYNAMIC_COPY);
+      result_.bind(GL_SHADER_STORAGE_BUFFER);
+      glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Candidate), nullptr, GL_DYNAMIC_COPY);
+      glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    bool NodePicker::init()
+    {
+      using Names = std::vector<std::string>;
+
+      if (!pick_prog_.build_program_from_files(Names{ "shader/pick.cs" })) {
+	return false;
+      }
+      if (!reduce_prog_.build_program_from_files(Names{ "shader/pick_reduce.cs" })) {
+	return false;
+      }
+
+      return true;
+    }
+
+    void NodePicker::request(GLuint nodes, unsigned count, unsigned stride,
+			     glm::vec2 cursor, float radius)
+    {
+      // 節点数が多い時は1 invocationで複数節点を担当させて
+      // 2段目の集計対象をmax_workgroups_個以下に抑える
+      unsigned groups = std::min((count + workgroup_size_ - 1) / workgroup_size_, max_workgroups_);
+      groups = std::max(groups, 1u);
+
+      // 正規化デバイス座標の差をpixel単位に直す係数
+      glm::vec2 scale(ScreenManager::width() * 0.5f, ScreenManager::height() * 0.5f);
+
+      glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, nodes);
+      partials_.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+      result_.bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+
+      // 節点バッファの更新完了を待つ
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      pick_prog_.use();
+      pick_prog_.set_uniform("cursor", cursor);
+      pick_prog_.set_uniform("scale", scale);
+      pick_prog_.set_uniform("node_num", count);
+      pick_prog_.set_uniform("stride", stride);
+      glDispatchCompute(groups, 1, 1);
+
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+      reduce_prog_.use();
+      reduce_prog_.set_uniform("partial_num", groups);
+      reduce_prog_.set_uniform("radius", radius);
+      glDispatchCompute(1, 1, 1);
+
+      // glCopyBufferSubDataの前にSSBOへの書き込みを可視化
+      glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+      readback_.copy_buffer(result_.handle(), 0, sizeof(Candidate));
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    bool NodePicker::poll(int* index)
+    {
+      Candidate c;
+      if (!readback_.poll(&c)) {
+	return false;
+      }
+      *index = (c.index == static_cast<unsigned>(-1)) ? -1 : static_cast<int>(c.index);
+      return true;
+    }
+  }
+}
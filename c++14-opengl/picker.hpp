@@ -0,0 +1,57 @@
+#ifndef INCLUDED_PICKER_HPP
+#define INCLUDED_PICKER_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "program.hpp"
+#include "globject.hpp"
+#include "readback.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // 節点バッファ(SSBO)からカーソルに最も近い節点を計算シェーダーで探す
+    // 節点位置はバッファ先頭からstride個のvec4毎に並んでいて
+    // xyがそのまま正規化デバイス座標として描画されている前提
+    //
+    // request()で計算シェーダーを起動して結果をPBOへコピーするだけなので
+    // 結果は次フレーム以降にpoll()で受け取る
+    class NodePicker {
+    public:
+      NodePicker();
+      ~NodePicker() = default;
+
+      NodePicker(const NodePicker&) = delete;
+      NodePicker& operator=(const NodePicker&) = delete;
+      NodePicker(NodePicker&&) = delete;
+      NodePicker& operator=(NodePicker&&) = delete;
+
+      bool init();
+
+      // nodes : 節点バッファ
+      // count : 節点数
+      // stride : 節点1個分のvec4の個数
+      // cursor : カーソル位置(正規化デバイス座標)
+      // radius : 当たり判定の半径(pixel)
+      void request(GLuint nodes, unsigned count, unsigned stride, glm::vec2 cursor, float radius);
+
+      // 結果が出ていればtrueを返し*indexに節点番号(範囲内に無ければ-1)を格納
+      bool poll(int* index);
+      bool pending() const noexcept { return readback_.pending(); }
+      void cancel() noexcept { readback_.cancel(); }
+
+    private:
+      Program pick_prog_; // workgroup毎の最近傍
+      Program reduce_prog_; // workgroup毎の結果から最終結果
+
+      gl::Buffer partials_;
+      gl::Buffer result_;
+      AsyncReadback readback_;
+
+      static const unsigned workgroup_size_ = 256;
+      static const unsigned max_workgroups_ = 64;
+    };
+  }
+}
+
+#endif // INCLUDED_PICKER_HPP
@@ -0,0 +1,355 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "pointcloud.hpp"
+#include "defines.hpp"
+#include "utils.hpp"
+
+using glm::vec3;
+using glm::vec4;
+using glm::mat4;
+
+namespace nekolib {
+  namespace renderer {
+    namespace {
+      using Point = GLfloat[3];
+
+      // PLYのpropertyの型のbyte数(不明なら0)
+      size_t ply_type_size(const std::string& type)
+      {
+	if (type == "char" || type == "uchar" || type == "int8" || type == "uint8") {
+	  return 1;
+	}
+	if (type == "short" || type == "ushort" || type == "int16" || type == "uint16") {
+	  return 2;
+	}
+	if (type == "int" || type == "uint" || type == "float" ||
+	    type == "int32" || type == "uint32" || type == "float32") {
+	  return 4;
+	}
+	if (type == "double" || type == "float64") {
+	  return 8;
+	}
+	return 0;
+      }
+
+      bool ends_with(const std::string& s, const std::string& suffix)
+      {
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+      }
+    }
+
+    PointCloud::PointCloud(GLsizeiptr segment_size, unsigned segment_num)
+      : stream_(segment_size, segment_num), fd_(-1), data_(nullptr), file_size_(0), released_(0),
+	vertices_(nullptr), stride_(0), offset_{ 0, 0, 0 }, point_num_(0), loaded_(0), failed_(false),
+	drawn_(0)
+    {
+      assert(segment_size >= static_cast<GLsizeiptr>(sizeof(Point) * chunk_points_));
+
+      vao_.bind();
+      vbo_.bind();
+      glEnableVertexAttribArray(0);
+      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
+      vao_.bind(false);
+    }
+
+    PointCloud::~PointCloud()
+    {
+      close();
+    }
+
+    void PointCloud::close()
+    {
+      if (data_) {
+	munmap(const_cast<unsigned char*>(data_), file_size_);
+	data_ = nullptr;
+      }
+      if (fd_ >= 0) {
+	::close(fd_);
+	fd_ = -1;
+      }
+      vertices_ = nullptr;
+      file_size_ = released_ = 0;
+      point_num_ = loaded_ = 0;
+      failed_ = false;
+      chunks_.clear();
+    }
+
+    bool PointCloud::open(const char* path)
+    {
+      close();
+
+      fd_ = ::open(path, O_RDONLY);
+      if (fd_ < 0) {
+	fprintf(stderr, "Can't open %s.\n", path);
+	return false;
+      }
+      struct stat st;
+      if (fstat(fd_, &st) != 0 || st.st_size == 0) {
+	fprintf(stderr, "Can't stat %s.\n", path);
+	close();
+	return false;
+      }
+      file_size_ = static_cast<size_t>(st.st_size);
+
+      void* p = mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+      if (p == MAP_FAILED) {
+	fprintf(stderr, "Can't mmap %s.\n", path);
+	close();
+	return false;
+      }
+      data_ = static_cast<const unsigned char*>(p);
+      // 先頭から順に1回だけ読む
+      madvise(p, file_size_, MADV_SEQUENTIAL);
+
+      size_t header_size = 0;
+      if (ends_with(path, ".ply")) {
+	if (!parse_ply(&header_size)) {
+	  fprintf(stderr, "Unsupported PLY file %s.\n", path);
+	  close();
+	  return false;
+	}
+      } else {
+	stride_ = sizeof(Point);
+	offset_[0] = 0; offset_[1] = sizeof(GLfloat); offset_[2] = 2 * sizeof(GLfloat);
+	point_num_ = file_size_ / stride_;
+      }
+      // 頂点数が巨大なヘッダでも掛け算が溢れないように割り算で確かめる
+      if (stride_ == 0 || header_size > file_size_ || point_num_ > (file_size_ - header_size) / stride_) {
+	fprintf(stderr, "%s is truncated.\n", path);
+	close();
+	return false;
+      }
+      vertices_ = data_ + header_size;
+
+      vbo_.bind();
+      glBufferData(GL_ARRAY_BUFFER, sizeof(Point) * point_num_, nullptr, GL_STATIC_DRAW);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+      min_ = vec3(std::numeric_limits<float>::max());
+      max_ = vec3(std::numeric_limits<float>::lowest());
+      chunks_.reserve((point_num_ + chunk_points_ - 1) / chunk_points_);
+
+      fprintf(stdout, "%s : %zu points\n", path, point_num_);
+      check_gl_error(__FILE__, __LINE__);
+
+      return true;
+    }
+
+    // PLYのヘッダを読んで頂点の形式を調べる
+    bool PointCloud::parse_ply(size_t* header_size)
+    {
+      static const char end_header[] = "end_header\n";
+      const size_t limit = std::min<size_t>(file_size_, 1 << 16);
+      const std::string text(reinterpret_cast<const char*>(data_), limit);
+      const size_t end = text.find(end_header);
+      if (text.compare(0, 4, "ply\n") != 0 || end == std::string::npos) {
+	return false;
+      }
+      *header_size = end + sizeof(end_header) - 1;
+
+      std::istringstream in(text.substr(0, end));
+      std::string line;
+      bool little_endian = false;
+      int element = -1; // 0 : vertex, 1 : それ以外
+      bool found[3] = { false, false, false };
+      stride_ = 0;
+      while (std::getline(in, line)) {
+	std::istringstream words(line);
+	std::string key;
+	words >> key;
+	if (key == "format") {
+	  std::string format;
+	  words >> format;
+	  little_endian = (format == "binary_little_endian");
+	} else if (key == "element") {
+	  std::string name;
+	  size_t count = 0;
+	  words >> name >> count;
+	  if (element < 0 && name == "vertex") {
+	    element = 0;
+	    point_num_ = count;
+	  } else if (element < 0) {
+	    // 頂点より前に他の要素があると頂点の位置が決まらない
+	    return false;
+	  } else {
+	    element = 1;
+	  }
+	} else if (key == "property" && element == 0) {
+	  std::string type, name;
+	  words >> type >> name;
+	  const size_t size = ply_type_size(type);
+	  if (size == 0) { // list等
+	    return false;
+	  }
+	  static const char* axes[] = { "x", "y", "z" };
+	  for (int i = 0; i < 3; ++i) {
+	    if (name == axes[i]) {
+	      if (type != "float" && type != "float32") {
+		return false;
+	      }
+	      offset_[i] = stride_;
+	      found[i] = true;
+	    }
+	  }
+	  stride_ += size;
+	}
+      }
+
+      return little_endian && element >= 0 && found[0] && found[1] && found[2];
+    }
+
+    // ファイル先頭からendまでのページを手放す
+    void PointCloud::release(size_t end)
+    {
+      const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+      end = end / page * page;
+      if (end > released_) {
+	madvise(const_cast<unsigned char*>(data_) + released_, end - released_, MADV_DONTNEED);
+	released_ = end;
+      }
+    }
+
+    PointCloud::Status PointCloud::stream(unsigned segments)
+    {
+      if (failed_) {
+	return Status::FAILED;
+      }
+      // 1区画の点数は空間索引の区画の倍数にしておく
+      const size_t chunk = chunk_points_;
+      const size_t segment_points = stream_.segment_size() / sizeof(Point) / chunk * chunk;
+      const bool packed = (stride_ == sizeof(Point) && offset_[0] == 0 &&
+			   offset_[1] == sizeof(GLfloat) && offset_[2] == 2 * sizeof(GLfloat));
+
+      for (unsigned s = 0; s < segments && !done(); ++s) {
+	if (!stream_.ready()) {
+	  break;
+	}
+	const size_t n = std::min(segment_points, point_num_ - loaded_);
+	const unsigned char* src = vertices_ + stride_ * loaded_;
+	Point* dst = static_cast<Point*>(stream_.map());
+	if (!dst) {
+	  fprintf(stderr, "Can't map stream buffer (point cloud %zu / %zu points loaded).\n", loaded_, point_num_);
+	  failed_ = true;
+	  return Status::FAILED;
+	}
+
+	if (packed) {
+	  memcpy(dst, src, sizeof(Point) * n);
+	} else {
+	  for (size_t i = 0; i < n; ++i) {
+	    for (int k = 0; k < 3; ++k) {
+	      memcpy(&dst[i][k], src + stride_ * i + offset_[k], sizeof(GLfloat));
+	    }
+	  }
+	}
+
+	// 空間索引(mapした側は書き込み専用なのでファイル側から読む)
+	for (size_t first = 0; first < n; first += chunk) {
+	  Chunk c = { vec3(std::numeric_limits<float>::max()), vec3(std::numeric_limits<float>::lowest()),
+		      static_cast<GLint>(loaded_ + first),
+		      static_cast<GLsizei>(std::min(chunk, n - first)) };
+	  for (GLsizei i = 0; i < c.count; ++i) {
+	    const unsigned char* p = src + stride_ * (first + i);
+	    vec3 v;
+	    memcpy(&v.x, p + offset_[0], sizeof(GLfloat));
+	    memcpy(&v.y, p + offset_[1], sizeof(GLfloat));
+	    memcpy(&v.z, p + offset_[2], sizeof(GLfloat));
+	    c.min = glm::min(c.min, v);
+	    c.max = glm::max(c.max, v);
+	  }
+	  min_ = glm::min(min_, c.min);
+	  max_ = glm::max(max_, c.max);
+	  chunks_.push_back(c);
+	}
+
+	const GLintptr offset = stream_.unmap(sizeof(Point) * n);
+	glBindBuffer(GL_COPY_READ_BUFFER, stream_.handle());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vbo_.handle());
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, sizeof(Point) * loaded_, sizeof(Point) * n);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	stream_.fence();
+
+	loaded_ += n;
+	release((vertices_ - data_) + stride_ * loaded_);
+      }
+      check_gl_error(__FILE__, __LINE__);
+
+      return done() ? Status::DONE : Status::STREAMING;
+    }
+
+    mat4 PointCloud::normalize_matrix() const
+    {
+      if (loaded_ == 0) {
+	return mat4(1.f);
+      }
+      const vec3 center = 0.5f * (min_ + max_);
+      const vec3 extent = max_ - min_;
+      const float size = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+      return glm::translate(glm::scale(mat4(1.f), vec3(2.f / size)), -center);
+    }
+
+    void PointCloud::render(const mat4& mvp) const
+    {
+      firsts_.clear();
+      counts_.clear();
+      drawn_ = 0;
+
+      // 視錐台の6平面(クリップ座標で-w <= x, y, z <= w)
+      vec4 planes[6];
+      for (int i = 0; i < 3; ++i) {
+	const vec4 row_w(mvp[0][3], mvp[1][3], mvp[2][3], mvp[3][3]);
+	const vec4 row(mvp[0][i], mvp[1][i], mvp[2][i], mvp[3][i]);
+	planes[2 * i] = row_w + row;
+	planes[2 * i + 1] = row_w - row;
+      }
+
+      for (const auto& c : chunks_) {
+	bool visible = true;
+	if (cull) {
+	  // AABBの平面の表側に最も出ている頂点が裏なら全体が外
+	  for (const auto& pl : planes) {
+	    const vec3 p(pl.x >= 0.f ? c.max.x : c.min.x,
+			 pl.y >= 0.f ? c.max.y : c.min.y,
+			 pl.z >= 0.f ? c.max.z : c.min.z);
+	    if (pl.x * p.x + pl.y * p.y + pl.z * p.z + pl.w < 0.f) {
+	      visible = false;
+	      break;
+	    }
+	  }
+	}
+	if (!visible) {
+	  continue;
+	}
+	if (!counts_.empty() && firsts_.back() + counts_.back() == c.first) {
+	  counts_.back() += c.count;
+	} else {
+	  firsts_.push_back(c.first);
+	  counts_.push_back(c.count);
+	}
+	drawn_ += c.count;
+      }
+
+      if (firsts_.empty()) {
+	return;
+      }
+      vao_.bind();
+      glMultiDrawArrays(GL_POINTS, firsts_.data(), counts_.data(), static_cast<GLsizei>(firsts_.size()));
+      vao_.bind(false);
+    }
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef INCLUDED_POINTCLOUD_HPP
+#define INCLUDED_POINTCLOUD_HPP
+
+#include <vector>
+#include <cstddef>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "globject.hpp"
+#include "streambuffer.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // 大きな点群ファイルを読みながら描画するクラス
+    // 対応形式
+    //  .ply : binary_little_endianで最初の要素がvertex, x/y/zがfloatのもの(他のpropertyは読み飛ばす)
+    //  それ以外 : float32のxyzを並べただけのバイナリ(XYZ)
+    //
+    // ファイルはmmapしてStreamBufferの区画経由でVBOへ少しずつ転送する
+    // (区画数は1フレームに転送する区画数より多くして, GPUが使用中の区画を待たないようにする)
+    // CPU側に点のコピーは持たない(転送済みの範囲はmadviseで手放す)
+    // 転送済みの点だけで描画できるので全部読み終わる前から表示が始まる
+    //
+    // 転送時にファイル上で連続するchunk_points_個毎の範囲(AABB)を空間索引として作り
+    // 描画時に視錐台の外の区画を除いてglMultiDrawArraysで描く
+    // (ファイル内の点の並びが空間的にまとまっているほど効く)
+    class PointCloud {
+    public:
+      // 空間索引の1区画
+      struct Chunk {
+	glm::vec3 min;
+	glm::vec3 max;
+	GLint first;
+	GLsizei count;
+      };
+
+      // stream()の結果
+      enum class Status {
+	STREAMING, // まだ続きがある
+	DONE, // 全部転送済み
+	FAILED, // 転送用バッファをmap出来なかった(以後は何もしない)
+      };
+
+      PointCloud(GLsizeiptr segment_size = 4 << 20, unsigned segment_num = 8);
+      ~PointCloud();
+
+      PointCloud(const PointCloud&) = delete;
+      PointCloud& operator=(const PointCloud&) = delete;
+      PointCloud(PointCloud&&) = delete;
+      PointCloud& operator=(PointCloud&&) = delete;
+
+      // ファイルを開いてヘッダを読み, 全点分のVBOを確保する
+      bool open(const char* path);
+      void close();
+
+      // 最大segments区画分をGPUへ転送する
+      // 次の区画がまだGPU使用中ならそこで止める(待たずに次のフレームへ回す)
+      Status stream(unsigned segments = 1);
+
+      // 転送済みの点を描画(位置はattribute 0)
+      // mvpは視錐台カリング用(描画用のuniformは呼び出し側で設定)
+      void render(const glm::mat4& mvp) const;
+
+      // 転送済みの点の範囲を[-1, 1]の立方体に収める行列
+      glm::mat4 normalize_matrix() const;
+
+      size_t point_num() const noexcept { return point_num_; }
+      size_t loaded() const noexcept { return loaded_; }
+      bool done() const noexcept { return loaded_ == point_num_; }
+      bool failed() const noexcept { return failed_; }
+      // 前回の描画で描いた点の数
+      size_t drawn() const noexcept { return drawn_; }
+
+      bool cull = true; // 視錐台カリングするか
+    private:
+      StreamBuffer stream_;
+      gl::VertexBuffer vbo_;
+      gl::Vao vao_;
+
+      // mmapしたファイル
+      int fd_;
+      const unsigned char* data_;
+      size_t file_size_;
+      size_t released_; // madviseで手放した範囲(ファイル先頭から)
+
+      // 頂点データ
+      const unsigned char* vertices_; // 先頭
+      size_t stride_; // 1点のbyte数
+      size_t offset_[3]; // x, y, zの点内のoffset
+      size_t point_num_;
+      size_t loaded_; // 転送済みの点の数
+      bool failed_;
+
+      std::vector<Chunk> chunks_;
+      glm::vec3 min_; // 転送済みの点の範囲
+      glm::vec3 max_;
+
+      // 描画範囲(隣接する区画はまとめる)
+      mutable std::vector<GLint> firsts_;
+      mutable std::vector<GLsizei> counts_;
+      mutable size_t drawn_;
+
+      bool parse_ply(size_t* header_size);
+      void release(size_t);
+
+      static const size_t chunk_points_ = 16384; // 空間索引の1区画の点数
+    };
+  }
+}
+
+#endif // INCLUDED_POINTCLOUD_HPP
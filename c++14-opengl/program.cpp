@@ -95,7 +95,20 @@ namespace nekolib {
 	break;
       }
 
-      const char* c_code = source.c_str();
+      // #defineは#versionより前に置けないので直後の行へ挿入
+      std::string code = source;
+      if (!defines_.empty()) {
+	std::string lines;
+	for (auto& d : defines_) {
+	  lines += d;
+	}
+	size_t pos = code.find("#version");
+	pos = (pos == std::string::npos) ? 0 : code.find('\n', pos);
+	pos = (pos == std::string::npos) ? code.size() : pos + 1;
+	code.insert(pos, lines);
+      }
+
+      const char* c_code = code.c_str();
       glShaderSource(shader_handle, 1, &c_code, nullptr);
 
       glCompileShader(shader_handle);
@@ -122,6 +135,11 @@ namespace nekolib {
       }
     }
 
+    void Program::define(const std::string& name, const std::string& value)
+    {
+      defines_.push_back("#define " + name + " " + value + "\n");
+    }
+
     bool Program::link()
     {
       if (linked_) {
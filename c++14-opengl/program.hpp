@@ -29,6 +29,9 @@ namespace nekolib {
       std::vector<std::pair<char*, int>> uniforms_;
       std::vector<std::pair<char*, int>> uniform_blocks_;
 
+      // compile時に#versionの直後へ挿入する#define
+      std::vector<std::string> defines_;
+
       int get_uniform_location(const char* name);
       int get_uniform_block_index(const char* name);
       bool file_exists(const char* filename);
@@ -50,6 +53,9 @@ namespace nekolib {
 
       bool compile_shader_from_file(const char* filename, ShaderType type);
       bool compile_shader_from_string(const std::string& source, ShaderType type);
+      // 以降にcompileするシェーダーの#versionの直後に"#define name value"を挿入する
+      // (同じソースからビルド時の設定に応じた変種を作る為)
+      void define(const std::string& name, const std::string& value = "");
       bool link();
       void use();
       bool valid();
@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "pyramid.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    bool Pyramid::init()
+    {
+      using Names = std::vector<std::string>;
+
+      if (!load_prog_.build_program_from_files(Names{ "shader/pyramid_convert.cs" })) {
+	return false;
+      }
+      store_prog_.define("TO_RGBA8");
+      if (!store_prog_.build_program_from_files(Names{ "shader/pyramid_convert.cs" })) {
+	return false;
+      }
+      if (!reduce_prog_.build_program_from_files(Names{ "shader/pyramid_reduce.cs" })) {
+	return false;
+      }
+      laplacian_prog_.define("LAPLACIAN");
+      if (!laplacian_prog_.build_program_from_files(Names{ "shader/pyramid_expand.cs" })) {
+	return false;
+      }
+      collapse_prog_.define("COLLAPSE");
+      if (!collapse_prog_.build_program_from_files(Names{ "shader/pyramid_expand.cs" })) {
+	return false;
+      }
+      upsample_prog_.define("UPSAMPLE");
+      if (!upsample_prog_.build_program_from_files(Names{ "shader/pyramid_expand.cs" })) {
+	return false;
+      }
+      if (!blend_prog_.build_program_from_files(Names{ "shader/pyramid_blend.cs" })) {
+	return false;
+      }
+
+      return true;
+    }
+
+    int Pyramid::max_levels(int width, int height)
+    {
+      int levels = 1;
+      while ((width | height) >> levels) {
+	++levels;
+      }
+      return levels;
+    }
+
+    // i段目の大きさ(mip levelと同じく切り捨て, 最小1)
+    static int level_size(int n, int level)
+    {
+      return std::max(n >> level, 1);
+    }
+
+#define WORKGROUP_SIZE 16
+    static void dispatch(int w, int h)
+    {
+      glDispatchCompute((w + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(h + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    // 作業用のpyramidを用意して実際に使える段数を返す
+    int Pyramid::allocate(int width, int height, int levels)
+    {
+      if (!gaussian_ || gaussian_.width() != width || gaussian_.height() != height) {
+	gaussian_ = Texture::create(width, height, TextureFormat::RGBA16F, 0);
+	laplacian_ = Texture::create(width, height, TextureFormat::RGBA16F, 0);
+	work_ = Texture::create(width, height, TextureFormat::RGBA16F, 0);
+      }
+      return std::max(1, std::min(levels, gaussian_.levels()));
+    }
+
+    // srcを0段目に読み込んでlevels段目まで縮小
+    void Pyramid::reduce(const Texture& src, const Texture& pyr, int levels)
+    {
+      load_prog_.use();
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, pyr.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+      dispatch(src.width(), src.height());
+
+      reduce_prog_.use();
+      for (int i = 1; i < levels; ++i) {
+	glBindImageTexture(0, pyr.handle(), i - 1, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	glBindImageTexture(1, pyr.handle(), i, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	dispatch(level_size(pyr.width(), i), level_size(pyr.height(), i));
+      }
+    }
+
+    // Gaussian pyramidの隣り合う段の差からLaplacian pyramidを作る
+    void Pyramid::subtract(const Texture& gauss, const Texture& lap, int levels)
+    {
+      laplacian_prog_.use();
+      for (int i = 0; i + 1 < levels; ++i) {
+	glBindImageTexture(0, gauss.handle(), i + 1, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	glBindImageTexture(1, gauss.handle(), i, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	glBindImageTexture(2, lap.handle(), i, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	dispatch(level_size(gauss.width(), i), level_size(gauss.height(), i));
+      }
+
+      // 最上段はそのまま
+      const int top = levels - 1;
+      glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+      glCopyImageSubData(gauss.handle(), GL_TEXTURE_2D, top, 0, 0, 0,
+			 lap.handle(), GL_TEXTURE_2D, top, 0, 0, 0,
+			 level_size(gauss.width(), top), level_size(gauss.height(), top), 1);
+    }
+
+    // 最上段から1段ずつ拡大して足していく(途中の結果はwork)
+    void Pyramid::collapse(const Texture& lap, const Texture& work, int levels, const Texture& dst)
+    {
+      collapse_prog_.use();
+      for (int i = levels - 2; i >= 0; --i) {
+	const Texture& coarse = (i == levels - 2) ? lap : work;
+	glBindImageTexture(0, coarse.handle(), i + 1, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	glBindImageTexture(1, lap.handle(), i, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	glBindImageTexture(2, work.handle(), i, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	dispatch(level_size(lap.width(), i), level_size(lap.height(), i));
+      }
+      store((levels == 1) ? lap : work, 0, dst);
+    }
+
+    void Pyramid::store(const Texture& pyr, int level, const Texture& dst)
+    {
+      assert(level_size(pyr.width(), level) == dst.width() && level_size(pyr.height(), level) == dst.height());
+      store_prog_.use();
+      glBindImageTexture(0, pyr.handle(), level, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    void Pyramid::build_gaussian(const Texture& src, int levels)
+    {
+      levels_ = allocate(src.width(), src.height(), levels);
+      reduce(src, gaussian_, levels_);
+      glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    void Pyramid::build_laplacian(const Texture& src, int levels)
+    {
+      levels_ = allocate(src.width(), src.height(), levels);
+      reduce(src, gaussian_, levels_);
+      subtract(gaussian_, laplacian_, levels_);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    void Pyramid::collapse(const Texture& dst)
+    {
+      assert(levels_ > 0);
+      collapse(laplacian_, work_, levels_, dst);
+    }
+
+    void Pyramid::blur(int level, const Texture& src, const Texture& dst)
+    {
+      const int levels = allocate(src.width(), src.height(), level + 1);
+      reduce(src, gaussian_, levels);
+      if (levels == 1) {
+	store(gaussian_, 0, dst);
+	return;
+      }
+
+      upsample_prog_.use();
+      for (int i = levels - 2; i >= 0; --i) {
+	const Texture& coarse = (i == levels - 2) ? gaussian_ : work_;
+	glBindImageTexture(0, coarse.handle(), i + 1, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	glBindImageTexture(2, work_.handle(), i, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	dispatch(level_size(src.width(), i), level_size(src.height(), i));
+      }
+      store(work_, 0, dst);
+    }
+
+    void Pyramid::blend(const Texture& a, const Texture& b, const Texture& mask, int levels, const Texture& dst)
+    {
+      assert(a.width() == b.width() && a.height() == b.height());
+      assert(a.width() == mask.width() && a.height() == mask.height());
+      levels_ = allocate(a.width(), a.height(), levels);
+
+      // a -> laplacian_, b -> work_, mask -> gaussian_(Gaussian pyramidのまま)
+      reduce(b, gaussian_, levels_);
+      subtract(gaussian_, work_, levels_);
+      reduce(a, gaussian_, levels_);
+      subtract(gaussian_, laplacian_, levels_);
+      reduce(mask, gaussian_, levels_);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+      // 段毎に混ぜてlaplacian_へ書き戻す
+      blend_prog_.use();
+      for (int i = 0; i < levels_; ++i) {
+	glBindImageTexture(0, laplacian_.handle(), i, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	glBindImageTexture(1, work_.handle(), i, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	glBindImageTexture(2, gaussian_.handle(), i, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+	glBindImageTexture(3, laplacian_.handle(), i, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	dispatch(level_size(a.width(), i), level_size(a.height(), i));
+      }
+
+      collapse(laplacian_, work_, levels_, dst);
+    }
+  }
+}
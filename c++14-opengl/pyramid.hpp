@@ -0,0 +1,116 @@
+#ifndef INCLUDED_PYRAMID_HPP
+#define INCLUDED_PYRAMID_HPP
+
+#include <glad/glad.h>
+
+#include "program.hpp"
+#include "texture.hpp"
+#include "filtergraph.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // Gaussian/Laplacian pyramid
+    // 各段をRGBA16Fのimmutableなテクスチャのmip levelに置き, 計算シェーダーで1段ずつ
+    //  shader/pyramid_reduce.cs : [1 4 6 4 1] / 16でぼかして1 / 2に縮小(Gaussian pyramid)
+    //  shader/pyramid_expand.cs : 同じ係数で2倍に拡大して差(Laplacian pyramid)/和(組み立て直し)
+    // 各段は1段下の1 / 4の画素数なので, 全段の手間は合わせても元の画像の4 / 3倍程度
+    // ぼかしの半径や混ぜる帯域の広さを段数で決めるので, 手間はどちらにもほぼよらない
+    class Pyramid {
+    public:
+      Pyramid() : levels_(0) {}
+      ~Pyramid() = default;
+
+      Pyramid(const Pyramid&) = delete;
+      Pyramid& operator=(const Pyramid&) = delete;
+
+      bool init();
+
+      // width x heightの画像で作れる段数(1x1まで)
+      static int max_levels(int width, int height);
+
+      // srcのGaussian pyramid(levels段, 0段目がsrc)をgaussian()へ
+      void build_gaussian(const Texture& src, int levels);
+      // srcのLaplacian pyramid(最上段はGaussian pyramidの最上段そのもの)をlaplacian()へ
+      void build_laplacian(const Texture& src, int levels);
+      // laplacian()を組み立て直してdstへ(build_laplacianの直後なら元の画像)
+      void collapse(const Texture& dst);
+
+      // srcをlevel段縮小してから拡大だけで戻す(半径2^level画素程度のぼかし)
+      void blur(int level, const Texture& src, const Texture& dst);
+      // multi-band blending(maskが0の所はa, 1の所はb, r, g, b別々)
+      // a, b, maskは同じ大きさ. levelsが多いほど粗い帯域が広い範囲で混ざる
+      void blend(const Texture& a, const Texture& b, const Texture& mask, int levels, const Texture& dst);
+
+      const Texture& gaussian() const noexcept { return gaussian_; }
+      const Texture& laplacian() const noexcept { return laplacian_; }
+      // 直近に作ったpyramidの段数
+      int levels() const noexcept { return levels_; }
+    private:
+      Program load_prog_; // rgba8 -> 0段目
+      Program store_prog_; // 0段目 -> rgba8
+      Program reduce_prog_;
+      Program laplacian_prog_;
+      Program collapse_prog_;
+      Program upsample_prog_;
+      Program blend_prog_;
+      // 全てRGBA16F, 1x1までのmip level付き
+      Texture gaussian_;
+      Texture laplacian_;
+      Texture work_; // blendのbの分や組み立て直しの途中
+      int levels_;
+
+      int allocate(int width, int height, int levels);
+      void reduce(const Texture& src, const Texture& pyr, int levels);
+      void subtract(const Texture& gauss, const Texture& lap, int levels);
+      void collapse(const Texture& lap, const Texture& work, int levels, const Texture& dst);
+      void store(const Texture& pyr, int level, const Texture& dst);
+    };
+
+    // FilterGraph用のぼかし(Pyramid::blur)
+    class PyramidBlurFilter : public FilterNode {
+    public:
+      PyramidBlurFilter(Pyramid& pyramid, int level) : pyramid_(pyramid), level_(level) {}
+
+      void set_level(int level) { level_ = level; }
+
+      size_t hash() const override { return hash_combine(reinterpret_cast<size_t>(&pyramid_), level_); }
+      void apply(const Texture& src, const Texture& dst) override { pyramid_.blur(level_, src, dst); }
+      // 縮小で2 * 2^i, 拡大で2^(i + 1)画素ずつ広がる
+      // (縮小の格子はタイルの位置で変わるので, タイル分割時は継ぎ目で僅かに値がずれる)
+      int footprint() const override { return 4 << level_; }
+    private:
+      Pyramid& pyramid_;
+      int level_;
+    };
+
+    // FilterGraph用のmulti-band blending
+    // 上流の画像とother(同じ大きさ)をmaskで混ぜる
+    class PyramidBlendFilter : public FilterNode {
+    public:
+      PyramidBlendFilter(Pyramid& pyramid, const Texture& other, const Texture& mask, int levels)
+	: pyramid_(pyramid), other_(other), mask_(mask), levels_(levels), version_(0) {}
+
+      void set_levels(int levels) { levels_ = levels; }
+      // maskの中身を書き換えた時も呼ぶ
+      void set_mask(const Texture& mask) { mask_ = mask; ++version_; }
+
+      size_t hash() const override
+      {
+	size_t h = hash_combine(reinterpret_cast<size_t>(&pyramid_), other_.handle());
+	h = hash_combine(h, mask_.handle());
+	return hash_combine(hash_combine(h, version_), levels_);
+      }
+      void apply(const Texture& src, const Texture& dst) override { pyramid_.blend(src, other_, mask_, levels_, dst); }
+      // 上流と別の画像を同じ位置で混ぜるのでタイルに分けられない
+      int footprint() const override { return -1; }
+    private:
+      Pyramid& pyramid_;
+      Texture other_;
+      Texture mask_;
+      int levels_;
+      unsigned version_;
+    };
+  }
+}
+
+#endif // INCLUDED_PYRAMID_HPP
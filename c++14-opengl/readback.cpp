@@ -0,0 +1,99 @@
+#include <cassert>
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include "readback.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    AsyncReadback::AsyncReadback(GLsizeiptr capacity)
+      : buffer_(), fence_(nullptr), capacity_(capacity), size_(0)
+    {
+      buffer_.bind(GL_PIXEL_PACK_BUFFER);
+      glBufferData(GL_PIXEL_PACK_BUFFER, capacity_, nullptr, GL_STREAM_READ);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    AsyncReadback::~AsyncReadback()
+    {
+      cancel();
+    }
+
+    void AsyncReadback::issue_fence()
+    {
+      cancel();
+      fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void AsyncReadback::read_pixels(const gl::FrameBuffer& fbo, GLenum attachment,
+				    int x, int y, int w, int h, GLenum format, GLenum type)
+    {
+      // 4byte/pixel未満の形式は想定していない
+      assert(static_cast<GLsizeiptr>(w) * h * 4 <= capacity_);
+      size_ = static_cast<GLsizeiptr>(w) * h * 4;
+
+      fbo.bind();
+      glReadBuffer(attachment);
+      buffer_.bind(GL_PIXEL_PACK_BUFFER);
+      // PBOがbindされているので最後の引数はPBO内のoffset
+      glReadPixels(x, y, w, h, format, type, nullptr);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      glReadBuffer(GL_NONE);
+      fbo.bind(false);
+
+      issue_fence();
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    void AsyncReadback::copy_buffer(GLuint src, GLintptr offset, GLsizeiptr size)
+    {
+      assert(size <= capacity_);
+      size_ = size;
+
+      glBindBuffer(GL_COPY_READ_BUFFER, src);
+      buffer_.bind(GL_COPY_WRITE_BUFFER);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, size);
+
+      issue_fence();
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    bool AsyncReadback::poll(void* dst, bool wait)
+    {
+      if (!fence_) {
+	return false;
+      }
+
+      // timeout=0ならfenceの状態確認のみ
+      // FLUSHを付けないとfence自体がGPUに届かず永遠に待つ事がある
+      GLuint64 timeout = wait ? 1000000000ull : 0ull;
+      GLenum status = glClientWaitSync(fence_, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+      if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+	return false;
+      }
+      glDeleteSync(fence_);
+      fence_ = nullptr;
+
+      buffer_.bind(GL_COPY_READ_BUFFER);
+      const void* p = glMapBufferRange(GL_COPY_READ_BUFFER, 0, size_, GL_MAP_READ_BIT);
+      if (!p) {
+	check_gl_error(__FILE__, __LINE__);
+	return false;
+      }
+      memcpy(dst, p, size_);
+      glUnmapBuffer(GL_COPY_READ_BUFFER);
+
+      return true;
+    }
+
+    void AsyncReadback::cancel() noexcept
+    {
+      if (fence_) {
+	glDeleteSync(fence_);
+	fence_ = nullptr;
+      }
+    }
+  }
+}
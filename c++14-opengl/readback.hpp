@@ -0,0 +1,46 @@
+#ifndef INCLUDED_READBACK_HPP
+#define INCLUDED_READBACK_HPP
+
+#include <glad/glad.h>
+
+#include "globject.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // GPU側の計算/描画結果をパイプラインを止めずにCPU側へ読み戻すクラス
+    // 要求時にはPBOへのコピーとfence発行のみ行い
+    // 次フレーム以降にpoll()でfence通過を確認してから中身を取り出す
+    // 1個のPBOを使い回すので同時に保持できる要求は1件だけ
+    class AsyncReadback {
+    private:
+      gl::Buffer buffer_;
+      GLsync fence_;
+      const GLsizeiptr capacity_;
+      GLsizeiptr size_; // 最後の要求で読み戻すbyte数
+
+      void issue_fence();
+    public:
+      AsyncReadback(GLsizeiptr capacity);
+      ~AsyncReadback();
+
+      AsyncReadback(const AsyncReadback&) = delete;
+      AsyncReadback& operator=(const AsyncReadback&) = delete;
+      AsyncReadback(AsyncReadback&&) = delete;
+      AsyncReadback& operator=(AsyncReadback&&) = delete;
+
+      // fboのattachmentの矩形領域を読む(glReadPixelsのPBO版)
+      void read_pixels(const gl::FrameBuffer& fbo, GLenum attachment,
+		       int x, int y, int w, int h, GLenum format, GLenum type);
+      // バッファオブジェクトsrcの[offset, offset + size)を読む
+      void copy_buffer(GLuint src, GLintptr offset, GLsizeiptr size);
+
+      // 結果が揃っていればdstへコピーしてtrueを返す
+      // wait = trueの時は揃うまで待つ(ベンチマーク等の非対話用途向け)
+      bool poll(void* dst, bool wait = false);
+      bool pending() const noexcept { return fence_ != nullptr; }
+      void cancel() noexcept;
+    };
+  }
+}
+
+#endif // INCLUDED_READBACK_HPP
@@ -0,0 +1,605 @@
+#include <cassert>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "rope.hpp"
+#include "program.hpp"
+#include "globject.hpp"
+#include "defines.hpp"
+#include "utils.hpp"
+
+using glm::vec3;
+using glm::vec4;
+
+namespace nekolib {
+  namespace renderer {
+    namespace {
+      using Names = std::vector<std::string>;
+
+      // 積分法毎の特性
+      // Point : 節点の構造体(シェーダー側とstd430で一致させる)
+      // buffer_num : 使い回すバッファの数
+      // start_index : 初期状態を書き込むバッファ
+      // Programs : 積分法が使うシェーダー等
+      // layout() : NodeEditQueue用の節点レイアウト
+      // setup_attribs() : VAOの設定(attribute 0が位置)
+      // attach() : バッファ確保後の追加設定
+      // build() : シェーダー準備
+      // start() : 初期位置から積分法に必要な初期値を計算
+      // advance() : 1ステップ進めて次の現在バッファの番号を返す
+      // edit_targets() : 編集を反映する先のバッファ
+      // read() : 読み戻した節点から位置と速度を取り出す
+
+      // Transform Feedback + 半陰的Euler法
+      struct EulerTraits {
+	struct Point {
+	  vec4 position; // 節点位置(xyz) + 固定flag(w)
+	  vec4 velocity;
+	};
+	static const RopeIntegrator integrator = RopeIntegrator::EULER;
+	static const size_t buffer_num = 2;
+	static const size_t start_index = 0;
+
+	struct Programs {
+	  Program update;
+	  gl::Texture table[buffer_num]; // 更新前の節点をtexelFetchで読む為のtexture buffer
+	};
+
+	static NodeLayout layout() { return NodeLayout{ 2, { 0, -1 }, { 1, -1 } }; }
+
+	static void setup_attribs() {
+	  glEnableVertexAttribArray(0);
+	  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Point), BUFFER_OFFSET(0));
+	  glEnableVertexAttribArray(1);
+	  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Point), BUFFER_OFFSET(sizeof(vec4)));
+	}
+
+	static void attach(Programs& p, const gl::VertexBuffer* buffers) {
+	  for (size_t i = 0; i < buffer_num; ++i) {
+	    glBindTexture(GL_TEXTURE_BUFFER, p.table[i].handle());
+	    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffers[i].handle());
+	  }
+	  glBindTexture(GL_TEXTURE_BUFFER, 0);
+	}
+
+	static bool build(Programs& p, GLuint ubo_binding) {
+	  if (!p.update.compile_shader_from_file("shader/rope_euler.vs", ShaderType::VERTEX)) {
+	    fprintf(stderr, "Compiling vertex shader failed.\n%s\n", p.update.log().c_str());
+	    return false;
+	  }
+
+	  // setup transform feedback (must be before link)
+	  const char* output_names[] = { "position", "velocity" };
+	  glTransformFeedbackVaryings(p.update.handle(), 2, output_names, GL_INTERLEAVED_ATTRIBS);
+
+	  if (!p.update.link()) {
+	    fprintf(stderr, "Linking shader program failed.\n%s\n", p.update.log().c_str());
+	    return false;
+	  }
+	  p.update.use();
+	  p.update.set_uniform_block("PhysicParams", ubo_binding);
+	  p.update.set_uniform("table", 1);
+	  return true;
+	}
+
+	static void start(Programs&, const gl::VertexBuffer*, size_t) {}
+
+	static size_t advance(Programs& p, const gl::Vao* vao, const gl::VertexBuffer* buffers,
+			      size_t cur, unsigned n) {
+	  size_t next = 1 - cur;
+
+	  p.update.use();
+	  p.table[cur].bind(1, GL_TEXTURE_BUFFER);
+	  vao[cur].bind();
+	  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[next].handle());
+
+	  glEnable(GL_RASTERIZER_DISCARD);
+	  glBeginTransformFeedback(GL_POINTS);
+	  glDrawArrays(GL_POINTS, 0, n);
+	  glEndTransformFeedback();
+	  glDisable(GL_RASTERIZER_DISCARD);
+
+	  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	  vao[cur].bind(false);
+	  return next;
+	}
+
+	static unsigned edit_targets(const gl::VertexBuffer* buffers, size_t cur, GLuint* targets) {
+	  targets[0] = buffers[cur].handle();
+	  return 1;
+	}
+
+	static void read(const Point& p, const Point*, const RopeParams&, vec3* x, vec3* v) {
+	  *x = vec3(p.position);
+	  *v = vec3(p.velocity);
+	}
+      };
+
+      // 計算シェーダー + 改良Euler法
+      struct ModifiedEulerTraits {
+	struct Point {
+	  vec4 position; // 節点位置(xyz) + 固定flag(w)
+	  vec4 velocity;
+	};
+	static const RopeIntegrator integrator = RopeIntegrator::MODIFIED_EULER;
+	static const size_t buffer_num = 2;
+	static const size_t start_index = 0;
+
+	struct Programs {
+	  Program update; // 両端以外の節点用
+	  Program update_end; // 両端の節点用
+	};
+
+	static NodeLayout layout() { return NodeLayout{ 2, { 0, -1 }, { 1, -1 } }; }
+
+	static void setup_attribs() {
+	  glEnableVertexAttribArray(0);
+	  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Point), BUFFER_OFFSET(0));
+	}
+
+	static void attach(Programs&, const gl::VertexBuffer*) {}
+
+	static bool build(Programs& p, GLuint ubo_binding) {
+	  if (!p.update.build_program_from_files(Names{ "shader/gomu.cs" })) {
+	    return false;
+	  }
+	  if (!p.update_end.build_program_from_files(Names{ "shader/gomu_end.cs" })) {
+	    return false;
+	  }
+	  p.update.use();
+	  p.update.set_uniform_block("PhysicParams", ubo_binding);
+	  p.update_end.use();
+	  p.update_end.set_uniform_block("PhysicParams", ubo_binding);
+	  return true;
+	}
+
+	static void start(Programs&, const gl::VertexBuffer*, size_t) {}
+
+	static size_t advance(Programs& p, const gl::Vao*, const gl::VertexBuffer* buffers,
+			      size_t cur, unsigned n) {
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[cur].handle());
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffers[1 - cur].handle());
+
+	  p.update_end.use();
+	  glDispatchCompute(1, 1, 1);
+	  p.update.use();
+	  glDispatchCompute(n - 2, 1, 1);
+
+	  return 1 - cur;
+	}
+
+	static unsigned edit_targets(const gl::VertexBuffer* buffers, size_t cur, GLuint* targets) {
+	  targets[0] = buffers[cur].handle();
+	  return 1;
+	}
+
+	static void read(const Point& p, const Point*, const RopeParams&, vec3* x, vec3* v) {
+	  *x = vec3(p.position);
+	  *v = vec3(p.velocity);
+	}
+      };
+
+      // 計算シェーダー + verlet法
+      // pos(t)とpos(t-dt)からpos(t+dt)を計算するのでバッファは3個
+      struct VerletTraits {
+	struct Point {
+	  vec4 position; // 節点位置(xyz) + 固定flag(w)
+	};
+	static const RopeIntegrator integrator = RopeIntegrator::VERLET;
+	static const size_t buffer_num = 3;
+	static const size_t start_index = 1;
+
+	struct Programs {
+	  Program init; // pos(-dt)の逆算
+	  Program update; // 両端以外の節点用
+	  Program update_end; // 両端の節点用
+	};
+
+	static NodeLayout layout() { return NodeLayout{ 1, { 0, -1 }, { -1, -1 } }; }
+
+	static void setup_attribs() {
+	  glEnableVertexAttribArray(0);
+	  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Point), BUFFER_OFFSET(0));
+	}
+
+	static void attach(Programs&, const gl::VertexBuffer*) {}
+
+	static bool build(Programs& p, GLuint ubo_binding) {
+	  if (!p.init.build_program_from_files(Names{ "shader/gomu_ver_init.cs" })) {
+	    return false;
+	  }
+	  if (!p.update.build_program_from_files(Names{ "shader/gomu_ver.cs" })) {
+	    return false;
+	  }
+	  if (!p.update_end.build_program_from_files(Names{ "shader/gomu_ver_end.cs" })) {
+	    return false;
+	  }
+	  for (Program* prog : { &p.init, &p.update, &p.update_end }) {
+	    prog->use();
+	    prog->set_uniform_block("PhysicParams", ubo_binding);
+	  }
+	  return true;
+	}
+
+	static size_t prev(size_t cur) { return (cur + 2) % 3; }
+
+	static void start(Programs& p, const gl::VertexBuffer* buffers, size_t cur) {
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[prev(cur)].handle());
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffers[cur].handle());
+	  p.init.use();
+	  glDispatchCompute(1, 1, 1);
+	}
+
+	static size_t advance(Programs& p, const gl::Vao*, const gl::VertexBuffer* buffers,
+			      size_t cur, unsigned n) {
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[prev(cur)].handle());
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffers[cur].handle());
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, buffers[(cur + 1) % 3].handle());
+
+	  p.update_end.use();
+	  glDispatchCompute(1, 1, 1);
+	  p.update.use();
+	  glDispatchCompute(n - 2, 1, 1);
+
+	  return (cur + 1) % 3;
+	}
+
+	// 現在位置と前回位置の両方を書き換える(移動すると速度は0になる)
+	static unsigned edit_targets(const gl::VertexBuffer* buffers, size_t cur, GLuint* targets) {
+	  targets[0] = buffers[cur].handle();
+	  targets[1] = buffers[prev(cur)].handle();
+	  return 2;
+	}
+
+	// 速度は前回位置との差分から
+	static void read(const Point& p, const Point* prev, const RopeParams& params, vec3* x, vec3* v) {
+	  *x = vec3(p.position);
+	  *v = (vec3(p.position) - vec3(prev->position)) / params.dt;
+	}
+      };
+
+      // 計算シェーダー + velocity verlet法
+      // NEKO_COMPACT_POINTSの時は節点を圧縮形式で持つ(シェーダー側はCOMPACT_POINTS)
+      // 紐は平面上なので位置はxyのみ, 固定flagはビット, 速度はfp16で64byte -> 32byte
+      struct VelocityVerletTraits {
+#ifdef NEKO_COMPACT_POINTS
+	struct Point {
+	  glm::vec2 position; // 節点位置(xy)
+	  GLuint flags; // POINT_MOVABLE
+	  GLuint velocity; // 速度(packHalf2x16)
+	  glm::vec2 position_temp; // p(t+dt)
+	  GLuint flags_temp;
+	  GLuint velocity_temp; // v(t)とv(t+dt)の中間(packHalf2x16)
+	};
+	static const bool compact = true;
+#else
+	struct Point {
+	  alignas(16) vec4 position; // 節点位置(xyz) + 固定flag(w)
+	  alignas(16) vec3 velocity; // 速度
+	  alignas(16) vec4 position_temp; // p(t+dt)
+	  alignas(16) vec3 velocity_temp; // v(t)とv(t+dt)の中間(計算途中の値)
+	};
+	static const bool compact = false;
+#endif
+	static const RopeIntegrator integrator = RopeIntegrator::VELOCITY_VERLET;
+	static const size_t buffer_num = 2;
+	static const size_t start_index = 0;
+
+	struct Programs {
+	  Program init; // position_temp, velocity_tempの設定
+	  Program update; // 両端以外の節点用
+	  Program update_end; // 両端の節点用
+	};
+
+	static NodeLayout layout() {
+	  const int p0 = offsetof(Point, position) / sizeof(vec4);
+	  const int p1 = offsetof(Point, position_temp) / sizeof(vec4);
+	  if (compact) {
+	    // 速度は位置と同じvec4の中
+	    return NodeLayout{ sizeof(Point) / sizeof(vec4), { p0, p1 }, { p0, p1 }, true };
+	  }
+	  return NodeLayout{ sizeof(Point) / sizeof(vec4), { p0, p1 },
+	      { offsetof(Point, velocity) / sizeof(vec4), offsetof(Point, velocity_temp) / sizeof(vec4) } };
+	}
+
+	static void setup_attribs() {
+	  glEnableVertexAttribArray(0);
+#ifdef NEKO_COMPACT_POINTS
+	  // 固定flagはattribute 1
+	  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Point), BUFFER_OFFSET(0));
+	  glEnableVertexAttribArray(1);
+	  glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(Point), BUFFER_OFFSETOF(Point, flags));
+#else
+	  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Point), BUFFER_OFFSET(0));
+#endif
+	}
+
+	static void attach(Programs&, const gl::VertexBuffer*) {}
+
+	static bool build(Programs& p, GLuint ubo_binding) {
+	  if (compact) {
+	    for (Program* prog : { &p.init, &p.update, &p.update_end }) {
+	      prog->define("COMPACT_POINTS");
+	    }
+	  }
+	  if (!p.init.build_program_from_files(Names{ "shader/gomu_vver_init.cs" })) {
+	    return false;
+	  }
+	  if (!p.update.build_program_from_files(Names{ "shader/gomu_vver.cs" })) {
+	    return false;
+	  }
+	  if (!p.update_end.build_program_from_files(Names{ "shader/gomu_vver_end.cs" })) {
+	    return false;
+	  }
+	  for (Program* prog : { &p.init, &p.update, &p.update_end }) {
+	    prog->use();
+	    prog->set_uniform_block("PhysicParams", ubo_binding);
+	  }
+	  return true;
+	}
+
+	static void start(Programs& p, const gl::VertexBuffer* buffers, size_t cur) {
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[cur].handle());
+	  p.init.use();
+	  glDispatchCompute(1, 1, 1);
+	}
+
+	static size_t advance(Programs& p, const gl::Vao*, const gl::VertexBuffer* buffers,
+			      size_t cur, unsigned n) {
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[cur].handle());
+	  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffers[1 - cur].handle());
+
+	  p.update_end.use();
+	  glDispatchCompute(1, 1, 1);
+	  p.update.use();
+	  glDispatchCompute(n - 2, 1, 1);
+
+	  return 1 - cur;
+	}
+
+	static unsigned edit_targets(const gl::VertexBuffer* buffers, size_t cur, GLuint* targets) {
+	  targets[0] = buffers[cur].handle();
+	  return 1;
+	}
+
+#ifdef NEKO_COMPACT_POINTS
+	static void read(const Point& p, const Point*, const RopeParams&, vec3* x, vec3* v) {
+	  *x = vec3(p.position, 0.f);
+	  *v = vec3(glm::unpackHalf2x16(p.velocity), 0.f);
+	}
+#else
+	static void read(const Point& p, const Point*, const RopeParams&, vec3* x, vec3* v) {
+	  *x = vec3(p.position);
+	  *v = p.velocity;
+	}
+#endif
+      };
+
+      // 節点の位置(xyz) + 固定flag(w)の読み書き
+      template <typename Point>
+      void set_position(Point& p, const vec4& x) { p.position = x; }
+      template <typename Point>
+      bool movable(const Point& p) { return p.position.w > 0.5f; }
+
+#ifdef NEKO_COMPACT_POINTS
+      // 圧縮形式の節点用
+      void set_position(VelocityVerletTraits::Point& p, const vec4& x)
+      {
+	p.position = glm::vec2(x.x, x.y);
+	p.flags = (x.w > 0.5f) ? POINT_MOVABLE : 0u;
+      }
+      bool movable(const VelocityVerletTraits::Point& p) { return (p.flags & POINT_MOVABLE) != 0; }
+#endif
+
+      // バッファとVAOの管理は積分法に依らず共通
+      template <typename Traits>
+      class BasicRope : public Rope {
+	using Point = typename Traits::Point;
+	static const size_t buffer_num = Traits::buffer_num;
+
+      public:
+	BasicRope(const RopeParams& params, vec3 left, vec3 right)
+	  : Rope(Traits::integrator, params, Traits::layout(), left, right), current_(Traits::start_index)
+	{
+	  static_assert(sizeof(Point) % sizeof(vec4) == 0, "Point must be a multiple of vec4");
+
+	  for (size_t i = 0; i < buffer_num; ++i) {
+	    buffer_[i].bind();
+	    glBufferData(GL_ARRAY_BUFFER, sizeof(Point) * params.point_num, nullptr, GL_DYNAMIC_COPY);
+
+	    vao_[i].bind();
+	    buffer_[i].bind();
+	    Traits::setup_attribs();
+	    vao_[i].bind(false);
+	  }
+	  Traits::attach(programs_, buffer_);
+
+	  check_gl_error(__FILE__, __LINE__);
+	}
+
+	void render(GLenum mode) const override {
+	  vao_[current_].bind();
+	  glDrawArrays(mode, 0, point_num());
+	}
+
+	GLuint handle() const override { return buffer_[current_].handle(); }
+	unsigned stride() const override { return sizeof(Point) / sizeof(vec4); }
+
+	void read_state(RopeState& state) const override {
+	  const size_t n = point_num();
+	  std::vector<Point> cur(n), prev(n);
+
+	  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	  buffer_[current_].bind();
+	  glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Point) * n, cur.data());
+	  buffer_[(current_ + buffer_num - 1) % buffer_num].bind();
+	  glGetBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Point) * n, prev.data());
+
+	  state.position.resize(n);
+	  state.velocity.resize(n);
+	  state.movable.resize(n);
+	  for (size_t i = 0; i < n; ++i) {
+	    Traits::read(cur[i], &prev[i], params(), &state.position[i], &state.velocity[i]);
+	    state.movable[i] = movable(cur[i]);
+	  }
+	}
+
+      protected:
+	bool build() override {
+	  return Traits::build(programs_, ubo_binding_);
+	}
+
+	void start(const std::vector<vec4>& position) override {
+	  current_ = Traits::start_index;
+
+	  buffer_[current_].bind();
+	  Point* pmapped = static_cast<Point*>(glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY));
+	  for (size_t i = 0; i < position.size(); ++i) {
+	    pmapped[i] = Point();
+	    set_position(pmapped[i], position[i]);
+	  }
+	  glUnmapBuffer(GL_ARRAY_BUFFER);
+
+	  ubo_.select(ubo_binding_);
+	  Traits::start(programs_, buffer_, current_);
+	}
+
+	unsigned edit_targets(GLuint* targets) const override {
+	  return Traits::edit_targets(buffer_, current_, targets);
+	}
+
+	void advance() override {
+	  current_ = Traits::advance(programs_, vao_, buffer_, current_, point_num());
+	}
+
+      private:
+	gl::Vao vao_[buffer_num];
+	gl::VertexBuffer buffer_[buffer_num];
+	typename Traits::Programs programs_;
+	size_t current_; // 現在表示中のbuffer_
+      };
+    }
+
+    const char* rope_integrator_name(RopeIntegrator integrator)
+    {
+      switch (integrator) {
+      case RopeIntegrator::EULER:
+	return "euler (transform feedback)";
+      case RopeIntegrator::MODIFIED_EULER:
+	return "modified euler";
+      case RopeIntegrator::VERLET:
+	return "verlet";
+      case RopeIntegrator::VELOCITY_VERLET:
+	return "velocity verlet";
+      }
+      return "unknown";
+    }
+
+    Rope::Rope(RopeIntegrator integrator, const RopeParams& params, const NodeLayout& layout,
+	       vec3 left, vec3 right)
+      : ubo_(&params), integrator_(integrator), compact_(layout.compact), params_(params), edits_(layout),
+	fix_flags_(params.point_num, false), left_end_(left), right_end_(right)
+    {
+      assert(params.point_num >= 3);
+    }
+
+    bool Rope::init()
+    {
+      if (!edits_.init()) {
+	return false;
+      }
+      if (!build()) {
+	return false;
+      }
+      reset();
+
+      return true;
+    }
+
+    void Rope::reset()
+    {
+      const unsigned n = params_.point_num;
+
+      // 両端だけ青(固定)
+      for (size_t i = 0; i < n; ++i) {
+	fix_flags_[i] = false;
+      }
+      fix_flags_[0] = fix_flags_[n - 1] = true;
+      edits_.clear();
+
+      std::vector<vec4> position(n);
+      for (size_t i = 0; i < n; ++i) {
+	// 線形補間
+	float t = static_cast<float>(i) / (n - 1);
+	position[i] = vec4(left_end_ * (1.f - t) + right_end_ * t, fix_flags_[i] ? 0.f : 1.f);
+      }
+      start(position);
+
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    void Rope::step()
+    {
+      // このステップの節点編集をまとめて反映
+      GLuint targets[2];
+      unsigned target_num = edit_targets(targets);
+      edits_.apply(targets, target_num);
+
+      // UBOの結び付けは他で上書きされているかもしれないので毎回
+      ubo_.select(ubo_binding_);
+      advance();
+
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+		      GL_TEXTURE_FETCH_BARRIER_BIT);
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    void Rope::move(int i, float x, float y, bool fixed)
+    {
+      assert(i >= 0 && i < static_cast<int>(params_.point_num));
+
+      edits_.move(i, x, y);
+      edits_.set_movable(i, !fixed);
+    }
+
+    void Rope::trigger_fix(int i)
+    {
+      assert(i >= 0 && i < static_cast<int>(params_.point_num));
+
+      fix_flags_[i] = !fix_flags_[i];
+      // position.wは0.f/1.f切り替え
+      // velocityは0.fクリア(Verlet法では前回位置を現在位置にそろえる)
+      edits_.set_movable(i, !fix_flags_[i]);
+      edits_.clear_velocity(i);
+    }
+
+    void Rope::set_params(const RopeParams& params)
+    {
+      unsigned n = params_.point_num;
+      params_ = params;
+      params_.point_num = n;
+      ubo_.send(&params_);
+    }
+
+    std::unique_ptr<Rope> create_rope(RopeIntegrator integrator, const RopeParams& params,
+				      vec3 left, vec3 right)
+    {
+      switch (integrator) {
+      case RopeIntegrator::EULER:
+	return std::make_unique<BasicRope<EulerTraits>>(params, left, right);
+      case RopeIntegrator::MODIFIED_EULER:
+	return std::make_unique<BasicRope<ModifiedEulerTraits>>(params, left, right);
+      case RopeIntegrator::VERLET:
+	return std::make_unique<BasicRope<VerletTraits>>(params, left, right);
+      case RopeIntegrator::VELOCITY_VERLET:
+	return std::make_unique<BasicRope<VelocityVerletTraits>>(params, left, right);
+      }
+      return nullptr;
+    }
+  }
+}
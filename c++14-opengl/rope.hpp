@@ -0,0 +1,123 @@
+#ifndef INCLUDED_ROPE_HPP
+#define INCLUDED_ROPE_HPP
+
+#include <memory>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "uniformbuffer.hpp"
+#include "nodeedit.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // ゴム紐の数値積分法
+    enum class RopeIntegrator {
+      EULER, // Transform Feedback + 半陰的Euler法
+      MODIFIED_EULER, // 計算シェーダー + 改良Euler法
+      VERLET, // 計算シェーダー + verlet法
+      VELOCITY_VERLET, // 計算シェーダー + velocity verlet法
+    };
+    const RopeIntegrator rope_integrators[] = {
+      RopeIntegrator::EULER, RopeIntegrator::MODIFIED_EULER,
+      RopeIntegrator::VERLET, RopeIntegrator::VELOCITY_VERLET,
+    };
+    const char* rope_integrator_name(RopeIntegrator);
+
+    // 物理パラメーター(UBO用)
+    // シェーダー側では layout (std140) uniform PhysicParams
+    struct RopeParams {
+      alignas(4) unsigned point_num; // 節点数
+      alignas(4) float dt; // タイムステップ
+      alignas(4) float m; // 節点1個の質量
+      alignas(4) float k; // ばね定数
+      alignas(4) float c; // ばね減衰係数
+    };
+
+    // CPU側に読み戻した紐の状態(ベンチマーク等での検証用)
+    struct RopeState {
+      std::vector<glm::vec3> position;
+      std::vector<glm::vec3> velocity;
+      std::vector<bool> movable;
+    };
+
+    // 両端を(left, right)に固定したゴム紐
+    // 積分法毎の違い(節点の構造体, バッファ数, シェーダー)は派生クラスに閉じ籠めて
+    // 節点の編集, 固定フラグ, 物理パラメーターのUBOはここで共通に持つ
+    //
+    // NEKO_COMPACT_POINTSを定義してビルドするとvelocity verlet法の節点は
+    // 圧縮形式(2次元位置 + flag + fp16速度で32byte)になる
+    //
+    // 生成はcreate_rope()から
+    class Rope {
+    public:
+      virtual ~Rope() = default;
+
+      Rope(const Rope&) = delete;
+      Rope& operator=(const Rope&) = delete;
+      Rope(Rope&&) = delete;
+      Rope& operator=(Rope&&) = delete;
+
+      // シェーダーを準備して初期状態にする
+      bool init();
+      // 節点を初期状態(両端以外固定解除)に戻す
+      void reset();
+      // 溜めた節点の編集を反映してから1ステップ進める
+      void step();
+      // 現在の節点を描画する(位置はattribute 0)
+      virtual void render(GLenum mode) const = 0;
+
+      // 現在の節点バッファ(pick用)と節点1個分のvec4の個数
+      virtual GLuint handle() const = 0;
+      virtual unsigned stride() const = 0;
+
+      // 現在の状態をCPU側へ読み戻す(同期するので遅い)
+      virtual void read_state(RopeState&) const = 0;
+
+      // i番目の節点を座標(x, y)に移動
+      // fixed = false の時力の影響を受ける : trueの時受けない
+      void move(int i, float x, float y, bool fixed);
+      // i番目の節点を左ドラッグ終了時に固定するかどうか切り替える
+      void trigger_fix(int i);
+      bool is_fix(int i) const { return fix_flags_[i]; }
+
+      // kやcの変更用(point_numは変更不可)
+      void set_params(const RopeParams&);
+      const RopeParams& params() const noexcept { return params_; }
+      unsigned point_num() const noexcept { return params_.point_num; }
+      RopeIntegrator integrator() const noexcept { return integrator_; }
+      // 節点が圧縮形式か(描画側はCOMPACT_POINTSを定義したシェーダーを使う)
+      bool compact() const noexcept { return compact_; }
+
+    protected:
+      Rope(RopeIntegrator, const RopeParams&, const NodeLayout&, glm::vec3 left, glm::vec3 right);
+
+      // 積分法毎のシェーダー準備
+      virtual bool build() = 0;
+      // 節点位置を初期化して積分法に必要な初期値を計算
+      virtual void start(const std::vector<glm::vec4>& position) = 0;
+      // 編集を反映する先のバッファ
+      virtual unsigned edit_targets(GLuint* targets) const = 0;
+      // 1ステップ分の計算シェーダー/Transform Feedback起動
+      virtual void advance() = 0;
+
+      StructUBO<RopeParams> ubo_;
+      static const GLuint ubo_binding_ = 0;
+
+    private:
+      const RopeIntegrator integrator_;
+      const bool compact_;
+      RopeParams params_;
+      NodeEditQueue edits_;
+      std::vector<bool> fix_flags_;
+      const glm::vec3 left_end_;
+      const glm::vec3 right_end_;
+    };
+
+    std::unique_ptr<Rope> create_rope(RopeIntegrator, const RopeParams&,
+				      glm::vec3 left = glm::vec3(-0.9f, 0.5f, 0.f),
+				      glm::vec3 right = glm::vec3(0.9f, 0.5f, 0.f));
+  }
+}
+
+#endif // INCLUDED_ROPE_HPP
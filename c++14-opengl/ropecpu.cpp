@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+#include "ropecpu.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    CpuRope::CpuRope(const RopeParams& params, unsigned threads, unsigned tile_size, unsigned time_block,
+		     glm::vec3 left, glm::vec3 right)
+      : params_(params),
+	threads_(threads ? threads : std::max(std::thread::hardware_concurrency(), 1u)),
+	tile_size_(tile_size), time_block_(std::max(time_block, 1u)),
+	left_end_(left), right_end_(right), current_(0)
+    {
+      assert(params.point_num >= 3 && tile_size > 0);
+
+      for (auto& s : state_) {
+	s.resize(params_.point_num);
+      }
+      movable_.resize(params_.point_num);
+      position_.resize(params_.point_num);
+      velocity_.resize(params_.point_num);
+
+      reset();
+    }
+
+    void CpuRope::reset()
+    {
+      const size_t n = params_.point_num;
+      const float g = -9.8f / n;
+      State& s = state_[current_];
+
+      for (size_t i = 0; i < n; ++i) {
+	// 線形補間
+	float t = static_cast<float>(i) / (n - 1);
+	glm::vec3 p = left_end_ * (1.f - t) + right_end_ * t;
+	movable_[i] = (i != 0 && i != n - 1);
+	position_[i] = glm::vec2(p.x, p.y);
+	velocity_[i] = glm::vec2(0.f);
+
+	s.x[i] = p.x;
+	s.y[i] = p.y;
+	// 両端以外は初速に0.5 * dt * gが加算されないようあらかじめ引いておく
+	s.vx[i] = 0.f;
+	s.vy[i] = movable_[i] ? -0.5f * params_.dt * g : 0.f;
+      }
+    }
+
+    void CpuRope::step(unsigned steps)
+    {
+      while (steps > 0) {
+	unsigned s = std::min(steps, time_block_);
+	advance_block(s);
+	steps -= s;
+      }
+    }
+
+    // 全tileをstepsステップ進める
+    // tileはスレッド毎にまとめて割り当て(隣接tileは同じスレッドでキャッシュに残りやすい)
+    void CpuRope::advance_block(unsigned steps)
+    {
+      const size_t n = params_.point_num;
+      const size_t tiles = (n + tile_size_ - 1) / tile_size_;
+      const unsigned threads = static_cast<unsigned>(std::min<size_t>(threads_, tiles));
+
+      auto worker = [&](unsigned tid) {
+	// 作業用バッファはtile + haloの大きさ
+	State work[2];
+	work[0].resize(tile_size_ + 2 * steps);
+	work[1].resize(tile_size_ + 2 * steps);
+
+	size_t first = tiles * tid / threads;
+	size_t last = tiles * (tid + 1) / threads;
+	for (size_t t = first; t < last; ++t) {
+	  advance_tile(t * tile_size_, std::min(n, (t + 1) * tile_size_), steps, work[0], work[1]);
+	}
+      };
+
+      std::vector<std::thread> pool;
+      for (unsigned tid = 1; tid < threads; ++tid) {
+	pool.emplace_back(worker, tid);
+      }
+      worker(0);
+      for (auto& th : pool) {
+	th.join();
+      }
+
+      current_ = 1 - current_;
+    }
+
+    // [begin, end)の節点をstepsステップ進めて書き込み先へ
+    void CpuRope::advance_tile(size_t begin, size_t end, unsigned steps, State& work0, State& work1)
+    {
+      const size_t n = params_.point_num;
+      const float dt = params_.dt;
+      const float m_inv = 1.f / params_.m;
+      const float k = params_.k;
+      const float c = params_.c;
+      const float l = 2.f / n; // 節点間の自然長
+      const float g = -9.8f / n; // 重力
+
+      const State& src = state_[current_];
+      State& dst = state_[1 - current_];
+
+      // haloを含めた読み込み範囲[a, b)
+      // 紐の端ではhaloが無いので有効範囲も縮まない
+      const size_t a = (begin > steps) ? begin - steps : 0;
+      const size_t b = std::min(n, end + steps);
+      const size_t len = b - a;
+      std::copy(src.x.begin() + a, src.x.begin() + b, work0.x.begin());
+      std::copy(src.y.begin() + a, src.y.begin() + b, work0.y.begin());
+      std::copy(src.vx.begin() + a, src.vx.begin() + b, work0.vx.begin());
+      std::copy(src.vy.begin() + a, src.vy.begin() + b, work0.vy.begin());
+
+      State* cur = &work0;
+      State* next = &work1;
+      for (unsigned s = 1; s <= steps; ++s) {
+	// このステップで正しく計算できるローカル範囲[lo, hi)
+	const size_t lo = (a == 0) ? 0 : s;
+	const size_t hi = (b == n) ? len : len - s;
+	const bool last_step = (s == steps);
+
+	for (size_t j = lo; j < hi; ++j) {
+	  const size_t i = a + j; // 紐全体での番号
+	  const float x = cur->x[j], y = cur->y[j];
+	  const float vx = cur->vx[j], vy = cur->vy[j];
+
+	  // 加速度 a(t + h) (gomu_vver.csと同じ)
+	  float fx = 0.f, fy = 0.f;
+	  if (i > 0) {
+	    float dx = cur->x[j - 1] - x, dy = cur->y[j - 1] - y;
+	    float d = std::sqrt(dx * dx + dy * dy);
+	    float f = (d > 0.f) ? (d - l) * k / d : 0.f;
+	    fx += f * dx - c * (vx - cur->vx[j - 1]);
+	    fy += f * dy - c * (vy - cur->vy[j - 1]);
+	  }
+	  if (i < n - 1) {
+	    float dx = cur->x[j + 1] - x, dy = cur->y[j + 1] - y;
+	    float d = std::sqrt(dx * dx + dy * dy);
+	    float f = (d > 0.f) ? (d - l) * k / d : 0.f;
+	    fx += f * dx - c * (vx - cur->vx[j + 1]);
+	    fy += f * dy - c * (vy - cur->vy[j + 1]);
+	  }
+	  const float ax = fx * m_inv;
+	  const float ay = fy * m_inv + g;
+	  const float movable = movable_[i] ? 1.f : 0.f;
+
+	  // 速度 v(t + h)
+	  const float hvx = movable * (vx + 0.5f * dt * ax);
+	  const float hvy = movable * (vy + 0.5f * dt * ay);
+
+	  // 位置 p(t + 2h), 速度 v(t + 2h)の途中
+	  next->x[j] = x + movable * (dt * hvx + 0.5f * dt * dt * ax);
+	  next->y[j] = y + movable * (dt * hvy + 0.5f * dt * dt * ay);
+	  next->vx[j] = movable * (vx + dt * ax);
+	  next->vy[j] = movable * (vy + dt * ay);
+
+	  if (last_step && i >= begin && i < end) {
+	    position_[i] = glm::vec2(x, y);
+	    velocity_[i] = glm::vec2(hvx, hvy);
+	  }
+	}
+	std::swap(cur, next);
+      }
+
+      // tile本体だけ書き戻す
+      const size_t o = begin - a;
+      std::copy(cur->x.begin() + o, cur->x.begin() + o + (end - begin), dst.x.begin() + begin);
+      std::copy(cur->y.begin() + o, cur->y.begin() + o + (end - begin), dst.y.begin() + begin);
+      std::copy(cur->vx.begin() + o, cur->vx.begin() + o + (end - begin), dst.vx.begin() + begin);
+      std::copy(cur->vy.begin() + o, cur->vy.begin() + o + (end - begin), dst.vy.begin() + begin);
+    }
+
+    void CpuRope::read_state(RopeState& state) const
+    {
+      const size_t n = params_.point_num;
+      state.position.resize(n);
+      state.velocity.resize(n);
+      state.movable.resize(n);
+      for (size_t i = 0; i < n; ++i) {
+	state.position[i] = glm::vec3(position_[i], 0.f);
+	state.velocity[i] = glm::vec3(velocity_[i], 0.f);
+	state.movable[i] = movable_[i] != 0;
+      }
+    }
+  }
+}
@@ -0,0 +1,71 @@
+#ifndef INCLUDED_ROPECPU_HPP
+#define INCLUDED_ROPECPU_HPP
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "rope.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // CPU版ゴム紐(velocity verlet法, gomu_vver.csと同じ計算)
+    // GPUの無い環境での実行とGPU版の検算用
+    //
+    // 紐をtile_size個ずつのtileに分けて各スレッドに割り当て
+    // tileの両側にtime_block個分の節点を余分に読み込んで(halo)
+    // スレッドローカルなバッファ上でtime_blockステップまとめて進めてから書き戻す
+    // (haloの分は隣のtileと重複して計算するが作業領域がL2に収まるのでメモリ帯域律速にならない)
+    class CpuRope {
+    public:
+      // threads = 0ならstd::thread::hardware_concurrency()
+      CpuRope(const RopeParams&, unsigned threads = 0,
+	      unsigned tile_size = 4096, unsigned time_block = 16,
+	      glm::vec3 left = glm::vec3(-0.9f, 0.5f, 0.f),
+	      glm::vec3 right = glm::vec3(0.9f, 0.5f, 0.f));
+      ~CpuRope() = default;
+
+      CpuRope(const CpuRope&) = delete;
+      CpuRope& operator=(const CpuRope&) = delete;
+      CpuRope(CpuRope&&) = delete;
+      CpuRope& operator=(CpuRope&&) = delete;
+
+      // 両端固定の初期状態に戻す(gomu_vver_init.csと同じ初期値)
+      void reset();
+      // stepsステップ進める
+      void step(unsigned steps = 1);
+      void read_state(RopeState&) const;
+
+      const RopeParams& params() const noexcept { return params_; }
+      unsigned point_num() const noexcept { return params_.point_num; }
+      unsigned threads() const noexcept { return threads_; }
+
+    private:
+      // 節点の状態(SoA)
+      // velocity verlet法で次のステップに必要なのは p(t + h)とv(t + h)の途中だけ
+      struct State {
+	std::vector<float> x, y; // p(t + h)
+	std::vector<float> vx, vy; // v(t + h)の途中
+	void resize(size_t n) { x.resize(n); y.resize(n); vx.resize(n); vy.resize(n); }
+      };
+
+      const RopeParams params_;
+      const unsigned threads_;
+      const unsigned tile_size_;
+      const unsigned time_block_;
+      const glm::vec3 left_end_;
+      const glm::vec3 right_end_;
+
+      State state_[2]; // 読み込み元と書き込み先を交互に
+      unsigned current_;
+      std::vector<unsigned char> movable_;
+      // 最後のステップの p(t), v(t) (描画/検算用)
+      std::vector<glm::vec2> position_;
+      std::vector<glm::vec2> velocity_;
+
+      void advance_block(unsigned steps);
+      void advance_tile(size_t begin, size_t end, unsigned steps, State& work0, State& work1);
+    };
+  }
+}
+
+#endif // INCLUDED_ROPECPU_HPP
@@ -0,0 +1,73 @@
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "sat.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    bool SummedAreaTable::init()
+    {
+      using Names = std::vector<std::string>;
+
+      if (!rows_prog_.build_program_from_files(Names{ "shader/sat_scan.cs" })) {
+	return false;
+      }
+      columns_prog_.define("VERTICAL");
+      if (!columns_prog_.build_program_from_files(Names{ "shader/sat_scan.cs" })) {
+	return false;
+      }
+      if (!box_prog_.build_program_from_files(Names{ "shader/sat_box.cs" })) {
+	return false;
+      }
+
+      return true;
+    }
+
+    void SummedAreaTable::build(const Texture& src)
+    {
+      const int w = src.width(), h = src.height();
+      if (!table_ || table_.width() != w || table_.height() != h) {
+	table_ = Texture::create(w, h, TextureFormat::RGBA32UI);
+      }
+
+      // 行方向(1 workgroupが1行)
+      rows_prog_.use();
+      glBindImageTexture(0, src.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
+      glBindImageTexture(1, table_.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32UI);
+      glDispatchCompute(h, 1, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+      // 列方向(その場で書き換え)
+      columns_prog_.use();
+      glBindImageTexture(0, table_.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32UI);
+      glBindImageTexture(1, table_.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32UI);
+      glDispatchCompute(w, 1, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+#define WORKGROUP_SIZE 16
+    void SummedAreaTable::box(int radius, const Texture& dst)
+    {
+      box_prog_.use();
+      box_prog_.set_uniform("radius", radius);
+      glBindImageTexture(0, table_.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA32UI);
+      glBindImageTexture(1, dst.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+      glDispatchCompute((dst.width() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+			(dst.height() + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    void SatBoxFilter::apply(const Texture& src, const Texture& dst)
+    {
+      sat_.build(src);
+      sat_.box(radius_, dst);
+    }
+  }
+}
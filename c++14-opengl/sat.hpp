@@ -0,0 +1,57 @@
+#ifndef INCLUDED_SAT_HPP
+#define INCLUDED_SAT_HPP
+
+#include <glad/glad.h>
+
+#include "program.hpp"
+#include "texture.hpp"
+#include "filtergraph.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // 積分画像(summed-area table)
+    // rgba8の画像から各画素までの左上の矩形の和(0-255の整数, rgba32ui)を
+    // 行方向 -> 列方向のscan 2パスで作る
+    // 作った後は任意の矩形の和が4点の参照で求まるので箱型平均の手間が半径によらない
+    class SummedAreaTable {
+    public:
+      SummedAreaTable() = default;
+      ~SummedAreaTable() = default;
+
+      SummedAreaTable(const SummedAreaTable&) = delete;
+      SummedAreaTable& operator=(const SummedAreaTable&) = delete;
+
+      bool init();
+
+      // srcの積分画像を作る
+      void build(const Texture& src);
+      // 作成済みの積分画像から(2 * radius + 1)^2の箱型平均をdstへ(alphaは1)
+      // 画像の端では箱を画像内に切り詰める(Convolutionの端の延長とは少し違う)
+      void box(int radius, const Texture& dst);
+
+      const Texture& table() const noexcept { return table_; }
+    private:
+      Program rows_prog_;
+      Program columns_prog_;
+      Program box_prog_;
+      Texture table_; // rgba32ui
+    };
+
+    // FilterGraph用の箱型平均(半径は自由)
+    class SatBoxFilter : public FilterNode {
+    public:
+      SatBoxFilter(SummedAreaTable& sat, int radius) : sat_(sat), radius_(radius) {}
+
+      void set_radius(int radius) { radius_ = radius; }
+
+      size_t hash() const override { return hash_combine(reinterpret_cast<size_t>(&sat_), radius_); }
+      void apply(const Texture& src, const Texture& dst) override;
+      int footprint() const override { return radius_; }
+    private:
+      SummedAreaTable& sat_;
+      int radius_;
+    };
+  }
+}
+
+#endif // INCLUDED_SAT_HPP
@@ -24,95 +24,10 @@ using glm::mat4;
 
 using namespace nekolib::renderer;
 
-// 粒子データ
-struct Particle
-{
-  glm::vec4 position; // 位置
-  glm::vec4 velocity; // 速度
-
-  Particle() noexcept {}
-  Particle(float px, float py, float pz, float vx = 0.f, float vy = 0.f, float vz = 0.f) noexcept
-    : position(px, py, pz, 1.f), velocity(vx, vy, vz, 0.f) {}
-  ~Particle() noexcept {}
-};
-
-// 点群
-class Blob
-{
-private:
-  nekolib::renderer::gl::Vao vao_;
-  nekolib::renderer::gl::VertexBuffer vbo_;
-
-  const GLsizei count_; // 頂点数
-public:
-  // ctor & dtor
-  Blob(const Particles& particles);
-  virtual ~Blob();
-
-  // copy
-  Blob(const Blob&) = delete;
-  Blob& operator=(const Blob&) = delete;
-
-  void init(const Particles& particles) const;
-  void render() const; // 描画 
-  void update() const; // 位置と速度の更新
-};
-
-// particles : in 初期化データ
-Blob::Blob(const Particles& particles) : count_(static_cast<GLsizei>(particles.size()))
-{
-  vbo_.bind();
-  glBufferData(GL_ARRAY_BUFFER, count_ * sizeof(Particle), nullptr, GL_STATIC_DRAW);
-
-  // シェーダin変数割り当て
-  vao_.bind();
-  vbo_.bind();
-  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), BUFFER_OFFSETOF(Particle, position));
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), BUFFER_OFFSETOF(Particle, velocity));
-  glEnableVertexAttribArray(1);
-  vao_.bind(false);
-
-  init(particles);
-}
-
-Blob::~Blob() = default;
-
-void Blob::init(const Particles& particles) const
-{
-  vbo_.bind();
-
-  // 頂点バッファにデータを格納
-  Particle* p = static_cast<Particle*>(glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY));
-
-  for (const auto& particle : particles) {
-    p->position = particle.position;
-    p->velocity = particle.velocity;
-    ++p;
-  }
-  glUnmapBuffer(GL_ARRAY_BUFFER);
-}
-
-void Blob::render() const
-{
-  vao_.bind();
-  glDrawArrays(GL_POINTS, 0, count_);
-}
-
-// コンピュートシェーダーを使って頂点バッファ上の位置/速度を更新
-void Blob::update() const
-{
-  // SSBO0番の結合ポイントとして頂点バッファをそのまま使用
-  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vbo_.handle());
-
-  // 計算実行
-  glDispatchCompute(count_, 1, 1);
-
-  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-}
-
-SceneBlob::SceneBlob() : rot_(1.f, 0.f, 0.f, 0.f), orig_(1.f, 0.f, 0.f, 0.f),
-			 drag_start_x_(0), drag_start_y_(0), imgui_(false)
+SceneBlob::SceneBlob(const char* cloud_path)
+  : rot_(1.f, 0.f, 0.f, 0.f), orig_(1.f, 0.f, 0.f, 0.f),
+    drag_start_x_(0), drag_start_y_(0), imgui_(false),
+    cloud_path_(cloud_path ? cloud_path : "")
 {
 }
 
@@ -131,31 +46,30 @@ bool SceneBlob::init()
   view_ = glm::lookAt(vec3(0.f, 0.f, 5.f), vec3(0.f, 0.f, 0.f), vec3(0.f, 1.f, 0.f));
   proj_ = glm::perspective(glm::radians(30.f), ScreenManager::aspectf(), 1.f, 10.f);
 
-  // 粒子群生成用パラメーター
-  const int blob_count(8);
-  const float blob_range(1.5f);
-  const int particle_count(1000);
-  const float particle_mean(0.f);
-  const float particle_deviation(1.f);
-  
-  std::random_device seed;
-  std::mt19937 rn(seed());
-  std::uniform_real_distribution<float> center(-blob_range, blob_range);
+  // 粒子プール(メモリ使用量は一定)
+  particles_ = std::make_unique<ParticleSystem>(max_particles_);
+  if (!particles_->init()) {
+    return false;
+  }
+  particles_->collide = true;
 
-  for (auto i = 0; i < blob_count; ++i) {
-    // Particle中心位置
-    const vec3 pos(center(rn), center(rn), center(rn));
-    add_particles(init_data_, particle_count, pos, particle_mean, particle_deviation, rn);
+  if (!cloud_path_.empty()) {
+    cloud_ = std::make_unique<PointCloud>();
+    if (!cloud_->open(cloud_path_.c_str())) {
+      return false;
+    }
   }
 
-  blob_ = std::make_unique<Blob>(init_data_);
+  std::random_device seed;
+  rn_.seed(seed());
+  place_emitters();
   
   prog_.use();
 
   glClearColor(0.1f, 0.2f, 0.3f, 0.f);
 
   fprintf(stdout, "You can drag left mouse button to rotate entire scene.\n");
-  fprintf(stdout, "Press 'd' key to show color config dialog.\n");
+  fprintf(stdout, "Press 'd' key to show config dialog.\n");
   
   return true;
 }
@@ -173,61 +87,49 @@ void SceneBlob::update_rotation(int x, int y) noexcept
   }
 }
 
-// paticles 粒子群の追加格納先
-// count 粒子群の粒子数
-// center 粒子群の中心位置
-// mean 粒子の粒子群の中心からの距離の平均値
-// deviation 粒子の粒子群の中心からの距離の標準偏差
-// rn メルセンヌツイスタ法による乱数生成器
-void SceneBlob::add_particles(Particles& particles, int count,
-			      glm::vec3 center, float mean, float deviation,
-			      std::mt19937& rn)
+// 破裂の中心(粒子の発生源)をランダムに配置しなおす
+void SceneBlob::place_emitters()
 {
-  // [0.f, 2.f)で一様分布の乱数
-  std::uniform_real_distribution<float> uniform(0.f, 2.f);
-
-  // 平均mean, 標準偏差deviationでの正規分布
-  std::normal_distribution<float> normal(mean, deviation);
-
-  particles.reserve(particles.size() + count);
-  
-  // 原点中心に直径方向に正規分布する粒子群を生成
-  for (auto i = 0; i < count; ++i) {
-    // 緯度方向
-    const float cp(uniform(rn) - 1.f);
-    const float sp(sqrt(1.f - cp * cp));
-
-    // 経度方向
-    const float t(glm::pi<float>() * uniform(rn));
-    const float ct(cos(t)), st(sin(t));
+  // 発生源生成用パラメーター
+  const int blob_count(8);
+  const float blob_range(1.5f);
+  const float particle_deviation(1.f); // 初速の大きさの標準偏差
 
-    // 粒子群中心からの距離
-    const float r(normal(rn));
+  std::uniform_real_distribution<float> center(-blob_range, blob_range);
 
-    // 粒子を追加
-    particles.emplace_back(center.x, center.y, center.z, r * sp * ct, r * sp * st, r * cp);
+  emitters_.resize(blob_count);
+  for (auto& e : emitters_) {
+    e.position = vec4(center(rn_), center(rn_), center(rn_), particle_deviation);
+    e.velocity = vec4(0.f, 0.f, 0.f, life_);
   }
+  particles_->set_emitters(emitters_);
 }
 
 void SceneBlob::update()
 {
+  // 点群ファイルは1フレームに数区画ずつ転送(区画の環は8区画なので普通は待たない)
+  // 失敗はPointCloudがstderrに出し, 以後は転送済みの分だけ描く
+  if (cloud_) {
+    cloud_->stream(4);
+  }
+
   // 前回リセットからの経過時間(秒)とフレーム毎経過時間(秒)
   float reset_delta = nekolib::clock::Clock::calc_delta_seconds(cur_, start_);
   float delta = nekolib::clock::Clock::calc_delta_seconds(cur_, prev_);
   
   if (reset_delta > reset_interval_) {
-    blob_->init(init_data_);
-    cur_ = nekolib::clock::Clock::create(0.f);
-    prev_ = cur_.snapshot();
+    place_emitters();
     start_ = cur_.snapshot();
-  } else {
-    prev_ = cur_.snapshot();
   }
+  prev_ = cur_.snapshot();
 
-  // 粒子位置/速度の更新
-  comp_prog_.use();
-  comp_prog_.set_uniform("dt", delta);
-  blob_->update();
+  // 発生数は端数を繰り越して1秒当たりemit_rate_個に合わせる
+  float emit = emit_rate_ * delta + emit_fraction_;
+  unsigned emit_num = static_cast<unsigned>(emit);
+  emit_fraction_ = emit - emit_num;
+
+  // 粒子の発生/更新(CPUは粒子データに触らない)
+  particles_->update(delta, emit_num);
 
   check_gl_error(__FILE__, __LINE__);
   
@@ -273,10 +175,37 @@ void SceneBlob::render()
   
   if (imgui_) {
     ImGui::SetNextWindowPos(ImVec2(100, 100), ImGuiCond_Once);
-    ImGui::Begin("color config", &imgui_, IMGUI_SIMPLE_DIALOG_FLAGS);
+    ImGui::Begin("config", &imgui_, IMGUI_SIMPLE_DIALOG_FLAGS);
 
     ImGui::ColorEdit3("background", &bg.x);
     ImGui::ColorEdit3("point color", &point_color.x);
+    ImGui::SliderFloat("emit / sec", &emit_rate_, 0.f, 2000000.f, "%.0f");
+    if (ImGui::SliderFloat("life", &life_, 0.1f, 10.f)) {
+      for (auto& e : emitters_) {
+	e.velocity.w = life_;
+      }
+      particles_->set_emitters(emitters_);
+    }
+    ImGui::Checkbox("collide", &particles_->collide);
+    if (particles_->collide) {
+      ImGui::SliderFloat("radius", &particles_->radius, 0.002f, 0.05f);
+      ImGui::SliderFloat("stiffness", &particles_->stiffness, 0.f, 200.f);
+      ImGui::SliderFloat("damping", &particles_->damping, 0.f, 20.f);
+    }
+    // 0なら並べ替えない
+    static const unsigned reorder_min = 0, reorder_max = 600;
+    ImGui::SliderScalar("reorder every", ImGuiDataType_U32, &particles_->reorder_interval,
+			&reorder_min, &reorder_max, "%u frames");
+    ImGui::Text("alive %u / %u", particles_->alive_count(), particles_->capacity());
+    if (cloud_) {
+      ImGui::ColorEdit3("cloud color", &cloud_color_.x);
+      ImGui::Text("cloud loaded %zu / %zu%s, drawn %zu", cloud_->loaded(), cloud_->point_num(),
+		  cloud_->failed() ? " (failed)" : "", cloud_->drawn());
+      ImGui::Checkbox("frustum culling", &cloud_->cull);
+    }
+    if (ImGui::Button("Reset")) {
+      particles_->reset();
+    }
     ImGui::End();
   }
 
@@ -289,7 +218,15 @@ void SceneBlob::render()
   model_ = glm::mat4(rot_);
   
   prog_.set_uniform("MVP", proj_ * view_ * model_);
-  blob_->render();
+  particles_->render();
+
+  // 点群の範囲を原点中心の[-1, 1]に収めて粒子と同じ空間に置く
+  if (cloud_) {
+    const mat4 mvp = proj_ * view_ * model_ * cloud_->normalize_matrix();
+    prog_.set_uniform("color", cloud_color_);
+    prog_.set_uniform("MVP", mvp);
+    cloud_->render(mvp);
+  }
 
   check_gl_error(__FILE__, __LINE__);
 }
@@ -314,19 +251,6 @@ bool SceneBlob::compile_and_link_shaders()
     return false;
   }
 
-  if (!comp_prog_.compile_shader_from_file("shader/blob.cs", ShaderType::COMPUTE)) {
-    fprintf(stderr, "Compiling compute shader failed.\n%s\n", comp_prog_.log().c_str());
-    return false;
-  }
-  if (!comp_prog_.link()) {
-    fprintf(stderr, "Linking shader program failed.\n%s\n", comp_prog_.log().c_str());
-    return false;
-  }
-  if (!comp_prog_.valid()) {
-    fprintf(stderr, "Validating program failed.\n%s\n", comp_prog_.log().c_str());
-    return false;
-  }
-
   prog_.use();
   prog_.print_active_attribs();
   prog_.print_active_uniforms();
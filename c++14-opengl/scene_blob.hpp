@@ -4,22 +4,20 @@
 #include <vector>
 #include <random>
 #include <memory>
+#include <string>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 #include "program.hpp"
 #include "clock.hpp"
-
-struct Particle;
-class Blob;
-using Particles = std::vector<Particle>;
+#include "particles.hpp"
+#include "pointcloud.hpp"
 
 class SceneBlob
 {
 private:
   nekolib::renderer::Program prog_;
-  nekolib::renderer::Program comp_prog_; // コンピュートシェーダ
 
   nekolib::clock::Clock cur_;
   nekolib::clock::Clock prev_;
@@ -35,18 +33,28 @@ private:
   
   bool imgui_;
   
-  Particles init_data_; // 点群用初期化データ
-  std::unique_ptr<Blob> blob_; // 点群
+  std::unique_ptr<nekolib::renderer::ParticleSystem> particles_; // 点群
+  std::vector<nekolib::renderer::ParticleEmitter> emitters_; // 破裂の中心
+  std::mt19937 rn_;
+
+  float emit_rate_ = 200000.f; // 1秒当たりの発生数
+  float emit_fraction_ = 0.f; // 発生数の端数の繰り越し
+  float life_ = 3.f; // 粒子の寿命の平均(秒)
   
-  const double reset_interval_ = 5.f; // アニメーションリセット周期
+  const double reset_interval_ = 5.f; // 破裂の中心を移す周期
+  const unsigned max_particles_ = 1u << 21; // 粒子プールの容量
+
+  // 点群ファイル(指定時のみ, 読みながら背景として表示)
+  const std::string cloud_path_;
+  std::unique_ptr<nekolib::renderer::PointCloud> cloud_;
+  glm::vec3 cloud_color_ = glm::vec3(0.5f, 0.5f, 0.5f);
   
   bool compile_and_link_shaders();
   void update_rotation(int, int) noexcept;
-  void add_particles(Particles&, int, glm::vec3, float, float, std::mt19937&);
+  void place_emitters();
 public:
   // ctor, dtor
-  // 不完全型へのunique_ptrがメンバ変数にあるのでheader内実装は不可
-  SceneBlob();
+  SceneBlob(const char* cloud_path = nullptr);
   ~SceneBlob();
 
   bool init();
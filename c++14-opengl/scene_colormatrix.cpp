@@ -34,11 +34,10 @@ bool SceneColorMatrix::init(int* width, int* height)
   }
   *width = source_tex_.width();
   *height = source_tex_.height();
-  
-  result_tex_ = Texture::create("texture/ginn_aomuke.png", true);
 
-  source_tex_.bind(1);
-  result_tex_.bind(2);
+  cm_filter_ = std::make_unique<AutoLevelsFilter>(levels_);
+  graph_.set_source(source_tex_);
+  graph_.set_chain({ cm_filter_.get() });
 
   fprintf(stdout, "Press 'd' key to show/hide color dialog.\n");
 
@@ -65,22 +64,6 @@ void SceneColorMatrix::update()
   }
 }
 
-#define WORKGROUP_SIZE 16
-void SceneColorMatrix::compute()
-{
-  // OpenGL ESだとglBindImageTextureの対象はimmutableなTextureでなければならない
-  // Desktop OpenGL + nvidia環境だと非immutableでも普通に動く模様
-  // 公式APIリファレンスも明言していないのでimmutableなブツを使用
-
-  // 一枚絵をそのままのサイズで表示するだけなのでmipmap level=0のみbind
-  glBindImageTexture(0, source_tex_.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
-  glBindImageTexture(1, result_tex_.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
-
-  glDispatchCompute(result_tex_.width() / WORKGROUP_SIZE + 1, result_tex_.height() / WORKGROUP_SIZE + 1, 1);
-
-  glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-}
-
 void SceneColorMatrix::render()
 {
   glClearColor(0.2f, 0.f, 0.2f, 1.f);
@@ -92,6 +75,15 @@ void SceneColorMatrix::render()
   static int hue = 0;
   static float mono_s = 0.f;
   static vec3 mono_color(0.4f, 0.3f, 0.15f); // セピア?
+  static bool auto_levels = false;
+  static int auto_mode = 0;
+  static float clip_percent = 0.5f;
+  static bool use_lut = true;
+  static int lut_size = 0; // 0 : 33, 1 : 65
+  static int tonemap = 0; // 0 : なし, 1 : Reinhard, 2 : ACES
+  static float exposure = 0.f;
+  static float curve = 0.f;
+  static float gamma = 1.f;
   
   if (imgui_) {
     ImGui::SetNextWindowPos(ImVec2(100, 100), ImGuiCond_Once);
@@ -104,6 +96,31 @@ void SceneColorMatrix::render()
     ImGui::SliderFloat("Monotone filter strength", &mono_s, 0.f, 1.f);
     ImGui::ColorEdit3("Monotone filter color", &mono_color.r);
 
+    // 以下は行列では表せないので3D LUTを使う時だけ有効
+    ImGui::Separator();
+    ImGui::Checkbox("3D LUT", &use_lut);
+    ImGui::SameLine();
+    ImGui::RadioButton("33^3", &lut_size, 0);
+    ImGui::SameLine();
+    ImGui::RadioButton("65^3", &lut_size, 1);
+    ImGui::Combo("Tone mapping", &tonemap, "None\0Reinhard\0ACES\0");
+    ImGui::SliderFloat("Exposure", &exposure, -3.f, 3.f);
+    ImGui::SliderFloat("S-curve", &curve, -1.f, 1.f);
+    ImGui::SliderFloat("Gamma", &gamma, 0.2f, 5.f);
+
+    // 度数分布の両端を捨てて引き伸ばす(他の補正より先に適用)
+    ImGui::Separator();
+    ImGui::Checkbox("Auto levels", &auto_levels);
+    ImGui::RadioButton("per channel", &auto_mode, 0);
+    ImGui::SameLine();
+    ImGui::RadioButton("luma", &auto_mode, 1);
+    ImGui::SliderFloat("clip %", &clip_percent, 0.f, 5.f);
+    glm::uvec4 low, high;
+    if (auto_levels && levels_.clip_points(&low, &high)) {
+      ImGui::Text("low  r:%3u g:%3u b:%3u luma:%3u", low.r, low.g, low.b, low.a);
+      ImGui::Text("high r:%3u g:%3u b:%3u luma:%3u", high.r, high.g, high.b, high.a);
+    }
+
     ImGui::End();
   }
 
@@ -143,12 +160,26 @@ void SceneColorMatrix::render()
 		 (1.f - mono_s) + mono_s * mono_color.b,
 		 0.f);
 
-  cm_prog_.use();
   //行列の掛算なので一部を除き交換則は成り立たない
   //今回はダイアログで上から表示される順に色変換を適用する仕様とする
-  cm_prog_.set_uniform("ColorMatrix", mono * lm * sm * cm * bm);
-  compute();
-  
+  if (use_lut) {
+    // 変換の数によらず1画素あたり3D LUTの参照1回(値が変わった時だけ焼き直す)
+    std::vector<ColorOp> ops{ ColorOp::affine(bm), ColorOp::affine(cm), ColorOp::affine(sm),
+			      ColorOp::affine(lm), ColorOp::affine(mono) };
+    if (tonemap > 0) {
+      ops.push_back(ColorOp::tonemap(exposure, static_cast<ColorOp::Tonemap>(tonemap - 1)));
+    }
+    ops.push_back(ColorOp::s_curve(curve));
+    ops.push_back(ColorOp::gamma(gamma));
+    lut_.bake(ops, lut_size ? 65 : 33);
+    cm_filter_->set_lut(&lut_);
+  } else {
+    cm_filter_->set_matrix(mono * lm * sm * cm * bm);
+    cm_filter_->set_lut(nullptr);
+  }
+  cm_filter_->set_auto(auto_levels, clip_percent * 0.01f, static_cast<AutoLevels::Mode>(auto_mode));
+  graph_.evaluate().bind(2);
+
   prog_.use();
   prog_.set_uniform("Tex", 2);
   quad_.render();
@@ -173,16 +204,8 @@ bool SceneColorMatrix::compile_and_link_shaders()
     return false;
   }
 
-  if (!cm_prog_.compile_shader_from_file("shader/colormatrix.cs", ShaderType::COMPUTE)) {
-    fprintf(stderr, "Compiling compute shader failed.\n%s\n", cm_prog_.log().c_str());
-    return false;
-  }
-  if (!cm_prog_.link()) {
-    fprintf(stderr, "Linking shader program failed.\n%s\n", cm_prog_.log().c_str());
-    return false;
-  }
-  if (!cm_prog_.valid()) {
-    fprintf(stderr, "Validating program failed.\n%s\n", cm_prog_.log().c_str());
+  if (!levels_.init() || !lut_.init()) {
+    fprintf(stderr, "Building color correction programs failed.\n");
     return false;
   }
 
@@ -9,20 +9,26 @@
 #include "texture.hpp"
 #include "globject.hpp"
 #include "shape.hpp"
+#include "filtergraph.hpp"
+#include "histogram.hpp"
+#include "lut.hpp"
 
 class SceneColorMatrix
 {
 private:
   nekolib::renderer::Program prog_; // 表示用
-  nekolib::renderer::Program cm_prog_; // 色補正 compute shader
+  nekolib::renderer::AutoLevels levels_; // 色補正 compute shader(度数分布による自動補正付き)
+  nekolib::renderer::ColorLut lut_; // トーンカーブ等の非線形な変換も含めて焼き込む3D LUT
 
   nekolib::renderer::Quad quad_;
   nekolib::renderer::Texture source_tex_;  // immutable
-  nekolib::renderer::Texture result_tex_;  // immutable
+
+  // 行列が変わった時だけ計算し直す
+  nekolib::renderer::FilterGraph graph_;
+  std::unique_ptr<nekolib::renderer::AutoLevelsFilter> cm_filter_;
 
   bool imgui_ = true;
 
-  void compute();
   bool compile_and_link_shaders();
 public:
   SceneColorMatrix() {}
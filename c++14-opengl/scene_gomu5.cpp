@@ -0,0 +1,272 @@
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/gtc/constants.hpp>
+
+#include "imgui/imgui.h"
+
+#include "scene_gomu5.hpp"
+#include "defines.hpp"
+#include "input.hpp"
+#include "renderer.hpp"
+#include "utils.hpp"
+#include "globject.hpp"
+#include "nodeedit.hpp"
+
+using glm::vec2;
+using glm::vec3;
+using glm::vec4;
+
+using namespace nekolib::renderer;
+
+// 節点の状態(gomu3と同じ)
+// NEKO_COMPACT_POINTSの時は圧縮形式(rope.cppと同じ)
+#ifdef NEKO_COMPACT_POINTS
+struct Point {
+  vec2 position; // 節点位置(xy)
+  GLuint flags; // POINT_MOVABLE
+  GLuint velocity; // 速度(packHalf2x16)
+  vec2 position_temp; // p(t+dt)
+  GLuint flags_temp;
+  GLuint velocity_temp; // v(t)とv(t+dt)の中間(packHalf2x16)
+};
+#else
+struct Point {
+  alignas(16) vec4 position; // 節点位置(xyz) + 固定flag(w)
+  alignas(16) vec3 velocity; // 速度
+  alignas(16) vec4 position_temp; // p(t+dt)
+  alignas(16) vec3 velocity_temp; // v(t)とv(t+dt)の中間(計算途中の値)
+};
+#endif
+
+// 紐1本分の情報(SSBO用)
+struct Rope {
+  unsigned first; // 先頭節点の番号
+  unsigned count; // 節点数
+  float rest_length; // 節点間の自然長
+  float gravity; // 重力加速度(y方向)
+};
+
+// 全ての紐の節点を1個のバッファに詰めたもの
+// 描画はglMultiDrawArraysで紐毎に折れ線を描く
+// 1個だけ作ってunique_ptrに放り込むのでコピー&ムーブ不可の方針で.
+class RopeBuffer
+{
+public:
+  RopeBuffer(unsigned rope_num, unsigned node_num, float dt);
+  ~RopeBuffer() = default;
+
+  RopeBuffer(const RopeBuffer&) = delete;
+  RopeBuffer& operator=(const RopeBuffer&) = delete;
+  RopeBuffer(RopeBuffer&&) = delete;
+  RopeBuffer& operator=(RopeBuffer&&) = delete;
+
+  void render() const;
+  void update(Program&, unsigned substeps);
+  void reset(float dt);
+
+  unsigned rope_num() const noexcept { return rope_num_; }
+  unsigned node_num() const noexcept { return node_num_; }
+
+  static const unsigned max_node_num_ = 1024; // gomu_vver_shared.csのMAX_NODES
+private:
+  gl::Vao vao_;
+  gl::VertexBuffer points_;
+  gl::Buffer ropes_;
+
+  std::vector<GLint> firsts_;
+  std::vector<GLsizei> counts_;
+
+  const unsigned rope_num_;
+  const unsigned node_num_;
+  const float length_ = 0.8f; // 紐の長さ
+};
+
+RopeBuffer::RopeBuffer(unsigned rope_num, unsigned node_num, float dt)
+  : firsts_(rope_num), counts_(rope_num, node_num), rope_num_(rope_num), node_num_(node_num)
+{
+  assert(node_num >= 2 && node_num <= max_node_num_);
+
+  std::vector<Rope> ropes(rope_num_);
+  for (unsigned r = 0; r < rope_num_; ++r) {
+    firsts_[r] = r * node_num_;
+    // 重力はgomu3と同じく節点数で割る
+    ropes[r] = Rope{ r * node_num_, node_num_, length_ / (node_num_ - 1), -9.8f / node_num_ };
+  }
+  ropes_.bind(GL_SHADER_STORAGE_BUFFER);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Rope) * rope_num_, ropes.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  points_.bind();
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Point) * rope_num_ * node_num_, nullptr, GL_DYNAMIC_DRAW);
+
+  vao_.bind();
+  points_.bind();
+  glEnableVertexAttribArray(0);
+#ifdef NEKO_COMPACT_POINTS
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Point), BUFFER_OFFSET(0));
+#else
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Point), BUFFER_OFFSET(0));
+#endif
+  vao_.bind(false);
+
+  reset(dt);
+}
+
+// 紐を初期状態に戻す
+// 上端を画面上部に等間隔に固定して少しずつ違う角度に伸ばしておく
+void RopeBuffer::reset(float dt)
+{
+  points_.bind();
+  Point* pmapped = static_cast<Point*>(glMapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY));
+  for (unsigned r = 0; r < rope_num_; ++r) {
+    vec3 top(-0.95f + 1.9f * (r + 0.5f) / rope_num_, 0.9f, 0.f);
+    float theta = glm::pi<float>() * (-0.5f + 0.4f * std::sin(r * 0.05f));
+    vec3 dir(std::cos(theta), std::sin(theta), 0.f);
+    vec2 g(0.f, -9.8f / node_num_);
+
+    for (unsigned i = 0; i < node_num_; ++i) {
+      Point& p = pmapped[r * node_num_ + i];
+      float t = static_cast<float>(i) / (node_num_ - 1);
+      vec3 x = top + dir * (length_ * t);
+      // 上端だけ固定
+      // velocity verlet法の初期状態(gomu_vver_init.csと同じ)
+#ifdef NEKO_COMPACT_POINTS
+      p.position = vec2(x.x, x.y);
+      p.flags = (i == 0) ? 0u : POINT_MOVABLE;
+      p.velocity = glm::packHalf2x16(vec2(0.f));
+      p.position_temp = p.position;
+      p.flags_temp = p.flags;
+      p.velocity_temp = glm::packHalf2x16((i == 0) ? vec2(0.f) : -0.5f * dt * g);
+#else
+      p.position = vec4(x, i == 0 ? 0.f : 1.f);
+      p.velocity = vec3(0.f);
+      p.position_temp = p.position;
+      p.velocity_temp = (i == 0) ? vec3(0.f) : -0.5f * dt * vec3(g, 0.f);
+#endif
+    }
+  }
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+
+  check_gl_error(__FILE__, __LINE__);
+}
+
+void RopeBuffer::render() const
+{
+  vao_.bind();
+  glMultiDrawArrays(GL_LINE_STRIP, firsts_.data(), counts_.data(), rope_num_);
+}
+
+// 更新用計算シェーダー起動
+// 紐1本につき1 workgroup
+void RopeBuffer::update(Program& prog, unsigned substeps)
+{
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, points_.handle());
+  ropes_.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+
+  prog.use();
+  prog.set_uniform("rope_num", rope_num_);
+  prog.set_uniform("substeps", substeps);
+  glDispatchCompute(rope_num_, 1, 1);
+
+  check_gl_error(__FILE__, __LINE__);
+}
+
+SceneGomu5::SceneGomu5() : imgui_(false) {}
+SceneGomu5::~SceneGomu5() {}
+
+bool SceneGomu5::init()
+{
+  if (!compile_and_link_shaders()) {
+    return false;
+  }
+
+  rope_buffer_ = std::make_unique<RopeBuffer>(rope_num_, node_num_, dt_ / substeps_);
+
+  fprintf(stdout, "\n%d ropes x %d points, %d substeps per frame.\n", rope_num_, node_num_, substeps_);
+  fprintf(stdout, "Press 'd' key to show config dialog.\n");
+
+  return true;
+}
+
+void SceneGomu5::update()
+{
+  using namespace nekolib::input;
+  Keyboard kb = nekolib::input::Manager::instance().keyboard();
+
+  // 'D'キー押し下げでダイアログ表示切り替え
+  if (kb.triggered(SDLK_d)) {
+    imgui_ = !imgui_;
+  }
+
+  update_prog_.use();
+  update_prog_.set_uniform("dt", dt_ / substeps_);
+  update_prog_.set_uniform("m", m_);
+  update_prog_.set_uniform("k", k_);
+  update_prog_.set_uniform("c", c_);
+
+  // substeps_回分の更新を1回の起動で
+  rope_buffer_->update(update_prog_, substeps_);
+}
+
+void SceneGomu5::render()
+{
+  glClearBufferfv(GL_COLOR, 0, &clear_color_.x);
+
+  if (imgui_) {
+    ImGui::SetNextWindowPos(ImVec2(100, 100), ImGuiCond_Once);
+    ImGui::Begin("config", &imgui_, IMGUI_SIMPLE_DIALOG_FLAGS);
+
+    ImGui::SliderInt("ropes", &rope_num_, 1, 10000);
+    ImGui::SliderInt("points", &node_num_, 2, RopeBuffer::max_node_num_);
+    ImGui::SliderInt("substeps", &substeps_, 1, 64);
+    ImGui::SliderFloat("k", &k_, 10.f, 5000.f);
+    ImGui::SliderFloat("c", &c_, 0.f, 100.f);
+
+    // 本数と節点数が変わっていれば作り直す
+    if (ImGui::Button("Reset")) {
+      if (static_cast<unsigned>(rope_num_) != rope_buffer_->rope_num() ||
+	  static_cast<unsigned>(node_num_) != rope_buffer_->node_num()) {
+	rope_buffer_ = std::make_unique<RopeBuffer>(rope_num_, node_num_, dt_ / substeps_);
+      } else {
+	rope_buffer_->reset(dt_ / substeps_);
+      }
+    }
+    ImGui::End();
+  }
+
+  // rope_buffer_->update()の完了待ち
+  glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+  line_prog_.use();
+  rope_buffer_->render();
+
+  check_gl_error(__FILE__, __LINE__);
+}
+
+bool SceneGomu5::compile_and_link_shaders()
+{
+  using Names = std::vector<std::string>;
+
+  // 描画用
+  if (!line_prog_.build_program_from_files(Names{ "shader/gomu2_line.vs", "shader/gomu2_line.fs" })) {
+    return false;
+  }
+
+  // 計算用
+#ifdef NEKO_COMPACT_POINTS
+  update_prog_.define("COMPACT_POINTS");
+#endif
+  if (!update_prog_.build_program_from_files(Names{ "shader/gomu_vver_shared.cs" })) {
+    return false;
+  }
+
+  line_prog_.use();
+  line_prog_.print_active_attribs();
+  line_prog_.print_active_uniforms();
+
+  return true;
+}
@@ -0,0 +1,46 @@
+#ifndef INCLUDED_SCENE_GOMU5_HPP
+#define INCLUDED_SCENE_GOMU5_HPP
+
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "program.hpp"
+
+class RopeBuffer;
+
+// 互いに独立した大量の紐をぶら下げる
+// 紐1本を計算シェーダーの1 workgroupの共有メモリに載せて
+// 1フレームにsubsteps_回分の更新をまとめて行う
+class SceneGomu5
+{
+private:
+  nekolib::renderer::Program line_prog_; // 描画用シェーダー(線)
+  nekolib::renderer::Program update_prog_; // 更新用計算シェーダー
+
+  std::unique_ptr<RopeBuffer> rope_buffer_;
+
+  int rope_num_ = 1000; // 紐の本数
+  int node_num_ = 64; // 紐1本の節点数(<= 1024)
+  int substeps_ = 8; // 1フレーム当たりの分割数
+
+  // 物理パラメーター
+  const float dt_ = 1.f / 60;
+  const float m_ = 1.f;
+  float k_ = 250.f;
+  float c_ = 25.f;
+
+  glm::vec4 clear_color_ = glm::vec4(1.f, 1.f, 1.f, 1.f);
+
+  bool imgui_ = false;
+
+  bool compile_and_link_shaders();
+public:
+  SceneGomu5();
+  ~SceneGomu5();
+
+  bool init();
+  void update();
+  void render();
+};
+
+#endif // INCLUDED_SCENE_GOMU5_HPP
@@ -20,6 +20,33 @@ using glm::mat4;
 
 using namespace nekolib::renderer;
 
+namespace {
+  // フィルタの種類(SceneImageProcess::filters_の添字)
+  enum {
+    FILTER_NONE = 0,
+    FILTER_INVERT,
+    FILTER_MONOTONE,
+    FILTER_MEAN3X3,
+    FILTER_LAPLACIAN,
+    FILTER_SOBEL,
+    FILTER_BOX,
+    FILTER_GAUSSIAN,
+    FILTER_DISK,
+    FILTER_SAT_BOX,
+    FILTER_MEDIAN,
+    FILTER_BILATERAL,
+    FILTER_PYRAMID_BLUR,
+    FILTER_PYRAMID_BLEND,
+    FILTER_MORPHOLOGY,
+    FILTER_CANNY,
+    FILTER_NUM,
+  };
+  const char* filter_names[] = { "None", "Invert", "Monotone", "Mean3x3", "Laplacian", "Sobel", "Box", "Gaussian", "Disk", "Box (SAT)", "Median", "Bilateral",
+				 "Blur (pyramid)", "Blend (pyramid)", "Morphology", "Canny" };
+  const char* morph_op_names[] = { "erode", "dilate", "open", "close", "top-hat", "black-hat" };
+  const char* morph_element_names[] = { "rect", "line 0", "line 45", "line 90", "line 135" };
+}
+
 bool SceneImageProcess::init(int* width, int* height)
 {
   if (!compile_and_link_shaders()) {
@@ -34,11 +61,35 @@ bool SceneImageProcess::init(int* width, int* height)
   }
   *width = source_tex_.width();
   *height = source_tex_.height();
-  
-  result_tex_ = Texture::create("texture/ginn_aomuke.png", true);
 
-  source_tex_.bind(1);
-  result_tex_.bind(2);
+  // 白黒化(彩度0の色変換行列)
+  const vec3 lumRGB(0.3086, 0.6094, 0.0820);
+  auto mono = std::make_unique<ProgramFilter>(cm_prog_, "ColorMatrix");
+  mono->set_matrix(mat4(vec4(lumRGB.r), vec4(lumRGB.g), vec4(lumRGB.b), vec4(0.f, 0.f, 0.f, 1.f)));
+
+  filters_.resize(FILTER_NUM);
+  filters_[FILTER_INVERT] = std::make_unique<ProgramFilter>(invert_prog_);
+  filters_[FILTER_MONOTONE] = std::move(mono);
+  filters_[FILTER_MEAN3X3] = std::make_unique<ConvolutionFilter>(conv_, ConvKernel::box(1));
+  filters_[FILTER_LAPLACIAN] = std::make_unique<ConvolutionFilter>(conv_, ConvKernel::laplacian());
+  filters_[FILTER_SOBEL] = std::make_unique<ConvolutionFilter>(conv_, ConvKernel({ 1.f, 2.f, 1.f }, { -1.f, 0.f, 1.f }, 0.5f),
+							       ConvKernel::sobel_y());
+  filters_[FILTER_BOX] = std::make_unique<ConvolutionFilter>(conv_, ConvKernel::box(blur_radius_));
+  filters_[FILTER_GAUSSIAN] = std::make_unique<ConvolutionFilter>(conv_, ConvKernel::gaussian(blur_radius_));
+  filters_[FILTER_DISK] = std::make_unique<ConvolutionFilter>(conv_, ConvKernel::disk(blur_radius_));
+  update_conv_methods();
+  filters_[FILTER_SAT_BOX] = std::make_unique<SatBoxFilter>(sat_, sat_radius_);
+  filters_[FILTER_MEDIAN] = std::make_unique<MedianFilter>(median_, median_radius_);
+  filters_[FILTER_BILATERAL] = std::make_unique<BilateralFilter>(bilateral_, bilateral_sigma_s_, bilateral_sigma_r_);
+  filters_[FILTER_PYRAMID_BLUR] = std::make_unique<PyramidBlurFilter>(pyramid_, pyramid_blur_level_);
+  // 上流の結果(左)と元の画像(右)を混ぜる
+  blend_mask_ = Texture::create(*width, *height, TextureFormat::RGBA8);
+  update_blend_mask();
+  filters_[FILTER_PYRAMID_BLEND] = std::make_unique<PyramidBlendFilter>(pyramid_, source_tex_, blend_mask_, blend_levels_);
+  filters_[FILTER_MORPHOLOGY] = std::make_unique<MorphologyFilter>(morph_, static_cast<Morphology::Op>(morph_op_), morph_element());
+  filters_[FILTER_CANNY] = std::make_unique<CannyFilter>(canny_, canny_sigma_, canny_low_, canny_high_);
+
+  graph_.set_source(source_tex_);
 
   fprintf(stdout, "Press 'd' key to show/hide filter dialog.\n");
 
@@ -65,73 +116,136 @@ void SceneImageProcess::update()
   }
 }
 
-#define WORKGROUP_SIZE 16
-void SceneImageProcess::filter(nekolib::renderer::Program& prog)
-{
-  prog.use();
-
-  // OpenGL ESだとglBindImageTextureの対象はimmutableなTextureでなければならない
-  // Desktop OpenGL + nvidia環境だと非immutableでも普通に動く模様
-  // 公式APIリファレンスも明言していないのでimmutableなブツを使用
-
-  // 一枚絵をそのままのサイズで表示するだけなのでmipmap level=0のみbind
-  glBindImageTexture(0, source_tex_.handle(), 0, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA8);
-  glBindImageTexture(1, result_tex_.handle(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
-
-  glDispatchCompute(result_tex_.width() / WORKGROUP_SIZE + 1, result_tex_.height() / WORKGROUP_SIZE + 1, 1);
-
-  glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-}
-
 void SceneImageProcess::render()
 {
   glClearColor(0.2f, 0.f, 0.2f, 1.f);
   glClear(GL_COLOR_BUFFER_BIT);
   
-  static int e = 0;
   if (imgui_) {
     ImGui::SetNextWindowPos(ImVec2(100, 100), ImGuiCond_Once);
     ImGui::Begin("filters", &imgui_, IMGUI_SIMPLE_DIALOG_FLAGS);
 
-    ImGui::RadioButton("None", &e, 0);
-    ImGui::RadioButton("Invert", &e, 1);
-    ImGui::RadioButton("Mean3x3", &e, 2);
-    ImGui::RadioButton("Laplacian", &e, 3);
-    ImGui::RadioButton("Sobel", &e, 4);
+    for (int i = 0; i < stage_num_; ++i) {
+      char label[16];
+      snprintf(label, sizeof(label), "stage %d", i + 1);
+      ImGui::Combo(label, &stages_[i], filter_names, FILTER_NUM);
+    }
+    const int radius = blur_radius_;
+    // 直接計算できない半径はFFT
+    ImGui::SliderInt("radius", &blur_radius_, 1, 256);
+    if (radius != blur_radius_) {
+      static_cast<ConvolutionFilter*>(filters_[FILTER_BOX].get())->set_kernel(ConvKernel::box(blur_radius_));
+      static_cast<ConvolutionFilter*>(filters_[FILTER_GAUSSIAN].get())->set_kernel(ConvKernel::gaussian(blur_radius_));
+      static_cast<ConvolutionFilter*>(filters_[FILTER_DISK].get())->set_kernel(ConvKernel::disk(blur_radius_));
+    }
+    bool force = ImGui::Checkbox("force 2D", &conv_.force_2d);
+    ImGui::SameLine();
+    force |= ImGui::Checkbox("force FFT", &conv_.force_fft);
+    if (radius != blur_radius_ || force) {
+      update_conv_methods();
+    }
+    ImGui::Text("box : %s, disk : %s", Convolution::method_name(box_method_), Convolution::method_name(disk_method_));
+    // 積分画像なので半径によらず1画素4点の参照
+    if (ImGui::SliderInt("SAT radius", &sat_radius_, 1, 512)) {
+      static_cast<SatBoxFilter*>(filters_[FILTER_SAT_BOX].get())->set_radius(sat_radius_);
+    }
+    // 半径2まではsorting network, それより大きければ度数分布(半径によらない手間)
+    if (ImGui::SliderInt("median radius", &median_radius_, 1, Median::max_radius_)) {
+      static_cast<MedianFilter*>(filters_[FILTER_MEDIAN].get())->set_radius(median_radius_);
+    }
+    ImGui::SameLine();
+    ImGui::Text("%s", median_radius_ <= Median::network_radius_ ? "(network)" : "(histogram)");
+    const bool s = ImGui::SliderInt("bilateral sigma s", &bilateral_sigma_s_, 2, 64);
+    const bool r = ImGui::SliderFloat("bilateral sigma r", &bilateral_sigma_r_, 0.02f, 0.5f);
+    if (s || r) {
+      static_cast<BilateralFilter*>(filters_[FILTER_BILATERAL].get())->set_sigma(bilateral_sigma_s_, bilateral_sigma_r_);
+    }
+    // 縮小してから拡大するだけなので段数によらず元の画像の4 / 3倍程度の手間
+    if (ImGui::SliderInt("pyramid blur level", &pyramid_blur_level_, 1, 8)) {
+      static_cast<PyramidBlurFilter*>(filters_[FILTER_PYRAMID_BLUR].get())->set_level(pyramid_blur_level_);
+    }
+    ImGui::SameLine();
+    ImGui::Text("(radius %d)", 1 << pyramid_blur_level_);
+    // 1段なら普通の切り替え, 段数を増やすと粗い帯域ほど広く混ざる
+    if (ImGui::SliderInt("blend levels", &blend_levels_, 1, Pyramid::max_levels(source_tex_.width(), source_tex_.height()))) {
+      static_cast<PyramidBlendFilter*>(filters_[FILTER_PYRAMID_BLEND].get())->set_levels(blend_levels_);
+    }
+    if (ImGui::SliderFloat("blend split", &blend_split_, 0.f, 1.f)) {
+      update_blend_mask();
+      static_cast<PyramidBlendFilter*>(filters_[FILTER_PYRAMID_BLEND].get())->set_mask(blend_mask_);
+    }
+    // van Herk/Gil-Werman法なので要素の大きさによらず画素あたり比較3回 x パス数
+    const bool op = ImGui::Combo("morphology", &morph_op_, morph_op_names, IM_ARRAYSIZE(morph_op_names));
+    const bool element = ImGui::Combo("element", &morph_element_, morph_element_names, IM_ARRAYSIZE(morph_element_names));
+    const bool size = ImGui::SliderInt("element size", &morph_size_, 1, 201);
+    if (op || element || size) {
+      auto morph = static_cast<MorphologyFilter*>(filters_[FILTER_MORPHOLOGY].get());
+      morph->set_op(static_cast<Morphology::Op>(morph_op_));
+      morph->set_element(morph_element());
+    }
+    // hysteresisは変化が無くなるまで(収束の判定もGPU上, max passesで打ち切ったらnot converged)
+    const bool sigma = ImGui::SliderFloat("canny sigma", &canny_sigma_, 0.f, 4.f);
+    const bool low = ImGui::SliderFloat("canny low", &canny_low_, 0.f, 1.f);
+    const bool high = ImGui::SliderFloat("canny high", &canny_high_, 0.f, 1.f);
+    ImGui::SliderInt("canny max passes", &canny_.max_passes, 1, 256);
+    if (sigma || low || high) {
+      static_cast<CannyFilter*>(filters_[FILTER_CANNY].get())->set_params(canny_sigma_, canny_low_, canny_high_);
+    }
+    ImGui::SameLine();
+    const int passes = canny_.passes();
+    ImGui::Text("(last %d%s)", passes, canny_.converged() ? "" : ", not converged");
+    ImGui::Text("computed stages : %d", graph_.computed());
+    ImGui::Text("pooled textures : %zu", graph_.pooled_textures());
 
     ImGui::End();
   }
 
-  switch (e) {
-  case 0:
-    source_tex_.bind(2);
-    break;
-  case 1:
-    filter(invert_prog_);
-    result_tex_.bind(2);
-    break;
-  case 2:
-    filter(mean_prog_);
-    result_tex_.bind(2);
-    break;
-  case 3:
-    filter(laplacian_prog_);
-    result_tex_.bind(2);
-    break;
-  case 4:
-    filter(sobel_prog_);
-    result_tex_.bind(2);
-    break;
-  default:
-    assert(!"This must not be happen!");
-    break;
+  std::vector<FilterNode*> chain;
+  for (auto stage : stages_) {
+    chain.push_back(filters_[stage].get()); // FILTER_NONEはnullptr
   }
-  
+  graph_.set_chain(chain);
+  graph_.evaluate().bind(2);
+
   prog_.use();
   prog_.set_uniform("Tex", 2);
   quad_.render();
 }
 
+StructuringElement SceneImageProcess::morph_element() const
+{
+  if (morph_element_ == 0) {
+    return StructuringElement::rect(morph_size_, morph_size_);
+  }
+  return StructuringElement::line(morph_size_, (morph_element_ - 1) * 45);
+}
+
+// 左右に分けるmask(blend_split_より右が1)
+void SceneImageProcess::update_blend_mask()
+{
+  const int w = blend_mask_.width(), h = blend_mask_.height();
+  const int split = static_cast<int>(blend_split_ * w);
+  std::vector<unsigned char> pixels(static_cast<size_t>(w) * h * 4);
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      const unsigned char v = (x < split) ? 0 : 255;
+      unsigned char* p = &pixels[(static_cast<size_t>(y) * w + x) * 4];
+      p[0] = p[1] = p[2] = p[3] = v;
+    }
+  }
+  blend_mask_.bind(0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+// Box/Diskの計算方法(カーネルを作るので毎フレームは求めない)
+void SceneImageProcess::update_conv_methods()
+{
+  const int w = source_tex_.width(), h = source_tex_.height();
+  box_method_ = conv_.method(ConvKernel::box(blur_radius_), w, h);
+  disk_method_ = conv_.method(ConvKernel::disk(blur_radius_), w, h);
+}
+
 bool SceneImageProcess::compile_and_link_shaders()
 {
   if (!prog_.compile_shader_from_file("shader/quad.vs", ShaderType::VERTEX)) {
@@ -164,45 +278,44 @@ bool SceneImageProcess::compile_and_link_shaders()
     return false;
   }
 
-  if (!mean_prog_.compile_shader_from_file("shader/mean3.cs", ShaderType::COMPUTE)) {
-    fprintf(stderr, "Compiling compute shader failed.\n%s\n", mean_prog_.log().c_str());
+  if (!cm_prog_.compile_shader_from_file("shader/colormatrix.cs", ShaderType::COMPUTE)) {
+    fprintf(stderr, "Compiling compute shader failed.\n%s\n", cm_prog_.log().c_str());
     return false;
   }
-  if (!mean_prog_.link()) {
-    fprintf(stderr, "Linking shader program failed.\n%s\n", mean_prog_.log().c_str());
+  if (!cm_prog_.link()) {
+    fprintf(stderr, "Linking shader program failed.\n%s\n", cm_prog_.log().c_str());
     return false;
   }
-  if (!mean_prog_.valid()) {
-    fprintf(stderr, "Validating program failed.\n%s\n", mean_prog_.log().c_str());
+  if (!cm_prog_.valid()) {
+    fprintf(stderr, "Validating program failed.\n%s\n", cm_prog_.log().c_str());
     return false;
   }
 
-  if (!laplacian_prog_.compile_shader_from_file("shader/laplacian.cs", ShaderType::COMPUTE)) {
-    fprintf(stderr, "Compiling compute shader failed.\n%s\n", laplacian_prog_.log().c_str());
+  if (!conv_.init()) {
+    fprintf(stderr, "Building convolution programs failed.\n");
     return false;
   }
-  if (!laplacian_prog_.link()) {
-    fprintf(stderr, "Linking shader program failed.\n%s\n", laplacian_prog_.log().c_str());
+  if (!sat_.init()) {
+    fprintf(stderr, "Building summed-area table programs failed.\n");
     return false;
   }
-  if (!laplacian_prog_.valid()) {
-    fprintf(stderr, "Validating program failed.\n%s\n", laplacian_prog_.log().c_str());
+  if (!median_.init() || !bilateral_.init()) {
+    fprintf(stderr, "Building median/bilateral programs failed.\n");
     return false;
   }
-  
-  if (!sobel_prog_.compile_shader_from_file("shader/sobel.cs", ShaderType::COMPUTE)) {
-    fprintf(stderr, "Compiling compute shader failed.\n%s\n", sobel_prog_.log().c_str());
+  if (!pyramid_.init()) {
+    fprintf(stderr, "Building pyramid programs failed.\n");
     return false;
   }
-  if (!sobel_prog_.link()) {
-    fprintf(stderr, "Linking shader program failed.\n%s\n", sobel_prog_.log().c_str());
+  if (!morph_.init()) {
+    fprintf(stderr, "Building morphology programs failed.\n");
     return false;
   }
-  if (!sobel_prog_.valid()) {
-    fprintf(stderr, "Validating program failed.\n%s\n", sobel_prog_.log().c_str());
+  if (!canny_.init()) {
+    fprintf(stderr, "Building Canny programs failed.\n");
     return false;
   }
-  
+
   prog_.use();
   prog_.print_active_attribs();
   prog_.print_active_uniforms();
@@ -2,6 +2,7 @@
 #define INCLUDED_SCENE_IMAGEPROCESS_HPP
 
 #include <memory>
+#include <vector>
 #include <glm/glm.hpp>
 
 #include "program.hpp"
@@ -9,26 +10,65 @@
 #include "texture.hpp"
 #include "globject.hpp"
 #include "shape.hpp"
+#include "convolution.hpp"
+#include "filtergraph.hpp"
+#include "sat.hpp"
+#include "median.hpp"
+#include "bilateral.hpp"
+#include "pyramid.hpp"
+#include "morphology.hpp"
+#include "canny.hpp"
 
 class SceneImageProcess
 {
 private:
   nekolib::renderer::Program prog_; // 表示用
-  nekolib::renderer::Program invert_prog_; // フィルタ用 compute shader その1
-  nekolib::renderer::Program mean_prog_; // フィルタ用 compute shader その2
-  nekolib::renderer::Program laplacian_prog_; // フィルタ用 compute shader その3
-  nekolib::renderer::Program sobel_prog_; // フィルタ用 compute shader その4
+  nekolib::renderer::Program invert_prog_; // フィルタ用 compute shader
+  nekolib::renderer::Program cm_prog_; // 色補正 compute shader(白黒化に使用)
+  nekolib::renderer::Convolution conv_; // 畳み込み系のフィルタ
+  nekolib::renderer::SummedAreaTable sat_; // 半径の大きな箱型平均
+  nekolib::renderer::Median median_; // 中央値
+  nekolib::renderer::BilateralGrid bilateral_; // bilateral filter
+  nekolib::renderer::Pyramid pyramid_; // Gaussian/Laplacian pyramid
+  nekolib::renderer::Morphology morph_; // erode/dilate/open/close
+  nekolib::renderer::Canny canny_; // エッジ検出(ぼかしはconv_を使う)
 
   nekolib::renderer::Quad quad_;
   nekolib::renderer::Texture source_tex_;  // immutable
-  nekolib::renderer::Texture result_tex_;  // immutable
+
+  // フィルタは最大stage_num_段までつなげられる
+  // 変更のあった段から下流だけを計算し直す
+  nekolib::renderer::FilterGraph graph_;
+  std::vector<std::unique_ptr<nekolib::renderer::FilterNode>> filters_; // stages_の値で選ぶ(0はなし)
+  static const int stage_num_ = 3;
+  int stages_[stage_num_] = { 0, 0, 0 };
 
   bool imgui_ = true;
+  int blur_radius_ = 8; // Box/Gaussian/Diskの半径
+  // 表示用のBox/Diskの計算方法(半径かforce_*が変わった時だけ求め直す)
+  nekolib::renderer::Convolution::Method box_method_ = nekolib::renderer::Convolution::Method::SEPARABLE;
+  nekolib::renderer::Convolution::Method disk_method_ = nekolib::renderer::Convolution::Method::DIRECT_2D;
+  int sat_radius_ = 32; // Box (SAT)の半径
+  int median_radius_ = 1;
+  int bilateral_sigma_s_ = 16; // 空間(画素)
+  float bilateral_sigma_r_ = 0.1f; // 輝度
+  int pyramid_blur_level_ = 4;
+  int blend_levels_ = 6; // multi-band blendingの段数
+  float blend_split_ = 0.5f; // 左右の境目
+  nekolib::renderer::Texture blend_mask_;
+  int morph_op_ = 0; // Morphology::Op
+  int morph_element_ = 0; // 0 : 矩形, 1-4 : 直線(0, 45, 90, 135度)
+  int morph_size_ = 15;
+  float canny_sigma_ = 1.4f;
+  float canny_low_ = 0.05f;
+  float canny_high_ = 0.15f;
 
-  void filter(nekolib::renderer::Program&);
   bool compile_and_link_shaders();
+  void update_blend_mask();
+  void update_conv_methods();
+  nekolib::renderer::StructuringElement morph_element() const;
 public:
-  SceneImageProcess() {}
+  SceneImageProcess() : canny_(conv_) {}
   ~SceneImageProcess() = default;
 
   bool init(int* width, int* height);
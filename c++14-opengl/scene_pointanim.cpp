@@ -1,4 +1,5 @@
 #include <vector>
+#include <string>
 #include <random>
 #include <cstdio>
 #include <cmath>
@@ -42,6 +43,16 @@ bool ScenePointAnim::init()
 
   disseminate(POINTS);
 
+  if (!cloud_path_.empty()) {
+    cloud_ = std::make_unique<PointCloud>();
+    if (!cloud_->open(cloud_path_.c_str())) {
+      return false;
+    }
+  }
+
+  std::random_device rd;
+  seed_ = rd();
+
   prog_.use();
 
   glClearColor(0.f, 0.1f, 0.3f, 1.f);
@@ -95,6 +106,12 @@ void ScenePointAnim::disseminate(size_t point_num)
 
 void ScenePointAnim::update()
 {
+  // 点群ファイルは1フレームに数区画ずつ転送(区画の環は8区画なので普通は待たない)
+  // 失敗はPointCloudがstderrに出し, 以後は転送済みの分だけ描く
+  if (cloud_) {
+    cloud_->stream(4);
+  }
+
   using namespace nekolib::input;
   Mouse m = nekolib::input::Manager::instance().mouse();
   Keyboard kb = nekolib::input::Manager::instance().keyboard();
@@ -136,10 +153,21 @@ void ScenePointAnim::render()
   
   if (imgui_) {
     ImGui::SetNextWindowPos(ImVec2(100, 100), ImGuiCond_Once);
-    ImGui::Begin("color config", &imgui_, IMGUI_SIMPLE_DIALOG_FLAGS);
+    ImGui::Begin("config", &imgui_, IMGUI_SIMPLE_DIALOG_FLAGS);
 
     ImGui::ColorEdit3("background", &bg.x);
     ImGui::ColorEdit3("point color", &point_color.x);
+    if (cloud_) {
+      ImGui::Text("loaded %zu / %zu points%s", cloud_->loaded(), cloud_->point_num(),
+		  cloud_->failed() ? " (failed)" : "");
+      ImGui::Text("drawn %zu points", cloud_->drawn());
+      ImGui::Checkbox("frustum culling", &cloud_->cull);
+    } else {
+      ImGui::Checkbox("procedural", &procedural_);
+    }
+    if (!cloud_ && procedural_) {
+      ImGui::SliderInt("points", &procedural_points_, 100000, 50000000);
+    }
 
     ImGui::End();
   }
@@ -147,20 +175,38 @@ void ScenePointAnim::render()
   glClearColor(bg.x, bg.y, bg.z, 1.f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  prog_.use();
-  prog_.set_uniform("point_color", point_color);
+  if (cloud_) {
+    // 点群の範囲を原点中心の[-1, 1]に収めて表示
+    model_ = glm::mat4(rot_) * cloud_->normalize_matrix();
+    cloud_prog_.use();
+    cloud_prog_.set_uniform("point_color", point_color);
+    cloud_prog_.set_uniform("MVP", proj_ * view_ * model_);
+    cloud_->render(proj_ * view_ * model_);
+    check_gl_error(__FILE__, __LINE__);
+    return;
+  }
+
+  Program& prog = procedural_ ? procedural_prog_ : prog_;
+  prog.use();
+  prog.set_uniform("point_color", point_color);
 
   model_ = glm::translate(mat4(1.f), vec3(0.f, 0.f, -1.f));
   model_ = glm::scale(model_, vec3(1.f, 1.f, 2.f));
   model_ = glm::mat4(rot_) * model_;
   
-  prog_.set_uniform("MVP", proj_ * view_ * model_);
+  prog.set_uniform("MVP", proj_ * view_ * model_);
 
   float delta = nekolib::clock::Clock::calc_delta_seconds(cur_, start_); // 経過時間(秒)
-  prog_.set_uniform("elapsed_time", delta / CYCLE);
+  prog.set_uniform("elapsed_time", delta / CYCLE);
 
-  vao_.bind();
-  glDrawArrays(GL_POINTS, 0, POINTS);
+  if (procedural_) {
+    prog.set_uniform("seed", seed_);
+    empty_vao_.bind();
+    glDrawArrays(GL_POINTS, 0, procedural_points_);
+  } else {
+    vao_.bind();
+    glDrawArrays(GL_POINTS, 0, POINTS);
+  }
 
   check_gl_error(__FILE__, __LINE__);
 }
@@ -185,6 +231,16 @@ bool ScenePointAnim::compile_and_link_shaders()
     return false;
   }
 
+  procedural_prog_.define("PROCEDURAL");
+  if (!procedural_prog_.build_program_from_files(std::vector<std::string>{ "shader/points.vs", "shader/points.fs" })) {
+    return false;
+  }
+
+  cloud_prog_.define("CLOUD");
+  if (!cloud_prog_.build_program_from_files(std::vector<std::string>{ "shader/points.vs", "shader/points.fs" })) {
+    return false;
+  }
+
   prog_.use();
   prog_.print_active_attribs();
   prog_.print_active_uniforms();
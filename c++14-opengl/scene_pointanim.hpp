@@ -1,18 +1,24 @@
 #ifndef INCLUDED_SCENE_POINTANIM_HPP
 #define INCLUDED_SCENE_POINTANIM_HPP
 
+#include <memory>
+#include <string>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
 #include "program.hpp"
 #include "clock.hpp"
 #include "globject.hpp"
+#include "pointcloud.hpp"
 
 class ScenePointAnim
 {
 private:
   nekolib::renderer::Program prog_;
+  nekolib::renderer::Program procedural_prog_; // 頂点バッファ無し版
+  nekolib::renderer::Program cloud_prog_; // 点群ファイル表示用
   nekolib::renderer::gl::Vao vao_;
+  nekolib::renderer::gl::Vao empty_vao_; // 頂点バッファ無しの描画用(core profileではVAOが必須)
   nekolib::renderer::gl::VertexBuffer buffer_;
 
   nekolib::clock::Clock cur_;
@@ -28,12 +34,24 @@ private:
   
   bool imgui_;
 
+  // 位置を頂点シェーダー内でgl_VertexIDから作るモード
+  // 頂点バッファもCPUからの転送も無いので点の数はラスタライズ性能だけで決まる
+  bool procedural_ = true;
+  int procedural_points_ = 10000000;
+  unsigned seed_ = 0;
+
+  // 点群ファイル(指定時のみ, 読みながら表示)
+  const std::string cloud_path_;
+  std::unique_ptr<nekolib::renderer::PointCloud> cloud_;
+
   bool compile_and_link_shaders();
   void update_rotation(int, int);
   void disseminate(size_t);
 public:
-  ScenePointAnim() : rot_(1.f, 0.f, 0.f, 0.f), orig_(1.f, 0.f, 0.f, 0.f),
-		     drag_start_x_(0), drag_start_y_(0), imgui_(false) {}
+  ScenePointAnim(const char* cloud_path = nullptr)
+    : rot_(1.f, 0.f, 0.f, 0.f), orig_(1.f, 0.f, 0.f, 0.f),
+      drag_start_x_(0), drag_start_y_(0), imgui_(false),
+      cloud_path_(cloud_path ? cloud_path : "") {}
   ~ScenePointAnim() = default;
 
   bool init();
@@ -0,0 +1,218 @@
+#include <cstdio>
+#include <vector>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "imgui/imgui.h"
+
+#include "scene_rope.hpp"
+#include "defines.hpp"
+#include "input.hpp"
+#include "renderer.hpp"
+#include "utils.hpp"
+
+using glm::vec2;
+using glm::vec4;
+
+using namespace nekolib::renderer;
+
+// GeForce GT 640だとpoint_numが100000でも滑らかに動く模様
+// (重力小さくなり過ぎるけど)
+SceneRope::SceneRope(RopeIntegrator integrator, unsigned point_num)
+  : integrator_(integrator),
+    params_{ point_num, 1.f / 60, 1.f, 250.f, 25.f },
+    imgui_(false) {}
+SceneRope::~SceneRope() {}
+
+// 積分法を切り替えて紐を作り直す
+// 失敗した時は今の紐をそのまま使う
+bool SceneRope::create_rope(RopeIntegrator integrator)
+{
+  std::unique_ptr<Rope> rope = nekolib::renderer::create_rope(integrator, params_);
+  if (!rope || !rope->init()) {
+    fprintf(stderr, "Creating rope (%s) failed.\n", rope_integrator_name(integrator));
+    return false;
+  }
+
+  // 前の紐の節点番号で届くpick結果は捨てる
+  if (picker_.pending()) {
+    picker_.cancel();
+  }
+  pick_purpose_ = PickPurpose::NONE;
+  hit_ = -1;
+
+  rope_ = std::move(rope);
+  integrator_ = integrator;
+  return true;
+}
+
+bool SceneRope::init()
+{
+  if (!compile_and_link_shaders()) {
+    return false;
+  }
+
+  if (!picker_.init()) {
+    return false;
+  }
+
+  // 節点+折れ線
+  if (!create_rope(integrator_)) {
+    return false;
+  }
+
+  for (Program* prog : { &point_prog_, &compact_point_prog_ }) {
+    prog->use();
+    prog->set_uniform("color_move", vec4(1.f, 0.f, 0.f, 1.f));
+    prog->set_uniform("color_fix", vec4(0.f, 0.f, 1.f, 1.f));
+  }
+
+  glPointSize(point_size_);
+
+  fprintf(stdout, "\nIntegrator: %s\n", rope_integrator_name(integrator_));
+  fprintf(stdout, "You can drag a point with left mouse button.\n");
+  fprintf(stdout, "Red points moves auto after dragging under force's influence.\n");
+  fprintf(stdout, "Blue points are fixed to that position after dragging.\n");
+  fprintf(stdout, "Click a point with right mouse button to switch red/blue.\n");
+  fprintf(stdout, "Press 'd' key to show config dialog.\n");
+
+  return true;
+}
+
+void SceneRope::update()
+{
+  using namespace nekolib::input;
+  Mouse m = nekolib::input::Manager::instance().mouse();
+  Keyboard kb = nekolib::input::Manager::instance().keyboard();
+
+  // imgui表示中は入力は全てそちらへ
+  // 'D'キー押し下げで切り替え
+  if (imgui_) {
+    if (kb.triggered(SDLK_d)) {
+      imgui_ = false;
+    }
+    return;
+  } else {
+    if (kb.triggered(SDLK_d)) {
+      imgui_ = true;
+      return;
+    }
+  }
+
+  int cx = nekolib::renderer::ScreenManager::width() / 2;
+  int cy = nekolib::renderer::ScreenManager::height() / 2;
+  float cx_inv = 1.f / cx;
+  float cy_inv = 1.f / cy;
+  float fx = static_cast<float>(m.x() - cx) * cx_inv;
+  float fy = static_cast<float>(cy - m.y()) * cy_inv;
+
+  // 前フレームまでに要求したpickの結果を受け取る
+  int picked;
+  if (picker_.poll(&picked)) {
+    if (pick_purpose_ == PickPurpose::DRAG) {
+      hit_ = picked;
+    } else if (pick_purpose_ == PickPurpose::FIX && picked >= 0) {
+      rope_->trigger_fix(picked);
+    }
+    pick_purpose_ = PickPurpose::NONE;
+  }
+
+  if (m.triggered(Mouse::Button::LEFT)) {
+    request_pick(PickPurpose::DRAG, fx, fy);
+  } else if (m.pushed(Mouse::Button::LEFT)) { // 左ドラッグ中
+    if (hit_ >= 0) {
+      rope_->move(hit_, fx, fy, true);
+    }
+  } else {
+    if (hit_ >= 0) { // 左ドラッグ終了
+      // 画鋲で止めてある節点は力の影響を受けない
+      rope_->move(hit_, fx, fy, rope_->is_fix(hit_));
+      hit_ = -1;
+    }
+  }
+
+  if (m.triggered(Mouse::Button::RIGHT)) {
+    request_pick(PickPurpose::FIX, fx, fy);
+  }
+
+  // 力の影響を計算して位置と速度を更新
+  rope_->step();
+}
+
+// 節点のpickを要求する
+// 結果は次フレーム以降のupdate()で受け取る
+void SceneRope::request_pick(PickPurpose purpose, float x, float y)
+{
+  if (picker_.pending()) { // 前の要求が未完了なら捨てる
+    picker_.cancel();
+  }
+  pick_purpose_ = purpose;
+  picker_.request(rope_->handle(), rope_->point_num(), rope_->stride(),
+		  vec2(x, y), point_size_ * 0.5f);
+}
+
+void SceneRope::render()
+{
+  glClearBufferfv(GL_COLOR, 0, &clear_color_.x);
+
+  if (imgui_) {
+    ImGui::SetNextWindowPos(ImVec2(100, 100), ImGuiCond_Once);
+    ImGui::Begin("config", &imgui_, IMGUI_SIMPLE_DIALOG_FLAGS);
+
+    RopeIntegrator selected = integrator_;
+    if (ImGui::BeginCombo("integrator", rope_integrator_name(selected))) {
+      for (RopeIntegrator i : rope_integrators) {
+	if (ImGui::Selectable(rope_integrator_name(i), i == selected)) {
+	  selected = i;
+	}
+      }
+      ImGui::EndCombo();
+    }
+    if (selected != integrator_) {
+      create_rope(selected);
+    }
+
+    bool changed = ImGui::SliderFloat("k", &params_.k, 10.f, 1000.f);
+    changed |= ImGui::SliderFloat("c", &params_.c, 0.f, 100.f);
+    if (changed) {
+      rope_->set_params(params_);
+    }
+
+    if (ImGui::Button("Reset")) {
+      rope_->reset();
+    }
+    ImGui::End();
+  }
+
+  line_prog_.use();
+  rope_->render(GL_LINE_STRIP);
+  (rope_->compact() ? compact_point_prog_ : point_prog_).use();
+  rope_->render(GL_POINTS);
+
+  check_gl_error(__FILE__, __LINE__);
+}
+
+bool SceneRope::compile_and_link_shaders()
+{
+  using Names = std::vector<std::string>;
+
+  // 描画用
+  if (!point_prog_.build_program_from_files(Names{ "shader/gomu2.vs", "shader/gomu2.fs" })) {
+    return false;
+  }
+  compact_point_prog_.define("COMPACT_POINTS");
+  if (!compact_point_prog_.build_program_from_files(Names{ "shader/gomu2.vs", "shader/gomu2.fs" })) {
+    return false;
+  }
+  // 線は位置しか使わないので圧縮形式でも共通
+  if (!line_prog_.build_program_from_files(Names{ "shader/gomu2_line.vs", "shader/gomu2_line.fs" })) {
+    return false;
+  }
+
+  point_prog_.use();
+  point_prog_.print_active_attribs();
+  point_prog_.print_active_uniforms();
+
+  return true;
+}
@@ -0,0 +1,47 @@
+#ifndef INCLUDED_SCENE_ROPE_HPP
+#define INCLUDED_SCENE_ROPE_HPP
+
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "program.hpp"
+#include "picker.hpp"
+#include "rope.hpp"
+
+// ゴム紐シミュレーション
+// 積分法(gomu, gomu2, gomu3, gomu4の違い)は実行中にダイアログから切り替え可能
+class SceneRope
+{
+private:
+  nekolib::renderer::Program point_prog_; // 描画用シェーダー(点)
+  nekolib::renderer::Program compact_point_prog_; // 同上(圧縮形式の節点用)
+  nekolib::renderer::Program line_prog_; // 描画用シェーダー(線)
+
+  std::unique_ptr<nekolib::renderer::Rope> rope_;
+  nekolib::renderer::RopeIntegrator integrator_;
+  nekolib::renderer::RopeParams params_;
+
+  // 節点のpick(結果は1フレーム以上遅れて届く)
+  enum class PickPurpose { NONE, DRAG, FIX };
+  nekolib::renderer::NodePicker picker_;
+  PickPurpose pick_purpose_ = PickPurpose::NONE;
+  int hit_ = -1; // ドラッグ中の節点
+
+  const float point_size_ = 10.f;
+  glm::vec4 clear_color_ = glm::vec4(1.f, 1.f, 1.f, 1.f);
+
+  bool imgui_ = false;
+
+  bool compile_and_link_shaders();
+  bool create_rope(nekolib::renderer::RopeIntegrator);
+  void request_pick(PickPurpose, float, float);
+public:
+  SceneRope(nekolib::renderer::RopeIntegrator, unsigned point_num = 100);
+  ~SceneRope();
+
+  bool init();
+  void update();
+  void render();
+};
+
+#endif // INCLUDED_SCENE_ROPE_HPP
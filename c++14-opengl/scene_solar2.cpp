@@ -12,6 +12,8 @@
 
 #include "scene_solar2.hpp"
 #include "uniformbuffer.hpp"
+#include "gpuprim.hpp"
+#include "readback.hpp"
 #include "defines.hpp"
 #include "input.hpp"
 #include "renderer.hpp"
@@ -28,13 +30,14 @@ using namespace nekolib::renderer;
 // 質点の状態(VBO用)
 struct Point {
   alignas(4) float mass; // 質量
+  alignas(4) uint id; // 初期状態での番号(Morton順に並べ替えても太陽(0)を見つける為)
   alignas(16) vec3 position; // 位置
   alignas(16) vec3 velocity; // 速度
   alignas(16) vec3 position_temp; // 計算途中の値
   alignas(16) vec3 velocity_temp; // 計算途中の値
 
-  Point(float m, vec3 p, vec3 v)
-    : mass(m), position(p), velocity(v), position_temp(p), velocity_temp(v){}
+  Point(float m, vec3 p, vec3 v, uint i)
+    : mass(m), id(i), position(p), velocity(v), position_temp(p), velocity_temp(v){}
 };
 
 // 物理パラメーター(UBO用)
@@ -51,7 +54,7 @@ class PointsBuffer
 {
 public:
   PointsBuffer(const Points&, const PhysicParams*,
-	       Program&, Program&);
+	       Program&, Program&, Program&, Program&);
   ~PointsBuffer() = default;
 
   PointsBuffer(const PointsBuffer&) = delete;
@@ -60,11 +63,14 @@ public:
   PointsBuffer(PointsBuffer&&) = delete;
   PointsBuffer& operator=(PointsBuffer&&) = delete;
 
+  bool init() { return reduce_.init() && sort_.init(); }
   void render_points() const;
   void update();
-  void get_info(vec3*, vec3*, vec3*, float*) const;
+  void get_info(vec3*, vec3*, vec3*, float*, bool wait = false);
 
   void reset();
+
+  unsigned reorder_interval = 256; // 何ステップ毎にMorton順に並べ替えるか(0なら並べ替えない)
 private:
   vec3 calc_momentum(const Point*) const noexcept;
   float calc_T(const Point*) const noexcept;
@@ -91,18 +97,55 @@ private:
   // SSBO経由でvbo_(のGPU側にあるデータ)を書き換える
   Program& vver_init_prog_;
   Program& vver_prog_;
+
+  // 運動量とエネルギーの集計
+  // 質点毎の項を計算シェーダーで求めてGPU上で総和を取り, 結果だけを非同期に読み戻す
+  // info_ = { (運動量, エネルギー), 太陽の位置, 太陽の速度 }
+  Program& info_prog_;
+  GpuReduce<vec4> reduce_;
+  gl::Buffer terms_; // 質点毎の項
+  gl::Buffer info_;
+  AsyncReadback readback_;
+  vec4 info_cache_[3]; // 最後に読み戻した値
+
+  void request_info();
+
+  // Morton順の並べ替え
+  Program& reorder_prog_;
+  GpuRadixSort sort_;
+  gl::Buffer keys_;
+  gl::Buffer values_; // 質点番号
+  unsigned steps_; // 前回並べ替えてからのステップ数
+
+  void reorder();
 };
 
 PointsBuffer::PointsBuffer(const Points& points, const PhysicParams* physic_params,
-			   Program& vver_init, Program& vver)
+			   Program& vver_init, Program& vver, Program& info, Program& reorder)
   : ubo_(physic_params), current_(0),
     init_data_(points), physic_params_(*physic_params),
     init_energy_(calc_U(&points[0]) + calc_T(&points[0])),
     init_momentum_(calc_momentum(&points[0])),
-    vver_init_prog_(vver_init), vver_prog_(vver)
+    vver_init_prog_(vver_init), vver_prog_(vver),
+    info_prog_(info), reduce_(physic_params->point_num), readback_(sizeof(info_cache_)),
+    reorder_prog_(reorder), sort_(physic_params->point_num), steps_(0)
 {
   assert(points.size() == physic_params_.point_num);
 
+  terms_.bind(GL_SHADER_STORAGE_BUFFER);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, physic_params_.point_num * sizeof(vec4), nullptr, GL_DYNAMIC_COPY);
+  info_.bind(GL_SHADER_STORAGE_BUFFER);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(info_cache_), nullptr, GL_DYNAMIC_COPY);
+  for (auto b : { &keys_, &values_ }) {
+    b->bind(GL_SHADER_STORAGE_BUFFER);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, physic_params_.point_num * sizeof(GLuint), nullptr, GL_DYNAMIC_COPY);
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  info_cache_[0] = vec4(init_momentum_, init_energy_);
+  info_cache_[1] = vec4(points[0].position, 1.f);
+  info_cache_[2] = vec4(points[0].velocity, 0.f);
+
   for (size_t i = 0; i < buffer_num_; ++i) {
     vbo_[i].bind();
     glBufferData(GL_ARRAY_BUFFER, physic_params_.point_num * sizeof(Point), &points[0], GL_DYNAMIC_DRAW);
@@ -179,18 +222,36 @@ float PointsBuffer::calc_T(const Point* p) const noexcept
   return ans;
 }
 
-// 太陽の位置と系全体の運動量及びエネルギーを取得する
-void PointsBuffer::get_info(vec3* sun_pos, vec3* sun_vel, vec3* m, float* e) const
+// 現在のvbo_[current_]から運動量とエネルギー等を集計してPBOへコピーする要求を出す
+void PointsBuffer::request_info()
 {
-  vbo_[current_].bind();
-  auto pmapped = static_cast<const Point*>(glMapBuffer(GL_ARRAY_BUFFER, GL_READ_ONLY));
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vbo_[current_].handle());
+  terms_.bind_base(GL_SHADER_STORAGE_BUFFER, 1);
+  info_.bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+
+  info_prog_.use();
+  info_prog_.set_uniform_block("PhysicParams", 0);
+  glDispatchCompute((physic_params_.point_num + 63) / 64, 1, 1);
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
-  auto M = calc_momentum(pmapped);
-  auto U = calc_U(pmapped); auto T = calc_T(pmapped);
-  *m = M - init_momentum_; *e = U + T - init_energy_;
-  *sun_pos = pmapped[0].position; *sun_vel = pmapped[0].velocity;
+  reduce_.reduce(terms_.handle(), physic_params_.point_num, info_.handle(), 0);
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
 
-  glUnmapBuffer(GL_ARRAY_BUFFER);
+  readback_.copy_buffer(info_.handle(), 0, sizeof(info_cache_));
+  check_gl_error(__FILE__, __LINE__);
+}
+
+// 太陽の位置と系全体の運動量及びエネルギーを取得する
+// 値は数フレーム前のもの(wait = trueなら最新の値が揃うまで待つ)
+void PointsBuffer::get_info(vec3* sun_pos, vec3* sun_vel, vec3* m, float* e, bool wait)
+{
+  if (!readback_.pending()) {
+    request_info();
+  }
+  readback_.poll(info_cache_, wait);
+
+  *m = vec3(info_cache_[0]) - init_momentum_; *e = info_cache_[0].w - init_energy_;
+  *sun_pos = vec3(info_cache_[1]); *sun_vel = vec3(info_cache_[2]);
 }
 
 void PointsBuffer::render_points() const
@@ -216,6 +277,55 @@ void PointsBuffer::update()
 
   // バッファ交代  
   current_ = (current_ + 1) % buffer_num_;
+
+  if (reorder_interval > 0 && ++steps_ >= reorder_interval) {
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    reorder();
+    steps_ = 0;
+  }
+}
+
+// 質点をMorton順に並べ直す
+// 近くの質点がメモリ上でも近くなる(太陽はidで探す)
+// vver系のシェーダーは質量とidを書かないので並べ替えた結果を両方のvbo_へ置く
+void PointsBuffer::reorder()
+{
+  const size_t next = (current_ + 1) % buffer_num_;
+  const GLuint groups = (physic_params_.point_num + 63) / 64;
+  // 太陽の位置は数フレーム前のもので十分
+  const vec3 center(info_cache_[1]);
+
+  auto bind = [&]() {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, vbo_[current_].handle());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vbo_[next].handle());
+    keys_.bind_base(GL_SHADER_STORAGE_BUFFER, 2);
+    values_.bind_base(GL_SHADER_STORAGE_BUFFER, 3);
+    reorder_prog_.use();
+    reorder_prog_.set_uniform_block("PhysicParams", 0);
+    reorder_prog_.set_uniform("bounds_min", center - vec3(2.f));
+    reorder_prog_.set_uniform("bounds_max", center + vec3(2.f));
+  };
+
+  bind();
+  reorder_prog_.set_uniform("stage", 0u);
+  glDispatchCompute(groups, 1, 1);
+  glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+  sort_.sort(keys_.handle(), values_.handle(), physic_params_.point_num);
+
+  // 並べ替えで結合ポイントが変わっているので結び直す
+  bind();
+  reorder_prog_.set_uniform("stage", 1u);
+  glDispatchCompute(groups, 1, 1);
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+  glBindBuffer(GL_COPY_READ_BUFFER, vbo_[next].handle());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, vbo_[current_].handle());
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, physic_params_.point_num * sizeof(Point));
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  check_gl_error(__FILE__, __LINE__);
 }
 
 // 質点を初期状態に戻す
@@ -228,6 +338,9 @@ void PointsBuffer::reset()
   }
 
   current_ = 0;
+  steps_ = 0;
+  // 初期化前の値を読み戻し中なら捨てる
+  readback_.cancel();
   
   init_vver();
 
@@ -391,7 +504,7 @@ Points SceneSolar2::generate_init_data(size_t point_num,
   // 太陽の初速(表示上の都合で0にしたくない)
   const vec3 sun_vel(0.f, 0.f, 1.f);
   // 最初の点データは固定値
-  ans.emplace_back(3000.0, vec3(0.f, 0.f, 0.f), sun_vel);
+  ans.emplace_back(3000.0, vec3(0.f, 0.f, 0.f), sun_vel, 0);
 
   std::random_device rd;
   std::mt19937 mt(rd());
@@ -423,7 +536,7 @@ Points SceneSolar2::generate_init_data(size_t point_num,
     vec3 vel = r * glm::normalize(glm::cross(pos, vec3(0.f, 0.f, 1.f)));
 
     // 初速には太陽の初速分を加算しておく
-    ans.emplace_back(mass, pos, sun_vel + vel);
+    ans.emplace_back(mass, pos, sun_vel + vel, static_cast<uint>(ans.size()));
   }
 
   return ans;
@@ -497,7 +610,11 @@ bool SceneSolar2::init()
     };
   
   points_buffer_ = std::make_unique<PointsBuffer>(init_data, &physic_param,
-						  vver_init_prog_, vver_prog_);
+						  vver_init_prog_, vver_prog_, info_prog_,
+						  reorder_prog_);
+  if (!points_buffer_->init()) {
+    return false;
+  }
 
 
   fprintf(stdout, "Press 'l' key to show/erase locus.\n");
@@ -602,7 +719,7 @@ void SceneSolar2::render()
       points_buffer_->reset();
       glClear(GL_COLOR_BUFFER_BIT);
       // 太陽位置を再取得
-      points_buffer_->get_info(&sun_pos, &sun_vel, &momentum, &en);
+      points_buffer_->get_info(&sun_pos, &sun_vel, &momentum, &en, true);
       camera_.set_target(sun_pos);   // カメラに太陽を追尾させる
     }
     ImGui::End();
@@ -655,6 +772,12 @@ bool SceneSolar2::compile_and_link_shaders()
   if (!vver_prog_.build_program_from_files(Names{ "shader/solar2_vver.cs" })) {
     return false;
   }
+  if (!info_prog_.build_program_from_files(Names{ "shader/solar2_info.cs" })) {
+    return false;
+  }
+  if (!reorder_prog_.build_program_from_files(Names{ "shader/solar2_reorder.cs" })) {
+    return false;
+  }
 
   points_prog_.use();
   points_prog_.print_active_attribs();
@@ -68,6 +68,10 @@ private:
   // Velocity Verlet法
   nekolib::renderer::Program vver_init_prog_;
   nekolib::renderer::Program vver_prog_;
+  // 運動量とエネルギーの集計
+  nekolib::renderer::Program info_prog_;
+  // Morton順の並べ替え
+  nekolib::renderer::Program reorder_prog_;
   
   // 座標軸描画
   nekolib::renderer::gl::Vao axis_vao_;
@@ -0,0 +1,24 @@
+#version 430 core
+layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+// bilateral gridをaxis(0 : x, 1 : y, 2 : 輝度)方向に[1 4 6 4 1] / 16でぼかす
+// 格子の外は0(imageLoadの範囲外は0)
+
+layout(binding = 0, rgba32f) uniform readonly image3D Source;
+layout(binding = 1, rgba32f) uniform writeonly image3D Result;
+
+uniform int axis;
+
+void main()
+{
+  const ivec3 p = ivec3(gl_GlobalInvocationID);
+  if (any(greaterThanEqual(p, imageSize(Source)))) {
+    return;
+  }
+  const ivec3 d = ivec3(axis == 0, axis == 1, axis == 2);
+
+  vec4 s = 6.0 * imageLoad(Source, p);
+  s += 4.0 * (imageLoad(Source, p - d) + imageLoad(Source, p + d));
+  s += imageLoad(Source, p - 2 * d) + imageLoad(Source, p + 2 * d);
+  imageStore(Result, p, s / 16.0);
+}
@@ -0,0 +1,28 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// ぼかしたbilateral gridを各画素の(位置, 輝度)で3次元線形補間して重みで割る
+// 格子の(i, j, k)にはbilateral_splat.csで位置[i, i + 1) * sigma_s, 輝度k * sigma_rの画素が
+// 集まっているので, texelの中心(+ 0.5)がそれぞれに対応する
+
+layout(binding = 0, rgba8) uniform readonly image2D SourceImage;
+layout(binding = 1, rgba8) uniform writeonly image2D ResultImage;
+layout(binding = 0) uniform sampler3D Grid;
+
+uniform int sigma_s;
+uniform float sigma_r;
+
+const vec3 lumRGB = vec3(0.3086, 0.6094, 0.0820); // bilateral_splat.csと同じ
+
+void main()
+{
+  const ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(pos, imageSize(SourceImage)))) {
+    return;
+  }
+
+  const vec3 c = imageLoad(SourceImage, pos).rgb;
+  const vec3 g = vec3((vec2(pos) + 0.5) / float(sigma_s), dot(c, lumRGB) / sigma_r + 0.5);
+  const vec4 v = texture(Grid, g / vec3(textureSize(Grid, 0)));
+  imageStore(ResultImage, pos, vec4((v.a > 1e-6) ? v.rgb / v.a : c, 1.0));
+}
@@ -0,0 +1,62 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// bilateral gridの作成
+// 格子の1列(gx, gy)を1 workgroupで受け持ち, sigma_s四方の画素を64個ずつ共有メモリに読んで
+// 輝度/sigma_rの位置の前後2個のbinと重みを置く. 各スレッドは自分のbin 1個について
+// 置かれた64個分を足していく(足し込み先がスレッド毎に別なのでatomicは不要)
+
+#define MAX_BINS 64 // local_size_x
+
+layout(binding = 0, rgba8) uniform readonly image2D SourceImage;
+layout(binding = 1, rgba32f) uniform writeonly image3D Grid;
+
+uniform int sigma_s;
+uniform float sigma_r;
+
+const vec3 lumRGB = vec3(0.3086, 0.6094, 0.0820); // scene_colormatrix.cppのlumRGB
+
+shared vec4 color[MAX_BINS]; // (rgb, 1)
+shared int bin[MAX_BINS]; // 前のbin(画素がなければ-2)
+shared float frac[MAX_BINS]; // 後ろのbinへの重み
+
+void main()
+{
+  const ivec3 grid_size = imageSize(Grid);
+  const ivec2 g = ivec2(gl_WorkGroupID.xy);
+  const int bins = grid_size.z;
+  const int t = int(gl_LocalInvocationID.x);
+
+  const ivec2 p0 = g * sigma_s;
+  const ivec2 extent = min(p0 + sigma_s, imageSize(SourceImage)) - p0;
+  const int n = extent.x * extent.y;
+
+  vec4 acc = vec4(0.0);
+  for (int i0 = 0; i0 < n; i0 += MAX_BINS) {
+    const int i = i0 + t;
+    if (i < n) {
+      const vec3 c = imageLoad(SourceImage, p0 + ivec2(i % extent.x, i / extent.x)).rgb;
+      const float z = dot(c, lumRGB) / sigma_r;
+      const int z0 = min(int(z), bins - 2);
+      color[t] = vec4(c, 1.0);
+      bin[t] = z0;
+      frac[t] = z - float(z0);
+    } else {
+      bin[t] = -2;
+    }
+    barrier();
+    for (int j = 0; j < MAX_BINS; ++j) {
+      const int z0 = bin[j];
+      if (z0 == t) {
+	acc += (1.0 - frac[j]) * color[j];
+      } else if (z0 + 1 == t) {
+	acc += frac[j] * color[j];
+      }
+    }
+    barrier();
+  }
+
+  if (t < bins) {
+    imageStore(Grid, ivec3(g, t), acc);
+  }
+}
@@ -0,0 +1,30 @@
+#version 430 core
+layout (local_size_x = 1) in;
+
+// Canny(canny.hpp)のhysteresisの繰り返しの制御(1スレッド)
+// 直前のパスで変化があれば次のパスのworkgroup数を設定し, 無ければ0にする
+// (glDispatchComputeIndirectで読むのでCPUへ読み戻さずに収束後のパスが空になる)
+
+layout(std430, binding = 0) buffer State
+{
+  uint changed; // canny_hysteresis.csが立てる
+  uint passes; // 実際に計算したパス数
+  uint num_groups[3]; // glDispatchComputeIndirectの引数
+};
+
+uniform uint groups_x;
+uniform uint groups_y;
+
+void main()
+{
+  if (changed != 0u) {
+    num_groups[0] = groups_x;
+    num_groups[1] = groups_y;
+    ++passes;
+  } else {
+    num_groups[0] = 0u;
+    num_groups[1] = 0u;
+  }
+  num_groups[2] = 1u;
+  changed = 0u;
+}
@@ -0,0 +1,38 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// Canny(canny.hpp)の勾配
+// ぼかした画像の輝度にSobel(3x3)をかけて(大きさ, 向き)をRG16Fへ
+// 大きさは明るさ0 -> 1の段差で1になるように1 / 4倍, 向きはatan(gy, gx)(-pi - pi)
+// 画像の端は延長
+
+layout(binding = 0, rgba8) uniform readonly image2D SourceImage;
+layout(binding = 1, rg16f) uniform writeonly image2D Gradient;
+
+const vec3 lum = vec3(0.299, 0.587, 0.114);
+
+ivec2 size;
+
+float luminance(ivec2 p)
+{
+  return dot(imageLoad(SourceImage, clamp(p, ivec2(0), size - 1)).rgb, lum);
+}
+
+void main()
+{
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  size = imageSize(SourceImage);
+  if (any(greaterThanEqual(p, size))) {
+    return;
+  }
+
+  float v[9];
+  for (int j = 0; j < 3; ++j) {
+    for (int i = 0; i < 3; ++i) {
+      v[j * 3 + i] = luminance(p + ivec2(i - 1, j - 1));
+    }
+  }
+  const float gx = (v[2] + 2.0 * v[5] + v[8]) - (v[0] + 2.0 * v[3] + v[6]);
+  const float gy = (v[6] + 2.0 * v[7] + v[8]) - (v[0] + 2.0 * v[1] + v[2]);
+  imageStore(Gradient, p, vec4(0.25 * length(vec2(gx, gy)), atan(gy, gx), 0.0, 0.0));
+}
@@ -0,0 +1,71 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// Canny(canny.hpp)のhysteresis 1パス
+// 強いエッジ(2)に8近傍でつながる弱いエッジ(1)を強いエッジにする
+// 16x16のタイルと周囲1画素を共有メモリに読み, タイル内では変化が無くなるまで繰り返すので
+// 1パスでタイル内の連結はつながり切る. 他のタイルへは次のパスで伝わる
+// 1画素でも変えたらchangedを立てる(canny_control.csが見て次のパスを決める)
+// Labelsはその場で書き換える(値は1 -> 2にしか変わらないので隣のタイルと競合しても
+// 伝わるのが次のパスに遅れるだけで, 変化の無いパスでは全ての読みが最新)
+
+layout(binding = 0, r32ui) uniform coherent uimage2D Labels;
+
+layout(std430, binding = 0) buffer State
+{
+  uint changed;
+  uint passes;
+  uint num_groups[3];
+};
+
+const int TILE = 16;
+shared uint tile[TILE + 2][TILE + 2];
+shared bool local_changed;
+
+void main()
+{
+  const ivec2 size = imageSize(Labels);
+  const ivec2 base = ivec2(gl_WorkGroupID.xy) * TILE - 1;
+  const ivec2 l = ivec2(gl_LocalInvocationID.xy);
+
+  // 周囲1画素を含めて読む(画像の外は0)
+  for (int y = l.y; y < TILE + 2; y += TILE) {
+    for (int x = l.x; x < TILE + 2; x += TILE) {
+      const ivec2 q = base + ivec2(x, y);
+      tile[y][x] = (all(greaterThanEqual(q, ivec2(0))) && all(lessThan(q, size))) ? imageLoad(Labels, q).r : 0u;
+    }
+  }
+  barrier();
+
+  const ivec2 t = l + 1;
+  bool promoted = false;
+  for (;;) {
+    if (l == ivec2(0)) {
+      local_changed = false;
+    }
+    barrier();
+    if (tile[t.y][t.x] == 1u) {
+      bool strong = false;
+      for (int dy = -1; dy <= 1; ++dy) {
+	for (int dx = -1; dx <= 1; ++dx) {
+	  strong = strong || (tile[t.y + dy][t.x + dx] == 2u);
+	}
+      }
+      if (strong) {
+	tile[t.y][t.x] = 2u;
+	promoted = true;
+	local_changed = true;
+      }
+    }
+    barrier();
+    if (!local_changed) {
+      break;
+    }
+    barrier();
+  }
+
+  if (promoted) {
+    imageStore(Labels, base + t, uvec4(2u));
+    atomicOr(changed, 1u);
+  }
+}
@@ -0,0 +1,38 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// Canny(canny.hpp)の細線化(non-maximum suppression)と2つの閾値による分類
+// 勾配の向きを45度刻みに丸め, その向きの前後2画素より大きくなければ捨てる
+// 残った画素を大きさで 2 : high以上(強いエッジ), 1 : low以上(弱いエッジ), 0 に分ける
+
+layout(binding = 0, rg16f) uniform readonly image2D Gradient;
+layout(binding = 1, r32ui) uniform writeonly uimage2D Labels;
+
+uniform float low;
+uniform float high;
+
+const float PI = 3.14159265358979;
+
+void main()
+{
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  const ivec2 size = imageSize(Gradient);
+  if (any(greaterThanEqual(p, size))) {
+    return;
+  }
+
+  const vec2 g = imageLoad(Gradient, p).rg;
+  // 向き(前後どちらでも同じ)を0, 45, 90, 135度の4通りに
+  const int sector = int(floor(g.y / (PI / 4.0) + 0.5)) & 3;
+  const ivec2 offsets[4] = ivec2[](ivec2(1, 0), ivec2(1, 1), ivec2(0, 1), ivec2(-1, 1));
+  const ivec2 d = offsets[sector];
+  const float a = imageLoad(Gradient, clamp(p + d, ivec2(0), size - 1)).r;
+  const float b = imageLoad(Gradient, clamp(p - d, ivec2(0), size - 1)).r;
+
+  uint label = 0u;
+  // 平らな所で同じ値が並ぶ時は片側だけ残す
+  if (g.x > a && g.x >= b) {
+    label = (g.x >= high) ? 2u : (g.x >= low) ? 1u : 0u;
+  }
+  imageStore(Labels, p, uvec4(label));
+}
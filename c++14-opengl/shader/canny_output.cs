@@ -0,0 +1,17 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// Canny(canny.hpp)の結果 : 強いエッジ(2)を白, 他を黒(alphaは1)
+
+layout(binding = 0, r32ui) uniform readonly uimage2D Labels;
+layout(binding = 1, rgba8) uniform writeonly image2D ResultImage;
+
+void main()
+{
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, imageSize(ResultImage)))) {
+    return;
+  }
+  const float v = (imageLoad(Labels, p).r == 2u) ? 1.0 : 0.0;
+  imageStore(ResultImage, p, vec4(vec3(v), 1.0));
+}
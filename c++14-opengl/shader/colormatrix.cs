@@ -4,7 +4,23 @@ layout (local_size_x = 16, local_size_y = 16) in;
 layout(binding = 0, rgba8) uniform image2D SourceImage;
 layout(binding = 1, rgba8) uniform image2D ResultImage;
 
+#ifdef LUT
+// lut.hppのColorLutが焼いた3D LUT(ColorMatrixの代わりに色変換全体を1回の補間で)
+layout(binding = 0) uniform sampler3D Lut;
+uniform float LutSize;
+#else
 uniform mat4 ColorMatrix;
+#endif
+
+#ifdef AUTO_LEVELS
+// histogram.hppのAutoLevelsが作った行列をColorMatrixより先に掛ける
+layout(std430, binding = 1) buffer Levels
+{
+  mat4 auto_matrix;
+  uvec4 low;
+  uvec4 high;
+};
+#endif
 
 void main()
 {
@@ -14,5 +30,15 @@ void main()
   vec4 org_color = imageLoad(SourceImage, ivec2(u, v));
   float alpha = org_color.w; // alphaは変換対象から外す
 
-  imageStore(ResultImage, ivec2(u, v), vec4((ColorMatrix * vec4(org_color.rgb, 1.f)).rgb, alpha));
+  vec4 color = vec4(org_color.rgb, 1.f);
+#ifdef AUTO_LEVELS
+  color = auto_matrix * color;
+#endif
+#ifdef LUT
+  // 格子点が各texelの中心に来るように[0.5 / n, 1 - 0.5 / n]へ縮める
+  vec3 uvw = clamp(color.rgb, 0.0, 1.0) * ((LutSize - 1.0) / LutSize) + 0.5 / LutSize;
+  imageStore(ResultImage, ivec2(u, v), vec4(texture(Lut, uvw).rgb, alpha));
+#else
+  imageStore(ResultImage, ivec2(u, v), vec4((ColorMatrix * color).rgb, alpha));
+#endif
 }
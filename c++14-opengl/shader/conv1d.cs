@@ -0,0 +1,69 @@
+#version 430 core
+layout (local_size_x = 256, local_size_y = 1) in;
+
+// 1次元の畳み込み(分離可能な係数の2パス用)
+// 行方向(既定) : rgba8 -> rgba16f(倍率は掛けない)
+// 列方向(VERTICAL) : rgba16f -> rgba8(倍率とbiasを掛ける)
+// 256画素 + 両側の半径分を共有メモリに1回だけ読んでから積和を取る
+// 画像の端は端の画素を延長する
+
+const int LINE = 256;
+const int MAX_RADIUS = 64; // convolution.hppのmax_radius_1d_
+
+#ifdef VERTICAL
+layout(binding = 0, rgba16f) uniform readonly image2D SourceImage;
+layout(binding = 1, rgba8) uniform writeonly image2D ResultImage;
+#else
+layout(binding = 0, rgba8) uniform readonly image2D SourceImage;
+layout(binding = 1, rgba16f) uniform writeonly image2D ResultImage;
+#endif
+
+layout(std430, binding = 0) buffer Weights
+{
+  readonly float weights[];
+};
+
+uniform int radius;
+uniform float scale = 1.0;
+uniform float bias = 0.0;
+
+shared vec3 line[LINE + 2 * MAX_RADIUS];
+
+// 処理方向の位置alongと直交方向の位置acrossから画素の位置
+ivec2 pixel(int along, int across)
+{
+#ifdef VERTICAL
+  return ivec2(across, along);
+#else
+  return ivec2(along, across);
+#endif
+}
+
+void main()
+{
+  const ivec2 size = imageSize(SourceImage);
+#ifdef VERTICAL
+  const int len = size.y;
+#else
+  const int len = size.x;
+#endif
+  const int across = int(gl_WorkGroupID.y);
+  const int base = int(gl_WorkGroupID.x) * LINE - radius;
+  const int l = int(gl_LocalInvocationID.x);
+
+  for (int i = l; i < LINE + 2 * radius; i += LINE) {
+    line[i] = imageLoad(SourceImage, pixel(clamp(base + i, 0, len - 1), across)).rgb;
+  }
+  barrier();
+
+  const int p = int(gl_GlobalInvocationID.x);
+  if (p >= len) {
+    return;
+  }
+
+  vec3 a = vec3(0.0);
+  for (int k = 0; k <= 2 * radius; ++k) {
+    a += weights[k] * line[l + k];
+  }
+  imageStore(ResultImage, pixel(p, across), vec4(a * scale + bias, 1.0));
+}
@@ -0,0 +1,65 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// 2次元の畳み込み(係数2個までで2個の時は結果の大きさ)
+// タイル + 周囲(半径分)を共有メモリに1回だけ読んでから積和を取る
+// 画像の端は端の画素を延長する
+
+const int TILE = 16;
+const int MAX_RADIUS = 8; // convolution.hppのmax_radius_2d_
+const int SIZE = TILE + 2 * MAX_RADIUS;
+
+layout(binding = 0, rgba8) uniform readonly image2D SourceImage;
+layout(binding = 1, rgba8) uniform writeonly image2D ResultImage;
+
+// 係数(行優先, 2個目は1個目の直後)
+layout(std430, binding = 0) buffer Weights
+{
+  readonly float weights[];
+};
+
+uniform int radius_x;
+uniform int radius_y;
+uniform int kernel_num;
+uniform float scale;
+uniform float bias;
+
+shared vec3 tile[SIZE][SIZE];
+
+void main()
+{
+  const ivec2 size = imageSize(SourceImage);
+  const ivec2 radius = ivec2(radius_x, radius_y);
+  const ivec2 origin = ivec2(gl_WorkGroupID.xy) * TILE - radius;
+  const ivec2 extent = ivec2(TILE) + 2 * radius;
+  const ivec2 l = ivec2(gl_LocalInvocationID.xy);
+
+  for (int y = l.y; y < extent.y; y += TILE) {
+    for (int x = l.x; x < extent.x; x += TILE) {
+      tile[y][x] = imageLoad(SourceImage, clamp(origin + ivec2(x, y), ivec2(0), size - 1)).rgb;
+    }
+  }
+  barrier();
+
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, size))) {
+    return;
+  }
+
+  const int kw = 2 * radius_x + 1;
+  const int kh = 2 * radius_y + 1;
+  vec3 a = vec3(0.0);
+  vec3 b = vec3(0.0);
+  for (int dy = 0; dy < kh; ++dy) {
+    for (int dx = 0; dx < kw; ++dx) {
+      vec3 c = tile[l.y + dy][l.x + dx];
+      a += weights[dy * kw + dx] * c;
+      if (kernel_num > 1) {
+	b += weights[kw * kh + dy * kw + dx] * c;
+      }
+    }
+  }
+
+  vec3 r = (kernel_num > 1) ? sqrt(a * a + b * b) : a;
+  imageStore(ResultImage, p, vec4(r * scale + bias, 1.0));
+}
@@ -0,0 +1,123 @@
+#version 430 core
+
+// Stockham自動整列FFT(radix 4, 残りの段が2ならradix 2)
+// RGBA32Fの各texelに複素数2個(xy, zw)を持ち, 行(VERTICALなら列)毎に長さnの1次元FFT
+//  SHARED : 1 workgroupが1行(n <= SHARED_MAX)を共有メモリに読み, 全段をその中で計算
+//  なし   : 1回のdispatchで1段(stride, pass_radixはuniform), 行が長い時用
+// 各段は入力のi, i + n / radix, ...を読んで出力の(i - k) * radix + k, ... + stride * mへ書く
+// (k = i % stride)ので並べ替えの段は要らない
+
+#define PI 3.14159265358979
+
+#ifdef SHARED
+#define SHARED_MAX 1024 // fft.hppのFft::shared_max_
+#define THREADS 256
+layout (local_size_x = THREADS) in;
+shared vec4 buf[2][SHARED_MAX];
+int cur = 0;
+#else
+layout (local_size_x = 64) in;
+uniform int stride;
+uniform int pass_radix;
+#endif
+
+layout(binding = 0, rgba32f) uniform readonly image2D Source;
+layout(binding = 1, rgba32f) uniform writeonly image2D Result;
+
+uniform int n; // 変換の長さ(2のべき)
+uniform float direction; // -1 : 順変換, 1 : 逆変換(1 / nは掛けない)
+
+ivec2 coord(int i, int line)
+{
+#ifdef VERTICAL
+  return ivec2(line, i);
+#else
+  return ivec2(i, line);
+#endif
+}
+
+#ifdef SHARED
+vec4 load(int i, int line) { return buf[cur][i]; }
+void store(int i, int line, vec4 v) { buf[1 - cur][i] = v; }
+#else
+vec4 load(int i, int line) { return imageLoad(Source, coord(i, line)); }
+void store(int i, int line, vec4 v) { imageStore(Result, coord(i, line), v); }
+#endif
+
+vec2 cmul(vec2 a, vec2 b)
+{
+  return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+// 2個の複素数それぞれに回転因子exp(i * a)を掛ける
+vec4 twiddle(vec4 v, float a)
+{
+  const vec2 w = vec2(cos(a), sin(a));
+  return vec4(cmul(v.xy, w), cmul(v.zw, w));
+}
+
+// i * direction倍
+vec4 rotate(vec4 v)
+{
+  return direction * vec4(-v.y, v.x, -v.w, v.z);
+}
+
+void butterfly(int i, int line, int p, int radix)
+{
+  const int k = i & (p - 1);
+  const float a = direction * 2.0 * PI * float(k) / float(radix * p);
+  if (radix == 4) {
+    const int q = n / 4;
+    const vec4 u0 = load(i, line);
+    const vec4 u1 = twiddle(load(i + q, line), a);
+    const vec4 u2 = twiddle(load(i + 2 * q, line), 2.0 * a);
+    const vec4 u3 = twiddle(load(i + 3 * q, line), 3.0 * a);
+    const vec4 v0 = u0 + u2;
+    const vec4 v1 = u0 - u2;
+    const vec4 v2 = u1 + u3;
+    const vec4 v3 = rotate(u1 - u3);
+    const int j = (i - k) * 4 + k;
+    store(j, line, v0 + v2);
+    store(j + p, line, v1 + v3);
+    store(j + 2 * p, line, v0 - v2);
+    store(j + 3 * p, line, v1 - v3);
+  } else {
+    const vec4 u0 = load(i, line);
+    const vec4 u1 = twiddle(load(i + n / 2, line), a);
+    const int j = (i - k) * 2 + k;
+    store(j, line, u0 + u1);
+    store(j + p, line, u0 - u1);
+  }
+}
+
+void main()
+{
+#ifdef SHARED
+  const int line = int(gl_WorkGroupID.x);
+  const int t = int(gl_LocalInvocationID.x);
+  for (int i = t; i < n; i += THREADS) {
+    buf[0][i] = imageLoad(Source, coord(i, line));
+  }
+  barrier();
+
+  for (int p = 1; p < n; ) {
+    const int radix = (n / p >= 4) ? 4 : 2;
+    for (int i = t; i < n / radix; i += THREADS) {
+      butterfly(i, line, p, radix);
+    }
+    barrier();
+    cur = 1 - cur;
+    p *= radix;
+  }
+
+  for (int i = t; i < n; i += THREADS) {
+    imageStore(Result, coord(i, line), buf[cur][i]);
+  }
+#else
+  const int i = int(gl_GlobalInvocationID.x);
+  if (i >= n / pass_radix) {
+    return;
+  }
+  butterfly(i, int(gl_GlobalInvocationID.y), stride, pass_radix);
+#endif
+}
@@ -0,0 +1,34 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// FFTによる畳み込みの係数
+// 係数(dx, dy)を(-dx, -dy)(画像の大きさで折り返し)に置く
+// 循環畳み込みが直接計算と同じ sum w(d) * src(p + d) になる
+
+layout(binding = 1, rgba32f) uniform writeonly image2D Result;
+
+layout(std430, binding = 0) buffer Weights
+{
+  readonly float weights[];
+};
+
+uniform int radius_x;
+uniform int radius_y;
+
+void main()
+{
+  const ivec2 size = imageSize(Result);
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, size))) {
+    return;
+  }
+
+  // -pを[-size / 2, size / 2)へ
+  ivec2 d = (size - p) % size;
+  d -= ivec2(greaterThanEqual(d, size / 2)) * size;
+  float w = 0.0;
+  if (abs(d.x) <= radius_x && abs(d.y) <= radius_y) {
+    w = weights[(d.y + radius_y) * (2 * radius_x + 1) + d.x + radius_x];
+  }
+  imageStore(Result, p, vec4(w, 0.0, 0.0, 0.0));
+}
@@ -0,0 +1,26 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// 周波数領域での積(画像の複素数2個それぞれに係数のスペクトルを掛ける)
+// 逆変換の1 / (幅 x 高さ)もここでscaleとして掛ける
+
+layout(binding = 0, rgba32f) uniform image2D Data;
+layout(binding = 1, rgba32f) uniform readonly image2D Spectrum;
+
+uniform float scale;
+
+vec2 cmul(vec2 a, vec2 b)
+{
+  return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+void main()
+{
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, imageSize(Data)))) {
+    return;
+  }
+  const vec4 v = imageLoad(Data, p);
+  const vec2 k = imageLoad(Spectrum, p).xy * scale;
+  imageStore(Data, p, vec4(cmul(v.xy, k), cmul(v.zw, k)));
+}
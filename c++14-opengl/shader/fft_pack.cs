@@ -0,0 +1,24 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// FFTによる畳み込みの入力
+// rgba8の画像を(offset_x, offset_y)へずらして2のべきの大きさのRGBA32Fへ
+// (r + g i, b + 0 i)の複素数2個として詰める(係数は実数なのでr, gを1個にまとめても混ざらない)
+// 周囲は端の画素を延長(Convolutionの直接計算と同じ)
+
+layout(binding = 0, rgba8) uniform readonly image2D SourceImage;
+layout(binding = 1, rgba32f) uniform writeonly image2D Result;
+
+uniform int offset_x;
+uniform int offset_y;
+
+void main()
+{
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, imageSize(Result)))) {
+    return;
+  }
+  const ivec2 size = imageSize(SourceImage);
+  const vec3 c = imageLoad(SourceImage, clamp(p - ivec2(offset_x, offset_y), ivec2(0), size - 1)).rgb;
+  imageStore(Result, p, vec4(c, 0.0));
+}
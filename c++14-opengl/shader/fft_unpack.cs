@@ -0,0 +1,23 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// FFTによる畳み込みの結果を取り出す((offset_x, offset_y)からの範囲, fft_pack.csの逆)
+// 実部と虚部がr, g, 2個目の実部がb
+
+layout(binding = 0, rgba32f) uniform readonly image2D Source;
+layout(binding = 1, rgba8) uniform writeonly image2D ResultImage;
+
+uniform int offset_x;
+uniform int offset_y;
+uniform float scale;
+uniform float bias;
+
+void main()
+{
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, imageSize(ResultImage)))) {
+    return;
+  }
+  const vec3 c = imageLoad(Source, p + ivec2(offset_x, offset_y)).xyz;
+  imageStore(ResultImage, p, vec4(c * scale + bias, 1.0));
+}
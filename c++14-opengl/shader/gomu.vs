@@ -1,13 +0,0 @@
-#version 330 core
-
-layout (location = 0) in vec4 aPos; // 節点位置(xyz) + 固定flag(w)
-
-out VS_OUT {
-  float fix_flag;
-} vs_out;
-
-void main()
-{
-  vs_out.fix_flag = aPos.w;
-  gl_Position = vec4(vec3(aPos), 1.f);
-}
@@ -1,6 +1,12 @@
 #version 330 core
 
+#ifdef COMPACT_POINTS
+// 圧縮形式の節点(rope.cpp参照)
+layout (location = 0) in vec2 aPos; // 節点位置(xy)
+layout (location = 1) in uint aFlags; // 固定flag(ビット0が可動)
+#else
 layout (location = 0) in vec4 aPos; // 節点位置(xyz)+固定flag(w)
+#endif
 
 out block {
   flat float fix_flag;
@@ -9,7 +15,12 @@ out block {
 
 void main()
 {
+#ifdef COMPACT_POINTS
+  vs_out.fix_flag = float(aFlags & 1u);
+  gl_Position = vec4(aPos, 0.f, 1.f);
+#else
   vs_out.fix_flag = aPos.w;
-  vs_out.pick_id = gl_VertexID;
   gl_Position = vec4(vec3(aPos), 1.f);
+#endif
+  vs_out.pick_id = gl_VertexID;
 }
@@ -8,8 +8,6 @@ struct Point
   vec4 velocity;
 };
 
-uniform uint point_num;
-
 // 節点群(更新前)
 layout(std430, binding = 0) buffer ReadPoints
 {
@@ -22,15 +20,18 @@ layout(std430, binding = 1) buffer WritePoints
   writeonly Point write_points[];
 };
 
-const float m = 1.f; // 節点の質量
+layout (std140) uniform PhysicParams
+{
+  uint point_num; // 節点数
+  float dt; // タイムステップ
+  float m; // 節点の質量
+  float k; // ばね定数
+  float c; // ばね減衰係数
+};
+
 float l = 2.f / point_num; // 節点間の自然長
-const float k = 250.f; // ばね定数
-const float c = 30.f; // ばね減衰係数
 vec2 g = vec2(0.f, -9.8f / point_num); // 重力
 
-// タイムステップ
-const float dt = 1.f / 60;
-
 void main()
 {
   // points[0]とpoint[point_num - 1]だけ計算する
@@ -2,6 +2,20 @@
 layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
 
 // 節点
+#ifdef COMPACT_POINTS
+// 圧縮形式 : 平面上なので位置はxyのみ, 固定flagはビット, 速度はfp16
+const uint POINT_MOVABLE = 1u;
+
+struct Point
+{
+  vec2 position; // 位置
+  uint flags; // POINT_MOVABLE
+  uint velocity; // 速度(packHalf2x16)
+  vec2 position_temp; // p(t + h)
+  uint flags_temp;
+  uint velocity_temp; // v(t + h)の途中(packHalf2x16)
+};
+#else
 struct Point
 {
   vec4 position; // 位置
@@ -9,6 +23,7 @@ struct Point
   vec4 position_temp; // p(t + h)
   vec3 velocity_temp; // v(t + h)の途中
 };
+#endif
 
 // 節点群(更新前)
 layout(std430, binding = 0) buffer ReadPoints
@@ -34,39 +49,68 @@ layout (std140) uniform PhysicParams
 float l = 2.f / point_num; // 節点間の自然長
 vec2 g = vec2(0.f, -9.8f / point_num); // 重力
 
-void main()
-{
-  // 頂点データ1番から
-  const uint i = gl_WorkGroupID.x + 1;
+// 節点iの読み出し
+#ifdef COMPACT_POINTS
+vec2 position_temp(uint i) { return current_points[i].position_temp; }
+vec2 velocity_temp(uint i) { return unpackHalf2x16(current_points[i].velocity_temp); }
+float movable(uint i) { return float(current_points[i].flags & POINT_MOVABLE); }
+float movable_temp(uint i) { return float(current_points[i].flags_temp & POINT_MOVABLE); }
+#else
+vec2 position_temp(uint i) { return current_points[i].position_temp.xy; }
+vec2 velocity_temp(uint i) { return current_points[i].velocity_temp.xy; }
+float movable(uint i) { return step(0.5, current_points[i].position.w); }
+float movable_temp(uint i) { return step(0.5, current_points[i].position_temp.w); }
+#endif
 
-  // 位置 p(t + h)
+// 節点iの書き込み
+// 速度v, 位置p(t + 2h), 途中の速度vt (位置 p(t + h)は更新前のposition_tempをそのまま使う)
+void store(uint i, vec2 v, vec2 pt, vec2 vt)
+{
+#ifdef COMPACT_POINTS
   next_points[i].position = current_points[i].position_temp;
-  
-  // 加速度 a(t + h) (v(t + h)の値が不正確だがverlet法では仕方がない)
-  vec2 l1 = current_points[i - 1].position_temp.xy - current_points[i].position_temp.xy;
-  vec2 dv1 = current_points[i].velocity_temp.xy - current_points[i - 1].velocity_temp.xy;
-  vec2 f1 = (length(l1) - l) * k * normalize(l1) - c * dv1;
+  next_points[i].flags = current_points[i].flags_temp;
+  next_points[i].velocity = packHalf2x16(v);
+  next_points[i].position_temp = pt;
+  next_points[i].flags_temp = current_points[i].flags_temp;
+  next_points[i].velocity_temp = packHalf2x16(vt);
+#else
+  next_points[i].position = current_points[i].position_temp;
+  next_points[i].velocity = vec3(v, 0.f);
+  next_points[i].position_temp = vec4(pt, current_points[i].position_temp.zw);
+  next_points[i].velocity_temp = vec3(vt, 0.f);
+#endif
+}
 
-  vec2 l2 = current_points[i + 1].position_temp.xy - current_points[i].position_temp.xy;
-  vec2 dv2 = current_points[i].velocity_temp.xy - current_points[i + 1].velocity_temp.xy;
-  vec2 f2 = (length(l2) - l) * k * normalize(l2) - c * dv2;
+// 節点iが隣の節点jから受ける力
+// 加速度 a(t + h) (v(t + h)の値が不正確だがverlet法では仕方がない)
+vec2 force(uint i, uint j)
+{
+  vec2 d = position_temp(j) - position_temp(i);
+  vec2 dv = velocity_temp(i) - velocity_temp(j);
+  return (length(d) - l) * k * normalize(d) - c * dv;
+}
 
-  vec3 a = vec3((f1 + f2) / m + g, 0.f);
+// 節点iに力fが働いた時の更新
+void update(uint i, vec2 f)
+{
+  vec2 a = f / m + g;
 
   // 速度 v(t + h)
-  vec3 delta = 0.5 * dt * a;
-  vec3 temp = step(0.5, current_points[i].position.w) *
-    (current_points[i].velocity_temp + delta);
-  next_points[i].velocity = temp;
-  
+  vec2 velocity = movable(i) * (velocity_temp(i) + 0.5 * dt * a);
+
   // 位置 p(t + 2h)
-  delta = dt * temp + 0.5 * dt * dt * a;
-  next_points[i].position_temp = current_points[i].position_temp +
-    step(0.5, current_points[i].position_temp.w) * vec4(delta, 0.f);
-  
+  vec2 position = position_temp(i) + movable_temp(i) * (dt * velocity + 0.5 * dt * dt * a);
+
   // 速度 v(t + 2h)は未完成
-  delta = dt * a;
-  next_points[i].velocity_temp = step(0.5, current_points[i].position_temp.w) *
-    (current_points[i].velocity_temp + delta);
+  vec2 velocity2 = movable_temp(i) * (velocity_temp(i) + dt * a);
+
+  store(i, velocity, position, velocity2);
+}
+
+void main()
+{
+  // 頂点データ1番から
+  const uint i = gl_WorkGroupID.x + 1;
 
+  update(i, force(i, i - 1) + force(i, i + 1));
 }
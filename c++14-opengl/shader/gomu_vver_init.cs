@@ -2,6 +2,20 @@
 layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
 
 // 節点
+#ifdef COMPACT_POINTS
+// 圧縮形式 : 平面上なので位置はxyのみ, 固定flagはビット, 速度はfp16
+const uint POINT_MOVABLE = 1u;
+
+struct Point
+{
+  vec2 position; // 位置
+  uint flags; // POINT_MOVABLE
+  uint velocity; // 速度(packHalf2x16)
+  vec2 position_temp; // p(t + h)
+  uint flags_temp;
+  uint velocity_temp; // v(t + h)の途中(packHalf2x16)
+};
+#else
 struct Point
 {
   vec4 position; // 位置
@@ -9,6 +23,7 @@ struct Point
   vec4 position_temp; // p(t + h)
   vec3 velocity_temp; // v(t + h)の途中
 };
+#endif
 
 // 節点群
 layout(std430, binding = 0) buffer ReadWritePoints
@@ -33,6 +48,9 @@ void main()
   // position_tempを正しい初期状態に設定する
   for (uint i = 0; i < point_num; ++i) {
     current_points[i].position_temp = current_points[i].position;
+#ifdef COMPACT_POINTS
+    current_points[i].flags_temp = current_points[i].flags;
+#endif
   }
 
   // velocity_tempを正しい初期状態に設定する
@@ -43,6 +61,11 @@ void main()
   for (uint i = 1; i < point_num - 1; ++i) {
     // このままだと初速に0.5 * dt * gが加算されてしまうので
     // あらかじめ引いた値をvelocity_tempとして設定
+#ifdef COMPACT_POINTS
+    current_points[i].velocity_temp =
+      packHalf2x16(unpackHalf2x16(current_points[i].velocity) - 0.5 * dt * g);
+#else
     current_points[i].velocity_temp = current_points[i].velocity - 0.5 * dt * vec3(g, 0.f);
+#endif
   }
 }
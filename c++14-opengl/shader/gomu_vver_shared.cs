@@ -0,0 +1,168 @@
+#version 430 core
+// 1 workgroupで紐1本を担当する
+// 紐の状態を共有メモリに載せてsubsteps回分velocity verlet法で更新し
+// 最後に1回だけSSBOへ書き戻す(gomu_vver.cs/gomu_vver_end.csをsubsteps回起動するのと同じ結果)
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+const uint MAX_NODES = 1024; // 紐1本の最大節点数
+const uint NODES_PER_INVOCATION = MAX_NODES / gl_WorkGroupSize.x;
+
+// 節点(gomu_vver.csと同じ)
+#ifdef COMPACT_POINTS
+const uint POINT_MOVABLE = 1u;
+
+struct Point
+{
+  vec2 position; // 位置
+  uint flags; // POINT_MOVABLE
+  uint velocity; // 速度(packHalf2x16)
+  vec2 position_temp; // p(t + h)
+  uint flags_temp;
+  uint velocity_temp; // v(t + h)の途中(packHalf2x16)
+};
+#else
+struct Point
+{
+  vec4 position; // 位置
+  vec3 velocity; // 速度
+  vec4 position_temp; // p(t + h)
+  vec3 velocity_temp; // v(t + h)の途中
+};
+#endif
+
+// 紐
+struct Rope
+{
+  uint first; // 先頭節点の番号
+  uint count; // 節点数(<= MAX_NODES)
+  float rest_length; // 節点間の自然長
+  float gravity; // 重力加速度(y方向)
+};
+
+// 全ての紐の節点群(紐毎に担当範囲が分かれているのでin-placeで更新)
+layout(std430, binding = 0) buffer Points
+{
+  Point points[];
+};
+
+layout(std430, binding = 1) buffer Ropes
+{
+  readonly Rope ropes[];
+};
+
+uniform uint rope_num;
+uniform uint substeps; // 1フレーム当たりの分割数
+uniform float dt; // 1 substep分のタイムステップ
+uniform float m; // 節点の質量
+uniform float k; // ばね定数
+uniform float c; // ばね減衰係数
+
+// 紐1本分の状態
+shared vec4 s_position[MAX_NODES]; // p(t + h) + 固定flag(w)
+shared vec2 s_velocity[MAX_NODES]; // v(t + h)の途中
+
+// 節点iが隣の節点jから受ける力
+vec2 force(uint i, uint j, float l)
+{
+  vec2 d = s_position[j].xy - s_position[i].xy;
+  vec2 dv = s_velocity[i] - s_velocity[j];
+  return (length(d) - l) * k * normalize(d) - c * dv;
+}
+
+void main()
+{
+  const uint r = gl_WorkGroupID.x;
+  const uint lid = gl_LocalInvocationID.x;
+  if (r >= rope_num) {
+    return;
+  }
+  const Rope rope = ropes[r];
+  const vec2 g = vec2(0.0, rope.gravity);
+
+  // 読み込み
+  for (uint n = 0; n < NODES_PER_INVOCATION; ++n) {
+    uint i = lid + n * gl_WorkGroupSize.x;
+    if (i < rope.count) {
+#ifdef COMPACT_POINTS
+      // 共有メモリ上は展開しておく
+      Point p = points[rope.first + i];
+      s_position[i] = vec4(p.position_temp, 0.0, float(p.flags_temp & POINT_MOVABLE));
+      s_velocity[i] = unpackHalf2x16(p.velocity_temp);
+#else
+      s_position[i] = points[rope.first + i].position_temp;
+      s_velocity[i] = points[rope.first + i].velocity_temp.xy;
+#endif
+    }
+  }
+  barrier();
+
+  // 各substepの結果は全員が読み終わるまで共有メモリに書けないので一旦ここに置く
+  vec4 next_position[NODES_PER_INVOCATION];
+  vec2 next_velocity[NODES_PER_INVOCATION];
+  // 最後のsubstepのp(t + h), v(t + h)
+  vec4 position[NODES_PER_INVOCATION];
+  vec2 velocity[NODES_PER_INVOCATION];
+
+  for (uint s = 0; s < substeps; ++s) {
+    for (uint n = 0; n < NODES_PER_INVOCATION; ++n) {
+      uint i = lid + n * gl_WorkGroupSize.x;
+      if (i >= rope.count) {
+	break;
+      }
+
+      // 加速度 a(t + h)
+      vec2 f = vec2(0.0);
+      if (i > 0) {
+	f += force(i, i - 1, rope.rest_length);
+      }
+      if (i < rope.count - 1) {
+	f += force(i, i + 1, rope.rest_length);
+      }
+      vec2 a = f / m + g;
+
+      float movable = step(0.5, s_position[i].w);
+
+      // 位置 p(t + h)と速度 v(t + h)
+      position[n] = s_position[i];
+      velocity[n] = movable * (s_velocity[i] + 0.5 * dt * a);
+
+      // 位置 p(t + 2h)
+      next_position[n] = s_position[i] + movable * vec4(dt * velocity[n] + 0.5 * dt * dt * a, 0.0, 0.0);
+      // 速度 v(t + 2h)は未完成
+      next_velocity[n] = movable * (s_velocity[i] + dt * a);
+    }
+    barrier();
+
+    for (uint n = 0; n < NODES_PER_INVOCATION; ++n) {
+      uint i = lid + n * gl_WorkGroupSize.x;
+      if (i < rope.count) {
+	s_position[i] = next_position[n];
+	s_velocity[i] = next_velocity[n];
+      }
+    }
+    barrier();
+  }
+
+  // 書き戻し
+  if (substeps > 0) {
+    for (uint n = 0; n < NODES_PER_INVOCATION; ++n) {
+      uint i = lid + n * gl_WorkGroupSize.x;
+      if (i < rope.count) {
+	uint j = rope.first + i;
+#ifdef COMPACT_POINTS
+	// 固定flagはsubstepの間変わらないのでflags_tempはそのまま
+	points[j].position = position[n].xy;
+	points[j].flags = points[j].flags_temp;
+	points[j].velocity = packHalf2x16(velocity[n]);
+	points[j].position_temp = s_position[i].xy;
+	points[j].velocity_temp = packHalf2x16(s_velocity[i]);
+#else
+	points[j].position = position[n];
+	points[j].velocity = vec3(velocity[n], 0.0);
+	points[j].position_temp = s_position[i];
+	points[j].velocity_temp = vec3(s_velocity[i], 0.0);
+#endif
+      }
+    }
+  }
+}
@@ -0,0 +1,50 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// r, g, b, 輝度の256段階の度数分布
+// 1 workgroupが64x64画素(1スレッド4x4画素)を共有メモリ上でatomicに数えてから全体へ足す
+// (全体のバッファは呼び出し側で0にしておく)
+
+const int TILE = 64;
+const vec3 LUMA = vec3(0.3086, 0.6094, 0.0820); // scene_colormatrix.cppのlumRGB
+
+layout(binding = 0, rgba8) uniform readonly image2D SourceImage;
+
+layout(std430, binding = 0) buffer Histogram
+{
+  uint hist[4 * 256]; // r, g, b, 輝度の順
+};
+
+shared uint local_hist[4 * 256];
+
+void main()
+{
+  const uint l = gl_LocalInvocationIndex;
+  for (uint i = l; i < 4 * 256; i += 256) {
+    local_hist[i] = 0;
+  }
+  barrier();
+
+  const ivec2 size = imageSize(SourceImage);
+  const ivec2 base = ivec2(gl_WorkGroupID.xy) * TILE + ivec2(gl_LocalInvocationID.xy);
+  for (int dy = 0; dy < TILE; dy += 16) {
+    for (int dx = 0; dx < TILE; dx += 16) {
+      const ivec2 p = base + ivec2(dx, dy);
+      if (all(lessThan(p, size))) {
+	const vec3 c = imageLoad(SourceImage, p).rgb;
+	const uvec3 b = uvec3(round(c * 255.0));
+	atomicAdd(local_hist[b.r], 1);
+	atomicAdd(local_hist[256 + b.g], 1);
+	atomicAdd(local_hist[512 + b.b], 1);
+	atomicAdd(local_hist[768 + uint(round(dot(c, LUMA) * 255.0))], 1);
+      }
+    }
+  }
+  barrier();
+
+  for (uint i = l; i < 4 * 256; i += 256) {
+    if (local_hist[i] != 0) {
+      atomicAdd(hist[i], local_hist[i]);
+    }
+  }
+}
@@ -0,0 +1,81 @@
+#version 430 core
+layout (local_size_x = 256) in;
+
+// 度数分布の累積から両端clipの割合を捨てる位置(0-255)を求め
+// その範囲を[0, 1]に引き伸ばす行列(auto levels)を作る
+// mode 0 : r, g, b毎(色かぶりも取れる), 1 : 輝度で共通(色合いを保ったままauto contrast)
+
+layout(std430, binding = 0) buffer Histogram
+{
+  readonly uint hist[4 * 256];
+};
+
+layout(std430, binding = 1) buffer Levels
+{
+  mat4 auto_matrix;
+  uvec4 low; // r, g, b, 輝度
+  uvec4 high;
+};
+
+uniform float clip;
+uniform int mode;
+
+shared uint cdf[256];
+shared uint low_bin;
+shared uint high_bin;
+
+void main()
+{
+  const uint i = gl_LocalInvocationID.x;
+  uvec4 lo = uvec4(0);
+  uvec4 hi = uvec4(255);
+
+  for (int c = 0; c < 4; ++c) {
+    cdf[i] = hist[c * 256 + i];
+    if (i == 0) {
+      low_bin = 0;
+      high_bin = 255;
+    }
+    barrier();
+
+    // Hillis-Steele
+    for (uint offset = 1; offset < 256; offset <<= 1) {
+      const uint v = (i >= offset) ? cdf[i - offset] : 0;
+      barrier();
+      cdf[i] += v;
+      barrier();
+    }
+
+    // 累積がしきい値をまたぐ段は1個だけ
+    const float total = float(cdf[255]);
+    const float t_low = clip * total;
+    const float t_high = (1.0 - clip) * total;
+    const float prev = (i > 0) ? float(cdf[i - 1]) : 0.0;
+    if (float(cdf[i]) > t_low && prev <= t_low) {
+      low_bin = i;
+    }
+    if (float(cdf[i]) >= t_high && prev < t_high) {
+      high_bin = i;
+    }
+    barrier();
+    lo[c] = low_bin;
+    hi[c] = high_bin;
+    barrier();
+  }
+
+  if (i == 0) {
+    mat4 m = mat4(1.0);
+    for (int c = 0; c < 3; ++c) {
+      const uint l = (mode == 0) ? lo[c] : lo.w;
+      const uint h = (mode == 0) ? hi[c] : hi.w;
+      if (h > l) {
+	const float s = 255.0 / float(h - l);
+	m[c][c] = s;
+	m[3][c] = -float(l) / 255.0 * s;
+      }
+    }
+    auto_matrix = m;
+    low = lo;
+    high = hi;
+  }
+}
@@ -0,0 +1,67 @@
+#version 430 core
+layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+// 格子点(size^3)毎に色変換の列を順に適用して3D LUTへ書き込む
+// (lut.hppのColorLut, 参照はcolormatrix.cs(LUT))
+
+layout(binding = 0, rgba16f) uniform writeonly image3D Lut;
+
+// lut.hppのColorOpと同じ並び
+struct ColorOp
+{
+  mat4 matrix;
+  vec4 param;
+  int type;
+};
+
+layout(std430, binding = 0) buffer Ops
+{
+  readonly ColorOp ops[];
+};
+
+uniform int op_count;
+uniform int size;
+
+#define OP_MATRIX 0
+#define OP_GAMMA 1
+#define OP_CURVE 2
+#define OP_TONEMAP 3
+
+// https://knarkowicz.wordpress.com/2016/01/06/aces-filmic-tone-mapping-curve/
+vec3 aces(vec3 c)
+{
+  return clamp((c * (2.51 * c + 0.03)) / (c * (2.43 * c + 0.59) + 0.14), 0.0, 1.0);
+}
+
+void main()
+{
+  ivec3 p = ivec3(gl_GlobalInvocationID);
+  if (any(greaterThanEqual(p, ivec3(size)))) {
+    return;
+  }
+
+  // 格子点は[0, 1]の両端を含めて等間隔
+  vec3 c = vec3(p) / float(size - 1);
+  for (int i = 0; i < op_count; ++i) {
+    const vec4 param = ops[i].param;
+    switch (ops[i].type) {
+    case OP_MATRIX:
+      c = (ops[i].matrix * vec4(c, 1.0)).rgb;
+      break;
+    case OP_GAMMA:
+      c = pow(max(c, 0.0), 1.0 / param.rgb);
+      break;
+    case OP_CURVE:
+      // smoothstepとの混合(負の強さでは逆向きに外挿しても単調なまま)
+      c = clamp(c, 0.0, 1.0);
+      c = mix(c, c * c * (3.0 - 2.0 * c), param.x);
+      break;
+    case OP_TONEMAP:
+      c = max(c, 0.0) * exp2(param.x);
+      c = (param.y < 0.5) ? c / (1.0 + c) : aces(c);
+      break;
+    }
+  }
+
+  imageStore(Lut, p, vec4(c, 1.0));
+}
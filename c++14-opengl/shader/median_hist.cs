@@ -0,0 +1,167 @@
+#version 430 core
+layout (local_size_x = 256) in;
+
+// 度数分布による中央値(S. Perreault, V. Hebert "Median Filtering in Constant Time")
+// 1 workgroupが幅STRIPの縦長の帯のBAND行分を上から順に処理する
+// 作業領域を抑える為に画像全体のworkgroupを何回かに分けて起動するので
+// 画像上の位置はgroup_x, group_yだけずらす(作業領域はこの回のworkgroup分だけ)
+//  列毎の度数分布 : 帯と左右radius列の各列について縦2 * radius + 1画素分
+//                   1行下がる毎に上端の1画素を引いて下端の1画素を足す(各列1スレッド)
+//  窓の度数分布 : 帯の左端の窓の分は列の差分で縦に更新し, 行の中では
+//                 右の列を足して左の列を引きながら横へずらす(各binを1スレッド)
+// どちらも半径によらない手間で, 中央値は16段 x 16段の2段階で探す
+// 行の中はPIXELS画素ずつまとめて窓を作り, その中央値を並列に探して書き出す
+// (barrierはPIXELS画素毎に3回)
+// r, g, bを別々に数える. 画像の端は延長
+
+#define STRIP 64
+#define BAND 128
+#define PIXELS 4 // 1回に中央値を求める画素数(STRIPの約数, PIXELS * 3 * 16 <= 256)
+
+layout(binding = 0, rgba8) uniform readonly image2D SourceImage;
+layout(binding = 1, rgba8) uniform writeonly image2D ResultImage;
+
+// 列毎の度数分布(workgroup毎に(STRIP + 2 * radius)列 x 3色 x 256bin, 8bitずつ4個詰め)
+layout(std430, binding = 0) coherent buffer Columns
+{
+  uint columns[];
+};
+
+uniform int radius;
+uniform int group_x; // この回の最初のworkgroupの画像上の位置(STRIP列, BAND行単位)
+uniform int group_y;
+
+shared int window_base[3 * 256]; // 帯の左端の窓
+shared int window[PIXELS * 3 * 256]; // この回のPIXELS画素の窓
+shared int coarse[PIXELS * 3 * 16];
+shared uint median[PIXELS * 3];
+
+ivec2 size;
+uint base;
+
+uvec3 load(int x, int y)
+{
+  vec3 c = imageLoad(SourceImage, clamp(ivec2(x, y), ivec2(0), size - 1)).rgb;
+  return uvec3(c * 255.0 + 0.5);
+}
+
+// 列cの度数分布にvを足す(d = 1)か引く(d = -1)
+void update_column(int c, uvec3 v, int d)
+{
+  for (int ch = 0; ch < 3; ++ch) {
+    uint i = base + uint(c * 3 + ch) * 64u + (v[ch] >> 2);
+    uint one = 1u << ((v[ch] & 3u) * 8u);
+    columns[i] = (d > 0) ? columns[i] + one : columns[i] - one;
+  }
+}
+
+int count(int c, int ch, uint b)
+{
+  return int((columns[base + uint(c * 3 + ch) * 64u + (b >> 2)] >> ((b & 3u) * 8u)) & 0xffu);
+}
+
+void main()
+{
+  size = imageSize(SourceImage);
+  const uint t = gl_LocalInvocationID.x;
+  const int ncol = STRIP + 2 * radius;
+  base = (gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x) * uint(ncol) * 3u * 64u;
+  const int x0 = (int(gl_WorkGroupID.x) + group_x) * STRIP;
+  const int y0 = (int(gl_WorkGroupID.y) + group_y) * BAND;
+  const int rank = ((2 * radius + 1) * (2 * radius + 1) + 1) / 2;
+
+  // 最初の行の列毎の度数分布(列x0 - radius + t)
+  if (t < ncol) {
+    for (uint i = 0; i < 3u * 64u; ++i) {
+      columns[base + t * 3u * 64u + i] = 0u;
+    }
+    for (int dy = -radius; dy <= radius; ++dy) {
+      update_column(int(t), load(x0 - radius + int(t), y0 + dy), 1);
+    }
+  }
+  memoryBarrierBuffer();
+  barrier();
+  for (int ch = 0; ch < 3; ++ch) {
+    int s = 0;
+    for (int c = 0; c <= 2 * radius; ++c) {
+      s += count(c, ch, t);
+    }
+    window_base[ch * 256 + t] = s;
+  }
+  barrier();
+
+  const int y1 = min(y0 + BAND, size.y);
+  const int x1 = min(x0 + STRIP, size.x);
+  for (int y = y0; y < y1; ++y) {
+    if (y > y0) {
+      if (t < ncol) {
+	const int x = x0 - radius + int(t);
+	const uvec3 removed = load(x, y - radius - 1);
+	const uvec3 added = load(x, y + radius);
+	update_column(int(t), removed, -1);
+	update_column(int(t), added, 1);
+	if (t <= 2 * radius) {
+	  for (int ch = 0; ch < 3; ++ch) {
+	    atomicAdd(window_base[ch * 256 + removed[ch]], -1);
+	    atomicAdd(window_base[ch * 256 + added[ch]], 1);
+	  }
+	}
+      }
+      memoryBarrierBuffer();
+      memoryBarrierShared();
+      barrier();
+    }
+    // 行の中でずらしていく窓(各スレッドは自分のbinだけ持つ)
+    int w[3];
+    for (int ch = 0; ch < 3; ++ch) {
+      w[ch] = window_base[ch * 256 + t];
+    }
+
+    for (int i0 = 0; i0 < x1 - x0; i0 += PIXELS) {
+      for (int k = 0; k < PIXELS; ++k) {
+	const int i = i0 + k;
+	if (i > 0) {
+	  // 列x + radiusを足してx - radius - 1を引く
+	  for (int ch = 0; ch < 3; ++ch) {
+	    w[ch] += count(i + 2 * radius, ch, t) - count(i - 1, ch, t);
+	  }
+	}
+	for (int ch = 0; ch < 3; ++ch) {
+	  window[(k * 3 + ch) * 256 + int(t)] = w[ch];
+	}
+      }
+      barrier();
+      if (t < PIXELS * 3u * 16u) {
+	int s = 0;
+	for (uint j = 0; j < 16u; ++j) {
+	  s += window[(t / 16u) * 256u + (t % 16u) * 16u + j];
+	}
+	coarse[t] = s;
+      }
+      barrier();
+      if (t < PIXELS * 3u) {
+	int acc = 0;
+	uint c = 0;
+	while (acc + coarse[t * 16u + c] < rank) {
+	  acc += coarse[t * 16u + c];
+	  ++c;
+	}
+	uint b = c * 16u;
+	while (acc + window[t * 256u + b] < rank) {
+	  acc += window[t * 256u + b];
+	  ++b;
+	}
+	median[t] = b;
+      }
+      barrier();
+      if (t < PIXELS) {
+	const int x = x0 + i0 + int(t);
+	if (x < x1) {
+	  const uint m = t * 3u;
+	  imageStore(ResultImage, ivec2(x, y), vec4(vec3(median[m], median[m + 1u], median[m + 2u]) / 255.0, 1.0));
+	}
+      }
+    }
+    barrier();
+  }
+}
@@ -0,0 +1,66 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// 3x3(RADIUS2なら5x5)の中央値を比較交換の固定列(sorting network)で求める
+// 中央値に関係する比較だけを残した列(N. Devillard, Fast median search)
+// min/maxをvec4のまま使うのでr, g, bを同時に並べ替える
+// 画像の端は延長
+
+layout(binding = 0, rgba8) uniform readonly image2D SourceImage;
+layout(binding = 1, rgba8) uniform writeonly image2D ResultImage;
+
+#ifdef RADIUS2
+#define RADIUS 2
+#else
+#define RADIUS 1
+#endif
+#define N ((2 * RADIUS + 1) * (2 * RADIUS + 1))
+
+// p[a] <= p[b]にする
+#define S(a, b) { vec4 t = min(p[a], p[b]); p[b] = max(p[a], p[b]); p[a] = t; }
+
+void main()
+{
+  const ivec2 size = imageSize(SourceImage);
+  const ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(pos, size))) {
+    return;
+  }
+
+  vec4 p[N];
+  for (int dy = -RADIUS; dy <= RADIUS; ++dy) {
+    for (int dx = -RADIUS; dx <= RADIUS; ++dx) {
+      p[(dy + RADIUS) * (2 * RADIUS + 1) + dx + RADIUS] = imageLoad(SourceImage, clamp(pos + ivec2(dx, dy), ivec2(0), size - 1));
+    }
+  }
+
+#ifdef RADIUS2
+  S(0, 1); S(3, 4); S(2, 4); S(2, 3); S(6, 7);
+  S(5, 7); S(5, 6); S(9, 10); S(8, 10); S(8, 9);
+  S(12, 13); S(11, 13); S(11, 12); S(15, 16); S(14, 16);
+  S(14, 15); S(18, 19); S(17, 19); S(17, 18); S(21, 22);
+  S(20, 22); S(20, 21); S(23, 24); S(2, 5); S(3, 6);
+  S(0, 6); S(0, 3); S(4, 7); S(1, 7); S(1, 4);
+  S(11, 14); S(8, 14); S(8, 11); S(12, 15); S(9, 15);
+  S(9, 12); S(13, 16); S(10, 16); S(10, 13); S(20, 23);
+  S(17, 23); S(17, 20); S(21, 24); S(18, 24); S(18, 21);
+  S(19, 22); S(8, 17); S(9, 18); S(0, 18); S(0, 9);
+  S(10, 19); S(1, 19); S(1, 10); S(11, 20); S(2, 20);
+  S(2, 11); S(12, 21); S(3, 21); S(3, 12); S(13, 22);
+  S(4, 22); S(4, 13); S(14, 23); S(5, 23); S(5, 14);
+  S(15, 24); S(6, 24); S(6, 15); S(7, 16); S(7, 19);
+  S(13, 21); S(15, 23); S(7, 13); S(7, 15); S(1, 9);
+  S(3, 11); S(5, 17); S(11, 17); S(9, 17); S(4, 10);
+  S(6, 12); S(7, 14); S(4, 6); S(4, 7); S(12, 14);
+  S(10, 14); S(6, 7); S(10, 12); S(6, 10); S(6, 17);
+  S(12, 17); S(7, 17); S(7, 10); S(12, 18); S(7, 12);
+  S(10, 18); S(12, 20); S(10, 20); S(10, 12);
+#else
+  S(1, 2); S(4, 5); S(7, 8); S(0, 1); S(3, 4);
+  S(6, 7); S(1, 2); S(4, 5); S(7, 8); S(0, 3);
+  S(5, 8); S(4, 7); S(3, 6); S(1, 4); S(2, 5);
+  S(4, 7); S(4, 2); S(6, 4); S(4, 2);
+#endif
+
+  imageStore(ResultImage, pos, vec4(p[N / 2].rgb, 1.0));
+}
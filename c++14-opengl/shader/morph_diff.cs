@@ -0,0 +1,19 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// top-hat用の差 max(A - B, 0) (alphaは1)
+//  white top-hat : A = 元の画像, B = opening
+//  black top-hat : A = closing, B = 元の画像
+
+layout(binding = 0, rgba8) uniform readonly image2D A;
+layout(binding = 1, rgba8) uniform readonly image2D B;
+layout(binding = 2, rgba8) uniform writeonly image2D ResultImage;
+
+void main()
+{
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, imageSize(ResultImage)))) {
+    return;
+  }
+  imageStore(ResultImage, p, vec4(max(imageLoad(A, p).rgb - imageLoad(B, p).rgb, 0.0), 1.0));
+}
@@ -0,0 +1,104 @@
+#version 430 core
+layout (local_size_x = 256, local_size_y = 1) in;
+
+// 直線の要素(長さelement_length)での最小値(erode)/最大値(dilate)
+// van Herk/Gil-Werman法 : 共有メモリに256画素 + element_length - 1画素を読み
+// element_length毎の区間に分けて
+//  g : 区間の先頭からの累積(前向き)
+//  h : 区間の末尾からの累積(後ろ向き)
+// を作ると, 長さelement_lengthの窓[i, i + element_length - 1]は隣り合う2区間に
+// またがるだけなので結果はop(h[i], g[i + element_length - 1])
+// 区間内の累積は全スレッドで並列に行う(距離1, 2, 4, ...の段を重ねるので
+// 段数はlog2(element_length)で, 区間数が少ない長い要素でも全スレッドが働く)
+// 方向(dir_x, dir_y)は(1, 0), (0, 1), (1, 1), (1, -1)のどれか
+// 画像の外は無視する(erodeは1, dilateは0として読む. 縦横では端の延長と同じ)
+
+const int LINE = 256;
+const int MAX_LENGTH = 511; // morphology.hppのmax_pass_length_
+const int PER_THREAD = (LINE + MAX_LENGTH - 1 + LINE - 1) / LINE; // 1スレッドが受け持つ画素数
+
+layout(binding = 0, rgba8) uniform readonly image2D SourceImage;
+layout(binding = 1, rgba8) uniform writeonly image2D ResultImage;
+
+uniform int element_length;
+uniform int origin; // 窓の先頭 = 位置 - origin
+uniform int dir_x;
+uniform int dir_y;
+uniform bool erode;
+
+shared vec3 g[LINE + MAX_LENGTH - 1];
+shared vec3 h[LINE + MAX_LENGTH - 1];
+
+ivec2 size;
+
+vec3 op(vec3 a, vec3 b)
+{
+  return erode ? min(a, b) : max(a, b);
+}
+
+// 直線の番号acrossと直線上の位置tから画素の位置
+// 斜めの直線はx = tの列で数え, 画像の外の部分も含めて幅 + 高さ - 1本
+ivec2 pixel(int t, int across)
+{
+  if (dir_y == 0) {
+    return ivec2(t, across);
+  } else if (dir_x == 0) {
+    return ivec2(across, t);
+  } else if (dir_y > 0) {
+    return ivec2(t, t + across - (size.x - 1));
+  } else {
+    return ivec2(t, across - t);
+  }
+}
+
+bool inside(ivec2 q)
+{
+  return all(greaterThanEqual(q, ivec2(0))) && all(lessThan(q, size));
+}
+
+void main()
+{
+  size = imageSize(SourceImage);
+  const int across = int(gl_WorkGroupID.y);
+  const int base = int(gl_WorkGroupID.x) * LINE - origin;
+  const int l = int(gl_LocalInvocationID.x);
+  const int n = LINE + element_length - 1;
+
+  const vec3 neutral = vec3(erode ? 1.0 : 0.0);
+  for (int i = l; i < n; i += LINE) {
+    const ivec2 q = pixel(base + i, across);
+    const vec3 v = inside(q) ? imageLoad(SourceImage, q).rgb : neutral;
+    g[i] = v;
+    h[i] = v;
+  }
+  barrier();
+
+  // 区間毎の累積(gは前向き, hは後ろ向き)
+  // 距離dの段では区間内でd離れた値と合わせる(区間の外からは取らない)
+  for (int d = 1; d < element_length; d <<= 1) {
+    vec3 ga[PER_THREAD], ha[PER_THREAD];
+    for (int k = 0; k < PER_THREAD; ++k) {
+      const int i = l + k * LINE;
+      if (i < n) {
+	const int p = i % element_length;
+	ga[k] = (p >= d) ? op(g[i - d], g[i]) : g[i];
+	ha[k] = (p + d < element_length && i + d < n) ? op(h[i], h[i + d]) : h[i];
+      }
+    }
+    barrier();
+    for (int k = 0; k < PER_THREAD; ++k) {
+      const int i = l + k * LINE;
+      if (i < n) {
+	g[i] = ga[k];
+	h[i] = ha[k];
+      }
+    }
+    barrier();
+  }
+
+  const ivec2 q = pixel(int(gl_GlobalInvocationID.x), across);
+  if (!inside(q)) {
+    return;
+  }
+  imageStore(ResultImage, q, vec4(op(h[l], g[l + element_length - 1]), 1.0));
+}
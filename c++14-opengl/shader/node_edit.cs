@@ -0,0 +1,133 @@
+#version 430 core
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// 編集命令(nodeedit.hppのNodeEditQueue::Editと同じレイアウト)
+struct NodeEdit
+{
+  uint index; // 節点番号
+  uint ops; // 編集の種類(ビット和)
+  vec2 position;
+};
+
+const uint SET_POSITION = 1u;
+const uint SET_FLAG = 2u;
+const uint CLEAR_VELOCITY = 4u;
+const uint FLAG_MOVABLE = 8u;
+
+// 転送用リングバッファ全体
+layout(std430, binding = 0) buffer Edits
+{
+  readonly NodeEdit edits[];
+};
+
+// 圧縮形式(COMPACT_POINTS)の節点のflag
+const uint POINT_MOVABLE = 1u;
+
+// 編集対象の節点バッファ(Verlet法の前回位置用に2個まで)
+// 圧縮形式ではfloat以外も混ざるのでuvec4として読み書きする
+layout(std430, binding = 1) buffer Nodes0
+{
+  uvec4 nodes0[];
+};
+
+layout(std430, binding = 2) buffer Nodes1
+{
+  uvec4 nodes1[];
+};
+
+uniform uint edit_offset; // edits[]の中の今回分の先頭
+uniform uint edit_num;
+uniform uint target_num; // 1 or 2
+uniform uint stride; // 節点1個分のvec4の個数
+// 節点内の位置/速度の場所(vec4単位, 無ければ-1)
+uniform int position_offset0 = -1;
+uniform int position_offset1 = -1;
+uniform int velocity_offset0 = -1;
+uniform int velocity_offset1 = -1;
+
+#ifdef COMPACT_POINTS
+// (x, y, flag, 速度)
+uvec4 edit_position(uvec4 p, NodeEdit e)
+{
+  if ((e.ops & SET_POSITION) != 0u) {
+    p.xy = floatBitsToUint(e.position);
+  }
+  if ((e.ops & SET_FLAG) != 0u) {
+    p.z = ((e.ops & FLAG_MOVABLE) != 0u) ? (p.z | POINT_MOVABLE) : (p.z & ~POINT_MOVABLE);
+  }
+  return p;
+}
+
+uvec4 clear_velocity(uvec4 v)
+{
+  v.w = packHalf2x16(vec2(0.0));
+  return v;
+}
+
+// 位置だけpから写す(flagと速度はそのまま)
+uvec4 copy_position(uvec4 q, uvec4 p)
+{
+  q.xy = p.xy;
+  return q;
+}
+#else
+// (x, y, z, 可動フラグ)
+uvec4 edit_position(uvec4 p, NodeEdit e)
+{
+  if ((e.ops & SET_POSITION) != 0u) {
+    p.xyz = floatBitsToUint(vec3(e.position, 0.0));
+  }
+  if ((e.ops & SET_FLAG) != 0u) {
+    p.w = floatBitsToUint(((e.ops & FLAG_MOVABLE) != 0u) ? 1.0 : 0.0);
+  }
+  return p;
+}
+
+uvec4 clear_velocity(uvec4 v)
+{
+  v.xyz = floatBitsToUint(vec3(0.0));
+  return v;
+}
+
+uvec4 copy_position(uvec4 q, uvec4 p)
+{
+  q.xyz = p.xyz;
+  return q;
+}
+#endif
+
+void edit_node(uint base, NodeEdit e, int pos, int vel)
+{
+  if (pos >= 0) {
+    uint k = base + uint(pos);
+    nodes0[k] = edit_position(nodes0[k], e);
+    if (target_num > 1u) {
+      nodes1[k] = edit_position(nodes1[k], e);
+      // 速度の欄が無い(Verlet法)なら前回位置を現在位置にそろえて速度0にする
+      if (vel < 0 && (e.ops & CLEAR_VELOCITY) != 0u) {
+	nodes1[k] = copy_position(nodes1[k], nodes0[k]);
+      }
+    }
+  }
+  if (vel >= 0 && (e.ops & CLEAR_VELOCITY) != 0u) {
+    uint k = base + uint(vel);
+    nodes0[k] = clear_velocity(nodes0[k]);
+    if (target_num > 1u) {
+      nodes1[k] = clear_velocity(nodes1[k]);
+    }
+  }
+}
+
+void main()
+{
+  const uint id = gl_GlobalInvocationID.x;
+  if (id >= edit_num) {
+    return;
+  }
+
+  NodeEdit e = edits[edit_offset + id];
+  uint base = e.index * stride;
+
+  edit_node(base, e, position_offset0, velocity_offset0);
+  edit_node(base, e, position_offset1, velocity_offset1);
+}
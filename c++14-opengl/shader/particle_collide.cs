@@ -0,0 +1,150 @@
+#version 430 core
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// 粒子同士の衝突(近距離の斥力)
+// 自分のセルと周囲26セルに入っている粒子だけを調べる
+// 半径hの中の粒子から線形kernelの斥力と法線方向の減衰を受けて速度を変える
+
+// 粒子
+#ifdef COMPACT_POINTS
+// 圧縮形式 : 位置のwは省略, 速度と寿命はfp16
+struct Particle
+{
+  float px, py, pz; // 位置
+  uint velocity_xy; // 速度xy(packHalf2x16)
+  uint velocity_z_life; // 速度z, 残り寿命(packHalf2x16)
+};
+#else
+struct Particle
+{
+  vec4 position; // 位置(w = 1)
+  vec4 velocity; // 速度(xyz) + 残り寿命(w)
+};
+#endif
+
+layout(std430, binding = 0) buffer Particles
+{
+  Particle particles[];
+};
+
+layout(std430, binding = 1) buffer CellCount
+{
+  readonly uint cell_count[];
+};
+
+layout(std430, binding = 2) buffer CellStart
+{
+  readonly uint cell_start[];
+};
+
+layout(std430, binding = 4) buffer Counters
+{
+  uint draw_count; // 生存数(particle_update.csで詰めた数)
+  uint draw_instance_count;
+  uint draw_first;
+  uint draw_base_instance;
+  uint groups_x;
+  uint groups_y;
+  uint groups_z;
+  uint alive_count;
+  uint dead_count;
+  uint emit_num;
+  uint emit_base;
+};
+
+layout(std430, binding = 5) buffer SortedPositions
+{
+  readonly vec4 sorted_positions[];
+};
+
+layout(std430, binding = 6) buffer SortedVelocities
+{
+  readonly vec4 sorted_velocities[];
+};
+
+layout(std430, binding = 7) buffer SortedIndices
+{
+  readonly uint sorted_indices[];
+};
+
+uniform float cell_size; // = 影響半径h
+uniform float stiffness; // 斥力の強さ
+uniform float damping; // 法線方向の相対速度の減衰
+uniform uint max_neighbors; // 1粒子が相手にする最大数(発生直後の密集対策)
+uniform float dt;
+
+const uint TABLE_SIZE = 1u << 20; // ハッシュ表の大きさ(particles.hppのgrid_table_size_)
+
+// 格子のセル座標 -> ハッシュ表の番号
+uint cell_hash(ivec3 c)
+{
+  return ((uint(c.x) * 73856093u) ^ (uint(c.y) * 19349663u) ^ (uint(c.z) * 83492791u)) & (TABLE_SIZE - 1u);
+}
+
+void main()
+{
+  // セル順に処理する(隣のスレッドは近くの粒子を読む)
+  const uint t = gl_GlobalInvocationID.x;
+  if (t >= draw_count) {
+    return;
+  }
+
+  const vec4 pi = sorted_positions[t];
+  const vec3 vi = sorted_velocities[t].xyz;
+  const ivec3 c = ivec3(floor(pi.xyz / cell_size));
+
+  vec3 dv = vec3(0.0);
+  uint neighbors = 0;
+  // ハッシュの衝突で同じセル番号を2回調べないように
+  uint visited[27];
+  uint visited_num = 0;
+
+  for (int z = -1; z <= 1; ++z) {
+    for (int y = -1; y <= 1; ++y) {
+      for (int x = -1; x <= 1; ++x) {
+	uint key = cell_hash(c + ivec3(x, y, z));
+	bool seen = false;
+	for (uint k = 0; k < visited_num; ++k) {
+	  seen = seen || (visited[k] == key);
+	}
+	if (seen) {
+	  continue;
+	}
+	visited[visited_num++] = key;
+
+	uint first = cell_start[key];
+	uint last = first + cell_count[key];
+	for (uint j = first; j < last && neighbors < max_neighbors; ++j) {
+	  if (j == t) {
+	    continue;
+	  }
+	  vec3 d = pi.xyz - sorted_positions[j].xyz;
+	  float r = length(d);
+	  // 他のセルの粒子がハッシュの衝突で混ざっているので距離で判定
+	  if (r >= cell_size || r < 1e-6) {
+	    continue;
+	  }
+	  vec3 n = d / r;
+	  float w = 1.0 - r / cell_size;
+	  float vn = dot(vi - sorted_velocities[j].xyz, n);
+	  dv += (stiffness * w - damping * w * vn) * n;
+	  ++neighbors;
+	}
+      }
+    }
+  }
+
+  if (neighbors == 0) {
+    return;
+  }
+
+  const uint index = sorted_indices[t];
+  const vec3 velocity = vi + dt * dv;
+#ifdef COMPACT_POINTS
+  float life = unpackHalf2x16(particles[index].velocity_z_life).y;
+  particles[index].velocity_xy = packHalf2x16(velocity.xy);
+  particles[index].velocity_z_life = packHalf2x16(vec2(velocity.z, life));
+#else
+  particles[index].velocity.xyz = velocity;
+#endif
+}
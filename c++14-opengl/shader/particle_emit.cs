@@ -0,0 +1,124 @@
+#version 430 core
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// 空きリストから粒子を取り出して発生源の設定で初期化し, 生存リストへ追加する
+
+// 粒子
+#ifdef COMPACT_POINTS
+// 圧縮形式 : 位置のwは省略, 速度と寿命はfp16
+struct Particle
+{
+  float px, py, pz; // 位置
+  uint velocity_xy; // 速度xy(packHalf2x16)
+  uint velocity_z_life; // 速度z, 残り寿命(packHalf2x16)
+};
+#else
+struct Particle
+{
+  vec4 position; // 位置(w = 1)
+  vec4 velocity; // 速度(xyz) + 残り寿命(w)
+};
+#endif
+
+// 発生源(particles.hppのParticleEmitterと同じレイアウト)
+struct Emitter
+{
+  vec4 position; // 発生位置(xyz) + 初速の大きさの標準偏差(w)
+  vec4 velocity; // 初速の平均(xyz) + 寿命の平均(w)
+};
+
+layout(std430, binding = 0) buffer Particles
+{
+  writeonly Particle particles[];
+};
+
+// 今回updateする生存リスト
+layout(std430, binding = 1) buffer AliveIn
+{
+  writeonly uint alive_in[];
+};
+
+layout(std430, binding = 3) buffer Dead
+{
+  readonly uint dead[];
+};
+
+layout(std430, binding = 4) buffer Counters
+{
+  uint draw_count;
+  uint draw_instance_count;
+  uint draw_first;
+  uint draw_base_instance;
+  uint groups_x;
+  uint groups_y;
+  uint groups_z;
+  uint alive_count;
+  uint dead_count; // particle_prepare.csで発生分を減らした後の値
+  uint emit_num;
+  uint emit_base;
+};
+
+layout(std430, binding = 5) buffer Emitters
+{
+  readonly Emitter emitters[];
+};
+
+uniform uint emitter_num;
+uniform uint seed; // フレーム毎に変える乱数の種
+
+const float PI = 3.141592653589793;
+
+// 整数ハッシュ(PCG)
+uint hash(uint x)
+{
+  uint state = x * 747796405u + 2891336453u;
+  uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+
+// [0, 1)の一様乱数
+float random(inout uint state)
+{
+  state = hash(state);
+  return float(state >> 8) / 16777216.0;
+}
+
+void main()
+{
+  const uint id = gl_GlobalInvocationID.x;
+  if (id >= emit_num) {
+    return;
+  }
+
+  const uint index = dead[dead_count + id];
+  const Emitter e = emitters[id % emitter_num];
+  uint state = hash(id ^ hash(seed));
+
+  // 直径方向に正規分布する初速(scene_blobの初期版と同じ分布)
+  // 緯度方向
+  const float cp = 2.0 * random(state) - 1.0;
+  const float sp = sqrt(1.0 - cp * cp);
+  // 経度方向
+  const float t = 2.0 * PI * random(state);
+  // Box-Muller法による正規分布(logに0を渡さないよう(0, 1]にする)
+  const float u1 = 1.0 - random(state);
+  const float u2 = random(state);
+  const float r = e.position.w * sqrt(-2.0 * log(u1)) * cos(2.0 * PI * u2);
+
+  const vec3 velocity = e.velocity.xyz + r * vec3(sp * cos(t), sp * sin(t), cp);
+  // 寿命は平均の0.5倍～1.5倍
+  const float life = e.velocity.w * (0.5 + random(state));
+
+#ifdef COMPACT_POINTS
+  particles[index].px = e.position.x;
+  particles[index].py = e.position.y;
+  particles[index].pz = e.position.z;
+  particles[index].velocity_xy = packHalf2x16(velocity.xy);
+  particles[index].velocity_z_life = packHalf2x16(vec2(velocity.z, life));
+#else
+  particles[index].position = vec4(e.position.xyz, 1.0);
+  particles[index].velocity = vec4(velocity, life);
+#endif
+
+  alive_in[emit_base + id] = index;
+}
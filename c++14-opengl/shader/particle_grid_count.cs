@@ -0,0 +1,59 @@
+#version 430 core
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// 近傍探索用の一様格子(ハッシュ表)へ粒子を振り分ける 1/3 (2/3はGpuScanによるセルの先頭の計算)
+// 粒子毎にセルを求めてセル毎の個数を数え, セル内での順位を覚えておく
+
+layout(std430, binding = 4) buffer Counters
+{
+  uint draw_count; // 生存数(particle_update.csで詰めた数)
+  uint draw_instance_count;
+  uint draw_first;
+  uint draw_base_instance;
+  uint groups_x;
+  uint groups_y;
+  uint groups_z;
+  uint alive_count;
+  uint dead_count;
+  uint emit_num;
+  uint emit_base;
+};
+
+// 今回の生存粒子の位置(xyz, particle_update.csで詰めたもの)
+layout(std430, binding = 6) buffer Positions
+{
+  readonly float positions[];
+};
+
+layout(std430, binding = 0) buffer CellCount
+{
+  uint cell_count[];
+};
+
+// (セル番号, セル内での順位)
+layout(std430, binding = 1) buffer CellKey
+{
+  writeonly uvec2 cell_key[];
+};
+
+uniform float cell_size;
+
+const uint TABLE_SIZE = 1u << 20; // ハッシュ表の大きさ(particles.hppのgrid_table_size_)
+
+// 格子のセル座標 -> ハッシュ表の番号
+uint cell_hash(ivec3 c)
+{
+  return ((uint(c.x) * 73856093u) ^ (uint(c.y) * 19349663u) ^ (uint(c.z) * 83492791u)) & (TABLE_SIZE - 1u);
+}
+
+void main()
+{
+  const uint s = gl_GlobalInvocationID.x;
+  if (s >= draw_count) {
+    return;
+  }
+
+  vec3 p = vec3(positions[3 * s], positions[3 * s + 1], positions[3 * s + 2]);
+  uint key = cell_hash(ivec3(floor(p / cell_size)));
+  cell_key[s] = uvec2(key, atomicAdd(cell_count[key], 1u));
+}
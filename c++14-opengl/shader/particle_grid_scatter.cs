@@ -0,0 +1,103 @@
+#version 430 core
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// 近傍探索用の一様格子(ハッシュ表)へ粒子を振り分ける 3/3
+// セルの先頭 + セル内の順位の位置へ粒子の位置と速度を並べ直す(counting sort)
+// 同じセルの粒子がメモリ上で連続するので近傍探索の読み込みがまとまる
+
+// 粒子
+#ifdef COMPACT_POINTS
+// 圧縮形式 : 位置のwは省略, 速度と寿命はfp16
+struct Particle
+{
+  float px, py, pz; // 位置
+  uint velocity_xy; // 速度xy(packHalf2x16)
+  uint velocity_z_life; // 速度z, 残り寿命(packHalf2x16)
+};
+#else
+struct Particle
+{
+  vec4 position; // 位置(w = 1)
+  vec4 velocity; // 速度(xyz) + 残り寿命(w)
+};
+#endif
+
+layout(std430, binding = 0) buffer Particles
+{
+  readonly Particle particles[];
+};
+
+layout(std430, binding = 1) buffer CellKey
+{
+  readonly uvec2 cell_key[];
+};
+
+layout(std430, binding = 2) buffer CellStart
+{
+  readonly uint cell_start[];
+};
+
+// 今回の生存リスト(particle_update.csで詰めたもの)
+layout(std430, binding = 3) buffer Alive
+{
+  readonly uint alive[];
+};
+
+layout(std430, binding = 4) buffer Counters
+{
+  uint draw_count; // 生存数(particle_update.csで詰めた数)
+  uint draw_instance_count;
+  uint draw_first;
+  uint draw_base_instance;
+  uint groups_x;
+  uint groups_y;
+  uint groups_z;
+  uint alive_count;
+  uint dead_count;
+  uint emit_num;
+  uint emit_base;
+};
+
+// セル順に並べた位置(xyz, wは使わない)
+layout(std430, binding = 5) buffer SortedPositions
+{
+  writeonly vec4 sorted_positions[];
+};
+
+// セル順に並べた速度
+layout(std430, binding = 6) buffer SortedVelocities
+{
+  writeonly vec4 sorted_velocities[];
+};
+
+// セル順に並べた粒子番号
+// (floatのwに詰めると小さい番号が非正規化数になり0に潰されることがあるので別のuintの配列)
+layout(std430, binding = 7) buffer SortedIndices
+{
+  writeonly uint sorted_indices[];
+};
+
+void main()
+{
+  const uint s = gl_GlobalInvocationID.x;
+  if (s >= draw_count) {
+    return;
+  }
+
+  const uint index = alive[s];
+  const uvec2 kr = cell_key[s];
+  const uint dst = cell_start[kr.x] + kr.y;
+
+#ifdef COMPACT_POINTS
+  Particle p = particles[index];
+  vec3 position = vec3(p.px, p.py, p.pz);
+  vec3 velocity = vec3(unpackHalf2x16(p.velocity_xy), unpackHalf2x16(p.velocity_z_life).x);
+#else
+  vec3 position = particles[index].position.xyz;
+  vec3 velocity = particles[index].velocity.xyz;
+#endif
+
+  sorted_positions[dst] = vec4(position, 0.0);
+  sorted_velocities[dst] = vec4(velocity, 0.0);
+  sorted_indices[dst] = index;
+}
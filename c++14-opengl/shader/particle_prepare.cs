@@ -0,0 +1,44 @@
+#version 430 core
+layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+
+// 毎フレームの最初に1スレッドだけで
+// 発生数を空きの数で制限し, update用の間接起動の引数を用意する
+
+const uint WORKGROUP_SIZE = 64; // particle_update.csのlocal_size_x
+
+// カウンター(particles.hppのParticleSystem::Countersと同じレイアウト)
+layout(std430, binding = 4) buffer Counters
+{
+  uint draw_count; // 前回updateで生き残った数 -> 今回のupdateで数え直す
+  uint draw_instance_count;
+  uint draw_first;
+  uint draw_base_instance;
+  uint groups_x;
+  uint groups_y;
+  uint groups_z;
+  uint alive_count;
+  uint dead_count;
+  uint emit_num;
+  uint emit_base;
+};
+
+uniform uint emit_request; // 発生させたい数
+
+void main()
+{
+  uint alive = draw_count;
+  uint n = min(emit_request, dead_count);
+
+  // 空きリストの末尾n個を発生に使う
+  dead_count -= n;
+  emit_num = n;
+  // 発生した粒子は生存リストの末尾へ
+  emit_base = alive;
+  alive_count = alive + n;
+
+  groups_x = (alive_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+  groups_y = 1;
+  groups_z = 1;
+
+  draw_count = 0;
+}
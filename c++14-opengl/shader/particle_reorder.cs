@@ -0,0 +1,137 @@
+#version 430 core
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// 粒子プールを位置のMorton順に並べ直す(空間的に近い粒子がメモリ上でも近くなる)
+//  stage 0 : 生存リストの粒子はMortonキー, 空きリストの粒子は最大値をキーにして(キー, 粒子番号)を作る
+//  (GpuRadixSortで並べ替え)
+//  stage 1 : 並べ替えた順に粒子を集め, 生存リストと空きリストを新しい番号で作り直す
+// 全粒子番号が生存リスト(draw_count個)と空きリスト(dead_count個)のどちらかに1回だけ現れる前提
+
+// 粒子
+#ifdef COMPACT_POINTS
+// 圧縮形式 : 位置のwは省略, 速度と寿命はfp16
+struct Particle
+{
+  float px, py, pz; // 位置
+  uint velocity_xy; // 速度xy(packHalf2x16)
+  uint velocity_z_life; // 速度z, 残り寿命(packHalf2x16)
+};
+#else
+struct Particle
+{
+  vec4 position; // 位置(w = 1)
+  vec4 velocity; // 速度(xyz) + 残り寿命(w)
+};
+#endif
+
+// 並べ替え前の粒子プール(のコピー)
+layout(std430, binding = 0) buffer Particles
+{
+  readonly Particle particles[];
+};
+
+layout(std430, binding = 1) buffer Keys
+{
+  uint keys[];
+};
+
+// 生存リスト(updateで詰めたもの)
+layout(std430, binding = 2) buffer Alive
+{
+  uint alive[];
+};
+
+layout(std430, binding = 3) buffer Dead
+{
+  uint dead[];
+};
+
+layout(std430, binding = 4) buffer Counters
+{
+  uint draw_count; // 生存数
+  uint draw_instance_count;
+  uint draw_first;
+  uint draw_base_instance;
+  uint groups_x;
+  uint groups_y;
+  uint groups_z;
+  uint alive_count;
+  uint dead_count; // 空きリストの個数
+  uint emit_num;
+  uint emit_base;
+};
+
+// 粒子番号(stage 1では並べ替え済み)
+layout(std430, binding = 5) buffer Values
+{
+  uint values[];
+};
+
+// 並べ替え後の粒子プール
+layout(std430, binding = 6) buffer SortedParticles
+{
+  writeonly Particle sorted_particles[];
+};
+
+uniform uint stage;
+uniform uint capacity;
+
+// Mortonキーを求める範囲(外側は端に寄せる)
+uniform vec3 bounds_min;
+uniform vec3 bounds_max;
+
+vec3 position(uint id)
+{
+#ifdef COMPACT_POINTS
+  return vec3(particles[id].px, particles[id].py, particles[id].pz);
+#else
+  return particles[id].position.xyz;
+#endif
+}
+
+// 10bitを3bit間隔に広げる
+uint expand_bits(uint v)
+{
+  v = (v * 0x00010001u) & 0xff0000ffu;
+  v = (v * 0x00000101u) & 0x0f00f00fu;
+  v = (v * 0x00000011u) & 0xc30c30c3u;
+  v = (v * 0x00000005u) & 0x49249249u;
+  return v;
+}
+
+// 30bitのMortonキー
+uint morton(vec3 p)
+{
+  vec3 t = clamp((p - bounds_min) / (bounds_max - bounds_min), 0.0, 1.0);
+  uvec3 q = uvec3(min(t * 1024.0, vec3(1023.0)));
+  return (expand_bits(q.x) << 2) | (expand_bits(q.y) << 1) | expand_bits(q.z);
+}
+
+void main()
+{
+  const uint k = gl_GlobalInvocationID.x;
+  if (k >= capacity) {
+    return;
+  }
+
+  if (stage == 0u) {
+    if (k < draw_count) {
+      const uint id = alive[k];
+      keys[k] = morton(position(id));
+      values[k] = id;
+    } else {
+      keys[k] = 0xffffffffu;
+      values[k] = dead[k - draw_count];
+    }
+    return;
+  }
+
+  // 新しい粒子番号はkそのもの
+  sorted_particles[k] = particles[values[k]];
+  if (k < draw_count) {
+    alive[k] = k;
+  } else {
+    // 番号の小さい方から取り出されるように逆順
+    dead[capacity - 1u - k] = k;
+  }
+}
@@ -0,0 +1,137 @@
+#version 430 core
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// 生存リストの粒子を積分する
+// 寿命が尽きたものは空きリストへ戻し, 残りは次の生存リストと描画用の位置バッファへ詰める
+
+// 粒子
+#ifdef COMPACT_POINTS
+// 圧縮形式 : 位置のwは省略, 速度と寿命はfp16
+struct Particle
+{
+  float px, py, pz; // 位置
+  uint velocity_xy; // 速度xy(packHalf2x16)
+  uint velocity_z_life; // 速度z, 残り寿命(packHalf2x16)
+};
+#else
+struct Particle
+{
+  vec4 position; // 位置(w = 1)
+  vec4 velocity; // 速度(xyz) + 残り寿命(w)
+};
+#endif
+
+layout(std430, binding = 0) buffer Particles
+{
+  Particle particles[];
+};
+
+layout(std430, binding = 1) buffer AliveIn
+{
+  readonly uint alive_in[];
+};
+
+layout(std430, binding = 2) buffer AliveOut
+{
+  writeonly uint alive_out[];
+};
+
+layout(std430, binding = 3) buffer Dead
+{
+  writeonly uint dead[];
+};
+
+layout(std430, binding = 4) buffer Counters
+{
+  uint draw_count; // 次の生存数(atomicAddで数える)
+  uint draw_instance_count;
+  uint draw_first;
+  uint draw_base_instance;
+  uint groups_x;
+  uint groups_y;
+  uint groups_z;
+  uint alive_count;
+  uint dead_count; // 空きリストの個数(atomicAddで積む)
+  uint emit_num;
+  uint emit_base;
+};
+
+// 描画用に詰めた位置(xyz)
+layout(std430, binding = 6) buffer Positions
+{
+  writeonly float positions[];
+};
+
+// 重力加速度
+const vec3 gravity = vec3(0.0, -9.8, 0.0);
+
+// 地面の高さ
+uniform float height = -0.95;
+
+// 減衰率
+uniform float attenuation = 0.7;
+
+// タイムステップ
+uniform float dt;
+
+void main()
+{
+  const uint id = gl_GlobalInvocationID.x;
+  if (id >= alive_count) {
+    return;
+  }
+  const uint index = alive_in[id];
+
+  // 読み込みは1回だけ
+#ifdef COMPACT_POINTS
+  Particle p = particles[index];
+  vec3 position = vec3(p.px, p.py, p.pz);
+  vec2 vz_life = unpackHalf2x16(p.velocity_z_life);
+  vec3 velocity = vec3(unpackHalf2x16(p.velocity_xy), vz_life.x);
+  float life = vz_life.y;
+#else
+  vec3 position = particles[index].position.xyz;
+  vec3 velocity = particles[index].velocity.xyz;
+  float life = particles[index].velocity.w;
+#endif
+
+  // 寿命が尽きたら空きリストへ
+  life -= dt;
+  if (life <= 0.0) {
+    dead[atomicAdd(dead_count, 1u)] = index;
+    return;
+  }
+
+  // 位置を更新
+  position += velocity * dt;
+
+  if (position.y < height) {
+    // y方向の速度を反転して減らす
+    velocity.y = -attenuation * velocity.y;
+
+    // 高さは地面から跳ね返った位置へ
+    position.y = height + attenuation * (height - position.y);
+  }
+
+  // 速度を更新
+  velocity += gravity * dt;
+
+  // 書き込み
+#ifdef COMPACT_POINTS
+  particles[index].px = position.x;
+  particles[index].py = position.y;
+  particles[index].pz = position.z;
+  particles[index].velocity_xy = packHalf2x16(velocity.xy);
+  particles[index].velocity_z_life = packHalf2x16(vec2(velocity.z, life));
+#else
+  particles[index].position.xyz = position;
+  particles[index].velocity = vec4(velocity, life);
+#endif
+
+  // 生き残ったものを詰める
+  const uint slot = atomicAdd(draw_count, 1u);
+  alive_out[slot] = index;
+  positions[3 * slot] = position.x;
+  positions[3 * slot + 1] = position.y;
+  positions[3 * slot + 2] = position.z;
+}
@@ -0,0 +1,66 @@
+#version 430 core
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+// 節点位置(xy)だけ読むのでvec4の配列として扱う
+layout(std430, binding = 0) buffer Nodes
+{
+  readonly vec4 nodes[];
+};
+
+struct Candidate
+{
+  float distance; // カーソルからの距離の2乗(pixel単位)
+  uint index; // 節点番号
+};
+
+// workgroup毎の最近傍
+layout(std430, binding = 1) buffer Partials
+{
+  writeonly Candidate partials[];
+};
+
+uniform vec2 cursor; // カーソル位置(正規化デバイス座標)
+uniform vec2 scale; // 正規化デバイス座標 -> pixel
+uniform uint node_num; // 節点数
+uniform uint stride; // 節点1個分のvec4の個数
+
+shared float s_distance[gl_WorkGroupSize.x];
+shared uint s_index[gl_WorkGroupSize.x];
+
+void main()
+{
+  const uint lid = gl_LocalInvocationID.x;
+
+  // 担当節点中の最近傍
+  float best = 3.402823e38;
+  uint best_index = 0xffffffffu;
+  for (uint i = gl_GlobalInvocationID.x; i < node_num; i += gl_NumWorkGroups.x * gl_WorkGroupSize.x) {
+    vec2 d = (nodes[i * stride].xy - cursor) * scale;
+    float d2 = dot(d, d);
+    if (d2 < best) {
+      best = d2;
+      best_index = i;
+    }
+  }
+  s_distance[lid] = best;
+  s_index[lid] = best_index;
+
+  barrier();
+
+  // workgroup内で木構造に集計(同距離なら節点番号が小さい方)
+  for (uint s = gl_WorkGroupSize.x / 2; s > 0; s >>= 1) {
+    if (lid < s) {
+      float d = s_distance[lid + s];
+      uint j = s_index[lid + s];
+      if (d < s_distance[lid] || (d == s_distance[lid] && j < s_index[lid])) {
+	s_distance[lid] = d;
+	s_index[lid] = j;
+      }
+    }
+    barrier();
+  }
+
+  if (lid == 0) {
+    partials[gl_WorkGroupID.x] = Candidate(s_distance[0], s_index[0]);
+  }
+}
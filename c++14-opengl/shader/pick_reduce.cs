@@ -0,0 +1,59 @@
+#version 430 core
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct Candidate
+{
+  float distance; // カーソルからの距離の2乗(pixel単位)
+  uint index; // 節点番号
+};
+
+// workgroup毎の最近傍(pick.csの出力)
+layout(std430, binding = 1) buffer Partials
+{
+  readonly Candidate partials[];
+};
+
+// 最終結果(CPU側へ読み戻す)
+layout(std430, binding = 2) buffer Result
+{
+  writeonly Candidate result;
+};
+
+uniform uint partial_num; // 有効なpartialsの個数(<= 64)
+uniform float radius; // 当たり判定の半径(pixel)
+
+shared float s_distance[gl_WorkGroupSize.x];
+shared uint s_index[gl_WorkGroupSize.x];
+
+void main()
+{
+  const uint lid = gl_LocalInvocationID.x;
+
+  if (lid < partial_num) {
+    s_distance[lid] = partials[lid].distance;
+    s_index[lid] = partials[lid].index;
+  } else {
+    s_distance[lid] = 3.402823e38;
+    s_index[lid] = 0xffffffffu;
+  }
+
+  barrier();
+
+  for (uint s = gl_WorkGroupSize.x / 2; s > 0; s >>= 1) {
+    if (lid < s) {
+      float d = s_distance[lid + s];
+      uint j = s_index[lid + s];
+      if (d < s_distance[lid] || (d == s_distance[lid] && j < s_index[lid])) {
+	s_distance[lid] = d;
+	s_index[lid] = j;
+      }
+    }
+    barrier();
+  }
+
+  if (lid == 0) {
+    // 半径外なら外れ
+    bool hit = s_distance[0] <= radius * radius;
+    result = Candidate(s_distance[0], hit ? s_index[0] : 0xffffffffu);
+  }
+}
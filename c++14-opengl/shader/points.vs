@@ -1,11 +1,52 @@
 #version 330 core
+
+#ifdef PROCEDURAL
+// 頂点バッファを使わずgl_VertexIDからハッシュで位置を作る
+// (scene_pointanim.cppのdisseminate()と同じ分布)
+uniform uint seed;
+
+// 整数ハッシュ(PCG)
+uint hash(uint x)
+{
+  uint state = x * 747796405u + 2891336453u;
+  uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+  return (word >> 22u) ^ word;
+}
+
+// [0, 1)の一様乱数
+float random(inout uint state)
+{
+  state = hash(state);
+  return float(state >> 8) / 16777216.0;
+}
+
+vec3 point_position()
+{
+  uint state = hash(uint(gl_VertexID) ^ seed);
+  float r = sqrt(2.0 * random(state)); // y=x^2/2 の逆関数
+  float t = 6.283185307179586 * random(state);
+  return vec3(r * cos(t), r * sin(t), random(state));
+}
+#else
 layout (location = 0) in vec3 aPos;
 
+vec3 point_position()
+{
+  return aPos;
+}
+#endif
+
 uniform mat4 MVP;
 uniform float elapsed_time;
 
 void main()
 {
-  float z = fract(aPos.z - elapsed_time);
-  gl_Position = MVP * vec4(aPos.x * z * z, aPos.y * z * z, z, 1.f);
+#ifdef CLOUD
+  // 点群ファイルの点(動かさない)
+  gl_Position = MVP * vec4(point_position(), 1.0);
+  return;
+#endif
+  vec3 p = point_position();
+  float z = fract(p.z - elapsed_time);
+  gl_Position = MVP * vec4(p.x * z * z, p.y * z * z, z, 1.f);
 }
@@ -0,0 +1,20 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// multi-band blending(pyramid.hppのPyramid::blend)の1段
+// 2枚のLaplacian pyramidの同じ段をmaskのGaussian pyramidの同じ段で混ぜる
+// 細かい帯域ほど狭い範囲, 粗い帯域ほど広い範囲で切り替わるので継ぎ目が目立たない
+
+layout(binding = 0, rgba16f) uniform readonly image2D A;
+layout(binding = 1, rgba16f) uniform readonly image2D B;
+layout(binding = 2, rgba16f) uniform readonly image2D Mask;
+layout(binding = 3, rgba16f) uniform writeonly image2D Result;
+
+void main()
+{
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, imageSize(Result)))) {
+    return;
+  }
+  imageStore(Result, p, mix(imageLoad(A, p), imageLoad(B, p), imageLoad(Mask, p)));
+}
@@ -0,0 +1,22 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// rgba8の画像 <-> pyramidの段(RGBA16F)の変換
+// TO_RGBA8を定義すると段 -> 画像(0-1へ切り詰め)
+
+#ifdef TO_RGBA8
+layout(binding = 0, rgba16f) uniform readonly image2D Source;
+layout(binding = 1, rgba8) uniform writeonly image2D Result;
+#else
+layout(binding = 0, rgba8) uniform readonly image2D Source;
+layout(binding = 1, rgba16f) uniform writeonly image2D Result;
+#endif
+
+void main()
+{
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, imageSize(Result)))) {
+    return;
+  }
+  imageStore(Result, p, imageLoad(Source, p));
+}
@@ -0,0 +1,51 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// pyramidの1段拡大(pyramid_reduce.csの係数を0を挟んで2倍に広げたもの)
+// 偶数の画素は粗い段の3画素を(1 6 1) / 8, 奇数の画素は2画素を(1 1) / 2で補間する
+//  LAPLACIAN : Fine - expand(Coarse) (Laplacian pyramidの1段)
+//  COLLAPSE  : Fine + expand(Coarse) (Laplacian pyramidから組み立て直す)
+//  UPSAMPLE  : expand(Coarse)だけ(pyramidによるぼかし)
+// 縮小と同じ拡大を使うので, LAPLACIAN -> COLLAPSEは(RGBA16Fの丸めを除いて)元に戻る
+
+layout(binding = 0, rgba16f) uniform readonly image2D Coarse;
+#ifndef UPSAMPLE
+layout(binding = 1, rgba16f) uniform readonly image2D Fine;
+#endif
+layout(binding = 2, rgba16f) uniform writeonly image2D Result;
+
+vec4 expand(ivec2 p)
+{
+  const ivec2 size = imageSize(Coarse);
+  const ivec2 m = p >> 1;
+  const vec3 even = vec3(0.125, 0.75, 0.125);
+  const vec3 odd = vec3(0.0, 0.5, 0.5);
+  const vec3 wx = ((p.x & 1) == 0) ? even : odd;
+  const vec3 wy = ((p.y & 1) == 0) ? even : odd;
+
+  vec4 sum = vec4(0.0);
+  for (int j = 0; j < 3; ++j) {
+    vec4 row = vec4(0.0);
+    for (int i = 0; i < 3; ++i) {
+      row += wx[i] * imageLoad(Coarse, clamp(m + ivec2(i - 1, j - 1), ivec2(0), size - 1));
+    }
+    sum += wy[j] * row;
+  }
+  return sum;
+}
+
+void main()
+{
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, imageSize(Result)))) {
+    return;
+  }
+
+#if defined(LAPLACIAN)
+  imageStore(Result, p, imageLoad(Fine, p) - expand(p));
+#elif defined(COLLAPSE)
+  imageStore(Result, p, imageLoad(Fine, p) + expand(p));
+#else
+  imageStore(Result, p, expand(p));
+#endif
+}
@@ -0,0 +1,31 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// pyramidの1段縮小(Burt, Adelson "The Laplacian Pyramid as a Compact Image Code")
+// 1段下の2p付近5x5を[1 4 6 4 1] / 16の2次元でぼかして1画素にする
+// Fine, Coarseは同じテクスチャの隣り合うmip level(pyramid.hpp)
+// 画像の端は延長
+
+layout(binding = 0, rgba16f) uniform readonly image2D Fine;
+layout(binding = 1, rgba16f) uniform writeonly image2D Coarse;
+
+const float weights[5] = float[](1.0 / 16.0, 4.0 / 16.0, 6.0 / 16.0, 4.0 / 16.0, 1.0 / 16.0);
+
+void main()
+{
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, imageSize(Coarse)))) {
+    return;
+  }
+  const ivec2 size = imageSize(Fine);
+
+  vec4 sum = vec4(0.0);
+  for (int dy = -2; dy <= 2; ++dy) {
+    vec4 row = vec4(0.0);
+    for (int dx = -2; dx <= 2; ++dx) {
+      row += weights[dx + 2] * imageLoad(Fine, clamp(2 * p + ivec2(dx, dy), ivec2(0), size - 1));
+    }
+    sum += weights[dy + 2] * row;
+  }
+  imageStore(Coarse, p, sum);
+}
@@ -0,0 +1,51 @@
+#version 430 core
+// Transform Feedback版Euler法(位置と速度をinterleavedで出力)
+// 速度を先に更新する半陰的Euler法なので陽的Euler法ほどエネルギーが増えない
+
+layout (location = 0) in vec4 aPos; // 節点位置(xyz)+固定flag(w)
+layout (location = 1) in vec4 aVel; // 速度
+
+out vec4 position;
+out vec4 velocity;
+
+// 更新前の節点群
+// texelFetch(table, 2 * i)が位置, 2 * i + 1が速度
+uniform samplerBuffer table;
+
+layout (std140) uniform PhysicParams
+{
+  uint point_num; // 節点数
+  float dt; // タイムステップ
+  float m; // 節点の質量
+  float k; // ばね定数
+  float c; // ばね減衰係数
+};
+
+float l = 2.f / point_num; // 節点間の自然長
+vec2 g = vec2(0.f, -9.8f / point_num); // 重力
+
+// 隣の節点jから受ける力
+vec2 force(int j)
+{
+  vec2 d = texelFetch(table, 2 * j).xy - aPos.xy;
+  vec2 dv = aVel.xy - texelFetch(table, 2 * j + 1).xy;
+  return (length(d) - l) * k * normalize(d) - c * dv;
+}
+
+void main()
+{
+  const int i = gl_VertexID;
+
+  vec2 f = vec2(0.f);
+  if (i > 0) {
+    f += force(i - 1);
+  }
+  if (i < int(point_num) - 1) {
+    f += force(i + 1);
+  }
+  vec4 a = vec4(f / m + g, 0.f, 0.f);
+
+  float movable = step(0.5, aPos.w);
+  velocity = movable * (aVel + a * dt);
+  position = aPos + movable * vec4(velocity.xyz * dt, 0.f);
+}
@@ -0,0 +1,32 @@
+#version 430 core
+layout (local_size_x = 16, local_size_y = 16) in;
+
+// 積分画像の4点から(2 * radius + 1)^2の箱型平均
+// 画像の端では箱を画像内に切り詰めて, 中の画素数で割る
+
+layout(binding = 0, rgba32ui) uniform readonly uimage2D Table;
+layout(binding = 1, rgba8) uniform writeonly image2D ResultImage;
+
+uniform int radius;
+
+// (-1, y), (x, -1)は0
+uvec4 at(ivec2 p)
+{
+  return any(lessThan(p, ivec2(0))) ? uvec4(0) : imageLoad(Table, p);
+}
+
+void main()
+{
+  const ivec2 size = imageSize(Table);
+  const ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(p, size))) {
+    return;
+  }
+
+  const ivec2 lo = max(p - radius - 1, ivec2(-1));
+  const ivec2 hi = min(p + radius, size - 1);
+  const uvec4 sum = at(hi) - at(ivec2(lo.x, hi.y)) - at(ivec2(hi.x, lo.y)) + at(lo);
+  const float n = float((hi.x - lo.x) * (hi.y - lo.y));
+
+  imageStore(ResultImage, p, vec4(vec3(sum.rgb) / (n * 255.0), 1.0));
+}
@@ -0,0 +1,69 @@
+#version 430 core
+layout (local_size_x = 256) in;
+
+// 積分画像(summed-area table)の1行(VERTICALなら1列)分の累積和
+// 1 workgroupが1行を256画素ずつ共有メモリ上でscanし, 前の区間までの和を足して書く
+// 行方向はrgba8を0-255の整数にして読み, 列方向は行方向の結果をその場で書き換える
+// 32bitを超えた分は捨てる(4点の差を取れば箱の中の和が2^32未満なら正しく求まる)
+
+const uint N = 256;
+
+#ifdef VERTICAL
+layout(binding = 0, rgba32ui) uniform readonly uimage2D SourceImage;
+#else
+layout(binding = 0, rgba8) uniform readonly image2D SourceImage;
+#endif
+layout(binding = 1, rgba32ui) uniform writeonly uimage2D ResultImage;
+
+shared uvec4 partial[N];
+
+ivec2 pos(int line, int i)
+{
+#ifdef VERTICAL
+  return ivec2(line, i);
+#else
+  return ivec2(i, line);
+#endif
+}
+
+uvec4 load(ivec2 p)
+{
+#ifdef VERTICAL
+  return imageLoad(SourceImage, p);
+#else
+  return uvec4(round(imageLoad(SourceImage, p) * 255.0));
+#endif
+}
+
+void main()
+{
+  const ivec2 size = imageSize(ResultImage);
+#ifdef VERTICAL
+  const int len = size.y;
+#else
+  const int len = size.x;
+#endif
+  const int line = int(gl_WorkGroupID.x);
+  const uint l = gl_LocalInvocationID.x;
+
+  uvec4 carry = uvec4(0);
+  for (int base = 0; base < len; base += int(N)) {
+    const int i = base + int(l);
+    partial[l] = (i < len) ? load(pos(line, i)) : uvec4(0);
+    barrier();
+
+    // Hillis-Steele
+    for (uint offset = 1; offset < N; offset <<= 1) {
+      const uvec4 v = (l >= offset) ? partial[l - offset] : uvec4(0);
+      barrier();
+      partial[l] += v;
+      barrier();
+    }
+
+    if (i < len) {
+      imageStore(ResultImage, pos(line, i), partial[l] + carry);
+    }
+    carry += partial[N - 1];
+    barrier();
+  }
+}
@@ -0,0 +1,66 @@
+#version 430 core
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// 系全体の運動量とエネルギーの質点毎の項を求める
+// 総和はGpuReduceで取る(U_ijはj > iの分だけ持つので二重に数えない)
+// ついでに太陽(初期状態で0番)の位置と速度をinfo[1], info[2]へ
+
+// 質点
+struct Point
+{
+  float mass; // 質量
+  uint id; // 初期状態での番号
+  vec3 position; // 位置
+  vec3 velocity; // 速度
+  vec3 position_temp;
+  vec3 velocity_temp;
+};
+
+layout (std140) uniform PhysicParams
+{
+  uint point_num; // 質点数
+  float dt; // タイムステップ
+  float g; // 重力加速度
+  float r_threshold; // 引力が発生する距離の閾値
+};
+
+layout(std430, binding = 0) buffer ReadPoints
+{
+  readonly Point points[];
+};
+
+// 質点毎の(運動量, 運動エネルギー + 位置エネルギー)
+layout(std430, binding = 1) buffer Terms
+{
+  writeonly vec4 terms[];
+};
+
+layout(std430, binding = 2) buffer Info
+{
+  writeonly vec4 info[];
+};
+
+void main()
+{
+  const uint i = gl_GlobalInvocationID.x;
+  if (i >= point_num) {
+    return;
+  }
+
+  const float mass = points[i].mass;
+  const vec3 position = points[i].position;
+  const vec3 velocity = points[i].velocity;
+
+  float e = 0.5 * mass * dot(velocity, velocity);
+  for (uint j = i + 1; j < point_num; ++j) {
+    // 位置エネルギーは距離=閾値の時の値を最小値とする
+    float r = max(length(points[j].position - position), r_threshold);
+    e += g * mass * points[j].mass / r;
+  }
+  terms[i] = vec4(mass * velocity, e);
+
+  if (points[i].id == 0u) {
+    info[1] = vec4(position, 1.0);
+    info[2] = vec4(velocity, 0.0);
+  }
+}
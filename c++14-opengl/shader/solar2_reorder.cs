@@ -0,0 +1,87 @@
+#version 430 core
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// 質点を位置のMorton順に並べ直す
+//  stage 0 : (Mortonキー, 質点番号)を作る
+//  (GpuRadixSortで並べ替え)
+//  stage 1 : 並べ替えた順に質点を集める
+// 太陽は番号ではなくidで探すので並べ替えても困らない
+
+// 質点
+struct Point
+{
+  float mass; // 質量
+  uint id; // 初期状態での番号
+  vec3 position; // 位置
+  vec3 velocity; // 速度
+  vec3 position_temp;
+  vec3 velocity_temp;
+};
+
+layout (std140) uniform PhysicParams
+{
+  uint point_num; // 質点数
+  float dt; // タイムステップ
+  float g; // 重力加速度
+  float r_threshold; // 引力が発生する距離の閾値
+};
+
+layout(std430, binding = 0) buffer ReadPoints
+{
+  readonly Point current_points[];
+};
+
+layout(std430, binding = 1) buffer WritePoints
+{
+  writeonly Point next_points[];
+};
+
+layout(std430, binding = 2) buffer Keys
+{
+  writeonly uint keys[];
+};
+
+// 質点番号(stage 1では並べ替え済み)
+layout(std430, binding = 3) buffer Values
+{
+  uint values[];
+};
+
+uniform uint stage;
+
+// Mortonキーを求める範囲(太陽の周り, 外側は端に寄せる)
+uniform vec3 bounds_min;
+uniform vec3 bounds_max;
+
+// 10bitを3bit間隔に広げる
+uint expand_bits(uint v)
+{
+  v = (v * 0x00010001u) & 0xff0000ffu;
+  v = (v * 0x00000101u) & 0x0f00f00fu;
+  v = (v * 0x00000011u) & 0xc30c30c3u;
+  v = (v * 0x00000005u) & 0x49249249u;
+  return v;
+}
+
+// 30bitのMortonキー
+uint morton(vec3 p)
+{
+  vec3 t = clamp((p - bounds_min) / (bounds_max - bounds_min), 0.0, 1.0);
+  uvec3 q = uvec3(min(t * 1024.0, vec3(1023.0)));
+  return (expand_bits(q.x) << 2) | (expand_bits(q.y) << 1) | expand_bits(q.z);
+}
+
+void main()
+{
+  const uint i = gl_GlobalInvocationID.x;
+  if (i >= point_num) {
+    return;
+  }
+
+  if (stage == 0u) {
+    keys[i] = morton(current_points[i].position);
+    values[i] = i;
+  } else {
+    next_points[i] = current_points[values[i]];
+  }
+}
@@ -5,6 +5,7 @@ layout(local_size_x = 1, local_size_y = 1, local_size_z = 1)in;
 struct Point
 {
   float mass; // 質量
+  uint id; // 初期状態での番号(並べ替えても変わらない)
   vec3 position; // 位置 p(h)
   vec3 velocity; // 速度 v(h)
   vec3 position_temp; // p(t+h)
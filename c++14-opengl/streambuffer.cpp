@@ -0,0 +1,88 @@
+#include <cassert>
+
+#include <glad/glad.h>
+
+#include "streambuffer.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    StreamBuffer::StreamBuffer(GLsizeiptr segment_size, unsigned segment_num)
+      : buffer_(), fences_(segment_num, nullptr),
+	segment_size_(segment_size), current_(0), mapped_(false)
+    {
+      assert(segment_num > 0);
+      buffer_.bind(GL_COPY_WRITE_BUFFER);
+      glBufferData(GL_COPY_WRITE_BUFFER, segment_size_ * segment_num, nullptr, GL_STREAM_DRAW);
+      check_gl_error(__FILE__, __LINE__);
+    }
+
+    StreamBuffer::~StreamBuffer()
+    {
+      for (auto& f : fences_) {
+	if (f) {
+	  glDeleteSync(f);
+	}
+      }
+    }
+
+    // i番目の区画のfenceをtimeout(ns)まで待つ
+    bool StreamBuffer::wait(unsigned i, GLuint64 timeout)
+    {
+      if (!fences_[i]) {
+	return true;
+      }
+      GLenum status = glClientWaitSync(fences_[i], GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+      if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+	return false;
+      }
+      glDeleteSync(fences_[i]);
+      fences_[i] = nullptr;
+      return true;
+    }
+
+    bool StreamBuffer::ready()
+    {
+      return wait(current_, 0);
+    }
+
+    void* StreamBuffer::map()
+    {
+      assert(!mapped_);
+
+      // 区画数をフレーム遅延より多くしておけば普通は待たない
+      while (!wait(current_, 1000000)) {
+      }
+
+      buffer_.bind(GL_COPY_WRITE_BUFFER);
+      void* p = glMapBufferRange(GL_COPY_WRITE_BUFFER, segment_size_ * current_, segment_size_,
+				 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+				 GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+      mapped_ = (p != nullptr);
+      check_gl_error(__FILE__, __LINE__);
+
+      return p;
+    }
+
+    GLintptr StreamBuffer::unmap(GLsizeiptr written)
+    {
+      assert(mapped_ && written <= segment_size_);
+
+      buffer_.bind(GL_COPY_WRITE_BUFFER);
+      if (written > 0) {
+	glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, 0, written);
+      }
+      glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+      mapped_ = false;
+
+      return segment_size_ * current_;
+    }
+
+    void StreamBuffer::fence()
+    {
+      assert(!fences_[current_]);
+      fences_[current_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      current_ = (current_ + 1) % fences_.size();
+    }
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef INCLUDED_STREAMBUFFER_HPP
+#define INCLUDED_STREAMBUFFER_HPP
+
+#include <vector>
+#include <glad/glad.h>
+
+#include "globject.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // CPU -> GPU転送用のリングバッファ
+    // 1個のバッファをsegment_num個の区画に分けて順番に使い回す
+    //
+    // 本来ならglBufferStorage + 永続mapを使いたいところだが
+    // OpenGL 4.3 coreの範囲で済ませる為に
+    // 区画毎にGL_MAP_UNSYNCHRONIZED_BITでmapしてfenceで再利用可否を判定する
+    // (GPUが読み終えていない区画に書き込まない限りドライバの暗黙の同期は入らない)
+    //
+    // 使い方
+    // void* p = sb.map(); ...書き込み...; GLintptr offset = sb.unmap(bytes);
+    // ...offsetから読むGPUコマンドを発行...; sb.fence();
+    class StreamBuffer {
+    public:
+      StreamBuffer(GLsizeiptr segment_size, unsigned segment_num = 3);
+      ~StreamBuffer();
+
+      StreamBuffer(const StreamBuffer&) = delete;
+      StreamBuffer& operator=(const StreamBuffer&) = delete;
+      StreamBuffer(StreamBuffer&&) = delete;
+      StreamBuffer& operator=(StreamBuffer&&) = delete;
+
+      // 次の区画を書き込み用にmapする(GPUが使用中なら空くまで待つ)
+      void* map();
+      // 先頭からwrittenバイトを確定してunmapし、その区画のバッファ内offsetを返す
+      GLintptr unmap(GLsizeiptr written);
+      // 直前にunmapした区画を読むGPUコマンドを発行した後に呼ぶ
+      void fence();
+      // 次にmapする区画がGPU使用中でなければtrue(待たない)
+      bool ready();
+
+      GLuint handle() const noexcept { return buffer_.handle(); }
+      GLsizeiptr segment_size() const noexcept { return segment_size_; }
+    private:
+      gl::Buffer buffer_;
+      std::vector<GLsync> fences_;
+      const GLsizeiptr segment_size_;
+      unsigned current_; // 現在書き込み中の区画
+      bool mapped_;
+
+      bool wait(unsigned, GLuint64);
+    };
+  }
+}
+
+#endif // INCLUDED_STREAMBUFFER_HPP
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <tuple>
 #define STB_IMAGE_IMPLEMENTATION
@@ -28,12 +29,14 @@ namespace nekolib {
       GLenum type_;
       GLenum iformat_;
       int w_, h_;
+      int levels_;
       gl::Texture texture_;
     public:
       // 空2Dテクスチャ
       // RenderTarget(=FBO)で書き込んで後にシェーダーでsampler2Dで読むのが定跡
-      Impl(int w, int h, TextureFormat tf)
-	: type_(0), w_(0), h_(0), texture_() {
+      // levelsを指定するとmipmap付きのimmutable(glTexStorage2D)
+      Impl(int w, int h, TextureFormat tf, int levels = 0)
+	: type_(0), w_(0), h_(0), levels_(1), texture_() {
 	texture_.bind(0, GL_TEXTURE_2D);
 	GLenum table[][3] =
 	  {
@@ -42,12 +45,14 @@ namespace nekolib {
 	   { GL_R16UI, GL_RED_INTEGER, GL_UNSIGNED_INT }, 
 	   { GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT }, 
 	   { GL_R32F, GL_RED, GL_FLOAT },
+	   { GL_RG16F, GL_RG, GL_FLOAT },
 	   { GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE },
 	   { GL_RGB16F, GL_RGB, GL_FLOAT },
 	   { GL_RGB32F, GL_RGB, GL_FLOAT },
 	   { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE },
 	   { GL_RGBA16F, GL_RGBA, GL_FLOAT },
 	   { GL_RGBA32F, GL_RGBA, GL_FLOAT },
+	   { GL_RGBA32UI, GL_RGBA_INTEGER, GL_UNSIGNED_INT },
 	   { GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT },
 	   //{ GL_DEPTH_COMPONENT32, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT },
 	   { GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT },
@@ -58,8 +63,16 @@ namespace nekolib {
 	
 	if (tf != TextureFormat::INVALID) {
 	  size_t index = static_cast<size_t>(tf);
-	  glTexImage2D(GL_TEXTURE_2D, 0, table[index][0], w, h, 0, table[index][1], table[index][2], nullptr);
-	  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	  if (levels == 0) {
+	    glTexImage2D(GL_TEXTURE_2D, 0, table[index][0], w, h, 0, table[index][1], table[index][2], nullptr);
+	    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	  } else {
+	    const int max_levels = static_cast<int>(calc_mipmap_levels(w, h));
+	    levels = (levels < 0 || levels > max_levels) ? max_levels : levels;
+	    glTexStorage2D(GL_TEXTURE_2D, levels, table[index][0], w, h);
+	    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+	    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	  }
 	  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -69,6 +82,7 @@ namespace nekolib {
 	    type_ = GL_TEXTURE_2D;
 	    iformat_ = table[index][0];
 	    w_ = w; h_ = h;
+	    levels_ = std::max(levels, 1);
 	  }
 	}
 
@@ -76,7 +90,7 @@ namespace nekolib {
       
       // 一枚絵2Dテクスチャをファイルから読みこみ
       Impl(const char* filename, bool immutable, bool flipped)
-	: type_(0), w_(0), h_(0), texture_() {
+	: type_(0), w_(0), h_(0), levels_(1), texture_() {
 	if (flipped) {
 	  stbi_set_flip_vertically_on_load(true);
 	}
@@ -87,6 +101,14 @@ namespace nekolib {
 	  return;
 	}
 	stbi_set_flip_vertically_on_load(false);
+	GLint max_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	if (width > max_size || height > max_size) {
+	  // 大きな画像はtiled.hppのTiledFilterでタイルに分けて処理する
+	  fprintf(stderr, "%s : %dx%d exceeds GL_MAX_TEXTURE_SIZE(%d).\n", filename, width, height, max_size);
+	  stbi_image_free(data);
+	  return;
+	}
 
 	GLenum iformat, format, wrap;
 	switch (components) {
@@ -132,12 +154,13 @@ namespace nekolib {
 	  type_ = GL_TEXTURE_2D;
 	  iformat_ = iformat;
 	  w_ = width; h_ = height;
+	  levels_ = static_cast<int>(calc_mipmap_levels(width, height));
 	}
       }
       // キューブマップを同サイズ6枚絵から作成
       // 画像サイズはあまり使わないしチェック緩い
       Impl(const char** cubemap_filenames)
-	: type_(0), w_(0), h_(0), texture_() {
+	: type_(0), w_(0), h_(0), levels_(1), texture_() {
 	texture_.bind(0, GL_TEXTURE_CUBE_MAP);
 
 	GLuint targets[] = {
@@ -209,6 +232,16 @@ namespace nekolib {
       return r;
     }
 
+    Texture Texture::create(int w, int h, TextureFormat tf, int levels)
+    {
+      Texture r;
+      r.impl_ = new Texture::Impl(w, h, tf, (levels <= 0) ? -1 : levels);
+      if (!r.impl_->valid()) {
+	SAFE_DELETE(r.impl_);
+      }
+      return r;
+    }
+
     Texture Texture::create(const char* filename, bool immutable, bool flipped)
     {
       Texture r;
@@ -259,6 +292,12 @@ namespace nekolib {
       return impl_->h_;
     }
 
+    int Texture::levels() const noexcept
+    {
+      assert(impl_);
+      return impl_->levels_;
+    }
+
     GLuint Texture::handle() const noexcept
     {      
       assert(impl_);
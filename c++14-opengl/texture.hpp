@@ -10,12 +10,14 @@ namespace nekolib {
 			       RED16,    // 16bit uint
 			       RED32,    // 32bit uint
 			       RED32F,   // 32bit float
+			       RG16F,    // R,G each 16bit float
 			       RGB8,     // R,G,B each 0-255
 			       RGB16F,   // R,G,B each 16bit float
 			       RGB32F,   // R,G,B each 32bit float
 			       RGBA8,    // R,G,B,A each 0-255
 			       RGBA16F,  // R,G,B,A each 16bit float
 			       RGBA32F,  // R,G,B,A each 32bit float
+			       RGBA32UI, // R,G,B,A each 32bit uint
 			       DEPTH24,  // depth 24bit uint
 			       // DEPTH32, // depth 32bit uint
 			       DEPTH32F, // depth 32bit float
@@ -28,6 +30,9 @@ namespace nekolib {
     public:
       // 空2Dテクスチャ (RenderTarget(=FBO)等で使用)
       static Texture create(int width, int height, TextureFormat tf);
+      // mipmapをlevels段持つ空2Dテクスチャ(immutable, levels <= 0なら1x1まで)
+      // 各段はglBindImageTextureのlevelで個別に読み書きする(pyramid.hpp等)
+      static Texture create(int width, int height, TextureFormat tf, int levels);
       // 一枚絵からロードされる2Dテクスチャ
       // mipmapは自動生成される
       // immutable=trueは要OpenGL 4.2以上
@@ -43,6 +48,7 @@ namespace nekolib {
       GLenum iformat() const noexcept;
       int width() const noexcept;
       int height() const noexcept;
+      int levels() const noexcept; // mipmapの段数
       GLuint handle() const noexcept;
       
       // 以下、参照回数計測クラスのテンプレート関数
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+
+#include <sys/types.h>
+
+#include "tiled.hpp"
+#include "utils.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    bool CpuImageSource::read(int x, int y, int w, int h, unsigned char* rgba)
+    {
+      for (int r = 0; r < h; ++r) {
+	memcpy(rgba + static_cast<size_t>(r) * w * 4, image_.row(y + r) + static_cast<size_t>(x) * 4,
+	       static_cast<size_t>(w) * 4);
+      }
+      return true;
+    }
+
+    bool CpuImageSink::write(int x, int y, int w, int h, const unsigned char* rgba, int stride)
+    {
+      assert(x + w <= image_.width && y + h <= image_.height);
+      for (int r = 0; r < h; ++r) {
+	memcpy(image_.row(y + r) + static_cast<size_t>(x) * 4, rgba + static_cast<size_t>(r) * stride * 4,
+	       static_cast<size_t>(w) * 4);
+      }
+      return true;
+    }
+
+    // PPMのヘッダの数値を1個読む(#から行末まではコメント)
+    static bool read_header_value(FILE* fp, int* value)
+    {
+      int c = fgetc(fp);
+      for (;;) {
+	if (c == '#') {
+	  while (c != '\n' && c != EOF) {
+	    c = fgetc(fp);
+	  }
+	} else if (isspace(c)) {
+	  c = fgetc(fp);
+	} else {
+	  break;
+	}
+      }
+      if (!isdigit(c)) {
+	return false;
+      }
+      long long v = 0;
+      while (isdigit(c)) {
+	v = v * 10 + (c - '0');
+	if (v > 0x7fffffff) {
+	  return false;
+	}
+	c = fgetc(fp);
+      }
+      // 数値の直後の空白1文字までがヘッダ
+      if (c == EOF || !isspace(c)) {
+	return false;
+      }
+      *value = static_cast<int>(v);
+      return true;
+    }
+
+    PpmReader::~PpmReader()
+    {
+      if (fp_) {
+	fclose(fp_);
+      }
+    }
+
+    bool PpmReader::open(const std::string& filename)
+    {
+      fp_ = fopen(filename.c_str(), "rb");
+      if (!fp_) {
+	fprintf(stderr, "Can't open %s.\n", filename.c_str());
+	return false;
+      }
+      int maxval = 0;
+      if (fgetc(fp_) != 'P' || fgetc(fp_) != '6' ||
+	  !read_header_value(fp_, &width_) || !read_header_value(fp_, &height_) ||
+	  !read_header_value(fp_, &maxval) || maxval != 255 || width_ <= 0 || height_ <= 0) {
+	fprintf(stderr, "%s is not 8bit binary PPM(P6).\n", filename.c_str());
+	fclose(fp_);
+	fp_ = nullptr;
+	return false;
+      }
+      offset_ = ftello(fp_);
+      return true;
+    }
+
+    bool PpmReader::read(int x, int y, int w, int h, unsigned char* rgba)
+    {
+      row_.resize(static_cast<size_t>(w) * 3);
+      for (int r = 0; r < h; ++r) {
+	const long long pos = offset_ + (static_cast<long long>(y + r) * width_ + x) * 3;
+	if (fseeko(fp_, static_cast<off_t>(pos), SEEK_SET) != 0 || fread(row_.data(), 3, w, fp_) != static_cast<size_t>(w)) {
+	  fprintf(stderr, "PPM read error at line %d.\n", y + r);
+	  return false;
+	}
+	unsigned char* d = rgba + static_cast<size_t>(r) * w * 4;
+	for (int i = 0; i < w; ++i) {
+	  d[i * 4 + 0] = row_[i * 3 + 0];
+	  d[i * 4 + 1] = row_[i * 3 + 1];
+	  d[i * 4 + 2] = row_[i * 3 + 2];
+	  d[i * 4 + 3] = 255;
+	}
+      }
+      return true;
+    }
+
+    PpmWriter::~PpmWriter()
+    {
+      close();
+    }
+
+    bool PpmWriter::create(const std::string& filename, int width, int height)
+    {
+      fp_ = fopen(filename.c_str(), "wb");
+      if (!fp_) {
+	fprintf(stderr, "Can't create %s.\n", filename.c_str());
+	return false;
+      }
+      fprintf(fp_, "P6\n%d %d\n255\n", width, height);
+      offset_ = ftello(fp_);
+      width_ = width;
+      return true;
+    }
+
+    bool PpmWriter::write(int x, int y, int w, int h, const unsigned char* rgba, int stride)
+    {
+      row_.resize(static_cast<size_t>(w) * 3);
+      for (int r = 0; r < h; ++r) {
+	const unsigned char* s = rgba + static_cast<size_t>(r) * stride * 4;
+	for (int i = 0; i < w; ++i) {
+	  row_[i * 3 + 0] = s[i * 4 + 0];
+	  row_[i * 3 + 1] = s[i * 4 + 1];
+	  row_[i * 3 + 2] = s[i * 4 + 2];
+	}
+	const long long pos = offset_ + (static_cast<long long>(y + r) * width_ + x) * 3;
+	if (fseeko(fp_, static_cast<off_t>(pos), SEEK_SET) != 0 || fwrite(row_.data(), 3, w, fp_) != static_cast<size_t>(w)) {
+	  fprintf(stderr, "PPM write error at line %d.\n", y + r);
+	  return false;
+	}
+      }
+      return true;
+    }
+
+    bool PpmWriter::close()
+    {
+      if (!fp_) {
+	return true;
+      }
+      const bool ok = (fclose(fp_) == 0);
+      fp_ = nullptr;
+      return ok;
+    }
+
+    TiledFilter::TiledFilter(int tile_size) : halo_(0), tiles_(0)
+    {
+      GLint max_size = 0;
+      glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+      tile_size_ = std::min(tile_size, static_cast<int>(max_size));
+    }
+
+    bool TiledFilter::retrieve(Pending& p, TileSink& dst)
+    {
+      while (glClientWaitSync(p.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED) {
+      }
+      glDeleteSync(p.fence);
+      p.fence = nullptr;
+
+      p.pbo.bind(GL_PIXEL_PACK_BUFFER);
+      const auto bytes = static_cast<GLsizeiptr>(p.tex_w) * p.tex_h * 4;
+      const auto* pixels = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT));
+      // テクスチャ内の書き出す範囲の左上から
+      const bool ok = dst.write(p.x, p.y, p.w, p.h, pixels + (static_cast<size_t>(p.oy) * p.tex_w + p.ox) * 4, p.tex_w);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+      return ok;
+    }
+
+    bool TiledFilter::process(const std::vector<FilterNode*>& chain, TileSource& src, TileSink& dst)
+    {
+      halo_ = 0;
+      tiles_ = 0;
+      for (auto node : chain) {
+	const int f = node->footprint();
+	if (f < 0) {
+	  fprintf(stderr, "TiledFilter : filter depends on whole image.\n");
+	  return false;
+	}
+	halo_ += f;
+      }
+
+      // 画像がタイルに収まる向きは分割しない
+      const int width = src.width();
+      const int height = src.height();
+      const int tex_w = std::min(tile_size_, width);
+      const int tex_h = std::min(tile_size_, height);
+      const int step_x = (tex_w == width) ? width : tex_w - 2 * halo_;
+      const int step_y = (tex_h == height) ? height : tex_h - 2 * halo_;
+      if (step_x <= 0 || step_y <= 0) {
+	fprintf(stderr, "TiledFilter : halo %d is too large for tile size %d.\n", halo_, tile_size_);
+	return false;
+      }
+
+      if (!source_ || source_.width() != tex_w || source_.height() != tex_h) {
+	source_ = Texture::create(tex_w, tex_h, TextureFormat::RGBA8);
+      }
+      graph_.set_source(source_);
+      graph_.set_chain(chain);
+      upload_.resize(static_cast<size_t>(tex_w) * tex_h * 4);
+      const GLsizeiptr bytes = static_cast<GLsizeiptr>(upload_.size());
+
+      bool ok = true;
+      int k = 0;
+      for (int y = 0; ok && y < height; y += step_y) {
+	for (int x = 0; ok && x < width; x += step_x) {
+	  // 内側[x, x + step)の周囲halo分を読むが, 画像からはみ出す時はずらす
+	  const int x0 = std::max(0, std::min(x - halo_, width - tex_w));
+	  const int y0 = std::max(0, std::min(y - halo_, height - tex_h));
+	  if (!src.read(x0, y0, tex_w, tex_h, upload_.data())) {
+	    ok = false;
+	    break;
+	  }
+	  source_.bind(0);
+	  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex_w, tex_h, GL_RGBA, GL_UNSIGNED_BYTE, upload_.data());
+	  graph_.touch_source();
+	  const Texture& result = graph_.evaluate();
+
+	  // image storeの結果をglGetTexImageで読む
+	  glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+	  Pending& p = pending_[k % 2];
+	  p.pbo.bind(GL_PIXEL_PACK_BUFFER);
+	  if (p.size < bytes) {
+	    glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+	    p.size = bytes;
+	  }
+	  result.bind(0);
+	  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	  p.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	  p.tex_w = tex_w;
+	  p.tex_h = tex_h;
+	  p.x = x;
+	  p.y = y;
+	  p.w = std::min(step_x, width - x);
+	  p.h = std::min(step_y, height - y);
+	  p.ox = x - x0;
+	  p.oy = y - y0;
+	  ++tiles_;
+	  ++k;
+
+	  // このタイルをGPUで計算している間に1つ前のタイルを書き出す
+	  Pending& prev = pending_[k % 2];
+	  if (prev.fence && !retrieve(prev, dst)) {
+	    ok = false;
+	  }
+	}
+      }
+      for (auto& p : pending_) {
+	if (p.fence && !retrieve(p, dst)) {
+	  ok = false;
+	}
+      }
+      check_gl_error(__FILE__, __LINE__);
+
+      return ok;
+    }
+  }
+}
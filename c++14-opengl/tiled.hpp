@@ -0,0 +1,148 @@
+#ifndef INCLUDED_TILED_HPP
+#define INCLUDED_TILED_HPP
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+#include "texture.hpp"
+#include "globject.hpp"
+#include "filtergraph.hpp"
+#include "cpufilter.hpp"
+
+namespace nekolib {
+  namespace renderer {
+    // タイル単位で読み出せるrgba8画像
+    class TileSource {
+    public:
+      virtual ~TileSource() = default;
+      virtual int width() const = 0;
+      virtual int height() const = 0;
+      // (x, y)からw x hを行優先でrgbaへ
+      virtual bool read(int x, int y, int w, int h, unsigned char* rgba) = 0;
+    };
+
+    // タイル単位で書き込めるrgba8画像
+    class TileSink {
+    public:
+      virtual ~TileSink() = default;
+      // rgbaは1行stride画素で並んだw x h
+      virtual bool write(int x, int y, int w, int h, const unsigned char* rgba, int stride) = 0;
+    };
+
+    // メモリ上の画像から読む
+    class CpuImageSource : public TileSource {
+    public:
+      explicit CpuImageSource(const CpuImage& image) : image_(image) {}
+      int width() const override { return image_.width; }
+      int height() const override { return image_.height; }
+      bool read(int x, int y, int w, int h, unsigned char* rgba) override;
+    private:
+      const CpuImage& image_;
+    };
+
+    // メモリ上の画像へ組み立てる(imageは元画像と同じ大きさにしておく)
+    class CpuImageSink : public TileSink {
+    public:
+      explicit CpuImageSink(CpuImage& image) : image_(image) {}
+      bool write(int x, int y, int w, int h, const unsigned char* rgba, int stride) override;
+    private:
+      CpuImage& image_;
+    };
+
+    // binary PPM(P6, 最大値255)のファイルから必要な行だけ読む(alphaは255)
+    // 画像全体はメモリに載せない
+    class PpmReader : public TileSource {
+    public:
+      PpmReader() = default;
+      ~PpmReader();
+      PpmReader(const PpmReader&) = delete;
+      PpmReader& operator=(const PpmReader&) = delete;
+
+      bool open(const std::string& filename);
+      int width() const override { return width_; }
+      int height() const override { return height_; }
+      bool read(int x, int y, int w, int h, unsigned char* rgba) override;
+    private:
+      FILE* fp_ = nullptr;
+      long long offset_ = 0; // 画素データの先頭
+      int width_ = 0;
+      int height_ = 0;
+      std::vector<unsigned char> row_;
+    };
+
+    // binary PPM(P6)へタイル毎に直接書き込む(alphaは捨てる)
+    // 各行の位置は決まっているのでタイルの順序は自由
+    class PpmWriter : public TileSink {
+    public:
+      PpmWriter() = default;
+      ~PpmWriter();
+      PpmWriter(const PpmWriter&) = delete;
+      PpmWriter& operator=(const PpmWriter&) = delete;
+
+      bool create(const std::string& filename, int width, int height);
+      bool write(int x, int y, int w, int h, const unsigned char* rgba, int stride) override;
+      bool close();
+    private:
+      FILE* fp_ = nullptr;
+      long long offset_ = 0;
+      int width_ = 0;
+      std::vector<unsigned char> row_;
+    };
+
+    // GL_MAX_TEXTURE_SIZEを超える画像をタイルに分けてFilterGraphの連結にかける
+    //
+    // 各タイルは連結したフィルタのfootprintの合計(halo)だけ周囲を余分に読み
+    // 計算後に内側だけを書き出す. footprintが正確な局所フィルタ(畳み込み, メディアン,
+    // 形態学的処理など)だけなら継ぎ目も画像全体を一度に処理した場合と一致するが,
+    // 縮小の格子がタイルの位置で変わるPyramidBlurFilterやBilateralFilterを含むと
+    // 継ぎ目で僅かに値がずれる(footprintは影響の大半が届く範囲の目安)
+    // テクスチャの大きさは常にtile_size四方(画像の端ではタイルを内側へずらして
+    // テクスチャの端を画像の端に合わせる)なので, 端の扱いも全体処理と同じで
+    // GPU側の使用量もタイル数によらずFilterGraphの段数 + 1枚分
+    //
+    // 読み戻しはPBO 2枚を交互に使い, タイルkの計算中にタイルk - 1を書き出す
+    // CPU側の使用量も転送用のタイル1枚分(+ PBO 2枚)
+    class TiledFilter {
+    public:
+      // tile_sizeはGL_MAX_TEXTURE_SIZEで頭打ち
+      explicit TiledFilter(int tile_size = 2048);
+      ~TiledFilter() = default;
+
+      TiledFilter(const TiledFilter&) = delete;
+      TiledFilter& operator=(const TiledFilter&) = delete;
+
+      // chainをsrc全体にかけてdstへ
+      // 画像全体に依存するフィルタを含む時やhaloがタイルに対して大き過ぎる時はfalse
+      bool process(const std::vector<FilterNode*>& chain, TileSource& src, TileSink& dst);
+
+      int tile_size() const noexcept { return tile_size_; }
+      // 直近のprocessのhaloとタイル数
+      int halo() const noexcept { return halo_; }
+      int tiles() const noexcept { return tiles_; }
+    private:
+      // 読み戻し中のタイル
+      struct Pending {
+	gl::Buffer pbo;
+	GLsizeiptr size = 0;
+	GLsync fence = nullptr;
+	int tex_w = 0, tex_h = 0;
+	int x = 0, y = 0, w = 0, h = 0; // 書き出す範囲
+	int ox = 0, oy = 0; // テクスチャ内での位置
+      };
+
+      int tile_size_;
+      int halo_;
+      int tiles_;
+      FilterGraph graph_;
+      Texture source_;
+      std::vector<unsigned char> upload_;
+      Pending pending_[2];
+
+      bool retrieve(Pending& p, TileSink& dst);
+    };
+  }
+}
+
+#endif // INCLUDED_TILED_HPP
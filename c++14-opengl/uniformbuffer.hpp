@@ -3,6 +3,7 @@
 
 #include <cstddef>
 #include <cassert>
+#include <cstring>
 #include <glad/glad.h>
 
 #include "globject.hpp"
@@ -11,13 +12,13 @@ namespace nekolib {
   namespace renderer {
     /* C++側で
        struct T {
-         alignas(x) 構造体Tのメンバ
+	 alignas(x) 構造体Tのメンバ
        };
        と宣言して
        shaderからは
        layout (std140) uniform Name
        {
-         構造体Tのメンバ
+	 構造体Tのメンバ
        };
        という形でアクセスされることを想定したUniform Buffer Object
      */
@@ -76,8 +77,8 @@ namespace nekolib {
     /* Tを組み込み型 or 構造体として
        shader側で
        layout (std140) uniform Name {
-         uint size; // 有効要素数
-         T data[max_size_];  // 配列本体
+	 uint size; // 有効要素数
+	 T data[max_size_];  // 配列本体
        };
        と宣言してアクセスされることを想定したUniform Buffer Object */
     template <typename T, size_t Align = 16>